@@ -0,0 +1,135 @@
+#include "beat_scheduler.h"
+#include "hal.h"
+#include "serial_dump.h"
+#include "step_timer.h"
+
+#include <stdio.h>
+
+uint32_t beatScaleQ16 = BEAT_SCALE_ONE;
+
+static unsigned long periodMicros = 1000000UL;
+static unsigned long beatStartMicros = 0;   // When the beat in progress started
+static unsigned long nextSlotMicros = 0;    // When the next beat is due
+static unsigned long scheduleDwell = 0;     // Dwells the beat in progress queued itself
+static unsigned long closedDwell = 0;       // scheduleDwell of the beat last closed
+static bool boundaryOpen = false;           // Dwell for this boundary still being queued
+static unsigned long dwellRemaining = 0;
+static bool reportEnabled = false;
+
+static BeatReport lastBeat;
+
+void beatSchedulerBegin(unsigned long period) {
+  periodMicros = period;
+  beatStartMicros = micros();
+  nextSlotMicros = beatStartMicros + periodMicros;
+  beatScaleQ16 = BEAT_SCALE_ONE;
+  scheduleDwell = 0;
+  boundaryOpen = false;
+  dwellRemaining = 0;
+  lastBeat = BeatReport{};
+  lastBeat.start = beatStartMicros;
+}
+
+void beatSchedulerSetPeriod(unsigned long period) {
+  nextSlotMicros = beatStartMicros + period;
+  periodMicros = period;
+}
+
+unsigned long beatSchedulerPeriod() {
+  return periodMicros;
+}
+
+void beatSchedulerScheduleDwell(unsigned long micros) {
+  scheduleDwell += micros;
+}
+
+void beatReportToggle() {
+  reportEnabled = !reportEnabled;
+}
+
+const BeatReport& beatSchedulerLastBeat() {
+  return lastBeat;
+}
+
+static size_t formatBeat(uint8_t, char* line, size_t size) {
+  int length = snprintf(line, size, "B %lu period=%lu err=%ld late=%lu dwell=%lu active=%lu scale=%lu", lastBeat.beat,
+                        lastBeat.period, lastBeat.error, lastBeat.late, lastBeat.dwell, lastBeat.active,
+                        static_cast<unsigned long>(lastBeat.scale));
+  return length < static_cast<int>(size) ? length : size;
+}
+
+// Ends the beat that just finished and works out how long to dwell
+static void closeBeat() {
+  const unsigned long now = micros();
+  const unsigned long active = now - beatStartMicros - scheduleDwell;
+  const long untilSlot = static_cast<long>(nextSlotMicros - now);
+  unsigned long start = now;
+  dwellRemaining = 0;
+  if (untilSlot >= static_cast<long>(MIN_STEP_INTERVAL_US)) {
+    dwellRemaining = untilSlot;
+    start = nextSlotMicros;
+  } else if (untilSlot <= -static_cast<long>(periodMicros)) {
+    nextSlotMicros = now;  // Too far behind to catch up; re-anchor
+  }
+
+  lastBeat.beat++;
+  lastBeat.start = start;
+  lastBeat.period = start - beatStartMicros;
+  lastBeat.error = static_cast<long>(lastBeat.period - periodMicros);
+  lastBeat.late = untilSlot > 0 ? 0 : start - nextSlotMicros;  // Started just short of its slot: not late
+  lastBeat.dwell = dwellRemaining;
+  lastBeat.active = active;
+  beatStartMicros = start;
+  closedDwell = scheduleDwell;
+  scheduleDwell = 0;
+  nextSlotMicros += periodMicros;
+}
+
+// Rescales the step intervals so the next beat's motion fits the period. Runs
+// after the dwell is queued, so the 64-bit division never delays the next beat.
+static void updateScale() {
+  const unsigned long active = lastBeat.active;
+  // Fit the motion into the period minus a guard band, and the whole beat with
+  // its schedule's dwells (scaled along with it) into the period less what it
+  // is behind schedule, down to the guarded period; never stretch it
+  const unsigned long target = periodMicros - (periodMicros >> BEAT_GUARD_SHIFT);
+  uint64_t scale = static_cast<uint64_t>(beatScaleQ16) * target / (active != 0 ? active : 1);
+  if (closedDwell != 0) {
+    const unsigned long late = lastBeat.late;
+    const unsigned long wholeTarget = late < periodMicros - target ? periodMicros - late : target;
+    const uint64_t whole = static_cast<uint64_t>(beatScaleQ16) * wholeTarget / (active + closedDwell);
+    scale = whole < scale ? whole : scale;
+  }
+  if (scale > BEAT_SCALE_ONE) {
+    scale = BEAT_SCALE_ONE;
+  }
+  if (scale < BEAT_SCALE_MIN) {
+    scale = BEAT_SCALE_MIN;
+  }
+  beatScaleQ16 = static_cast<uint32_t>(scale);
+  lastBeat.scale = beatScaleQ16;
+  if (reportEnabled) {
+    serialDumpRequest(1, formatBeat);  // Skipped if another dump is still running
+  }
+}
+
+bool beatSchedulerWait() {
+  if (!boundaryOpen) {
+    closeBeat();
+    boundaryOpen = true;
+  }
+  // Queue the dwell in pieces the step timer can hold, back to back
+  while (dwellRemaining > 0) {
+    unsigned long piece = dwellRemaining;
+    if (piece > MAX_STEP_INTERVAL_US) {
+      piece = dwellRemaining < MAX_STEP_INTERVAL_US + MIN_STEP_INTERVAL_US ? dwellRemaining / 2 : MAX_STEP_INTERVAL_US;
+    }
+    if (!stepTimerQueueDwell(piece)) {
+      return false;
+    }
+    dwellRemaining -= piece;
+  }
+  updateScale();
+  boundaryOpen = false;
+  return true;
+}
@@ -0,0 +1,68 @@
+#ifndef BEAT_SCHEDULER_H
+#define BEAT_SCHEDULER_H
+
+#include <stdint.h>
+
+// Beat-period regulation for HEART_RATE.
+//
+// Beats are anchored to an absolute schedule (session start + n * period), so
+// per-beat errors never accumulate into the long-run rate. At every
+// CYCLE_COMPLETE the scheduler compares the time the beat's motion took with
+// the time left until the next slot:
+//   - if the beat finished early, the rest of the slot is queued on the step
+//     timer as dwells, so the next beat starts on the exact timer tick;
+//   - if it ran late, the next beat starts at once (later beats catch up by
+//     dwelling less) and the step intervals of the following beats are scaled
+//     down until the motion fits the period again.
+// Dwells the beat's own schedule asks for (a compiled waveform's pauses) are
+// part of its shape, not motion: they are left out of the time fitted into
+// the period, so a waveform that fills its period plays at its own speed.
+// A beat more than a whole period late re-anchors the schedule instead of
+// rushing to catch up, e.g. after a jog or a stall.
+//
+// Sending 'B' toggles a per-beat report line:
+//   "B <beat> period=<us> err=<us> late=<us> dwell=<us> active=<us> scale=<q16>"
+
+constexpr uint32_t BEAT_SCALE_ONE = 65536;       // Q16.16 interval scale of 1.0
+constexpr uint32_t BEAT_SCALE_MIN = 8192;        // Do not compress the motion below 1/8
+constexpr uint8_t BEAT_GUARD_SHIFT = 4;          // Aim the motion at period - period/16
+
+extern uint32_t beatScaleQ16;
+
+// Last completed beat, as in the 'B' report
+struct BeatReport {
+  unsigned long beat;    // Beats completed this session
+  unsigned long start;   // When the next beat's motion starts
+  unsigned long period;
+  long error;
+  unsigned long late;
+  unsigned long dwell;
+  unsigned long active;   // Motion only, without the schedule's dwells
+  uint32_t scale;
+};
+
+// Restarts the schedule with the first beat starting now
+void beatSchedulerBegin(unsigned long periodMicros);
+
+// Changes the period from the next beat on, keeping the schedule's anchor
+void beatSchedulerSetPeriod(unsigned long periodMicros);
+unsigned long beatSchedulerPeriod();
+
+// Counts a dwell the beat in progress queued as part of its own schedule
+void beatSchedulerScheduleDwell(unsigned long micros);
+
+// Called on every CYCLE_COMPLETE pass; true once the next beat may start
+bool beatSchedulerWait();
+
+void beatReportToggle();
+const BeatReport& beatSchedulerLastBeat();
+
+// Step interval after the current beat's scaling
+inline unsigned int beatScaled(unsigned int delayMicros) {
+  if (beatScaleQ16 == BEAT_SCALE_ONE) {
+    return delayMicros;
+  }
+  return static_cast<unsigned int>((static_cast<uint32_t>(delayMicros) * beatScaleQ16) >> 16);
+}
+
+#endif // BEAT_SCHEDULER_H
@@ -0,0 +1,164 @@
+#ifndef COMMAND_PROTOCOL_H
+#define COMMAND_PROTOCOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Framed binary command protocol on the serial port.
+//
+//   0xA5 | length | command | payload[length] | CRC-16 (high, low)
+//
+// The CRC is CRC-16/CCITT-FALSE over length, command and payload. Multi-byte
+// payload fields are little endian. Every accepted frame is answered with a
+// frame whose command has COMMAND_REPLY set and whose payload starts with a
+// CommandStatus byte. Frames with a bad CRC or length are dropped and counted.
+//
+// Bytes outside a frame are the single-letter diagnostic commands ('B', 'J',
+// 'P'), which are plain ASCII and can never be mistaken for the sync byte.
+//
+// Telemetry records (telemetry.h) use the same framing with their own codes.
+//
+// This header is shared with the host library in tools/pump_link.
+
+constexpr uint8_t COMMAND_SYNC = 0xA5;
+constexpr uint8_t COMMAND_MAX_PAYLOAD = 16;
+constexpr uint8_t COMMAND_REPLY = 0x80;
+
+enum CommandCode : uint8_t {
+  COMMAND_STATUS = 0x01,     // -> state u8, profile u8, position i32, stopping u8, dropped u16, pending u8
+  COMMAND_START = 0x02,      // Start a session from HOLD_POSITION
+  COMMAND_STOP = 0x03,       // Finish the current beat, then SHUTDOWN
+  COMMAND_JOG = 0x04,        // position i32: move there from HOLD_POSITION
+  COMMAND_PROFILE = 0x05,    // profile u8 (MotionProfile)
+  COMMAND_RAMPS = 0x06,      // systole accel u16, floor u16, diastole accel u16, floor u16 (live ramp profile)
+  COMMAND_RATE = 0x07,       // heart rate u16, beats per minute
+  COMMAND_RUNTIME = 0x08,    // session length u32, seconds
+  COMMAND_TELEMETRY = 0x09,  // TelemetryClass mask u8; 0 stops the stream (TELEMETRY builds)
+  COMMAND_ABORT = 0x0A,      // Ramp down mid-stroke at once, then SHUTDOWN
+};
+
+enum CommandStatus : uint8_t {
+  STATUS_OK = 0,
+  STATUS_UNKNOWN_COMMAND = 1,
+  STATUS_BAD_PAYLOAD = 2,
+  STATUS_REFUSED = 3,  // Not possible in the current state
+};
+
+// Motion profile a beat is played with
+enum MotionProfile : uint8_t {
+  PROFILE_TABLES = 0,     // Compile-time AVR446 flash tables
+  PROFILE_LIVE_RAMP = 1,  // Fixed-point AVR446 ramp with COMMAND_RAMPS parameters
+  PROFILE_WAVEFORM = 2,   // Compiled waveform schedule (PLAY_WAVEFORM builds)
+  PROFILE_COUNT
+};
+
+inline uint16_t crc16Update(uint16_t crc, uint8_t byte) {
+  crc ^= static_cast<uint16_t>(byte) << 8;
+  for (uint8_t bit = 0; bit < 8; bit++) {
+    crc = (crc & 0x8000) ? static_cast<uint16_t>((crc << 1) ^ 0x1021) : static_cast<uint16_t>(crc << 1);
+  }
+  return crc;
+}
+
+struct CommandFrame {
+  uint8_t command;
+  uint8_t length;
+  uint8_t payload[COMMAND_MAX_PAYLOAD];
+};
+
+// Writes a complete frame into `out` (at least length + 5 bytes); returns its size
+inline size_t encodeCommandFrame(uint8_t command, const uint8_t* payload, uint8_t length, uint8_t* out) {
+  uint16_t crc = 0xFFFF;
+  size_t size = 0;
+  out[size++] = COMMAND_SYNC;
+  out[size++] = length;
+  crc = crc16Update(crc, length);
+  out[size++] = command;
+  crc = crc16Update(crc, command);
+  for (uint8_t i = 0; i < length; i++) {
+    out[size++] = payload[i];
+    crc = crc16Update(crc, payload[i]);
+  }
+  out[size++] = static_cast<uint8_t>(crc >> 8);
+  out[size++] = static_cast<uint8_t>(crc);
+  return size;
+}
+
+// Incremental frame parser; feed it one byte at a time
+class CommandParser {
+ public:
+  enum Result : uint8_t { NEED_MORE, FRAME, TEXT, DROPPED };
+
+  // FRAME: `frame` holds a verified frame. TEXT: `byte` was outside any frame.
+  // DROPPED: a frame failed its length or CRC check.
+  Result feed(uint8_t byte, CommandFrame& frame) {
+    switch (stage) {
+      case WAIT_SYNC:
+        if (byte != COMMAND_SYNC) {
+          return TEXT;
+        }
+        stage = LENGTH;
+        crc = 0xFFFF;
+        return NEED_MORE;
+      case LENGTH:
+        if (byte > COMMAND_MAX_PAYLOAD) {
+          stage = WAIT_SYNC;
+          return DROPPED;
+        }
+        frame.length = byte;
+        crc = crc16Update(crc, byte);
+        stage = COMMAND;
+        return NEED_MORE;
+      case COMMAND:
+        frame.command = byte;
+        crc = crc16Update(crc, byte);
+        received = 0;
+        stage = frame.length != 0 ? PAYLOAD : CRC_HIGH;
+        return NEED_MORE;
+      case PAYLOAD:
+        frame.payload[received++] = byte;
+        crc = crc16Update(crc, byte);
+        if (received == frame.length) {
+          stage = CRC_HIGH;
+        }
+        return NEED_MORE;
+      case CRC_HIGH:
+        crcHigh = byte;
+        stage = CRC_LOW;
+        return NEED_MORE;
+      case CRC_LOW:
+      default:
+        stage = WAIT_SYNC;
+        return (static_cast<uint16_t>(crcHigh << 8 | byte) == crc) ? FRAME : DROPPED;
+    }
+  }
+
+  bool inFrame() const { return stage != WAIT_SYNC; }
+
+ private:
+  enum Stage : uint8_t { WAIT_SYNC, LENGTH, COMMAND, PAYLOAD, CRC_HIGH, CRC_LOW };
+  Stage stage = WAIT_SYNC;
+  uint8_t received = 0;
+  uint8_t crcHigh = 0;
+  uint16_t crc = 0xFFFF;
+};
+
+inline uint16_t readU16(const uint8_t* p) {
+  return static_cast<uint16_t>(p[0] | (static_cast<uint16_t>(p[1]) << 8));
+}
+
+inline uint32_t readU32(const uint8_t* p) {
+  return static_cast<uint32_t>(readU16(p)) | (static_cast<uint32_t>(readU16(p + 2)) << 16);
+}
+
+inline void writeU16(uint8_t* p, uint16_t value) {
+  p[0] = static_cast<uint8_t>(value);
+  p[1] = static_cast<uint8_t>(value >> 8);
+}
+
+inline void writeU32(uint8_t* p, uint32_t value) {
+  writeU16(p, static_cast<uint16_t>(value));
+  writeU16(p + 2, static_cast<uint16_t>(value >> 16));
+}
+
+#endif // COMMAND_PROTOCOL_H
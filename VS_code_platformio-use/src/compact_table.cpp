@@ -0,0 +1,38 @@
+#include "compact_table.h"
+
+void CompactTableReader::begin(const uint16_t* headEntries, int headEntryCount, const uint16_t* lastEntry,
+                               const int8_t* stepEntries, int entryCount) {
+  head = headEntries;
+  headCount = headEntryCount;
+  last = lastEntry;
+  steps = stepEntries;
+  count = entryCount;
+  index = -1;
+}
+
+uint16_t CompactTableReader::delayAt(int target) {
+  if (target < headCount) {
+    index = target;
+    delay = pgm_read_word(&head[target]);
+    return delay;
+  }
+  if (index < headCount - 1 || (target != index + 1 && target != index - 1 && target != index)) {
+    // Not next to the last entry read: start from the nearer anchor
+    if (target - (headCount - 1) <= count - 1 - target) {
+      index = headCount - 1;
+      delay = pgm_read_word(&head[index]);
+    } else {
+      index = count - 1;
+      delay = pgm_read_word(last);
+    }
+  }
+  while (index < target) {
+    index++;
+    delay -= static_cast<int8_t>(pgm_read_byte(&steps[index - headCount]));
+  }
+  while (index > target) {
+    delay += static_cast<int8_t>(pgm_read_byte(&steps[index - headCount]));
+    index--;
+  }
+  return delay;
+}
@@ -0,0 +1,80 @@
+#ifndef COMPACT_TABLE_H
+#define COMPACT_TABLE_H
+
+#include "motion_profiles.h"
+
+#include <stdint.h>
+
+// Delay tables stored as byte-sized steps, in flash.
+//
+// A ramp changes by more than a byte between entries only over its first
+// few steps (the shipped AVR446 tables: 5-7 entries, the sine tables: none). A
+// CompactTable keeps those HEAD entries verbatim, the last entry as an anchor
+// for the DECEL phases that start there, and every later entry as its signed
+// 8-bit difference from the one before. A 600-entry table shrinks from 1200
+// to about 620 bytes. compactHead() picks HEAD at compile time from the
+// table itself, so any table compacts.
+//
+// CompactTableReader decodes it one index at a time: a step to a neighbouring
+// index is one byte read and an add, and the start of a phase (index 0 or
+// the last) reads its anchor. Only a jump elsewhere walks from the nearer
+// anchor, which the phases never do.
+
+template <int N, int HEAD>
+struct CompactTable {
+  static_assert(HEAD >= 1 && HEAD < N, "a table this steep is better stored as a DelayTable");
+  uint16_t head[HEAD];  // Entries 0 .. HEAD-1
+  uint16_t last;        // Entry N-1
+  int8_t steps[N - HEAD];  // steps[i - HEAD] = entry[i - 1] - entry[i]
+};
+
+// Entries kept verbatim: up to the last one whose step from its predecessor
+// does not fit a signed byte
+template <int N>
+constexpr int compactHead(const DelayTable<N>& table) {
+  int head = 1;
+  for (int i = 1; i < N; i++) {
+    const int step = table.delays[i - 1] - table.delays[i];
+    if (step < -128 || step > 127) {
+      head = i + 1;
+    }
+  }
+  return head;
+}
+
+template <int HEAD, int N>
+constexpr CompactTable<N, HEAD> compactTable(const DelayTable<N>& table) {
+  CompactTable<N, HEAD> compact{};
+  for (int i = 0; i < HEAD; i++) {
+    compact.head[i] = table.delays[i];
+  }
+  compact.last = table.delays[N - 1];
+  for (int i = HEAD; i < N; i++) {
+    compact.steps[i - HEAD] = static_cast<int8_t>(table.delays[i - 1] - table.delays[i]);
+  }
+  return compact;
+}
+
+class CompactTableReader {
+ public:
+  template <int N, int HEAD>
+  void begin(const CompactTable<N, HEAD>& table) {
+    begin(table.head, HEAD, &table.last, table.steps, N);
+  }
+
+  // Entry `index`; constant time from the index before or after the last call
+  uint16_t delayAt(int index);
+
+ private:
+  void begin(const uint16_t* head, int headCount, const uint16_t* last, const int8_t* steps, int count);
+
+  const uint16_t* head = nullptr;
+  const uint16_t* last = nullptr;
+  const int8_t* steps = nullptr;
+  int headCount = 0;
+  int count = 0;
+  int index = -1;  // Entry in `delay`, -1 before the first call
+  uint16_t delay = 0;
+};
+
+#endif // COMPACT_TABLE_H
@@ -0,0 +1,90 @@
+#ifndef FAST_GPIO_H
+#define FAST_GPIO_H
+
+#include "hal.h"
+#include "main.h"
+
+// Compile-time GPIO for the motor driver pins.
+//
+// On the ATmega328P each FastPin<N> resolves its port and bit at compile time,
+// so high()/low() become a single sbi/cbi instruction instead of digitalWrite()'s
+// pin lookup and PWM-timer check. Those instructions are atomic, so they are
+// safe from both loop() and the step timer ISR. Every other target falls back
+// to pinMode()/digitalWrite().
+
+// Shortest STEP high time the DM860I driver accepts (2.5 us)
+constexpr unsigned long STEP_PULSE_NS = 2500;
+
+#if defined(__AVR_ATmega328P__)
+
+template <uint8_t PIN>
+struct FastPin {
+  static_assert(PIN < 20, "FastPin only maps the Uno's digital and analog header pins");
+
+  static constexpr uint8_t MASK = PIN < 8 ? _BV(PIN) : PIN < 14 ? _BV(PIN - 8) : _BV(PIN - 14);
+
+  static inline void output() {
+    if (PIN < 8) {
+      DDRD |= MASK;
+    } else if (PIN < 14) {
+      DDRB |= MASK;
+    } else {
+      DDRC |= MASK;
+    }
+  }
+
+  static inline void high() {
+    if (PIN < 8) {
+      PORTD |= MASK;
+    } else if (PIN < 14) {
+      PORTB |= MASK;
+    } else {
+      PORTC |= MASK;
+    }
+  }
+
+  static inline void low() {
+    if (PIN < 8) {
+      PORTD &= static_cast<uint8_t>(~MASK);
+    } else if (PIN < 14) {
+      PORTB &= static_cast<uint8_t>(~MASK);
+    } else {
+      PORTC &= static_cast<uint8_t>(~MASK);
+    }
+  }
+
+  static inline void write(bool level) {
+    if (level) {
+      high();
+    } else {
+      low();
+    }
+  }
+};
+
+// Busy-wait for exactly the minimum pulse width, rounded up to whole cycles
+inline void stepPulseDelay() {
+  __builtin_avr_delay_cycles((F_CPU / 1000000UL * STEP_PULSE_NS + 999) / 1000);
+}
+
+#else
+
+template <uint8_t PIN>
+struct FastPin {
+  static inline void output() { pinMode(PIN, OUTPUT); }
+  static inline void high() { digitalWrite(PIN, HIGH); }
+  static inline void low() { digitalWrite(PIN, LOW); }
+  static inline void write(bool level) { digitalWrite(PIN, level ? HIGH : LOW); }
+};
+
+inline void stepPulseDelay() {
+  delayMicroseconds((STEP_PULSE_NS + 999) / 1000);
+}
+
+#endif
+
+using StepPin = FastPin<STEP_PIN>;
+using DirPin = FastPin<DIR_PIN>;
+using EnablePin = FastPin<ENABLE_PIN>;
+
+#endif // FAST_GPIO_H
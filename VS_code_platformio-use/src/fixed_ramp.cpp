@@ -0,0 +1,138 @@
+#include "fixed_ramp.h"
+#include "motion_profiles.h"
+
+#include <math.h>
+
+// 900 * 0.67703 squared, times 2 * angle in thousandths: c0^2 = RAMP_C0_SQUARED / accelMilli
+constexpr uint64_t RAMP_C0_SQUARED = 742558786ULL;
+
+struct RampFactors {
+  uint16_t decrement[FIXED_RAMP_MAX_STEPS];  // 2/(4i+1) in Q0.16
+  uint16_t increment[FIXED_RAMP_MAX_STEPS];  // 2/(4i-1) in Q0.16
+};
+
+constexpr RampFactors makeRampFactors() {
+  RampFactors factors{};
+  for (int i = 1; i < FIXED_RAMP_MAX_STEPS; i++) {
+    const uint32_t down = 4 * i + 1;
+    const uint32_t up = 4 * i - 1;
+    factors.decrement[i] = static_cast<uint16_t>((2UL * 65536UL * 2 + down) / (2 * down));
+    factors.increment[i] = static_cast<uint16_t>((2UL * 65536UL * 2 + up) / (2 * up));
+  }
+  return factors;
+}
+
+constexpr RampFactors RAMP_FACTORS PROGMEM = makeRampFactors();
+
+// Q16.16 x Q0.16 -> Q16.16 as two 16x16 multiplies
+static inline uint32_t mulQ16(uint32_t value, uint16_t factor) {
+  return static_cast<uint32_t>(static_cast<uint16_t>(value >> 16)) * factor +
+         ((static_cast<uint32_t>(static_cast<uint16_t>(value)) * factor) >> 16);
+}
+
+static uint32_t isqrt64(uint64_t value) {
+  uint64_t result = 0;
+  uint64_t bit = 1ULL << 62;
+  while (bit > value) {
+    bit >>= 2;
+  }
+  while (bit != 0) {
+    if (value >= result + bit) {
+      value -= result + bit;
+      result = (result >> 1) + bit;
+    } else {
+      result >>= 1;
+    }
+    bit >>= 2;
+  }
+  return static_cast<uint32_t>(result);
+}
+
+uint32_t FixedRamp::initialDelayQ16(uint16_t accelMilli) {
+  // Runs once per ramp, never on the step path
+  return isqrt64((RAMP_C0_SQUARED << 32) / accelMilli);
+}
+
+void FixedRamp::begin(uint16_t accelMilli, uint16_t floorMicros) {
+  floorQ16 = static_cast<uint32_t>(floorMicros) << 16;
+  delayQ16 = initialDelayQ16(accelMilli);
+  clampStart = FIXED_RAMP_MAX_STEPS;
+  if (delayQ16 < floorQ16) {
+    preClampQ16 = delayQ16;
+    delayQ16 = floorQ16;
+    clampStart = 0;
+  }
+  index = 0;
+}
+
+void FixedRamp::forward() {
+  index++;
+  if (index >= clampStart) {
+    return;  // Once at the floor the recurrence can only stay there
+  }
+  const uint16_t factor = pgm_read_word(&RAMP_FACTORS.decrement[index]);
+  uint32_t next = delayQ16 - mulQ16(delayQ16, factor);
+  if (next < floorQ16) {
+    preClampQ16 = delayQ16;
+    next = floorQ16;
+    clampStart = index;
+  }
+  delayQ16 = next;
+}
+
+void FixedRamp::backward() {
+  if (index == clampStart) {
+    delayQ16 = preClampQ16;
+  } else if (index < clampStart) {
+    const uint16_t factor = pgm_read_word(&RAMP_FACTORS.increment[index]);
+    delayQ16 += mulQ16(delayQ16, factor);
+  }
+  index--;
+}
+
+uint16_t FixedRamp::delayAt(int target) {
+  while (index < target) {
+    forward();
+  }
+  while (index > target) {
+    backward();
+  }
+  return static_cast<uint16_t>(delayQ16 >> 16);
+}
+
+void FloatRamp::begin(float accel, int highSpeed) {
+  const float angle = 1;  // Angle of rotation per step
+  floor = highSpeed;
+  delay = 900.0f * sqrtf(2 * angle / accel) * 0.67703f;  // Single precision, as on the AVR
+  clampStart = FIXED_RAMP_MAX_STEPS;
+  if (delay < floor) {
+    preClamp = delay;
+    delay = floor;
+    clampStart = 0;
+  }
+  index = 0;
+}
+
+uint16_t FloatRamp::delayAt(int target) {
+  while (index < target) {
+    index++;
+    if (index < clampStart) {
+      float d = delay - (2 * delay) / (4 * index + 1);
+      if (d < floor) {
+        preClamp = delay;
+        d = floor;
+        clampStart = index;
+      }
+      delay = d;
+    }
+  }
+  while (index > target) {
+    if (index == clampStart) {
+      delay = preClamp;
+    } else if (index < clampStart) {
+      delay = delay + (2 * delay) / (4 * index - 1);
+    }
+    index--;
+  }
+  return static_cast<uint16_t>(static_cast<int>(delay));
+}
@@ -0,0 +1,59 @@
+#ifndef FIXED_RAMP_H
+#define FIXED_RAMP_H
+
+#include <stdint.h>
+
+// On-the-fly AVR446 ramp in Q16.16 fixed point.
+//
+// The float recurrence d[i] = d[i-1] - 2*d[i-1]/(4i+1) costs a software float
+// division per step on the Uno. Its factor 2/(4i+1) does not depend on the ramp
+// parameters, so it is kept in flash as a Q0.16 table and each step becomes two
+// 16x16 multiplies. Walking back down the ramp uses the exact inverse
+// d[i-1] = d[i] + 2*d[i]/(4i-1), so one ramp serves both the ACCEL and the
+// mirrored DECEL phase. Parameters can be changed between phases without any
+// table being rebuilt.
+//
+// FloatRamp is the reference: the original float recurrence with the same
+// interface, kept for comparison and for boards with an FPU.
+
+constexpr int FIXED_RAMP_MAX_STEPS = 600;  // Longest ramp the factor tables cover
+
+class FixedRamp {
+ public:
+  // accelMilli is calculateDelays()'s accel in thousandths (0.05 -> 50),
+  // floorMicros its highSpeed floor
+  void begin(uint16_t accelMilli, uint16_t floorMicros);
+
+  // Delay before step `index`. The ramp walks one step forward or back per
+  // call, so indices must be visited in sequence (as the ACCEL/DECEL phases do).
+  uint16_t delayAt(int index);
+
+  int position() const { return index; }
+
+  static uint32_t initialDelayQ16(uint16_t accelMilli);
+
+ private:
+  void forward();
+  void backward();
+
+  uint32_t delayQ16 = 0;
+  uint32_t floorQ16 = 0;
+  uint32_t preClampQ16 = 0;  // Last delay above the floor, to walk back out of the clamp
+  int clampStart = FIXED_RAMP_MAX_STEPS;
+  int index = 0;
+};
+
+class FloatRamp {
+ public:
+  void begin(float accel, int highSpeed);
+  uint16_t delayAt(int index);
+
+ private:
+  float delay = 0;
+  float floor = 0;
+  float preClamp = 0;
+  int clampStart = FIXED_RAMP_MAX_STEPS;
+  int index = 0;
+};
+
+#endif // FIXED_RAMP_H
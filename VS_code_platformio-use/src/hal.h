@@ -0,0 +1,76 @@
+#ifndef HAL_H
+#define HAL_H
+
+// Thin hardware-abstraction layer under main.h.
+//
+// On the board this is just the Arduino core. The native build has no core, so
+// the handful of calls the firmware makes (micros, millis, pinMode,
+// digitalWrite, delayMicroseconds) are provided by hal_native.cpp on top of a
+// deterministic virtual clock. The clock only moves when the simulation driver
+// advances it, so a whole session runs as fast as the host can execute loop().
+
+#ifdef ARDUINO
+
+#include <Arduino.h>
+
+#else
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+constexpr uint8_t LOW = 0;
+constexpr uint8_t HIGH = 1;
+constexpr uint8_t INPUT = 0;
+constexpr uint8_t OUTPUT = 1;
+
+unsigned long micros();
+unsigned long millis();
+void delayMicroseconds(unsigned int us);
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t level);
+int digitalRead(uint8_t pin);
+
+// Serial port. TX goes to the serial listener (stdout by default); RX reads
+// whatever the driver injected with halSerialInject(). halSerialAttach()
+// connects both directions to a file descriptor such as a pty instead.
+class HalSerial {
+ public:
+  void begin(unsigned long baud);
+  int available();
+  int read();
+  int availableForWrite();
+  size_t write(uint8_t byte);
+  size_t write(const uint8_t* buffer, size_t size);
+};
+
+extern HalSerial Serial;
+
+// Virtual clock, in microseconds since the simulation started. Unlike micros()
+// it does not wrap, so long sessions can be timestamped directly.
+unsigned long long halNowMicros();
+
+// Moves the virtual clock forward, firing every step-timer compare match that
+// falls inside the window at its exact tick.
+void halAdvance(unsigned long elapsedMicros);
+
+// Called for every pin level change with the virtual time it happened at
+typedef void (*HalPinListener)(uint8_t pin, uint8_t level, unsigned long long nowMicros);
+void halSetPinListener(HalPinListener listener);
+
+// Queues bytes for the firmware to receive; returns how many fit
+size_t halSerialInject(const uint8_t* data, size_t size);
+
+// Serial I/O through a non-blocking file descriptor; -1 detaches
+void halSerialAttach(int fd);
+
+// Receives everything the firmware transmits
+typedef void (*HalSerialListener)(const uint8_t* data, size_t size);
+void halSetSerialListener(HalSerialListener listener);
+
+// Restarts the clock at zero, drives every pin low and empties the serial port
+void halReset();
+
+#endif
+
+#endif // HAL_H
@@ -0,0 +1,163 @@
+#ifndef ARDUINO
+
+#include "hal.h"
+#include "step_timer.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+
+constexpr uint8_t HAL_PIN_COUNT = 20;  // Uno digital and analog header pins
+
+static unsigned long long nowMicros = 0;
+static uint8_t pinLevels[HAL_PIN_COUNT];
+static HalPinListener pinListener = nullptr;
+
+constexpr size_t HAL_SERIAL_RX_SIZE = 1024;
+static uint8_t serialRx[HAL_SERIAL_RX_SIZE];
+static size_t serialRxHead = 0;
+static size_t serialRxCount = 0;
+static HalSerialListener serialListener = nullptr;
+static int serialFd = -1;
+
+// Moves whatever the attached descriptor has into the RX ring
+static void pollSerialFd() {
+  if (serialFd < 0 || serialRxCount == HAL_SERIAL_RX_SIZE) {
+    return;
+  }
+  uint8_t buffer[64];
+  size_t room = HAL_SERIAL_RX_SIZE - serialRxCount;
+  const ssize_t got = ::read(serialFd, buffer, room < sizeof(buffer) ? room : sizeof(buffer));
+  if (got > 0) {
+    halSerialInject(buffer, static_cast<size_t>(got));
+  }
+}
+
+HalSerial Serial;
+
+unsigned long micros() {
+  return static_cast<unsigned long>(nowMicros);
+}
+
+unsigned long millis() {
+  return static_cast<unsigned long>(nowMicros / 1000ULL);
+}
+
+void delayMicroseconds(unsigned int) {
+  // Only used inside the step pulse. The step timer measures each interval from
+  // the compare match, so the pulse width never shifts the next deadline.
+}
+
+void pinMode(uint8_t, uint8_t) {}
+
+void digitalWrite(uint8_t pin, uint8_t level) {
+  if (pin >= HAL_PIN_COUNT) {
+    return;
+  }
+  level = level ? HIGH : LOW;
+  if (pinLevels[pin] != level) {
+    pinLevels[pin] = level;
+    if (pinListener != nullptr) {
+      pinListener(pin, level, nowMicros);
+    }
+  }
+}
+
+int digitalRead(uint8_t pin) {
+  return pin < HAL_PIN_COUNT ? pinLevels[pin] : LOW;
+}
+
+void HalSerial::begin(unsigned long) {}
+
+int HalSerial::available() {
+  pollSerialFd();
+  return static_cast<int>(serialRxCount);
+}
+
+int HalSerial::read() {
+  if (serialRxCount == 0) {
+    return -1;
+  }
+  const uint8_t byte = serialRx[serialRxHead];
+  serialRxHead = (serialRxHead + 1) % HAL_SERIAL_RX_SIZE;
+  serialRxCount--;
+  return byte;
+}
+
+int HalSerial::availableForWrite() {
+  return 63;  // The Uno's TX buffer never looks fuller than this
+}
+
+size_t HalSerial::write(uint8_t byte) {
+  return write(&byte, 1);
+}
+
+size_t HalSerial::write(const uint8_t* buffer, size_t size) {
+  if (serialFd >= 0) {
+    size_t written = 0;
+    while (written < size) {
+      const ssize_t put = ::write(serialFd, buffer + written, size - written);
+      if (put <= 0) {
+        break;  // Nobody reading the pty; the bytes are lost, as on a real link
+      }
+      written += static_cast<size_t>(put);
+    }
+  } else if (serialListener != nullptr) {
+    serialListener(buffer, size);
+  } else {
+    fwrite(buffer, 1, size, stdout);
+  }
+  return size;
+}
+
+size_t halSerialInject(const uint8_t* data, size_t size) {
+  size_t accepted = 0;
+  while (accepted < size && serialRxCount < HAL_SERIAL_RX_SIZE) {
+    serialRx[(serialRxHead + serialRxCount) % HAL_SERIAL_RX_SIZE] = data[accepted++];
+    serialRxCount++;
+  }
+  return accepted;
+}
+
+void halSerialAttach(int fd) {
+  if (fd >= 0) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  }
+  serialFd = fd;
+}
+
+void halSetSerialListener(HalSerialListener listener) {
+  serialListener = listener;
+}
+
+unsigned long long halNowMicros() {
+  return nowMicros;
+}
+
+void halAdvance(unsigned long elapsedMicros) {
+  // Stop the clock at each compare match so the pulse is stamped at its tick
+  unsigned long toNext = stepTimerMicrosToNextStep();
+  while (toNext != 0 && toNext <= elapsedMicros) {
+    nowMicros += toNext;
+    elapsedMicros -= toNext;
+    stepTimerAdvance(toNext);
+    toNext = stepTimerMicrosToNextStep();
+  }
+  nowMicros += elapsedMicros;
+  stepTimerAdvance(elapsedMicros);
+}
+
+void halSetPinListener(HalPinListener listener) {
+  pinListener = listener;
+}
+
+void halReset() {
+  nowMicros = 0;
+  for (uint8_t pin = 0; pin < HAL_PIN_COUNT; pin++) {
+    pinLevels[pin] = LOW;
+  }
+  serialRxHead = 0;
+  serialRxCount = 0;
+}
+
+#endif
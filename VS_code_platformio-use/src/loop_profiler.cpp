@@ -0,0 +1,144 @@
+#include "loop_profiler.h"
+
+#ifdef LOOP_PROFILER
+
+#include "hal.h"
+#include "serial_dump.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static ProfileHistogram histograms[PROFILE_REGION_COUNT];
+
+static const char* const REGION_NAMES[PROFILE_REGION_COUNT] = {
+    "SYSTOLE_ACCEL",   "SYSTOLE_DECEL", "DIASTOLE_ACCEL", "DIASTOLE_DECEL", "RETURN_TO_START", "CYCLE_COMPLETE",
+    "SHUTDOWN",        "HOLD_POSITION", "RETURN_TO_MANUAL_POSITION",        "WAVEFORM_PLAYBACK", "commands",
+    "profile",
+};
+
+#ifdef __AVR__
+
+#include <util/atomic.h>
+
+constexpr uint32_t PROFILER_TICKS_PER_US = 2;  // F_CPU / 8
+
+static volatile uint32_t overflowTicks = 0;
+
+ISR(TIMER2_OVF_vect) {
+  overflowTicks += 256;
+}
+
+void profilerBegin() {
+  TCCR2A = 0;
+  TCCR2B = _BV(CS21);  // Normal mode, prescaler 8
+  TCNT2 = 0;
+  TIFR2 = _BV(TOV2);
+  TIMSK2 = _BV(TOIE2);
+}
+
+uint32_t profilerNow() {
+  uint32_t high;
+  uint8_t low;
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE) {
+    high = overflowTicks;
+    low = TCNT2;
+    if ((TIFR2 & _BV(TOV2)) && low < 255) {
+      high += 256;  // Overflowed after interrupts were masked
+    }
+  }
+  return high + low;
+}
+
+#else
+
+#include <time.h>
+
+constexpr uint32_t PROFILER_TICKS_PER_US = 2;  // As on the Uno, so both fill the same buckets
+
+void profilerBegin() {}
+
+uint32_t profilerNow() {
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  const uint64_t nanos = static_cast<uint64_t>(now.tv_sec) * 1000000000ULL + now.tv_nsec;
+  return static_cast<uint32_t>(nanos / (1000 / PROFILER_TICKS_PER_US));
+}
+
+#endif
+
+// Bucket b < 2 holds b ticks; above that each power of two splits into two
+static uint8_t bucketOf(uint32_t ticks) {
+  if (ticks < 2) {
+    return static_cast<uint8_t>(ticks);
+  }
+  uint8_t octave = 0;
+  while ((ticks >> octave) > 3) {
+    octave++;
+  }
+  const uint8_t bucket = static_cast<uint8_t>(2 * octave + (ticks >> octave));
+  return bucket < PROFILE_BUCKET_COUNT ? bucket : PROFILE_BUCKET_COUNT - 1;
+}
+
+// Smallest tick count that lands in the bucket after `bucket`
+static uint32_t bucketLimit(uint8_t bucket) {
+  if (bucket < 2) {
+    return bucket + 1UL;
+  }
+  const uint8_t octave = (bucket - 2) / 2;
+  return static_cast<uint32_t>(2 + (bucket - 2) % 2 + 1) << octave;
+}
+
+void profilerRecord(uint8_t region, uint32_t elapsedTicks) {
+  ProfileHistogram& histogram = histograms[region];
+  uint16_t& bucket = histogram.buckets[bucketOf(elapsedTicks)];
+  if (bucket == 0xFFFF) {
+    for (uint8_t b = 0; b < PROFILE_BUCKET_COUNT; b++) {
+      histogram.buckets[b] /= 2;
+    }
+  }
+  bucket++;
+  histogram.count++;
+  if (elapsedTicks > histogram.maxTicks) {
+    histogram.maxTicks = elapsedTicks;
+  }
+}
+
+void profilerReset() {
+  memset(histograms, 0, sizeof(histograms));
+}
+
+static unsigned long ticksToNanos(uint32_t ticks) {
+  return static_cast<unsigned long>(ticks * (1000UL / PROFILER_TICKS_PER_US));
+}
+
+// Upper edge of the bucket holding the given fraction of samples, capped at max
+static uint32_t percentile(const ProfileHistogram& histogram, uint8_t percent) {
+  uint32_t total = 0;
+  for (uint8_t b = 0; b < PROFILE_BUCKET_COUNT; b++) {
+    total += histogram.buckets[b];
+  }
+  const uint32_t target = (total * percent + 99) / 100;
+  uint32_t seen = 0;
+  for (uint8_t b = 0; b < PROFILE_BUCKET_COUNT; b++) {
+    seen += histogram.buckets[b];
+    if (seen >= target && seen != 0) {
+      const uint32_t limit = bucketLimit(b) - 1;
+      return limit < histogram.maxTicks ? limit : histogram.maxTicks;
+    }
+  }
+  return histogram.maxTicks;
+}
+
+static size_t formatLine(uint8_t region, char* line, size_t size) {
+  const ProfileHistogram& histogram = histograms[region];
+  int length = snprintf(line, size, "P %s n=%lu p50=%lu p99=%lu max=%lu", REGION_NAMES[region],
+                        static_cast<unsigned long>(histogram.count), ticksToNanos(percentile(histogram, 50)),
+                        ticksToNanos(percentile(histogram, 99)), ticksToNanos(histogram.maxTicks));
+  return length < static_cast<int>(size) ? length : size;
+}
+
+void profilerDumpRequest() {
+  serialDumpRequest(PROFILE_REGION_COUNT, formatLine);
+}
+
+#endif
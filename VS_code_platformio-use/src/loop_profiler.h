@@ -0,0 +1,68 @@
+#ifndef LOOP_PROFILER_H
+#define LOOP_PROFILER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// loop() latency profiler, compiled in with -D LOOP_PROFILER.
+//
+// Every loop() pass is timed and charged to the State it started in, and
+// PROFILE_SCOPE() charges named regions inside the pass (command parsing,
+// delay-table / ramp evaluation). Durations go into a log-linear histogram per
+// region (two buckets per power of two), so p50/p99 come out within about 25%
+// and max is kept exactly. Sending 'P' on the serial port dumps
+// "P <region> n= p50= p99= max=" in nanoseconds.
+//
+// On the Uno the clock is Timer2, free running at F_CPU/8 (0.5 us) and widened
+// to 32 bits by its overflow interrupt, which fires every 128 us and costs a
+// few microseconds of step ISR latency while profiling. Timer0 (millis) and
+// Timer1 (step engine) are untouched. On the host the clock is the OS
+// monotonic clock, so the report reflects the host's real execution time; it
+// is counted in the same 0.5 us ticks, so the buckets cover the same range
+// (up to 512 us, longer passes share the last) on both. Twelve regions take
+// 576 bytes of SRAM. Without the flag every scope compiles to nothing.
+
+// Regions after the ten State values
+enum ProfileRegion : uint8_t {
+  PROFILE_REGION_COMMANDS = 10,  // handleSerialCommands()
+  PROFILE_REGION_PROFILE,       // Selecting and evaluating the active delay profile
+  PROFILE_REGION_COUNT
+};
+
+constexpr uint8_t PROFILE_BUCKET_COUNT = 20;
+
+struct ProfileHistogram {
+  uint32_t count;
+  uint32_t maxTicks;
+  uint16_t buckets[PROFILE_BUCKET_COUNT];  // Halved together when one saturates
+};
+
+#ifdef LOOP_PROFILER
+
+uint32_t profilerNow();
+void profilerBegin();
+void profilerRecord(uint8_t region, uint32_t elapsedTicks);
+void profilerReset();
+void profilerDumpRequest();
+
+class ProfileScope {
+ public:
+  explicit ProfileScope(uint8_t region) : region(region), start(profilerNow()) {}
+  ~ProfileScope() { profilerRecord(region, profilerNow() - start); }
+
+ private:
+  uint8_t region;
+  uint32_t start;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(region) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(region)
+
+#else
+
+#define PROFILE_SCOPE(region) ((void)0)
+
+#endif
+
+#endif // LOOP_PROFILER_H
@@ -1,21 +1,41 @@
 #include "main.h"
-
-// Define pin numbers for motor control
-constexpr int DIR_PIN = 2;    // Direction pin
-constexpr int STEP_PIN = 5;   // Step pin
-constexpr int ENABLE_PIN = 8; // Enable pin
+#include "beat_scheduler.h"
+#include "command_protocol.h"
+#include "compact_table.h"
+#include "fast_gpio.h"
+#include "fixed_ramp.h"
+#include "loop_profiler.h"
+#include "motion_profiles.h"
+#include "motion_segments.h"
+#include "point_move.h"
+#include "pulsatile_driver.h"
+#include "serial_dump.h"
+#include "step_jitter.h"
+#include "step_timer.h"
+#include "telemetry.h"
+#include "waveform.h"
+#ifdef PLAY_WAVEFORM
+#include "waveforms/waveforms.h"
+#endif
 
 // Debug LED pin
 constexpr int DEBUG_LED = 13; // Built-in LED
 
-constexpr int STEPS = 600;    // Number of steps per phase (half of 400 steps/rev)
-constexpr int HEART_RATE = 60; // Target heart rate in beats per minute
+constexpr unsigned long SERIAL_BAUD = 115200;
+
+// Pump variant: MainPump, Pump100mlSV, SinusoidalPump or FullSinePump (see pulsatile_driver.h)
+#ifndef PUMP_VARIANT
+#define PUMP_VARIANT MainPump
+#endif
+using Pump = PUMP_VARIANT;
+
+constexpr int STEPS = Pump::PHASE_STEPS;    // Number of steps per phase
+constexpr int HEART_RATE = Pump::HEART_RATE; // Target heart rate in beats per minute
 
 // Overall runtime in seconds
-constexpr unsigned long RUNTIME_SECONDS = 15; // Set runtime here (e.g., 60 seconds)
+constexpr unsigned long RUNTIME_SECONDS = Pump::RUNTIME_SECONDS;
 unsigned long runtimeMillis = RUNTIME_SECONDS * 1000UL; // Convert runtime to milliseconds
 unsigned long startMillis;
-unsigned long lastStepTime = 0;
 
 // Position tracking relative to cycle start position
 volatile long cyclePosition = 0; // Track position relative to start of cycle
@@ -23,109 +43,602 @@ long initialPosition = 0;  // Store the initial position as home
 constexpr int HALF_REV = 200;   // Half revolution (400/2 steps)
 constexpr int QUARTER_REV = 100; // Quarter revolution for each phase (400/4 steps)
 
-// State machine states
-enum class State {
-  SYSTOLE_ACCEL,  // Always start with systole
-  SYSTOLE_DECEL,
-  DIASTOLE_ACCEL,
-  DIASTOLE_DECEL,
-  RETURN_TO_START,
-  CYCLE_COMPLETE,
-  SHUTDOWN,
-  HOLD_POSITION,
-  RETURN_TO_MANUAL_POSITION  // New state for returning to manually set position
-};
-
 // Initialize state to systole
 State currentState = State::SYSTOLE_ACCEL;
-int currentStep = 0;
-int returnStepsRemaining = 0;
-bool returnDirection = true;
+int currentStep = 0;  // Steps of the executing segment already queued
+
+// The homing limits in main.h reach their floor inside the ramp
+static_assert(makeAccelTable<FIXED_RAMP_MAX_STEPS>(MOVE_ACCEL_MILLI / 1000.0f, MOVE_FLOOR_MICROS)
+                      .delays[FIXED_RAMP_MAX_STEPS - 1] == MOVE_FLOOR_MICROS,
+              "the homing ramp must reach its floor within FIXED_RAMP_MAX_STEPS");
+PointMove homingMove;
 
 // Motor control parameters
-int delays[STEPS];  // Array to store delay times
-const float angle = 1; // Angle of rotation per step
+// Ramp tables are generated at compile time and live in flash, byte-coded (see compact_table.h)
+constexpr int SYSTOLE_HEAD = compactHead(Pump::systoleTable());
+constexpr int DIASTOLE_HEAD = compactHead(Pump::diastoleTable());
+constexpr CompactTable<Pump::TABLE_STEPS, SYSTOLE_HEAD> SYSTOLE_DELAYS PROGMEM =
+    compactTable<SYSTOLE_HEAD>(Pump::systoleTable());  // Faster movement for systole (contraction)
+constexpr CompactTable<Pump::TABLE_STEPS, DIASTOLE_HEAD> DIASTOLE_DELAYS PROGMEM =
+    compactTable<DIASTOLE_HEAD>(Pump::diastoleTable());  // Slower movement for diastole (relaxation)
+CompactTableReader systoleTable;
+CompactTableReader diastoleTable;
+// Same ramps computed on the fly, with parameters that can change between beats
+FixedRamp systoleRamp;
+FixedRamp diastoleRamp;
 bool motorDirection = true;
 
+// Phases of the beat in progress, queued when it starts (see motion_segments.h)
+SegmentQueue<4> beatSegments;
+
+// Compiled waveform played as a whole beat instead of the four ramp phases
+#ifdef PLAY_WAVEFORM
+constexpr bool HAS_WAVEFORM = true;
+const Waveform* const compiledWaveform = &ACTIVE_WAVEFORM;
+#else
+constexpr bool HAS_WAVEFORM = false;
+const Waveform* const compiledWaveform = nullptr;
+#endif
+
+// The waveform stroke in progress (steps in one direction, no dwell between),
+// followed as its entries are queued so an abort can tell how it is moving
+struct WaveformStroke {
+  uint16_t first;    // Schedule index of its first step
+  uint16_t last;     // Interval of the step queued last
+  uint16_t fastest;  // Shortest interval so far
+  bool clockwise;
+  bool moving;       // False from a dwell to the next stroke's first step
+};
+WaveformStroke waveformStroke;
+bool waveformWindingDown = false;  // Aborted past its fastest: the stroke plays on to its end
+
+// Everything a command can change. Commands edit pendingConfig; it replaces
+// activeConfig at the next beat boundary so a beat never changes mid-stroke.
+struct BeatConfig {
+  uint8_t profile;
+  uint16_t systoleAccelMilli;   // Live ramp parameters, as in FixedRamp::begin()
+  uint16_t systoleFloorMicros;
+  uint16_t diastoleAccelMilli;
+  uint16_t diastoleFloorMicros;
+  uint16_t heartRate;
+};
+
+// Build with -D PLAY_WAVEFORM to start on ACTIVE_WAVEFORM, or with
+// -D FIXED_POINT_RAMPS to start on the live ramp instead of the flash tables
+#if defined(PLAY_WAVEFORM)
+constexpr uint8_t DEFAULT_PROFILE = PROFILE_WAVEFORM;
+#elif defined(FIXED_POINT_RAMPS)
+static_assert(Pump::LIVE_RAMP, "this PUMP_VARIANT has no live-ramp equivalent");
+constexpr uint8_t DEFAULT_PROFILE = PROFILE_LIVE_RAMP;
+#else
+constexpr uint8_t DEFAULT_PROFILE = PROFILE_TABLES;
+#endif
+
+BeatConfig activeConfig = {DEFAULT_PROFILE,
+                           Pump::SYSTOLE_LIVE.accelMilli, Pump::SYSTOLE_LIVE.floorMicros,
+                           Pump::DIASTOLE_LIVE.accelMilli, Pump::DIASTOLE_LIVE.floorMicros,
+                           HEART_RATE};
+BeatConfig pendingConfig = activeConfig;
+unsigned long pendingRuntimeMillis = 0;  // 0 when the runtime is not being changed
+bool configPending = false;
+
+// Serial command link
+constexpr uint8_t COMMAND_BYTES_PER_PASS = 8;  // Parsing budget per loop() pass
+CommandParser commandParser;
+CommandFrame commandFrame;
+uint8_t replyFrame[COMMAND_MAX_PAYLOAD + 5];
+uint8_t replySize = 0;  // Reply waiting for room in the TX buffer
+uint16_t droppedFrames = 0;
+#ifdef TELEMETRY
+State reportedState = State::SYSTOLE_ACCEL;  // Last State sent as a PHASE record
+#endif
+
 // Add new variable to track if we should shutdown after cycle
 bool shutdownRequested = false;
 bool completeCurrentCycle = false;  // New flag to track if we should complete current cycle
+bool abortRequested = false;  // COMMAND_ABORT: ramp down mid-stroke instead of finishing the beat
 
 // Add new variable to track manually set position
 long manualPosition = 0;
 
-void calculateDelays(float accel, int highSpeed) {
-  const float c0 = 900 * sqrt(2 * angle / accel) * 0.67703; // Calculate initial delay
-  float lastDelay = 0;
+// Delay before step `step` of a table or live-ramp segment
+inline unsigned int segmentDelay(const MotionSegment& segment, int step) {
+  PROFILE_SCOPE(PROFILE_REGION_PROFILE);
+  const int index = segment.firstIndex + segment.indexStep * step;
+  if (segment.source == SegmentSource::LIVE_RAMP) {
+    return beatScaled(segment.ramp->delayAt(index));
+  }
+  return beatScaled(segment.table->delayAt(index));
+}
 
-  // Calculate delay array for acceleration
-  for (int i = 0; i < STEPS; i++) {
-    float d = c0;
-    if (i > 0) {
-      d = lastDelay - (2 * lastDelay) / (4 * i + 1);
-    }
-    if (d < highSpeed) {
-      d = highSpeed;
+// First state of every beat
+inline State beatStartState() {
+  return activeConfig.profile == PROFILE_WAVEFORM ? State::WAVEFORM_PLAYBACK : State::SYSTOLE_ACCEL;
+}
+
+// Takes over the configuration commands have queued; called between beats
+void applyPendingConfig() {
+  if (!configPending) {
+    return;
+  }
+  configPending = false;
+  activeConfig = pendingConfig;
+  if (pendingRuntimeMillis != 0) {
+    runtimeMillis = pendingRuntimeMillis;
+    pendingRuntimeMillis = 0;
+  }
+  beatSchedulerSetPeriod(60000000UL / activeConfig.heartRate);
+}
+
+// Hands one schedule entry to the step timer; false while it has no room
+inline bool queueWaveformEntry(uint16_t entry) {
+  const unsigned int interval = beatScaled(entry & WAVEFORM_INTERVAL_MASK);
+  if (entry & WAVEFORM_DWELL) {
+    if (!stepTimerQueueDwell(interval)) {
+      return false;
     }
-    delays[i] = static_cast<int>(d);
-    lastDelay = d;
+    beatSchedulerScheduleDwell(interval);
+    return true;
   }
+  return handleMotorStep((entry & WAVEFORM_CLOCKWISE) != 0, interval);
 }
 
 void enableMotor(bool enable) {
-  digitalWrite(ENABLE_PIN, enable ? LOW : HIGH);
+  EnablePin::write(!enable);  // Driver enable is active low
 }
 
 void setDirection(bool clockwise) {
+  // The DIR pin itself is driven by the step timer alongside each queued step,
+  // so a direction change never overtakes steps that are still in flight
   motorDirection = clockwise;
-  digitalWrite(DIR_PIN, clockwise ? HIGH : LOW);  // HIGH for clockwise when looking at shaft
 }
 
+// Hands the next step to the step timer, which fires it stepDelay microseconds
+// after the previous pulse. Returns false while the engine already has a step
+// waiting, in which case the caller retries on the next pass.
 bool handleMotorStep(bool clockwise, int stepDelay) {
-  unsigned long currentMicros = micros();
-  if (currentMicros - lastStepTime >= stepDelay) {
-    digitalWrite(STEP_PIN, HIGH);
-    delayMicroseconds(2);
-    digitalWrite(STEP_PIN, LOW);
-    // Consistent position tracking: increment for counter-clockwise, decrement for clockwise
-    cyclePosition += (clockwise ? -1 : 1);
-    lastStepTime = currentMicros;
-    return true;
+  if (!stepTimerQueue(clockwise, stepDelay)) {
+    return false;
   }
-  return false;
+  telemetryStep();
+  return true;
+}
+
+// Reports the beat whose motion starts next
+void reportBeatStart() {
+  const BeatReport& beat = beatSchedulerLastBeat();
+  telemetryBeatStart(beat.beat, beat.start, beatSchedulerPeriod());
+}
+
+// Queues one phase of the coming beat
+void queuePhase(State state, bool clockwise, bool decel, CompactTableReader& table, FixedRamp& ramp) {
+  MotionSegment segment;
+  segment.state = state;
+  segment.clockwise = clockwise;
+  segment.steps = STEPS;
+  segment.firstIndex = decel ? Pump::decelIndex(0) : Pump::accelIndex(0);
+  segment.indexStep = decel ? -1 : 1;
+  if (activeConfig.profile == PROFILE_LIVE_RAMP) {
+    segment.source = SegmentSource::LIVE_RAMP;
+    segment.ramp = &ramp;
+  } else {
+    segment.source = SegmentSource::TABLE;
+    segment.table = &table;
+  }
+  beatSegments.push(segment);
+}
+
+// Queues every phase of the beat about to start, with the configuration it
+// runs under, so the executor never has to stop and decide at a phase boundary
+void queueBeat() {
+  PROFILE_SCOPE(PROFILE_REGION_PROFILE);
+  beatSegments.clear();  // A session restarted from HOLD_POSITION may leave the last beat's segments behind
+  currentStep = 0;
+  currentState = beatStartState();
+  if (activeConfig.profile == PROFILE_WAVEFORM) {
+    waveformStroke.moving = false;
+    waveformWindingDown = false;
+    MotionSegment segment;
+    segment.state = State::WAVEFORM_PLAYBACK;
+    segment.source = SegmentSource::WAVEFORM;
+    segment.clockwise = true;  // Each entry carries its own direction
+    segment.indexStep = 1;
+    segment.firstIndex = 0;
+    segment.steps = compiledWaveform->length;
+    segment.waveform = compiledWaveform;
+    beatSegments.push(segment);
+    return;
+  }
+  if (activeConfig.profile == PROFILE_LIVE_RAMP) {
+    systoleRamp.begin(activeConfig.systoleAccelMilli, activeConfig.systoleFloorMicros);
+    diastoleRamp.begin(activeConfig.diastoleAccelMilli, activeConfig.diastoleFloorMicros);
+  } else {
+    systoleTable.begin(SYSTOLE_DELAYS);
+    diastoleTable.begin(DIASTOLE_DELAYS);
+  }
+  // Faster acceleration for systole (contraction, clockwise), slower for diastole (relaxation)
+  queuePhase(State::SYSTOLE_ACCEL, true, false, systoleTable, systoleRamp);
+  queuePhase(State::SYSTOLE_DECEL, true, true, systoleTable, systoleRamp);
+  queuePhase(State::DIASTOLE_ACCEL, false, false, diastoleTable, diastoleRamp);
+  queuePhase(State::DIASTOLE_DECEL, false, true, diastoleTable, diastoleRamp);
+}
+
+// Moves on from segments with no steps left, reporting the state of the next;
+// once an abort has landed the rest of the beat is dropped
+void skipFinishedSegments() {
+  for (MotionSegment* segment = beatSegments.front(); segment != nullptr && currentStep >= segment->steps;
+       segment = beatSegments.front()) {
+    beatSegments.pop();
+    currentStep = 0;
+    if (abortRequested) {
+      beatSegments.clear();
+    } else if (beatSegments.front() != nullptr) {
+      currentState = beatSegments.front()->state;
+    }
+  }
+}
+
+void trackWaveformStroke(uint16_t entry, uint16_t index) {
+  if (entry & WAVEFORM_DWELL) {
+    waveformStroke.moving = false;
+    return;
+  }
+  const bool clockwise = (entry & WAVEFORM_CLOCKWISE) != 0;
+  const uint16_t interval = entry & WAVEFORM_INTERVAL_MASK;
+  if (!waveformStroke.moving || clockwise != waveformStroke.clockwise) {
+    waveformStroke = {index, interval, interval, clockwise, true};
+    return;
+  }
+  waveformStroke.last = interval;
+  if (interval < waveformStroke.fastest) {
+    waveformStroke.fastest = interval;
+  }
+}
+
+// Queues the next waveform entry; a stroke winding down after an abort ends
+// the segment at its last step instead
+bool executeWaveform(MotionSegment& segment) {
+  const uint16_t index = segment.firstIndex + segment.indexStep * currentStep;
+  const uint16_t entry = readWaveformEntry(*segment.waveform, index);
+  if (waveformWindingDown &&
+      ((entry & WAVEFORM_DWELL) || ((entry & WAVEFORM_CLOCKWISE) != 0) != waveformStroke.clockwise)) {
+    segment.steps = currentStep;
+    return false;
+  }
+  if (!queueWaveformEntry(entry)) {
+    return false;
+  }
+  trackWaveformStroke(entry, index);
+  return true;
+}
+
+// Hands the next step of the queued beat to the step timer, going straight
+// on to the next segment when one ends; false once the beat has nothing left
+// to queue
+bool executeSegments() {
+  skipFinishedSegments();
+  MotionSegment* segment = beatSegments.front();
+  if (segment == nullptr) {
+    return false;
+  }
+  bool queued;
+  if (segment->source == SegmentSource::WAVEFORM) {
+    queued = executeWaveform(*segment);
+  } else {
+    queued = handleMotorStep(segment->clockwise, segmentDelay(*segment, currentStep));
+  }
+  if (queued) {
+    currentStep++;
+  }
+  skipFinishedSegments();
+  return true;
 }
 
 void initializeSystoleState() {
   // Reset all parameters for systole
-  currentState = State::SYSTOLE_ACCEL;
+  writeCyclePosition(0);
+  queueBeat();
+  reportBeatStart();
+}
+
+// A waveform stroke still near its fastest walks back down the entries it has
+// queued, as an ACCEL phase does; one already slowing down (by more than a
+// sixteenth) plays on to its last step; between strokes the motor is at rest
+// and the beat ends at once. Either way the ramp-down takes no longer than
+// the stroke has run or has left.
+void abortWaveform(MotionSegment& segment) {
+  if (waveformWindingDown) {
+    return;
+  }
+  if (!waveformStroke.moving) {
+    segment.steps = currentStep;
+  } else if (waveformStroke.last - waveformStroke.fastest <= (waveformStroke.fastest >> 4)) {
+    segment.firstIndex = segment.firstIndex + currentStep - 1;
+    segment.indexStep = -1;
+    segment.steps = currentStep - waveformStroke.first;
+    currentStep = 0;
+  } else {
+    waveformWindingDown = true;
+  }
+}
+
+// Aborting during an ACCEL phase turns it around: the segment walks back down
+// the table entries the ACCEL phase has queued, from the last one, so the motor
+// ramps down from the speed it has reached instead of stopping dead and losing
+// steps. The variant's own DECEL phase may read other entries (SinusoidalPump
+// starts it from the far end of the table), so it cannot stand in for this.
+// A waveform is one segment for the whole beat and is handled by its strokes.
+void abortAcceleration() {
+  MotionSegment* segment = beatSegments.front();
+  if (segment == nullptr || segment->indexStep < 0) {
+    return;
+  }
+  if (segment->source == SegmentSource::WAVEFORM) {
+    abortWaveform(*segment);
+    return;
+  }
+  segment->state = segment->state == State::SYSTOLE_ACCEL ? State::SYSTOLE_DECEL : State::DIASTOLE_DECEL;
+  segment->firstIndex = segment->firstIndex + currentStep - 1;
+  segment->indexStep = -1;
+  segment->steps = currentStep;
   currentStep = 0;
-  cyclePosition = 0;
-  calculateDelays(0.05, 1);  // Faster acceleration for systole (contraction) phase
-  setDirection(true);  // clockwise for systole (contraction)
+  currentState = segment->state;
+}
+
+// Runs the homing move towards `target`, planning it once the motor is at
+// rest; true when the motor stands exactly there
+bool moveTo(long target) {
+  if (!homingMove.done()) {
+    if (handleMotorStep(homingMove.clockwise(), homingMove.delay())) {
+      homingMove.advance();
+    }
+    return false;
+  }
+  if (!stepTimerIdle()) {
+    return false;  // Let the last steps land before reading the position
+  }
+  const long position = readCyclePosition();
+  if (position == target) {
+    return true;
+  }
+  homingMove.begin(position, target, MOVE_ACCEL_MILLI, MOVE_FLOOR_MICROS);
+  setDirection(homingMove.clockwise());
+  return false;
+}
+
+// Decides what follows the last step of a beat, once the step timer has drained
+void finishBeat() {
+  long position = readCyclePosition();
+  telemetryBeatEnd(beatSchedulerLastBeat().beat, micros(), position);
+  // If shutdown was requested and we're in diastole, go to shutdown
+  if (shutdownRequested && completeCurrentCycle) {
+    completeCurrentCycle = false;
+    currentState = State::SHUTDOWN;
+  } else if (position != initialPosition) {
+    // If not at start, do return
+    currentState = State::RETURN_TO_START;
+  } else {
+    // If at start and shutdown requested, go to shutdown
+    if (shutdownRequested) {
+      currentState = State::SHUTDOWN;
+    } else {
+      // Otherwise continue with next cycle
+      currentState = State::CYCLE_COMPLETE;
+    }
+  }
 }
 
 void setup() {
-  pinMode(STEP_PIN, OUTPUT);
-  pinMode(DIR_PIN, OUTPUT);
-  pinMode(ENABLE_PIN, OUTPUT);
+  StepPin::output();
+  DirPin::output();
+  EnablePin::output();
   pinMode(DEBUG_LED, OUTPUT);
+  Serial.begin(SERIAL_BAUD);
+#ifdef LOOP_PROFILER
+  profilerBegin();
+#endif
 
-  digitalWrite(ENABLE_PIN, LOW); // Enable motor driver
+  EnablePin::low(); // Enable motor driver
+  stepTimerBegin();
   
   // Store the initial position as home
-  initialPosition = cyclePosition;
+  initialPosition = readCyclePosition();
   
   // Initialize for normal operation
   startMillis = millis();
+  beatSchedulerBegin(60000000UL / activeConfig.heartRate);
   initializeSystoleState();
 }
 
-// Function to handle manual position commands if needed
+// Starts a new session from HOLD_POSITION; the current position becomes home
+void startSession() {
+  applyPendingConfig();
+  shutdownRequested = false;
+  completeCurrentCycle = false;
+  abortRequested = false;
+  startMillis = millis();
+  beatSchedulerBegin(60000000UL / activeConfig.heartRate);
+  initializeSystoleState();
+}
+
+// Runs one verified command frame and prepares its reply
+void executeCommand(const CommandFrame& frame) {
+  uint8_t reply[COMMAND_MAX_PAYLOAD];
+  uint8_t replyLength = 1;
+  uint8_t status = STATUS_OK;
+  const bool idle = currentState == State::HOLD_POSITION;
+
+  switch (frame.command) {
+    case COMMAND_STATUS:
+      reply[1] = static_cast<uint8_t>(currentState);
+      reply[2] = activeConfig.profile;
+      writeU32(&reply[3], static_cast<uint32_t>(readCyclePosition()));
+      reply[7] = shutdownRequested ? 1 : 0;
+      writeU16(&reply[8], droppedFrames);
+      reply[10] = configPending ? 1 : 0;
+      replyLength = 11;
+      break;
+
+    case COMMAND_START:
+      if (!idle) {
+        status = STATUS_REFUSED;
+      } else {
+        startSession();
+      }
+      break;
+
+    case COMMAND_STOP:
+      if (idle || currentState == State::SHUTDOWN) {
+        status = STATUS_REFUSED;
+      } else if (!shutdownRequested) {
+        shutdownRequested = true;
+        completeCurrentCycle = true;  // Finish the beat in progress first
+      }
+      break;
+
+    case COMMAND_ABORT:
+      if (idle || currentState == State::SHUTDOWN) {
+        status = STATUS_REFUSED;
+      } else {
+        shutdownRequested = true;
+        completeCurrentCycle = true;
+        abortRequested = true;
+      }
+      break;
+
+    case COMMAND_JOG:
+      if (frame.length != 4) {
+        status = STATUS_BAD_PAYLOAD;
+      } else if (!idle) {
+        status = STATUS_REFUSED;
+      } else {
+        manualPosition = static_cast<long>(static_cast<int32_t>(readU32(frame.payload)));
+        currentState = State::RETURN_TO_MANUAL_POSITION;
+      }
+      break;
+
+    case COMMAND_PROFILE:
+      if (frame.length != 1 || frame.payload[0] >= PROFILE_COUNT) {
+        status = STATUS_BAD_PAYLOAD;
+      } else if ((frame.payload[0] == PROFILE_WAVEFORM && !HAS_WAVEFORM) ||
+                 (frame.payload[0] == PROFILE_LIVE_RAMP && !Pump::LIVE_RAMP)) {
+        status = STATUS_REFUSED;  // Not built with PLAY_WAVEFORM, or no AVR446 ramps to compute
+      } else {
+        pendingConfig.profile = frame.payload[0];
+        configPending = true;
+      }
+      break;
+
+    case COMMAND_RAMPS:
+      if (frame.length != 8 || readU16(&frame.payload[0]) == 0 || readU16(&frame.payload[4]) == 0) {
+        status = STATUS_BAD_PAYLOAD;
+      } else if (!Pump::LIVE_RAMP) {
+        status = STATUS_REFUSED;
+      } else {
+        pendingConfig.systoleAccelMilli = readU16(&frame.payload[0]);
+        pendingConfig.systoleFloorMicros = readU16(&frame.payload[2]);
+        pendingConfig.diastoleAccelMilli = readU16(&frame.payload[4]);
+        pendingConfig.diastoleFloorMicros = readU16(&frame.payload[6]);
+        configPending = true;
+      }
+      break;
+
+    case COMMAND_RATE:
+      if (frame.length != 2 || readU16(frame.payload) == 0 || readU16(frame.payload) > 600) {
+        status = STATUS_BAD_PAYLOAD;
+      } else {
+        pendingConfig.heartRate = readU16(frame.payload);
+        configPending = true;
+      }
+      break;
+
+    case COMMAND_RUNTIME:
+      if (frame.length != 4 || readU32(frame.payload) == 0 || readU32(frame.payload) > 4000000UL) {
+        status = STATUS_BAD_PAYLOAD;
+      } else {
+        pendingRuntimeMillis = readU32(frame.payload) * 1000UL;
+        configPending = true;
+      }
+      break;
+
+    case COMMAND_TELEMETRY:
+#ifdef TELEMETRY
+      if (frame.length != 1 || (frame.payload[0] & ~TELEMETRY_ALL) != 0) {
+        status = STATUS_BAD_PAYLOAD;
+      } else {
+        telemetrySetClasses(frame.payload[0]);
+      }
+#else
+      status = STATUS_REFUSED;  // Not built with TELEMETRY
+#endif
+      break;
+
+    default:
+      status = STATUS_UNKNOWN_COMMAND;
+      break;
+  }
+  reply[0] = status;
+  replySize = encodeCommandFrame(frame.command | COMMAND_REPLY, reply, replyLength, replyFrame);
+}
+
+// Single-letter diagnostic commands outside the framed protocol
+void handleDiagnosticCommand(uint8_t command) {
+  switch (command) {
+    case 'B':
+      beatReportToggle();
+      break;
+#ifdef STEP_JITTER_STATS
+    case 'J':
+      jitterDumpRequest();
+      break;
+#endif
+#ifdef LOOP_PROFILER
+    case 'P':
+      profilerDumpRequest();
+      break;
+#endif
+    default:
+      break;
+  }
+}
+
+// Parses at most COMMAND_BYTES_PER_PASS bytes of serial input per pass, so a
+// burst of commands can never hold up the next step deadline
 void handleSerialCommands() {
-  // Empty implementation - manual control removed
+  PROFILE_SCOPE(PROFILE_REGION_COMMANDS);
+  // A reply goes out whole, between text dumps, once the TX buffer has room
+  if (replySize != 0 && !serialDumpBusy() && Serial.availableForWrite() >= replySize) {
+    Serial.write(replyFrame, replySize);
+    replySize = 0;
+  }
+  if (replySize == 0) {
+    telemetryService();
+  }
+  for (uint8_t budget = COMMAND_BYTES_PER_PASS; budget > 0 && replySize == 0; budget--) {
+    // Leave further input unread while a reply or text dump is still going out
+    if (Serial.available() <= 0 || (!commandParser.inFrame() && serialDumpBusy())) {
+      break;
+    }
+    const uint8_t byte = static_cast<uint8_t>(Serial.read());
+    switch (commandParser.feed(byte, commandFrame)) {
+      case CommandParser::FRAME:
+        executeCommand(commandFrame);
+        break;
+      case CommandParser::TEXT:
+        handleDiagnosticCommand(byte);
+        break;
+      case CommandParser::DROPPED:
+        droppedFrames++;
+        break;
+      default:
+        break;
+    }
+  }
+  serialDumpService();
 }
 
 void loop() {
+  PROFILE_SCOPE(static_cast<uint8_t>(currentState));  // Whole pass, charged to the state it started in
   unsigned long currentMillis = millis();
   // Check if runtime exceeded, but only set the flag
   if (currentMillis - startMillis >= runtimeMillis && !shutdownRequested) {
@@ -135,117 +648,48 @@ void loop() {
 
   // Handle serial commands
   handleSerialCommands();
+  if (abortRequested) {
+    abortAcceleration();
+  }
 
   switch (currentState) {
     case State::SYSTOLE_ACCEL:
-      if (handleMotorStep(true, delays[currentStep])) {  // true for clockwise (systole/contraction)
-        currentStep++;
-        if (currentStep >= STEPS) {
-          currentStep = 0;
-          currentState = State::SYSTOLE_DECEL;
-        }
-      }
-      break;
-
     case State::SYSTOLE_DECEL:
-      if (handleMotorStep(true, delays[STEPS - currentStep - 1])) {  // true for clockwise (systole/contraction)
-        currentStep++;
-        if (currentStep >= STEPS) {
-          currentStep = 0;
-          calculateDelays(0.02 , 15);  // Slower acceleration for diastole (relaxation) phase
-          setDirection(false);  // counter-clockwise for diastole (relaxation)
-          currentState = State::DIASTOLE_ACCEL;
-        }
-      }
-      break;
-
     case State::DIASTOLE_ACCEL:
-      if (handleMotorStep(false, delays[currentStep])) {  // false for counter-clockwise (diastole/relaxation)
-        currentStep++;
-        if (currentStep >= STEPS) {
-          currentStep = 0;
-          currentState = State::DIASTOLE_DECEL;
-        }
-      }
-      break;
-
     case State::DIASTOLE_DECEL:
-      if (handleMotorStep(false, delays[STEPS - currentStep - 1])) {  // false for counter-clockwise (diastole/relaxation)
-        currentStep++;
-        if (currentStep >= STEPS) {
-          // If shutdown was requested and we're in diastole, go to shutdown
-          if (shutdownRequested && completeCurrentCycle) {
-            completeCurrentCycle = false;
-            currentState = State::SHUTDOWN;
-          } else if (cyclePosition != initialPosition) {
-            // If not at start, do return
-            currentState = State::RETURN_TO_START;
-            returnStepsRemaining = abs(cyclePosition - initialPosition);
-            returnDirection = cyclePosition < initialPosition;
-            setDirection(returnDirection);
-          } else {
-            // If at start and shutdown requested, go to shutdown
-            if (shutdownRequested) {
-              currentState = State::SHUTDOWN;
-            } else {
-              // Otherwise continue with next cycle
-              currentState = State::CYCLE_COMPLETE;
-              calculateDelays(0.05, 1);  // Faster acceleration for next systole (contraction)
-              setDirection(true);  // clockwise for next systole (contraction)
-              currentStep = 0;
-            }
-          }
-        }
+    case State::WAVEFORM_PLAYBACK:
+      if (!executeSegments() && stepTimerIdle()) {  // Let the queued steps land before reading the position
+        finishBeat();
       }
       break;
 
     case State::RETURN_TO_START:
-      if (returnStepsRemaining > 0) {
-        returnDirection = cyclePosition < initialPosition;  // Recalculate direction
-        setDirection(returnDirection);
-        if (handleMotorStep(returnDirection, 40)) {  // Extremely fast return
-          returnStepsRemaining--;
-        }
-      } else {
-        // Check if we're at initial position
-        if (abs(cyclePosition - initialPosition) < 5) {  // Allow small tolerance
-          cyclePosition = initialPosition;  // Force to exact initial position
-          // If shutdown was requested, go to shutdown
-          if (shutdownRequested) {
-            currentState = State::SHUTDOWN;
-          } else {
-            currentState = State::CYCLE_COMPLETE;
-            calculateDelays(0.05, 1);  // Reset to systole speed for next cycle
-            setDirection(true);  // clockwise for systole
-            currentStep = 0;
-          }
+      if (moveTo(initialPosition)) {
+        // If shutdown was requested, go to shutdown
+        if (shutdownRequested) {
+          currentState = State::SHUTDOWN;
         } else {
-          // If not at initial position, recalculate return
-          returnStepsRemaining = abs(cyclePosition - initialPosition);
-          returnDirection = cyclePosition < initialPosition;
+          currentState = State::CYCLE_COMPLETE;
         }
       }
       break;
 
     case State::CYCLE_COMPLETE:
-      // Only start new cycle if not shutting down
-      if (!shutdownRequested) {
-        currentState = State::SYSTOLE_ACCEL;
+      // Only start new cycle if not shutting down; the beat scheduler holds the
+      // next beat back until its slot in the HEART_RATE schedule
+      applyPendingConfig();
+      if (shutdownRequested) {
+        currentState = State::SHUTDOWN;
+      } else if (beatSchedulerWait()) {
+        const BeatReport& beat = beatSchedulerLastBeat();
+        telemetryTiming(beat.beat - 1, beat.error, beat.dwell, beat.scale);
+        queueBeat();
+        reportBeatStart();
       }
       break;
 
     case State::SHUTDOWN:
-      if (abs(cyclePosition - initialPosition) > 5) {  // Check if we're not at home with tolerance
-        // Return to initial position before final shutdown
-        returnStepsRemaining = abs(cyclePosition - initialPosition);
-        returnDirection = cyclePosition < initialPosition;
-        setDirection(returnDirection);
-        
-        if (handleMotorStep(returnDirection, 250)) {  // Moderate speed return
-          returnStepsRemaining--;
-        }
-      } else {
-        cyclePosition = initialPosition;  // Force to exact initial position
+      if (moveTo(initialPosition)) {  // Return to initial position before final shutdown
         currentState = State::HOLD_POSITION;
         // Keep motor enabled to maintain position at end of runtime
       }
@@ -257,17 +701,9 @@ void loop() {
       break;
 
     case State::RETURN_TO_MANUAL_POSITION:
-      if (cyclePosition != manualPosition) {
-        bool dir = cyclePosition < manualPosition;
-        setDirection(dir);
-        if (handleMotorStep(dir, 40)) {  // Fast return to position
-          if (dir) {
-            cyclePosition++;
-          } else {
-            cyclePosition--;
-          }
-        }
-      } else {
+      // The step timer already counts every step into cyclePosition, so the
+      // move is planned from the position it reports
+      if (moveTo(manualPosition)) {
         currentState = State::HOLD_POSITION;
       }
       break;
@@ -276,4 +712,17 @@ void loop() {
       initializeSystoleState();
       break;
   }
-}
\ No newline at end of file
+
+#ifdef TELEMETRY
+  if (currentState != reportedState) {
+    reportedState = currentState;
+    telemetryPhase(static_cast<uint8_t>(currentState), micros(), readCyclePosition());
+  }
+  uint32_t reversalMicros;
+  bool reversalClockwise;
+  long reversalPosition;
+  if (stepTimerTakeReversal(reversalMicros, reversalClockwise, reversalPosition)) {
+    telemetryReversal(reversalClockwise, reversalMicros, reversalPosition);
+  }
+#endif
+}
@@ -1,7 +1,42 @@
 #ifndef MAIN_H
 #define MAIN_H
 
-#include <Arduino.h>
+#include "hal.h"
+
+// Define pin numbers for motor control
+constexpr int DIR_PIN = 2;    // Direction pin
+constexpr int STEP_PIN = 5;   // Step pin
+constexpr int ENABLE_PIN = 8; // Enable pin
+
+// Limits for the homing moves (RETURN_TO_START, SHUTDOWN, RETURN_TO_MANUAL_POSITION):
+// up to the rate the returns have always stepped at, which they used to jump
+// to from rest. This acceleration starts at 1.1 ms per step and gets there
+// after about 400 steps, well inside the ramp; the systole's 50 would still be
+// at 116 us after 600, so a 1200-step return would take 275 ms instead of 80.
+constexpr uint16_t MOVE_ACCEL_MILLI = 600;
+constexpr uint16_t MOVE_FLOOR_MICROS = 40;
+
+// Position tracking relative to cycle start position (written by the step timer ISR)
+extern volatile long cyclePosition;
+
+// State machine states
+enum class State {
+  SYSTOLE_ACCEL,  // Always start with systole
+  SYSTOLE_DECEL,
+  DIASTOLE_ACCEL,
+  DIASTOLE_DECEL,
+  RETURN_TO_START,
+  CYCLE_COMPLETE,
+  SHUTDOWN,
+  HOLD_POSITION,
+  RETURN_TO_MANUAL_POSITION,  // New state for returning to manually set position
+  WAVEFORM_PLAYBACK           // Whole beat played from a compiled waveform schedule
+};
+
+extern State currentState;
+
+// Session length; setup() starts the clock and loop() requests SHUTDOWN once it expires
+extern unsigned long runtimeMillis;
 
 // Function declarations
 void setup();
@@ -9,7 +44,8 @@ void loop();
 void enableMotor(bool enable);
 void setDirection(bool clockwise);
 bool handleMotorStep(bool clockwise, int stepDelay);
-void calculateDelays(float accel, int highSpeed);
+void queueBeat();
 void initializeSystoleState();
+void finishBeat();
 
 #endif // MAIN_H 
\ No newline at end of file
@@ -0,0 +1,115 @@
+#ifndef MOTION_PROFILES_H
+#define MOTION_PROFILES_H
+
+#include <stdint.h>
+
+#ifdef __AVR__
+#include <avr/pgmspace.h>
+#else
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+#define pgm_read_word(addr) (*(const uint16_t*)(addr))
+#endif
+
+// Step-delay tables evaluated entirely at compile time and stored in flash.
+//
+// The generators below reproduce the old runtime calculateDelays() variants
+// operation for operation in single precision (the AVR's double is 32 bits), so
+// the tables hold the same integers the firmware used to compute at every phase
+// change. Nothing on the step path touches float math any more.
+
+template <int N>
+struct DelayTable {
+  uint16_t delays[N];
+};
+
+template <int N>
+inline uint16_t readDelay(const DelayTable<N>& table, int index) {
+  return pgm_read_word(&table.delays[index]);
+}
+
+namespace profile_math {
+
+constexpr double PI_D = 3.14159265358979323846;
+
+// Newton iteration to the correctly rounded single-precision square root
+constexpr float sqrtf(float x) {
+  if (x <= 0.0f) {
+    return 0.0f;
+  }
+  double guess = x > 1.0f ? x : 1.0;
+  for (int i = 0; i < 64; i++) {
+    double next = 0.5 * (guess + x / guess);
+    if (next == guess) {
+      break;
+    }
+    guess = next;
+  }
+  return static_cast<float>(guess);
+}
+
+// Taylor series sine for arguments in [0, PI], rounded to single precision
+constexpr float sinf(float x) {
+  double r = x;
+  if (r > PI_D / 2) {
+    r = PI_D - r;  // sin(PI - x) == sin(x) keeps the series near zero
+  }
+  double term = r;
+  double sum = r;
+  for (int n = 1; n < 20; n++) {
+    term *= -r * r / ((2 * n) * (2 * n + 1));
+    sum += term;
+  }
+  return static_cast<float>(sum);
+}
+
+}  // namespace profile_math
+
+// AVR446 constant-acceleration ramp, formerly calculateDelays(accel, highSpeed)
+template <int N>
+constexpr DelayTable<N> makeAccelTable(float accel, int highSpeed) {
+  DelayTable<N> table{};
+  const float angle = 1;  // Angle of rotation per step
+  const float c0 = 900.0f * profile_math::sqrtf(2 * angle / accel) * 0.67703f;  // Initial delay
+  float lastDelay = 0;
+  for (int i = 0; i < N; i++) {
+    float d = c0;
+    if (i > 0) {
+      d = lastDelay - (2 * lastDelay) / (4 * i + 1);
+    }
+    if (d < highSpeed) {
+      d = highSpeed;
+    }
+    table.delays[i] = static_cast<uint16_t>(static_cast<int>(d));
+    lastDelay = d;
+  }
+  return table;
+}
+
+// Sinusoidal profile from code_versions/sinusoidaltest.cpp. maxSpeed and
+// minSpeed are delays in microseconds (smaller = faster); a full sine spans
+// 0..PI, a half sine 0..PI/2 for a single acceleration or deceleration.
+template <int N>
+constexpr DelayTable<N> makeSineTable(float maxSpeed, float minSpeed, bool fullSine) {
+  DelayTable<N> table{};
+  const float pi = static_cast<float>(profile_math::PI_D);
+  const float speedAmplitude = (minSpeed - maxSpeed) / 2.0f;
+  const float midSpeed = maxSpeed + speedAmplitude;
+  for (int i = 0; i < N; i++) {
+    float delay = 0;
+    if (fullSine) {
+      float angle = pi * static_cast<float>(i) / static_cast<float>(N - 1);
+      delay = midSpeed - speedAmplitude * profile_math::sinf(angle);
+    } else {
+      float angle = pi / 2 * static_cast<float>(i) / static_cast<float>(N - 1);
+      float ratio = profile_math::sinf(angle);
+      delay = minSpeed - (minSpeed - maxSpeed) * ratio;
+    }
+    if (delay < maxSpeed) delay = maxSpeed;
+    if (delay > minSpeed) delay = minSpeed;
+    table.delays[i] = static_cast<uint16_t>(static_cast<int>(delay));
+  }
+  return table;
+}
+
+#endif // MOTION_PROFILES_H
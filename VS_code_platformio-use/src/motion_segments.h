@@ -0,0 +1,81 @@
+#ifndef MOTION_SEGMENTS_H
+#define MOTION_SEGMENTS_H
+
+#include "compact_table.h"
+#include "fixed_ramp.h"
+#include "main.h"
+#include "waveform.h"
+
+#include <stdint.h>
+
+// Ready-to-run motion segments for the beat in progress.
+//
+// When a beat starts, queueBeat() in loop() sets up everything the beat
+// needs: direction, step count and which profile each phase reads (a flash
+// table's reader or a FixedRamp, both begun for the beat, or the compiled
+// waveform), and queues one segment per phase. The step loop then only hands
+// the head segment's steps to the step timer and, when one ends, moves
+// straight on to the next, so a phase boundary costs no more than any other
+// step. A phase reads table index firstIndex + indexStep * step, and the
+// DECEL phases walk their table downwards.
+//
+// This is the phase switch restructured, not a motion planner: the segments
+// hold one beat, set up when it starts, with no lookahead across segments or
+// beats and no junction speeds to negotiate (the phases meet at rest or at
+// their table's peak). SegmentQueue is a plain FIFO; it is filled and drained
+// in loop(), never in an interrupt, so it needs no locking, and the step timer
+// only ever sees the steps loop() hands it.
+
+enum class SegmentSource : uint8_t {
+  TABLE,      // Flash delay table (CompactTableReader)
+  LIVE_RAMP,  // FixedRamp
+  WAVEFORM,   // Compiled schedule, entries carry their own direction and dwells
+};
+
+struct MotionSegment {
+  State state;  // Reported while the segment runs
+  SegmentSource source;
+  bool clockwise;
+  int8_t indexStep;  // +1 for ACCEL, -1 for DECEL
+  int16_t firstIndex;
+  uint16_t steps;
+  union {
+    CompactTableReader* table;
+    FixedRamp* ramp;
+    const Waveform* waveform;
+  };
+};
+
+// N is a power of two no larger than 128
+template <uint8_t N>
+class SegmentQueue {
+  static_assert(N > 0 && N <= 128 && (N & (N - 1)) == 0, "SegmentQueue size must be a power of two up to 128");
+
+ public:
+  // False when the queue is full
+  bool push(const MotionSegment& segment) {
+    if (static_cast<uint8_t>(head - tail) == N) {
+      return false;
+    }
+    slots[head & (N - 1)] = segment;
+    head = static_cast<uint8_t>(head + 1);
+    return true;
+  }
+
+  // The segment being executed, nullptr when there is none
+  MotionSegment* front() { return tail == head ? nullptr : &slots[tail & (N - 1)]; }
+
+  void pop() { tail = static_cast<uint8_t>(tail + 1); }
+
+  // Drops everything queued
+  void clear() { tail = head; }
+
+  bool empty() const { return head == tail; }
+
+ private:
+  MotionSegment slots[N];
+  uint8_t head = 0;
+  uint8_t tail = 0;
+};
+
+#endif // MOTION_SEGMENTS_H
@@ -0,0 +1,19 @@
+#include "point_move.h"
+
+void PointMove::begin(long from, long to, uint16_t accelMilli, uint16_t floorMicros) {
+  towardsLower = to < from;
+  length = towardsLower ? from - to : to - from;
+  step = 0;
+  ramp.begin(accelMilli, floorMicros);
+}
+
+uint16_t PointMove::delay() {
+  long index = step;
+  if (length - 1 - step < index) {
+    index = length - 1 - step;  // Decelerating: the same ramp walked back down
+  }
+  if (index > FIXED_RAMP_MAX_STEPS - 1) {
+    index = FIXED_RAMP_MAX_STEPS - 1;
+  }
+  return ramp.delayAt(static_cast<int>(index));
+}
@@ -0,0 +1,39 @@
+#ifndef POINT_MOVE_H
+#define POINT_MOVE_H
+
+#include "fixed_ramp.h"
+
+#include <stdint.h>
+
+// Point-to-point move from rest to rest, shared by the homing states.
+//
+// Step s of an n-step move waits delayAt(min(s, n-1-s)) on a FixedRamp: the
+// motor accelerates along the ramp until it reaches the floor (cruise), then
+// walks the same ramp back down so it lands at rest on the last step. A move
+// too short to reach the floor turns round in the middle (a triangular
+// profile) at the speed it has reached. The ramp is at most
+// FIXED_RAMP_MAX_STEPS long, so limits that only reach the floor later would
+// leave a long move cruising at the ramp's last delay; pick ones that get
+// there in time (main.cpp checks its own at compile time).
+
+class PointMove {
+ public:
+  // Plans the move from `from` to `to`; the motor must be at rest. accelMilli
+  // and floorMicros are the ramp's limits, as in FixedRamp::begin()
+  void begin(long from, long to, uint16_t accelMilli, uint16_t floorMicros);
+
+  bool done() const { return step >= length; }
+  // Clockwise counts cyclePosition down
+  bool clockwise() const { return towardsLower; }
+  // Delay before the next step; advance() once it has been queued
+  uint16_t delay();
+  void advance() { step++; }
+
+ private:
+  FixedRamp ramp;
+  long length = 0;
+  long step = 0;
+  bool towardsLower = true;
+};
+
+#endif // POINT_MOVE_H
@@ -0,0 +1,85 @@
+#ifndef PROFILE_POLICIES_H
+#define PROFILE_POLICIES_H
+
+#include "motion_profiles.h"
+
+// Motion-profile policies for PulsatileDriver.
+//
+// A policy turns one ramp's parameters (its Ramp struct) into a flash delay
+// table at compile time. Policies are plain types with static constexpr
+// members: the firmware picks one per build, so the step path reads a table
+// and never dispatches on the profile.
+
+// AVR446 constant-acceleration ramp, calculateDelays(accel, highSpeed) of
+// src/main.cpp and code_versions/100mlSV.cpp
+struct Avr446Profile {
+  struct Ramp {
+    uint16_t accelMilli;   // accel in thousandths (0.045 -> 45)
+    uint16_t floorMicros;  // highSpeed, the shortest delay
+  };
+
+  // FixedRamp computes the same ramp on the fly, so it can stand in for the table
+  static constexpr bool LIVE_RAMP = true;
+
+  template <int N>
+  static constexpr DelayTable<N> table(Ramp ramp) {
+    return makeAccelTable<N>(ramp.accelMilli / 1000.0f, ramp.floorMicros);
+  }
+
+  static constexpr Ramp liveRamp(Ramp ramp) { return ramp; }
+};
+
+// Sinusoidal ramps of code_versions/sinusoidaltest.cpp, delays in
+// microseconds (smaller = faster)
+struct SineRamp {
+  uint16_t fastMicros;  // maxSpeed
+  uint16_t slowMicros;  // minSpeed
+};
+
+// calculateDelays(maxSpeed, minSpeed, true): slow -> fast -> slow over 0..PI
+struct SineProfile {
+  using Ramp = SineRamp;
+  static constexpr bool LIVE_RAMP = false;
+
+  template <int N>
+  static constexpr DelayTable<N> table(Ramp ramp) {
+    return makeSineTable<N>(ramp.fastMicros, ramp.slowMicros, true);
+  }
+
+  static constexpr Avr446Profile::Ramp liveRamp(Ramp) { return {0, 0}; }
+};
+
+// calculateDelays(maxSpeed, minSpeed, false): slow -> fast over 0..PI/2
+struct HalfSineProfile {
+  using Ramp = SineRamp;
+  static constexpr bool LIVE_RAMP = false;
+
+  template <int N>
+  static constexpr DelayTable<N> table(Ramp ramp) {
+    return makeSineTable<N>(ramp.fastMicros, ramp.slowMicros, false);
+  }
+
+  static constexpr Avr446Profile::Ramp liveRamp(Ramp) { return {0, 0}; }
+};
+
+// Delays listed by hand (or generated elsewhere) as a constexpr array with at
+// least the driver's TABLE_STEPS entries
+struct TableProfile {
+  struct Ramp {
+    const uint16_t* delays;
+  };
+  static constexpr bool LIVE_RAMP = false;
+
+  template <int N>
+  static constexpr DelayTable<N> table(Ramp ramp) {
+    DelayTable<N> table{};
+    for (int i = 0; i < N; i++) {
+      table.delays[i] = ramp.delays[i];
+    }
+    return table;
+  }
+
+  static constexpr Avr446Profile::Ramp liveRamp(Ramp) { return {0, 0}; }
+};
+
+#endif // PROFILE_POLICIES_H
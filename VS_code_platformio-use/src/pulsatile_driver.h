@@ -0,0 +1,88 @@
+#ifndef PULSATILE_DRIVER_H
+#define PULSATILE_DRIVER_H
+
+#include "profile_policies.h"
+
+// Compile-time description of one pulsatile pump build.
+//
+// The former firmware forks (src/main.cpp, code_versions/100mlSV.cpp and
+// code_versions/sinusoidaltest.cpp) ran the same state machine and differed
+// only in how calculateDelays() filled the delay table and in a few constants.
+// PulsatileDriver<Profile, Config> carries exactly those differences; main.cpp
+// runs the state machine against the one selected with -D PUMP_VARIANT.
+//
+// Config supplies:
+//   TABLE_STEPS       entries per delay table (the old STEPS)
+//   PHASE_STEPS       steps per ACCEL or DECEL phase; DECEL walks the table
+//                     back from its last entry, as the old code did
+//   SYSTOLE/DIASTOLE  Profile::Ramp parameters of each stroke
+//   HEART_RATE        beats per minute
+//   RUNTIME_SECONDS   session length
+
+template <class ProfilePolicy, class Config>
+struct PulsatileDriver {
+  using Profile = ProfilePolicy;
+
+  static constexpr int TABLE_STEPS = Config::TABLE_STEPS;
+  static constexpr int PHASE_STEPS = Config::PHASE_STEPS;
+  static constexpr int HEART_RATE = Config::HEART_RATE;
+  static constexpr unsigned long RUNTIME_SECONDS = Config::RUNTIME_SECONDS;
+
+  // FixedRamp walks one step at a time, so it only replaces tables that the
+  // phases traverse end to end
+  static constexpr bool LIVE_RAMP = Profile::LIVE_RAMP && PHASE_STEPS == TABLE_STEPS;
+  static constexpr Avr446Profile::Ramp SYSTOLE_LIVE = Profile::liveRamp(Config::SYSTOLE);
+  static constexpr Avr446Profile::Ramp DIASTOLE_LIVE = Profile::liveRamp(Config::DIASTOLE);
+
+  static_assert(PHASE_STEPS > 0 && PHASE_STEPS <= TABLE_STEPS, "a phase cannot run past its table");
+  static_assert(!LIVE_RAMP || TABLE_STEPS <= 600, "FixedRamp covers at most FIXED_RAMP_MAX_STEPS");
+
+  static constexpr DelayTable<TABLE_STEPS> systoleTable() { return Profile::template table<TABLE_STEPS>(Config::SYSTOLE); }
+  static constexpr DelayTable<TABLE_STEPS> diastoleTable() { return Profile::template table<TABLE_STEPS>(Config::DIASTOLE); }
+
+  // Table index of step `step` of an ACCEL or DECEL phase
+  static constexpr int accelIndex(int step) { return step; }
+  static constexpr int decelIndex(int step) { return TABLE_STEPS - step - 1; }
+};
+
+// Named build configurations, one per former fork
+
+// src/main.cpp: AVR446 ramps 0.05/1 and 0.02/15, 15 s sessions
+struct MainStroke {
+  static constexpr int TABLE_STEPS = 600;
+  static constexpr int PHASE_STEPS = 600;
+  static constexpr Avr446Profile::Ramp SYSTOLE = {50, 1};   // Faster acceleration for systole (contraction)
+  static constexpr Avr446Profile::Ramp DIASTOLE = {20, 15};  // Slower acceleration for diastole (relaxation)
+  static constexpr int HEART_RATE = 60;
+  static constexpr unsigned long RUNTIME_SECONDS = 15;
+};
+using MainPump = PulsatileDriver<Avr446Profile, MainStroke>;
+
+// code_versions/100mlSV.cpp: gentler AVR446 ramps 0.045/1 and 0.015/15, 45 min sessions
+struct Stroke100mlSV {
+  static constexpr int TABLE_STEPS = 600;
+  static constexpr int PHASE_STEPS = 600;
+  static constexpr Avr446Profile::Ramp SYSTOLE = {45, 1};
+  static constexpr Avr446Profile::Ramp DIASTOLE = {15, 15};
+  static constexpr int HEART_RATE = 60;
+  static constexpr unsigned long RUNTIME_SECONDS = 2700;
+};
+using Pump100mlSV = PulsatileDriver<Avr446Profile, Stroke100mlSV>;
+
+// code_versions/sinusoidaltest.cpp: half-sine ramps over the first half of a
+// 600-entry table, 300 steps per phase, 45 min sessions. DECEL starts from the
+// far end of the table exactly as that file did.
+struct SinusoidalStroke {
+  static constexpr int TABLE_STEPS = 600;
+  static constexpr int PHASE_STEPS = 300;
+  static constexpr SineRamp SYSTOLE = {1, 300};
+  static constexpr SineRamp DIASTOLE = {15, 400};
+  static constexpr int HEART_RATE = 60;
+  static constexpr unsigned long RUNTIME_SECONDS = 2700;
+};
+using SinusoidalPump = PulsatileDriver<HalfSineProfile, SinusoidalStroke>;
+
+// sinusoidaltest.cpp with its fullSine option switched on
+using FullSinePump = PulsatileDriver<SineProfile, SinusoidalStroke>;
+
+#endif // PULSATILE_DRIVER_H
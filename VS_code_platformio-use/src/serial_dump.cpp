@@ -0,0 +1,52 @@
+#include "serial_dump.h"
+#include "hal.h"
+
+static SerialDumpFormatter dumpFormatter = nullptr;
+static uint8_t dumpLines = 0;
+static uint8_t dumpNext = 0;
+static char dumpLine[SERIAL_DUMP_LINE_SIZE];
+static uint8_t dumpLength = 0;
+static uint8_t dumpSent = 0;
+
+bool serialDumpRequest(uint8_t lineCount, SerialDumpFormatter formatter) {
+  if (dumpFormatter != nullptr) {
+    return false;
+  }
+  dumpFormatter = formatter;
+  dumpLines = lineCount;
+  dumpNext = 0;
+  dumpLength = 0;
+  dumpSent = 0;
+  return true;
+}
+
+void serialDumpService() {
+  if (dumpFormatter == nullptr) {
+    return;
+  }
+  if (dumpSent >= dumpLength) {
+    if (dumpNext >= dumpLines) {
+      dumpFormatter = nullptr;
+      return;
+    }
+    size_t length = dumpFormatter(dumpNext++, dumpLine, sizeof(dumpLine) - 1);
+    if (length > sizeof(dumpLine) - 1) {
+      length = sizeof(dumpLine) - 1;
+    }
+    dumpLine[length++] = '\n';
+    dumpLength = static_cast<uint8_t>(length);
+    dumpSent = 0;
+  }
+  int room = Serial.availableForWrite();
+  if (room > dumpLength - dumpSent) {
+    room = dumpLength - dumpSent;
+  }
+  if (room > 0) {
+    Serial.write(reinterpret_cast<const uint8_t*>(dumpLine + dumpSent), room);
+    dumpSent += room;
+  }
+}
+
+bool serialDumpBusy() {
+  return dumpFormatter != nullptr;
+}
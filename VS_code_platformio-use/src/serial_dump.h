@@ -0,0 +1,25 @@
+#ifndef SERIAL_DUMP_H
+#define SERIAL_DUMP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Non-blocking line dump for the diagnostic serial commands.
+//
+// A dump is a fixed number of text lines produced one at a time by a formatter.
+// serialDumpService() runs once per loop() pass and writes only what fits in
+// the serial TX buffer, so printing a report never stalls the state machine.
+// Only one dump runs at a time; a request made while another is in progress
+// is refused, so callers leave further commands unread until it finishes.
+
+constexpr size_t SERIAL_DUMP_LINE_SIZE = 160;
+
+// Writes line `index` into `line` (at most `size` bytes, no newline needed) and
+// returns its length
+typedef size_t (*SerialDumpFormatter)(uint8_t index, char* line, size_t size);
+
+bool serialDumpRequest(uint8_t lineCount, SerialDumpFormatter formatter);
+void serialDumpService();
+bool serialDumpBusy();
+
+#endif // SERIAL_DUMP_H
@@ -0,0 +1,49 @@
+#include "step_jitter.h"
+#include "serial_dump.h"
+
+#ifdef STEP_JITTER_STATS
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef __AVR__
+#include <util/atomic.h>
+#endif
+
+JitterStats jitterStats[JITTER_STATE_COUNT];
+
+void jitterReset() {
+#ifdef __AVR__
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+#endif
+  {
+    memset(jitterStats, 0, sizeof(jitterStats));
+  }
+}
+
+// Formats one state's line from a snapshot taken with the ISR held off
+static size_t formatLine(uint8_t state, char* line, size_t size) {
+  JitterStats stats;
+#ifdef __AVR__
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+#endif
+  {
+    stats = jitterStats[state];
+  }
+  const long mean = stats.count != 0 ? static_cast<long>(stats.errorSum / static_cast<int32_t>(stats.count)) : 0;
+  int length = snprintf(line, size, "J %u n=%lu min=%d max=%d mean=%ld miss=%lu clamp=%lu h=", state,
+                        static_cast<unsigned long>(stats.count), stats.minError, stats.maxError, mean,
+                        static_cast<unsigned long>(stats.missed), static_cast<unsigned long>(stats.clamped));
+  for (uint8_t bin = 0; bin < JITTER_BIN_COUNT && length < static_cast<int>(size); bin++) {
+    length += snprintf(line + length, size - length, bin == 0 ? "%lu" : ",%lu",
+                       static_cast<unsigned long>(stats.bins[bin]));
+  }
+  return length < static_cast<int>(size) ? length : size;
+}
+
+void jitterDumpRequest() {
+  serialDumpRequest(JITTER_STATE_COUNT, formatLine);
+}
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef STEP_JITTER_H
+#define STEP_JITTER_H
+
+#include <stdint.h>
+
+// Step-timing jitter instrumentation, compiled in with -D STEP_JITTER_STATS.
+//
+// The step timer ISR reports each pulse's real interval since the previous
+// pulse (in timer ticks, measured from Timer1's counter rather than micros())
+// against the stepDelay the state machine commanded for it. The error feeds a
+// fixed-size histogram per State with min/max/mean and two counters:
+//   clamped - commanded delay was below MIN_STEP_INTERVAL_US
+//   missed  - the pulse landed more than JITTER_MISS_TOLERANCE_US after the
+//             interval the engine actually loaded
+// Ten states at 52 bytes each take 520 bytes of SRAM. Without the flag none
+// of this is compiled and the step path is unchanged.
+//
+// Sending 'J' on the serial port dumps one line per state. The dump is written
+// only as fast as the TX buffer drains, so it never blocks loop().
+
+constexpr uint8_t JITTER_STATE_COUNT = 10;  // Values of the State enum
+constexpr uint8_t JITTER_BIN_COUNT = 8;
+constexpr int16_t JITTER_MISS_TOLERANCE_US = 8;
+
+// Upper bin edges of the error histogram in microseconds; the last bin is open
+constexpr int16_t JITTER_BIN_EDGES_US[JITTER_BIN_COUNT - 1] = {-8, -2, 2, 8, 32, 128, 512};
+
+struct JitterStats {
+  uint32_t count;
+  int32_t errorSum;  // Microseconds
+  int16_t minError;
+  int16_t maxError;
+  uint32_t missed;
+  uint32_t clamped;
+  uint32_t bins[JITTER_BIN_COUNT];
+};
+
+extern JitterStats jitterStats[JITTER_STATE_COUNT];
+
+// Called from the step timer ISR. actualTicks and loadedTicks are Timer1 ticks
+// (STEP_TIMER_TICKS_PER_US per microsecond); commandedMicros is the stepDelay
+// handed to handleMotorStep() before clamping.
+inline void jitterRecord(uint8_t state, uint16_t commandedMicros, uint16_t loadedTicks,
+                         uint32_t actualTicks, uint8_t ticksPerMicro) {
+  if (state >= JITTER_STATE_COUNT) {
+    return;
+  }
+  JitterStats& stats = jitterStats[state];
+  const int32_t actualMicros = static_cast<int32_t>(actualTicks / ticksPerMicro);
+  int32_t error = actualMicros - commandedMicros;
+  if (error > 32767) {
+    error = 32767;  // Saturate: a stall this long is already counted as missed
+  }
+  const int16_t errorMicros = static_cast<int16_t>(error);
+
+  uint8_t bin = 0;
+  while (bin < JITTER_BIN_COUNT - 1 && errorMicros >= JITTER_BIN_EDGES_US[bin]) {
+    bin++;
+  }
+  stats.bins[bin]++;
+  if (stats.count == 0 || errorMicros < stats.minError) {
+    stats.minError = errorMicros;
+  }
+  if (stats.count == 0 || errorMicros > stats.maxError) {
+    stats.maxError = errorMicros;
+  }
+  stats.count++;
+  stats.errorSum += errorMicros;
+  if (commandedMicros * static_cast<uint32_t>(ticksPerMicro) < loadedTicks) {
+    stats.clamped++;
+  }
+  if (actualTicks > loadedTicks + static_cast<uint32_t>(JITTER_MISS_TOLERANCE_US) * ticksPerMicro) {
+    stats.missed++;
+  }
+}
+
+void jitterReset();
+
+// Starts a dump of every state's statistics through serialDumpService()
+void jitterDumpRequest();
+
+#endif // STEP_JITTER_H
@@ -0,0 +1,358 @@
+#include "step_timer.h"
+#include "fast_gpio.h"
+#include "main.h"
+#include "step_jitter.h"
+
+#ifdef __AVR__
+#include <util/atomic.h>
+#endif
+
+// Step currently loaded in the timer; armedPulse is false for a dwell
+static volatile bool armed = false;
+static volatile bool armedPulse = true;
+static volatile bool armedClockwise = true;
+
+// Step waiting behind it, loaded by the ISR when the armed step fires
+static volatile bool nextValid = false;
+static volatile bool nextPulse = true;
+static volatile bool nextClockwise = true;
+static volatile uint16_t nextTicks = 0;
+
+#ifdef TELEMETRY
+// Last motor reversal, for stepTimerTakeReversal()
+static bool pulsedBefore = false;
+static bool lastPulseClockwise = true;
+static volatile bool reversalPending = false;
+static volatile uint32_t reversalMicros = 0;
+static volatile bool reversalClockwise = true;
+static volatile long reversalPosition = 0;
+#endif
+
+#if defined(STEP_JITTER_STATS) || !defined(__AVR__)
+// State loop() was in when it queued the armed and the waiting step: the jitter
+// histograms are kept per state, and off-target pump_sim counts steps by it
+#define STEP_TIMER_TAGS
+static volatile uint8_t armedTag = 0;
+static volatile uint8_t nextTag = 0;
+#endif
+
+#ifdef STEP_JITTER_STATS
+// Commanded delay of the armed and waiting steps, plus what is needed to
+// reconstruct the real interval between pulses in timer ticks
+static volatile uint16_t armedCommand = 0;
+static volatile uint16_t armedTicks = 0;
+static volatile uint16_t nextCommand = 0;
+static volatile uint16_t startGapTicks = 0;    // Idle time between the last pulse and a restart
+static volatile uint16_t lastLatencyTicks = 0; // ISR entry delay of the last match
+static volatile bool lastPulseValid = false;  // A pulse or dwell match to measure from
+
+// Ticks between the compare match and the pulse / since the last pulse while halted
+static uint16_t timerLatencyTicks();
+static uint16_t timerIdleTicks();
+#endif
+
+static uint16_t intervalToTicks(unsigned int intervalMicros) {
+  if (intervalMicros < MIN_STEP_INTERVAL_US) {
+    intervalMicros = MIN_STEP_INTERVAL_US;
+  }
+  if (intervalMicros > MAX_STEP_INTERVAL_US) {
+    intervalMicros = MAX_STEP_INTERVAL_US;
+  }
+  return static_cast<uint16_t>(intervalMicros * STEP_TIMER_TICKS_PER_US);
+}
+
+// Timer backend: arm the first step of a run / stop when the queue runs dry
+static void timerStart(uint16_t ticks);
+static void timerReload(uint16_t ticks);
+static void timerHalt();
+
+// Shared compare-match body for the real and simulated timer
+static void onCompareMatch() {
+#ifdef TELEMETRY
+  bool reversed = false;
+#endif
+  if (armedPulse) {
+    StepPin::high();
+  }
+#ifdef STEP_JITTER_STATS
+  const uint16_t latency = timerLatencyTicks();
+  if (armedPulse && lastPulseValid) {
+    const uint32_t actual = static_cast<uint32_t>(startGapTicks) + armedTicks + latency - lastLatencyTicks;
+    jitterRecord(armedTag, armedCommand, armedTicks, actual, STEP_TIMER_TICKS_PER_US);
+  }
+  lastLatencyTicks = latency;
+  lastPulseValid = true;
+  startGapTicks = 0;
+#endif
+  if (armedPulse) {
+    stepPulseDelay();
+    StepPin::low();
+    // Consistent position tracking: increment for counter-clockwise, decrement for clockwise
+    cyclePosition += (armedClockwise ? -1 : 1);
+#ifdef TELEMETRY
+    if (armedClockwise != lastPulseClockwise || !pulsedBefore) {
+      pulsedBefore = true;
+      lastPulseClockwise = armedClockwise;
+      reversalClockwise = armedClockwise;
+      reversalPosition = cyclePosition;
+      reversed = true;
+    }
+#endif
+  }
+
+  if (nextValid) {
+    timerReload(nextTicks);
+#ifdef STEP_JITTER_STATS
+    armedTicks = nextTicks;
+    armedCommand = nextCommand;
+#endif
+#ifdef STEP_TIMER_TAGS
+    armedTag = nextTag;
+#endif
+    armedPulse = nextPulse;
+    if (nextPulse && nextClockwise != armedClockwise) {
+      DirPin::write(nextClockwise);
+      armedClockwise = nextClockwise;
+    }
+    nextValid = false;
+  } else {
+    timerHalt();
+    armed = false;
+  }
+#ifdef TELEMETRY
+  // Stamped after the reload so the next interval is never delayed by it
+  if (reversed) {
+    reversalMicros = micros();
+    reversalPending = true;
+  }
+#endif
+}
+
+// Queues a step (pulse) or a dwell that only lets the interval elapse
+static bool queueEntry(bool pulse, bool clockwise, unsigned int intervalMicros) {
+  uint16_t ticks = intervalToTicks(intervalMicros);
+  bool accepted = false;
+#ifdef __AVR__
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+#endif
+  {
+    if (!armed) {
+      if (pulse) {
+        DirPin::write(clockwise);  // HIGH for clockwise when looking at shaft
+        armedClockwise = clockwise;
+      }
+      armedPulse = pulse;
+      armed = true;
+#ifdef STEP_JITTER_STATS
+      startGapTicks = timerIdleTicks();
+      armedTicks = ticks;
+      armedCommand = intervalMicros;
+#endif
+#ifdef STEP_TIMER_TAGS
+      armedTag = static_cast<uint8_t>(currentState);
+#endif
+      timerStart(ticks);
+      accepted = true;
+    } else if (!nextValid) {
+      nextTicks = ticks;
+#ifdef STEP_JITTER_STATS
+      nextCommand = intervalMicros;
+#endif
+#ifdef STEP_TIMER_TAGS
+      nextTag = static_cast<uint8_t>(currentState);
+#endif
+      nextClockwise = clockwise;
+      nextPulse = pulse;
+      nextValid = true;
+      accepted = true;
+    }
+  }
+  return accepted;
+}
+
+bool stepTimerQueue(bool clockwise, unsigned int intervalMicros) {
+  return queueEntry(true, clockwise, intervalMicros);
+}
+
+bool stepTimerQueueDwell(unsigned int intervalMicros) {
+  return queueEntry(false, true, intervalMicros);
+}
+
+bool stepTimerIdle() {
+  return !armed;
+}
+
+void stepTimerStop() {
+#ifdef __AVR__
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+#endif
+  {
+    timerHalt();
+    armed = false;
+    nextValid = false;
+#ifdef STEP_JITTER_STATS
+    lastPulseValid = false;  // The next pulse starts a new interval chain
+#endif
+  }
+}
+
+long readCyclePosition() {
+  long position;
+#ifdef __AVR__
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+#endif
+  {
+    position = cyclePosition;
+  }
+  return position;
+}
+
+void writeCyclePosition(long position) {
+#ifdef __AVR__
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+#endif
+  {
+    cyclePosition = position;
+  }
+}
+
+#ifdef TELEMETRY
+bool stepTimerTakeReversal(uint32_t& timeMicros, bool& clockwise, long& position) {
+  bool taken = false;
+#ifdef __AVR__
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+#endif
+  {
+    if (reversalPending) {
+      timeMicros = reversalMicros;
+      clockwise = reversalClockwise;
+      position = reversalPosition;
+      reversalPending = false;
+      taken = true;
+    }
+  }
+  return taken;
+}
+#endif
+
+#ifdef __AVR__
+
+void stepTimerBegin() {
+  TCCR1A = 0;
+  TCCR1B = _BV(WGM12);  // CTC on OCR1A, clock stopped until the first step is queued
+  TCNT1 = 0;
+  TIMSK1 = _BV(OCIE1A);
+#ifdef STEP_JITTER_STATS
+  lastPulseValid = false;
+#endif
+}
+
+static void timerStart(uint16_t ticks) {
+  OCR1A = ticks - 1;
+  TCNT1 = 0;
+  TIFR1 = _BV(OCF1A);
+#ifdef STEP_JITTER_STATS
+  TIMSK1 = _BV(OCIE1A);
+#endif
+  TCCR1B = _BV(WGM12) | _BV(CS11);  // Prescaler 8
+}
+
+static void timerReload(uint16_t ticks) {
+  // The counter has already restarted from zero at the match, so the new period
+  // is measured from the pulse that just fired
+  OCR1A = ticks - 1;
+}
+
+#ifdef STEP_JITTER_STATS
+// While instrumented, a halt leaves the counter running from the last match with
+// the interrupt masked, so the idle time is still on TCNT1 when the next step
+// restarts it. OCF1A set means it reached 0xFFFF (32 ms) and saturated.
+static void timerHalt() {
+  TIMSK1 = 0;
+  OCR1A = 0xFFFF;
+}
+
+static uint16_t timerLatencyTicks() {
+  return TCNT1;
+}
+
+static uint16_t timerIdleTicks() {
+  if (!lastPulseValid || (TIFR1 & _BV(OCF1A))) {
+    return 0xFFFF;
+  }
+  return TCNT1;
+}
+#else
+static void timerHalt() {
+  TCCR1B = _BV(WGM12);
+}
+#endif
+
+ISR(TIMER1_COMPA_vect) {
+  onCompareMatch();
+}
+
+#else
+
+// Simulated Timer1: counts down microseconds instead of 0.5 us ticks
+static unsigned long simRemainingMicros = 0;
+#ifdef STEP_JITTER_STATS
+static unsigned long simLastPulseMicros = 0;
+#endif
+
+void stepTimerBegin() {
+  simRemainingMicros = 0;
+}
+
+static void timerStart(uint16_t ticks) {
+  simRemainingMicros = ticks / STEP_TIMER_TICKS_PER_US;
+}
+
+static void timerReload(uint16_t ticks) {
+  simRemainingMicros = ticks / STEP_TIMER_TICKS_PER_US;
+}
+
+static void timerHalt() {
+  simRemainingMicros = 0;
+#ifdef STEP_JITTER_STATS
+  simLastPulseMicros = micros();
+#endif
+}
+
+#ifdef STEP_JITTER_STATS
+static uint16_t timerLatencyTicks() {
+  return 0;  // The simulated ISR runs exactly on the match
+}
+
+static uint16_t timerIdleTicks() {
+  const unsigned long idle = (micros() - simLastPulseMicros) * STEP_TIMER_TICKS_PER_US;
+  return idle > 0xFFFF ? 0xFFFF : static_cast<uint16_t>(idle);
+}
+#endif
+
+unsigned int stepTimerAdvance(unsigned long elapsedMicros) {
+  unsigned int fired = 0;
+  while (armed && elapsedMicros >= simRemainingMicros) {
+    elapsedMicros -= simRemainingMicros;
+    onCompareMatch();
+    fired++;
+  }
+  if (armed) {
+    simRemainingMicros -= elapsedMicros;
+  }
+  return fired;
+}
+
+unsigned long stepTimerMicrosToNextStep() {
+  return armed ? simRemainingMicros : 0;
+}
+
+uint8_t stepTimerQueued() {
+  return (armed ? 1 : 0) + (nextValid ? 1 : 0);
+}
+
+State stepTimerArmedState() {
+  return static_cast<State>(armedTag);
+}
+
+#endif
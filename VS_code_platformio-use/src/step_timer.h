@@ -0,0 +1,56 @@
+#ifndef STEP_TIMER_H
+#define STEP_TIMER_H
+
+#include "hal.h"
+
+// Interrupt-driven step engine.
+//
+// On the Uno, Timer1 runs in CTC mode at F_CPU/8 (0.5 us per tick) and each
+// compare match emits exactly one STEP pulse. The state machine in loop() only
+// hands over the interval to the next step; the engine keeps one step armed in
+// the timer and one waiting behind it, so the next interval is always loaded in
+// the ISR the moment the previous pulse fires. cyclePosition is updated in the
+// ISR, so loop() must read and write it through the helpers below.
+//
+// Off-target there is no Timer1; the same compare-match path is driven from a
+// simulated timer via stepTimerAdvance().
+
+constexpr unsigned int STEP_TIMER_TICKS_PER_US = 2;    // 16 MHz / 8
+constexpr unsigned int MIN_STEP_INTERVAL_US = 20;      // Shortest interval the ISR can reload in time
+constexpr unsigned int MAX_STEP_INTERVAL_US = 32000;   // Keeps OCR1A inside 16 bits
+
+void stepTimerBegin();
+bool stepTimerQueue(bool clockwise, unsigned int intervalMicros);
+// Queues an interval that elapses without a pulse, so a pause can be timed
+// from the previous step exactly like a step would be
+bool stepTimerQueueDwell(unsigned int intervalMicros);
+bool stepTimerIdle();
+void stepTimerStop();
+
+long readCyclePosition();
+void writeCyclePosition(long position);
+
+#ifdef TELEMETRY
+// The ISR latches micros() and the position at every pulse that runs the
+// motor the other way from the pulse before it. Returns true once per
+// reversal; reversals are hundreds of milliseconds apart, so loop() always
+// takes one before the next overwrites it.
+bool stepTimerTakeReversal(uint32_t& timeMicros, bool& clockwise, long& position);
+#endif
+
+#ifndef __AVR__
+// Advance the simulated timer by the given number of microseconds, firing every
+// compare match that falls inside that window. Returns the number of steps fired.
+unsigned int stepTimerAdvance(unsigned long elapsedMicros);
+// Microseconds until the armed step fires, or 0 when the engine is idle.
+unsigned long stepTimerMicrosToNextStep();
+// Steps the engine is holding (armed plus waiting), 0 to 2
+uint8_t stepTimerQueued();
+enum class State;  // main.h
+// State loop() was in when it queued the armed step. A pin listener sees the
+// step that is firing, which may have been queued two steps before currentState
+// last changed.
+State stepTimerArmedState();
+#endif
+
+#endif // STEP_TIMER_H
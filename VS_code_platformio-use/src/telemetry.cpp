@@ -0,0 +1,135 @@
+#ifdef TELEMETRY
+
+#include "telemetry.h"
+#include "command_protocol.h"
+#include "hal.h"
+#include "serial_dump.h"
+
+struct TelemetryRecord {
+  uint8_t code;
+  uint8_t payload[TELEMETRY_MAX_PAYLOAD];
+};
+
+static TelemetryRecord ring[TELEMETRY_RING_SIZE];
+static volatile uint8_t ringHead = 0;  // Next slot the producer fills
+static volatile uint8_t ringTail = 0;  // Next slot the consumer sends
+static uint8_t classes = 0;
+static uint8_t sequence = 0;
+uint16_t telemetryBeatSteps = 0;
+
+static uint8_t payloadLength(uint8_t code) {
+  switch (code) {
+    case TELEMETRY_BEAT_START:
+      return 11;
+    case TELEMETRY_BEAT_END:
+      return 13;
+    case TELEMETRY_PHASE:
+    case TELEMETRY_REVERSAL:
+      return 10;
+    default:
+      return 15;
+  }
+}
+
+void telemetrySetClasses(uint8_t mask) {
+  classes = mask & TELEMETRY_ALL;
+}
+
+uint8_t telemetryClasses() {
+  return classes;
+}
+
+// Claims the next ring slot for a record of class `recordClass`, or returns
+// nullptr when the class is off or the ring is full. The sequence number is
+// spent either way, so the host sees a dropped record as a gap.
+static uint8_t* beginRecord(uint8_t recordClass, uint8_t code) {
+  if ((classes & recordClass) == 0) {
+    return nullptr;
+  }
+  const uint8_t seq = sequence++;
+  const uint8_t head = ringHead;
+  if (static_cast<uint8_t>(head - ringTail) >= TELEMETRY_RING_SIZE) {
+    return nullptr;
+  }
+  TelemetryRecord& record = ring[head % TELEMETRY_RING_SIZE];
+  record.code = code;
+  record.payload[0] = seq;
+  return record.payload + 1;
+}
+
+// Publishes the slot beginRecord() returned
+static void commitRecord() {
+  ringHead = ringHead + 1;
+}
+
+void telemetryBeatStart(uint16_t beat, uint32_t startMicros, uint32_t periodMicros) {
+  telemetryBeatSteps = 0;
+  uint8_t* p = beginRecord(TELEMETRY_BEATS, TELEMETRY_BEAT_START);
+  if (p != nullptr) {
+    writeU16(p, beat);
+    writeU32(p + 2, startMicros);
+    writeU32(p + 6, periodMicros);
+    commitRecord();
+  }
+}
+
+void telemetryBeatEnd(uint16_t beat, uint32_t endMicros, int32_t position) {
+  uint8_t* p = beginRecord(TELEMETRY_BEATS, TELEMETRY_BEAT_END);
+  if (p != nullptr) {
+    writeU16(p, beat);
+    writeU16(p + 2, telemetryBeatSteps);
+    writeU32(p + 4, endMicros);
+    writeU32(p + 8, static_cast<uint32_t>(position));
+    commitRecord();
+  }
+}
+
+void telemetryPhase(uint8_t state, uint32_t timeMicros, int32_t position) {
+  uint8_t* p = beginRecord(TELEMETRY_PHASES, TELEMETRY_PHASE);
+  if (p != nullptr) {
+    p[0] = state;
+    writeU32(p + 1, timeMicros);
+    writeU32(p + 5, static_cast<uint32_t>(position));
+    commitRecord();
+  }
+}
+
+void telemetryTiming(uint16_t beat, int32_t errorMicros, uint32_t dwellMicros, uint32_t scaleQ16) {
+  uint8_t* p = beginRecord(TELEMETRY_TIMING, TELEMETRY_BEAT_TIMING);
+  if (p != nullptr) {
+    writeU16(p, beat);
+    writeU32(p + 2, static_cast<uint32_t>(errorMicros));
+    writeU32(p + 6, dwellMicros);
+    writeU32(p + 10, scaleQ16);
+    commitRecord();
+  }
+}
+
+void telemetryReversal(bool clockwise, uint32_t timeMicros, int32_t position) {
+  uint8_t* p = beginRecord(TELEMETRY_PHASES, TELEMETRY_REVERSAL);
+  if (p != nullptr) {
+    p[0] = clockwise ? 1 : 0;
+    writeU32(p + 1, timeMicros);
+    writeU32(p + 5, static_cast<uint32_t>(position));
+    commitRecord();
+  }
+}
+
+void telemetryService() {
+  const uint8_t tail = ringTail;
+  // Text dumps go out a piece at a time; never split one with a frame
+  if (tail == ringHead || serialDumpBusy()) {
+    return;
+  }
+  const TelemetryRecord& record = ring[tail % TELEMETRY_RING_SIZE];
+  const uint8_t length = payloadLength(record.code);
+  if (Serial.availableForWrite() < length + 5) {
+    return;
+  }
+  uint8_t frame[TELEMETRY_MAX_PAYLOAD + 5];
+  const size_t size = encodeCommandFrame(record.code, record.payload, length, frame);
+  ringTail = tail + 1;
+  Serial.write(frame, size);
+}
+
+#endif // TELEMETRY
@@ -0,0 +1,90 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+
+// Binary session telemetry, compiled in with -D TELEMETRY.
+//
+// The state machine pushes fixed-size records into a single-producer /
+// single-consumer ring (loop() produces, the drain consumes; the indices are
+// single bytes, so neither side ever needs to lock out the other). The drain
+// hands at most one whole record per loop() pass to the serial TX buffer, and
+// only when the buffer has room for all of it, so the UART data-register-empty
+// interrupt sends it while loop() moves on. Nothing ever waits for the link;
+// when the ring is full the record is dropped.
+//
+// Records travel as frames of the command protocol (command_protocol.h) with
+// the codes below, so a host resynchronises on the sync byte and CRC, and
+// replies, text dumps and telemetry can share the port. Every record counts
+// one sequence number whether or not it could be queued, so the host counts
+// gaps as lost records. Payloads (little endian, times are micros()):
+//
+//   BEAT_START  seq u8, beat u16, start u32, period u32
+//   BEAT_END    seq u8, beat u16, steps u16, end u32, position i32
+//   PHASE       seq u8, state u8, time u32, position i32
+//   REVERSAL    seq u8, clockwise u8, time u32, position i32
+//   TIMING      seq u8, beat u16, error i32, dwell u32, scale u32 (Q16.16)
+//
+// PHASE is stamped when loop() moves on, which is up to two queued steps
+// before the motor does. REVERSAL is stamped by the step ISR at the first
+// pulse in a new direction, the moment the valves are driven to close, so the
+// host can predict when to listen for them (tools/click_analysis/phase_gate.h).
+
+// Beats are numbered from 0 at the start of a session. Nothing is sent until
+// a host selects record classes with COMMAND_TELEMETRY, so a terminal on the
+// port stays readable. At 60 bpm all classes together take about 180 bytes a
+// second of the link's 11 kB/s. The ring takes 256 bytes of SRAM.
+
+enum TelemetryClass : uint8_t {
+  TELEMETRY_BEATS = 0x01,   // BEAT_START and BEAT_END
+  TELEMETRY_PHASES = 0x02,  // Every State change and motor reversal
+  TELEMETRY_TIMING = 0x04,  // Beat scheduler error, dwell and scale
+  TELEMETRY_ALL = 0x07
+};
+
+enum TelemetryRecordCode : uint8_t {
+  TELEMETRY_BEAT_START = 0x41,
+  TELEMETRY_BEAT_END = 0x42,
+  TELEMETRY_PHASE = 0x43,
+  TELEMETRY_BEAT_TIMING = 0x44,
+  TELEMETRY_REVERSAL = 0x45,
+};
+
+constexpr uint8_t TELEMETRY_RING_SIZE = 16;  // Power of two
+constexpr uint8_t TELEMETRY_MAX_PAYLOAD = 15;
+
+#ifdef TELEMETRY
+
+extern uint16_t telemetryBeatSteps;
+
+void telemetrySetClasses(uint8_t mask);
+uint8_t telemetryClasses();
+
+// Producer side, called from loop()
+void telemetryBeatStart(uint16_t beat, uint32_t startMicros, uint32_t periodMicros);
+void telemetryBeatEnd(uint16_t beat, uint32_t endMicros, int32_t position);
+void telemetryPhase(uint8_t state, uint32_t timeMicros, int32_t position);
+void telemetryTiming(uint16_t beat, int32_t errorMicros, uint32_t dwellMicros, uint32_t scaleQ16);
+void telemetryReversal(bool clockwise, uint32_t timeMicros, int32_t position);
+
+// Counts one step queued in the current beat
+inline void telemetryStep() {
+  telemetryBeatSteps++;
+}
+
+// Consumer side: moves at most one record to the serial TX buffer
+void telemetryService();
+
+#else
+
+inline void telemetryBeatStart(uint16_t, uint32_t, uint32_t) {}
+inline void telemetryBeatEnd(uint16_t, uint32_t, int32_t) {}
+inline void telemetryPhase(uint8_t, uint32_t, int32_t) {}
+inline void telemetryTiming(uint16_t, int32_t, uint32_t, uint32_t) {}
+inline void telemetryReversal(bool, uint32_t, int32_t) {}
+inline void telemetryStep() {}
+inline void telemetryService() {}
+
+#endif
+
+#endif // TELEMETRY_H
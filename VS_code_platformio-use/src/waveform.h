@@ -0,0 +1,40 @@
+#ifndef WAVEFORM_H
+#define WAVEFORM_H
+
+#include "motion_profiles.h"
+
+#include <stdint.h>
+
+// Step-interval schedules compiled from a displacement-vs-time curve.
+//
+// tools/waveform_compiler turns a CSV flow waveform into a flash array of
+// 16-bit entries that State::WAVEFORM_PLAYBACK hands straight to the step
+// timer, one entry per pass:
+//   bit 15     direction, set for clockwise (systole / contraction)
+//   bit 14     dwell: let the interval elapse without a pulse
+//   bits 0-13  interval in microseconds since the previous entry
+// Pauses longer than WAVEFORM_MAX_INTERVAL_US are split into several dwells.
+
+constexpr uint16_t WAVEFORM_CLOCKWISE = 0x8000;
+constexpr uint16_t WAVEFORM_DWELL = 0x4000;
+constexpr uint16_t WAVEFORM_INTERVAL_MASK = 0x3FFF;
+constexpr uint16_t WAVEFORM_MAX_INTERVAL_US = WAVEFORM_INTERVAL_MASK;
+
+struct Waveform {
+  const uint16_t* schedule;  // In flash
+  uint16_t length;
+};
+
+inline uint16_t readWaveformEntry(const Waveform& waveform, uint16_t index) {
+  return pgm_read_word(&waveform.schedule[index]);
+}
+
+constexpr uint16_t makeWaveformStep(bool clockwise, uint16_t intervalMicros) {
+  return (clockwise ? WAVEFORM_CLOCKWISE : 0) | (intervalMicros & WAVEFORM_INTERVAL_MASK);
+}
+
+constexpr uint16_t makeWaveformDwell(uint16_t intervalMicros) {
+  return WAVEFORM_DWELL | (intervalMicros & WAVEFORM_INTERVAL_MASK);
+}
+
+#endif // WAVEFORM_H
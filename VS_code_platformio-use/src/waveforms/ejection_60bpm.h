@@ -0,0 +1,254 @@
+// Generated by tools/waveform_compiler from tools/waveform_compiler/examples/ejection_60bpm.csv - do not edit
+#ifndef WAVEFORM_EJECTION_60BPM_H
+#define WAVEFORM_EJECTION_60BPM_H
+
+#include "../waveform.h"
+
+constexpr uint16_t EJECTION_60BPM_SCHEDULE[] PROGMEM = {
+    0x902B, 0x8D07, 0x8A6B, 0x867A, 0x867B, 0x8659, 0x84A3, 0x84A3, 0x84A3, 0x84A3,
+    0x83C3, 0x839E, 0x839E, 0x839E, 0x839D, 0x8352, 0x82F8, 0x82F8, 0x82F8, 0x82F8,
+    0x82F8, 0x82F8, 0x8294, 0x8286, 0x8285, 0x8286, 0x8286, 0x8285, 0x8286, 0x827A,
+    0x8233, 0x8232, 0x8232, 0x8232, 0x8233, 0x8232, 0x8232, 0x8232, 0x8223, 0x81F3,
+    0x81F3, 0x81F3, 0x81F2, 0x81F3, 0x81F3, 0x81F3, 0x81F3, 0x81F2, 0x81E8, 0x81C1,
+    0x81C1, 0x81C1, 0x81C1, 0x81C1, 0x81C1, 0x81C1, 0x81C1, 0x81C1, 0x81C1, 0x81BE,
+    0x8199, 0x8199, 0x8199, 0x8199, 0x8199, 0x8199, 0x8199, 0x8199, 0x8199, 0x8199,
+    0x8199, 0x819A, 0x817C, 0x8179, 0x8178, 0x8178, 0x8179, 0x8178, 0x8178, 0x8178,
+    0x8179, 0x8178, 0x8178, 0x8179, 0x8178, 0x8169, 0x815D, 0x815D, 0x815D, 0x815D,
+    0x815D, 0x815D, 0x815D, 0x815D, 0x815D, 0x815D, 0x815D, 0x815D, 0x815D, 0x8158,
+    0x8146, 0x8146, 0x8146, 0x8146, 0x8146, 0x8146, 0x8146, 0x8146, 0x8146, 0x8146,
+    0x8146, 0x8146, 0x8147, 0x8146, 0x8146, 0x8134, 0x8132, 0x8133, 0x8133, 0x8132,
+    0x8133, 0x8132, 0x8133, 0x8132, 0x8133, 0x8132, 0x8133, 0x8132, 0x8133, 0x8133,
+    0x8132, 0x8129, 0x8121, 0x8122, 0x8122, 0x8122, 0x8121, 0x8122, 0x8122, 0x8122,
+    0x8121, 0x8122, 0x8122, 0x8122, 0x8121, 0x8122, 0x8122, 0x8122, 0x811C, 0x8114,
+    0x8113, 0x8113, 0x8113, 0x8114, 0x8113, 0x8113, 0x8113, 0x8114, 0x8113, 0x8113,
+    0x8113, 0x8114, 0x8113, 0x8113, 0x8113, 0x8113, 0x8111, 0x8107, 0x8107, 0x8106,
+    0x8107, 0x8107, 0x8106, 0x8107, 0x8106, 0x8107, 0x8107, 0x8106, 0x8107, 0x8107,
+    0x8106, 0x8107, 0x8106, 0x8107, 0x8107, 0x8105, 0x80FB, 0x80FC, 0x80FB, 0x80FC,
+    0x80FC, 0x80FB, 0x80FC, 0x80FB, 0x80FC, 0x80FB, 0x80FC, 0x80FC, 0x80FB, 0x80FC,
+    0x80FB, 0x80FC, 0x80FB, 0x80FC, 0x80FC, 0x80F9, 0x80F2, 0x80F1, 0x80F2, 0x80F2,
+    0x80F2, 0x80F2, 0x80F2, 0x80F2, 0x80F2, 0x80F2, 0x80F2, 0x80F2, 0x80F1, 0x80F2,
+    0x80F2, 0x80F2, 0x80F2, 0x80F2, 0x80F2, 0x80F2, 0x80ED, 0x80E9, 0x80E9, 0x80EA,
+    0x80E9, 0x80EA, 0x80E9, 0x80E9, 0x80EA, 0x80E9, 0x80EA, 0x80E9, 0x80E9, 0x80EA,
+    0x80E9, 0x80EA, 0x80E9, 0x80E9, 0x80EA, 0x80E9, 0x80EA, 0x80E8, 0x80E2, 0x80E1,
+    0x80E2, 0x80E2, 0x80E2, 0x80E2, 0x80E2, 0x80E2, 0x80E2, 0x80E2, 0x80E2, 0x80E2,
+    0x80E1, 0x80E2, 0x80E2, 0x80E2, 0x80E2, 0x80E2, 0x80E2, 0x80E2, 0x80E2, 0x80E1,
+    0x80DC, 0x80DB, 0x80DB, 0x80DC, 0x80DB, 0x80DB, 0x80DC, 0x80DB, 0x80DB, 0x80DC,
+    0x80DB, 0x80DB, 0x80DB, 0x80DC, 0x80DB, 0x80DB, 0x80DC, 0x80DB, 0x80DB, 0x80DC,
+    0x80DB, 0x80DB, 0x80DA, 0x80D6, 0x80D5, 0x80D6, 0x80D5, 0x80D6, 0x80D5, 0x80D6,
+    0x80D5, 0x80D6, 0x80D5, 0x80D6, 0x80D5, 0x80D6, 0x80D5, 0x80D6, 0x80D5, 0x80D6,
+    0x80D5, 0x80D6, 0x80D5, 0x80D6, 0x80D5, 0x80D6, 0x80D1, 0x80D1, 0x80D0, 0x80D0,
+    0x80D1, 0x80D0, 0x80D1, 0x80D0, 0x80D0, 0x80D1, 0x80D0, 0x80D1, 0x80D0, 0x80D0,
+    0x80D1, 0x80D0, 0x80D1, 0x80D0, 0x80D1, 0x80D0, 0x80D0, 0x80D1, 0x80D0, 0x80D1,
+    0x80CC, 0x80CC, 0x80CC, 0x80CC, 0x80CC, 0x80CC, 0x80CC, 0x80CC, 0x80CC, 0x80CC,
+    0x80CC, 0x80CC, 0x80CC, 0x80CC, 0x80CC, 0x80CC, 0x80CC, 0x80CC, 0x80CC, 0x80CB,
+    0x80CC, 0x80CC, 0x80CC, 0x80CC, 0x80CB, 0x80C8, 0x80C8, 0x80C8, 0x80C8, 0x80C8,
+    0x80C9, 0x80C8, 0x80C8, 0x80C8, 0x80C8, 0x80C8, 0x80C8, 0x80C8, 0x80C8, 0x80C8,
+    0x80C8, 0x80C8, 0x80C8, 0x80C9, 0x80C8, 0x80C8, 0x80C8, 0x80C8, 0x80C8, 0x80C7,
+    0x80C5, 0x80C4, 0x80C5, 0x80C5, 0x80C5, 0x80C4, 0x80C5, 0x80C5, 0x80C5, 0x80C4,
+    0x80C5, 0x80C5, 0x80C4, 0x80C5, 0x80C5, 0x80C5, 0x80C4, 0x80C5, 0x80C5, 0x80C5,
+    0x80C4, 0x80C5, 0x80C5, 0x80C5, 0x80C4, 0x80C2, 0x80C2, 0x80C2, 0x80C2, 0x80C2,
+    0x80C2, 0x80C2, 0x80C2, 0x80C2, 0x80C1, 0x80C2, 0x80C2, 0x80C2, 0x80C2, 0x80C2,
+    0x80C2, 0x80C2, 0x80C2, 0x80C1, 0x80C2, 0x80C2, 0x80C2, 0x80C2, 0x80C2, 0x80C2,
+    0x80C1, 0x80C0, 0x80BF, 0x80C0, 0x80BF, 0x80C0, 0x80BF, 0x80C0, 0x80BF, 0x80C0,
+    0x80BF, 0x80C0, 0x80BF, 0x80C0, 0x80BF, 0x80C0, 0x80BF, 0x80C0, 0x80BF, 0x80C0,
+    0x80BF, 0x80C0, 0x80BF, 0x80C0, 0x80BF, 0x80C0, 0x80BF, 0x80BE, 0x80BE, 0x80BD,
+    0x80BE, 0x80BD, 0x80BE, 0x80BD, 0x80BE, 0x80BD, 0x80BE, 0x80BD, 0x80BE, 0x80BE,
+    0x80BD, 0x80BE, 0x80BD, 0x80BE, 0x80BD, 0x80BE, 0x80BD, 0x80BE, 0x80BD, 0x80BE,
+    0x80BE, 0x80BD, 0x80BE, 0x80BC, 0x80BC, 0x80BC, 0x80BC, 0x80BC, 0x80BC, 0x80BC,
+    0x80BC, 0x80BC, 0x80BC, 0x80BC, 0x80BC, 0x80BC, 0x80BC, 0x80BC, 0x80BC, 0x80BC,
+    0x80BC, 0x80BC, 0x80BC, 0x80BC, 0x80BC, 0x80BC, 0x80BC, 0x80BC, 0x80BD, 0x80BB,
+    0x80BB, 0x80BB, 0x80BB, 0x80BB, 0x80BB, 0x80BB, 0x80BB, 0x80BA, 0x80BB, 0x80BB,
+    0x80BB, 0x80BB, 0x80BB, 0x80BB, 0x80BB, 0x80BA, 0x80BB, 0x80BB, 0x80BB, 0x80BB,
+    0x80BB, 0x80BB, 0x80BB, 0x80BA, 0x80BB, 0x80BB, 0x80BB, 0x80BA, 0x80BA, 0x80BA,
+    0x80BA, 0x80BA, 0x80BB, 0x80BA, 0x80BA, 0x80BA, 0x80BA, 0x80BA, 0x80BA, 0x80BA,
+    0x80BA, 0x80BB, 0x80BA, 0x80BA, 0x80BA, 0x80BA, 0x80BA, 0x80BA, 0x80BA, 0x80BB,
+    0x80BA, 0x80BA, 0x80BA, 0x80BA, 0x80BA, 0x80B9, 0x80BA, 0x80BA, 0x80BA, 0x80B9,
+    0x80BA, 0x80BA, 0x80BA, 0x80B9, 0x80BA, 0x80BA, 0x80B9, 0x80BA, 0x80BA, 0x80BA,
+    0x80B9, 0x80BA, 0x80BA, 0x80BA, 0x80B9, 0x80BA, 0x80BA, 0x80BA, 0x80B9, 0x80BA,
+    0x80BA, 0x80BA, 0x80B9, 0x80BA, 0x80BA, 0x80BA, 0x80B9, 0x80BA, 0x80BA, 0x80BA,
+    0x80B9, 0x80BA, 0x80BA, 0x80BA, 0x80B9, 0x80BA, 0x80BA, 0x80B9, 0x80BA, 0x80BA,
+    0x80BA, 0x80B9, 0x80BA, 0x80BA, 0x80BA, 0x80B9, 0x80BA, 0x80BA, 0x80BA, 0x80BA,
+    0x80BA, 0x80BB, 0x80BA, 0x80BA, 0x80BA, 0x80BA, 0x80BA, 0x80BA, 0x80BA, 0x80BB,
+    0x80BA, 0x80BA, 0x80BA, 0x80BA, 0x80BA, 0x80BA, 0x80BA, 0x80BA, 0x80BB, 0x80BA,
+    0x80BA, 0x80BA, 0x80BA, 0x80BA, 0x80BB, 0x80BB, 0x80BB, 0x80BA, 0x80BB, 0x80BB,
+    0x80BB, 0x80BB, 0x80BB, 0x80BB, 0x80BB, 0x80BA, 0x80BB, 0x80BB, 0x80BB, 0x80BB,
+    0x80BB, 0x80BB, 0x80BB, 0x80BA, 0x80BB, 0x80BB, 0x80BB, 0x80BB, 0x80BB, 0x80BB,
+    0x80BB, 0x80BB, 0x80BD, 0x80BC, 0x80BC, 0x80BC, 0x80BC, 0x80BC, 0x80BC, 0x80BC,
+    0x80BC, 0x80BC, 0x80BC, 0x80BC, 0x80BC, 0x80BC, 0x80BC, 0x80BC, 0x80BC, 0x80BC,
+    0x80BC, 0x80BC, 0x80BC, 0x80BC, 0x80BC, 0x80BC, 0x80BC, 0x80BC, 0x80BE, 0x80BD,
+    0x80BE, 0x80BE, 0x80BD, 0x80BE, 0x80BD, 0x80BE, 0x80BD, 0x80BE, 0x80BD, 0x80BE,
+    0x80BD, 0x80BE, 0x80BE, 0x80BD, 0x80BE, 0x80BD, 0x80BE, 0x80BD, 0x80BE, 0x80BD,
+    0x80BE, 0x80BD, 0x80BE, 0x80BE, 0x80BF, 0x80C0, 0x80BF, 0x80C0, 0x80BF, 0x80C0,
+    0x80BF, 0x80C0, 0x80BF, 0x80C0, 0x80BF, 0x80C0, 0x80BF, 0x80C0, 0x80BF, 0x80C0,
+    0x80BF, 0x80C0, 0x80BF, 0x80C0, 0x80BF, 0x80C0, 0x80BF, 0x80C0, 0x80BF, 0x80C0,
+    0x80C1, 0x80C2, 0x80C2, 0x80C2, 0x80C2, 0x80C2, 0x80C2, 0x80C1, 0x80C2, 0x80C2,
+    0x80C2, 0x80C2, 0x80C2, 0x80C2, 0x80C2, 0x80C2, 0x80C1, 0x80C2, 0x80C2, 0x80C2,
+    0x80C2, 0x80C2, 0x80C2, 0x80C2, 0x80C2, 0x80C2, 0x80C4, 0x80C5, 0x80C5, 0x80C5,
+    0x80C4, 0x80C5, 0x80C5, 0x80C5, 0x80C4, 0x80C5, 0x80C5, 0x80C5, 0x80C4, 0x80C5,
+    0x80C5, 0x80C4, 0x80C5, 0x80C5, 0x80C5, 0x80C4, 0x80C5, 0x80C5, 0x80C5, 0x80C4,
+    0x80C5, 0x80C7, 0x80C8, 0x80C8, 0x80C8, 0x80C8, 0x80C8, 0x80C9, 0x80C8, 0x80C8,
+    0x80C8, 0x80C8, 0x80C8, 0x80C8, 0x80C8, 0x80C8, 0x80C8, 0x80C8, 0x80C8, 0x80C8,
+    0x80C9, 0x80C8, 0x80C8, 0x80C8, 0x80C8, 0x80C8, 0x80CB, 0x80CC, 0x80CC, 0x80CC,
+    0x80CC, 0x80CB, 0x80CC, 0x80CC, 0x80CC, 0x80CC, 0x80CC, 0x80CC, 0x80CC, 0x80CC,
+    0x80CC, 0x80CC, 0x80CC, 0x80CC, 0x80CC, 0x80CC, 0x80CC, 0x80CC, 0x80CC, 0x80CC,
+    0x80CC, 0x80D1, 0x80D0, 0x80D1, 0x80D0, 0x80D0, 0x80D1, 0x80D0, 0x80D1, 0x80D0,
+    0x80D1, 0x80D0, 0x80D0, 0x80D1, 0x80D0, 0x80D1, 0x80D0, 0x80D0, 0x80D1, 0x80D0,
+    0x80D1, 0x80D0, 0x80D0, 0x80D1, 0x80D1, 0x80D6, 0x80D5, 0x80D6, 0x80D5, 0x80D6,
+    0x80D5, 0x80D6, 0x80D5, 0x80D6, 0x80D5, 0x80D6, 0x80D5, 0x80D6, 0x80D5, 0x80D6,
+    0x80D5, 0x80D6, 0x80D5, 0x80D6, 0x80D5, 0x80D6, 0x80D5, 0x80D6, 0x80DA, 0x80DB,
+    0x80DB, 0x80DC, 0x80DB, 0x80DB, 0x80DC, 0x80DB, 0x80DB, 0x80DC, 0x80DB, 0x80DB,
+    0x80DB, 0x80DC, 0x80DB, 0x80DB, 0x80DC, 0x80DB, 0x80DB, 0x80DC, 0x80DB, 0x80DB,
+    0x80DC, 0x80E1, 0x80E2, 0x80E2, 0x80E2, 0x80E2, 0x80E2, 0x80E2, 0x80E2, 0x80E2,
+    0x80E1, 0x80E2, 0x80E2, 0x80E2, 0x80E2, 0x80E2, 0x80E2, 0x80E2, 0x80E2, 0x80E2,
+    0x80E2, 0x80E1, 0x80E2, 0x80E8, 0x80EA, 0x80E9, 0x80EA, 0x80E9, 0x80E9, 0x80EA,
+    0x80E9, 0x80EA, 0x80E9, 0x80E9, 0x80EA, 0x80E9, 0x80EA, 0x80E9, 0x80E9, 0x80EA,
+    0x80E9, 0x80EA, 0x80E9, 0x80E9, 0x80ED, 0x80F2, 0x80F2, 0x80F2, 0x80F2, 0x80F2,
+    0x80F2, 0x80F2, 0x80F1, 0x80F2, 0x80F2, 0x80F2, 0x80F2, 0x80F2, 0x80F2, 0x80F2,
+    0x80F2, 0x80F2, 0x80F2, 0x80F1, 0x80F2, 0x80F9, 0x80FC, 0x80FC, 0x80FB, 0x80FC,
+    0x80FB, 0x80FC, 0x80FB, 0x80FC, 0x80FC, 0x80FB, 0x80FC, 0x80FB, 0x80FC, 0x80FB,
+    0x80FC, 0x80FC, 0x80FB, 0x80FC, 0x80FB, 0x8105, 0x8107, 0x8107, 0x8106, 0x8107,
+    0x8106, 0x8107, 0x8107, 0x8106, 0x8107, 0x8107, 0x8106, 0x8107, 0x8106, 0x8107,
+    0x8107, 0x8106, 0x8107, 0x8107, 0x8111, 0x8113, 0x8113, 0x8113, 0x8113, 0x8114,
+    0x8113, 0x8113, 0x8113, 0x8114, 0x8113, 0x8113, 0x8113, 0x8114, 0x8113, 0x8113,
+    0x8113, 0x8114, 0x811C, 0x8122, 0x8122, 0x8122, 0x8121, 0x8122, 0x8122, 0x8122,
+    0x8121, 0x8122, 0x8122, 0x8122, 0x8121, 0x8122, 0x8122, 0x8122, 0x8121, 0x8129,
+    0x8132, 0x8133, 0x8133, 0x8132, 0x8133, 0x8132, 0x8133, 0x8132, 0x8133, 0x8132,
+    0x8133, 0x8132, 0x8133, 0x8133, 0x8132, 0x8134, 0x8146, 0x8146, 0x8147, 0x8146,
+    0x8146, 0x8146, 0x8146, 0x8146, 0x8146, 0x8146, 0x8146, 0x8146, 0x8146, 0x8146,
+    0x8146, 0x8158, 0x815D, 0x815D, 0x815D, 0x815D, 0x815D, 0x815D, 0x815D, 0x815D,
+    0x815D, 0x815D, 0x815D, 0x815D, 0x815D, 0x8169, 0x8178, 0x8179, 0x8178, 0x8178,
+    0x8179, 0x8178, 0x8178, 0x8178, 0x8179, 0x8178, 0x8178, 0x8179, 0x817C, 0x819A,
+    0x8199, 0x8199, 0x8199, 0x8199, 0x8199, 0x8199, 0x8199, 0x8199, 0x8199, 0x8199,
+    0x8199, 0x81BE, 0x81C1, 0x81C1, 0x81C1, 0x81C1, 0x81C1, 0x81C1, 0x81C1, 0x81C1,
+    0x81C1, 0x81C1, 0x81E8, 0x81F2, 0x81F3, 0x81F3, 0x81F3, 0x81F3, 0x81F2, 0x81F3,
+    0x81F3, 0x81F3, 0x8223, 0x8232, 0x8232, 0x8232, 0x8233, 0x8232, 0x8232, 0x8232,
+    0x8233, 0x827A, 0x8286, 0x8285, 0x8286, 0x8286, 0x8285, 0x8286, 0x8294, 0x82F8,
+    0x82F8, 0x82F8, 0x82F8, 0x82F8, 0x82F8, 0x8352, 0x839D, 0x839E, 0x839E, 0x839E,
+    0x83C3, 0x84A3, 0x84A3, 0x84A3, 0x84A3, 0x8659, 0x867B, 0x867A, 0x8A6B, 0x8D07,
+    0x2616, 0x118D, 0x0AB4, 0x0A0D, 0x07A8, 0x07A7, 0x0689, 0x05F6, 0x05F6, 0x058D,
+    0x04E3, 0x04E3, 0x04E3, 0x049A, 0x0425, 0x0425, 0x0425, 0x0425, 0x03C8, 0x039A,
+    0x039B, 0x039A, 0x039B, 0x037F, 0x0330, 0x0331, 0x0331, 0x0330, 0x0331, 0x0325,
+    0x02DE, 0x02DD, 0x02DD, 0x02DE, 0x02DD, 0x02DD, 0x02C8, 0x029B, 0x029A, 0x029A,
+    0x029A, 0x029A, 0x029A, 0x029A, 0x026E, 0x0263, 0x0263, 0x0263, 0x0263, 0x0263,
+    0x0263, 0x0263, 0x0246, 0x0235, 0x0235, 0x0235, 0x0235, 0x0235, 0x0235, 0x0235,
+    0x0234, 0x0217, 0x020E, 0x020E, 0x020E, 0x020E, 0x020E, 0x020E, 0x020E, 0x020E,
+    0x0204, 0x01ED, 0x01EC, 0x01ED, 0x01EC, 0x01ED, 0x01EC, 0x01EC, 0x01ED, 0x01EC,
+    0x01E9, 0x01D0, 0x01CF, 0x01D0, 0x01D0, 0x01CF, 0x01D0, 0x01CF, 0x01D0, 0x01CF,
+    0x01D0, 0x01C7, 0x01B7, 0x01B6, 0x01B6, 0x01B7, 0x01B6, 0x01B6, 0x01B7, 0x01B6,
+    0x01B7, 0x01B6, 0x01B6, 0x01A2, 0x01A0, 0x01A1, 0x01A0, 0x01A0, 0x01A0, 0x01A0,
+    0x01A1, 0x01A0, 0x01A0, 0x01A0, 0x01A1, 0x018E, 0x018D, 0x018C, 0x018D, 0x018D,
+    0x018C, 0x018D, 0x018D, 0x018D, 0x018C, 0x018D, 0x018D, 0x0187, 0x017B, 0x017C,
+    0x017B, 0x017C, 0x017B, 0x017B, 0x017C, 0x017B, 0x017C, 0x017B, 0x017B, 0x017C,
+    0x0179, 0x016C, 0x016C, 0x016C, 0x016C, 0x016C, 0x016C, 0x016C, 0x016B, 0x016C,
+    0x016C, 0x016C, 0x016C, 0x016C, 0x0166, 0x015F, 0x015E, 0x015E, 0x015E, 0x015E,
+    0x015E, 0x015E, 0x015E, 0x015E, 0x015E, 0x015E, 0x015E, 0x015E, 0x015D, 0x0152,
+    0x0151, 0x0152, 0x0152, 0x0151, 0x0152, 0x0152, 0x0151, 0x0152, 0x0151, 0x0152,
+    0x0152, 0x0151, 0x0152, 0x014E, 0x0147, 0x0146, 0x0147, 0x0146, 0x0146, 0x0147,
+    0x0146, 0x0147, 0x0146, 0x0147, 0x0146, 0x0147, 0x0146, 0x0146, 0x0147, 0x013C,
+    0x013D, 0x013C, 0x013C, 0x013D, 0x013C, 0x013D, 0x013C, 0x013C, 0x013D, 0x013C,
+    0x013C, 0x013D, 0x013C, 0x013C, 0x013B, 0x0133, 0x0134, 0x0133, 0x0133, 0x0133,
+    0x0133, 0x0134, 0x0133, 0x0133, 0x0133, 0x0133, 0x0134, 0x0133, 0x0133, 0x0133,
+    0x0133, 0x012C, 0x012B, 0x012B, 0x012B, 0x012B, 0x012B, 0x012B, 0x012B, 0x012B,
+    0x012B, 0x012B, 0x012A, 0x012B, 0x012B, 0x012B, 0x012B, 0x012A, 0x0123, 0x0124,
+    0x0123, 0x0124, 0x0123, 0x0124, 0x0123, 0x0124, 0x0123, 0x0123, 0x0124, 0x0123,
+    0x0124, 0x0123, 0x0124, 0x0123, 0x0124, 0x011C, 0x011D, 0x011D, 0x011C, 0x011D,
+    0x011D, 0x011C, 0x011D, 0x011D, 0x011C, 0x011D, 0x011D, 0x011C, 0x011D, 0x011D,
+    0x011C, 0x011D, 0x011A, 0x0116, 0x0117, 0x0116, 0x0117, 0x0116, 0x0117, 0x0117,
+    0x0116, 0x0117, 0x0116, 0x0117, 0x0116, 0x0117, 0x0116, 0x0117, 0x0116, 0x0117,
+    0x0113, 0x0111, 0x0111, 0x0111, 0x0111, 0x0111, 0x0111, 0x0111, 0x0111, 0x0111,
+    0x0111, 0x0111, 0x0111, 0x0111, 0x0111, 0x0111, 0x0111, 0x0111, 0x0110, 0x010C,
+    0x010C, 0x010C, 0x010C, 0x010C, 0x010C, 0x010C, 0x010C, 0x010C, 0x010C, 0x010C,
+    0x010B, 0x010C, 0x010C, 0x010C, 0x010C, 0x010C, 0x010C, 0x010A, 0x0107, 0x0108,
+    0x0107, 0x0107, 0x0108, 0x0107, 0x0108, 0x0107, 0x0108, 0x0107, 0x0107, 0x0108,
+    0x0107, 0x0108, 0x0107, 0x0108, 0x0107, 0x0107, 0x0106, 0x0103, 0x0103, 0x0104,
+    0x0103, 0x0103, 0x0104, 0x0103, 0x0103, 0x0104, 0x0103, 0x0104, 0x0103, 0x0103,
+    0x0104, 0x0103, 0x0103, 0x0104, 0x0103, 0x0103, 0x00FF, 0x0100, 0x0100, 0x00FF,
+    0x0100, 0x0100, 0x0100, 0x00FF, 0x0100, 0x0100, 0x0100, 0x00FF, 0x0100, 0x0100,
+    0x00FF, 0x0100, 0x0100, 0x0100, 0x00FF, 0x00FE, 0x00FC, 0x00FD, 0x00FC, 0x00FD,
+    0x00FC, 0x00FD, 0x00FC, 0x00FD, 0x00FC, 0x00FD, 0x00FC, 0x00FD, 0x00FC, 0x00FD,
+    0x00FC, 0x00FD, 0x00FC, 0x00FD, 0x00FC, 0x00FA, 0x00FA, 0x00F9, 0x00FA, 0x00FA,
+    0x00F9, 0x00FA, 0x00FA, 0x00F9, 0x00FA, 0x00FA, 0x00F9, 0x00FA, 0x00FA, 0x00F9,
+    0x00FA, 0x00FA, 0x00F9, 0x00FA, 0x00FA, 0x00F7, 0x00F7, 0x00F7, 0x00F8, 0x00F7,
+    0x00F7, 0x00F7, 0x00F7, 0x00F7, 0x00F8, 0x00F7, 0x00F7, 0x00F7, 0x00F7, 0x00F7,
+    0x00F8, 0x00F7, 0x00F7, 0x00F7, 0x00F7, 0x00F6, 0x00F5, 0x00F5, 0x00F5, 0x00F5,
+    0x00F5, 0x00F5, 0x00F5, 0x00F5, 0x00F5, 0x00F5, 0x00F5, 0x00F5, 0x00F5, 0x00F5,
+    0x00F5, 0x00F5, 0x00F5, 0x00F5, 0x00F5, 0x00F5, 0x00F3, 0x00F4, 0x00F3, 0x00F3,
+    0x00F3, 0x00F3, 0x00F4, 0x00F3, 0x00F3, 0x00F3, 0x00F3, 0x00F4, 0x00F3, 0x00F3,
+    0x00F3, 0x00F4, 0x00F3, 0x00F3, 0x00F3, 0x00F3, 0x00F3, 0x00F1, 0x00F2, 0x00F2,
+    0x00F1, 0x00F2, 0x00F2, 0x00F2, 0x00F1, 0x00F2, 0x00F2, 0x00F1, 0x00F2, 0x00F2,
+    0x00F2, 0x00F1, 0x00F2, 0x00F2, 0x00F2, 0x00F1, 0x00F2, 0x00F0, 0x00F1, 0x00F1,
+    0x00F0, 0x00F1, 0x00F0, 0x00F1, 0x00F0, 0x00F1, 0x00F0, 0x00F1, 0x00F0, 0x00F1,
+    0x00F0, 0x00F1, 0x00F1, 0x00F0, 0x00F1, 0x00F0, 0x00F1, 0x00F0, 0x00F0, 0x00EF,
+    0x00F0, 0x00F0, 0x00EF, 0x00F0, 0x00F0, 0x00EF, 0x00F0, 0x00F0, 0x00EF, 0x00F0,
+    0x00F0, 0x00EF, 0x00F0, 0x00F0, 0x00EF, 0x00F0, 0x00F0, 0x00EF, 0x00F0, 0x00EF,
+    0x00EF, 0x00EF, 0x00EF, 0x00EF, 0x00EF, 0x00EF, 0x00EF, 0x00EF, 0x00EF, 0x00EF,
+    0x00F0, 0x00EF, 0x00EF, 0x00EF, 0x00EF, 0x00EF, 0x00EF, 0x00EF, 0x00EF, 0x00EF,
+    0x00EF, 0x00EF, 0x00EE, 0x00EF, 0x00EF, 0x00EF, 0x00EF, 0x00EE, 0x00EF, 0x00EF,
+    0x00EF, 0x00EE, 0x00EF, 0x00EF, 0x00EF, 0x00EF, 0x00EE, 0x00EF, 0x00EF, 0x00EF,
+    0x00EE, 0x00EF, 0x00EF, 0x00EF, 0x00EE, 0x00EF, 0x00EF, 0x00EF, 0x00EF, 0x00EE,
+    0x00EF, 0x00EF, 0x00EF, 0x00EE, 0x00EF, 0x00EF, 0x00EF, 0x00EF, 0x00EE, 0x00EF,
+    0x00EF, 0x00EF, 0x00EF, 0x00EF, 0x00EF, 0x00EF, 0x00EF, 0x00EF, 0x00EF, 0x00EF,
+    0x00F0, 0x00EF, 0x00EF, 0x00EF, 0x00EF, 0x00EF, 0x00EF, 0x00EF, 0x00EF, 0x00EF,
+    0x00EF, 0x00EF, 0x00F0, 0x00EF, 0x00F0, 0x00F0, 0x00EF, 0x00F0, 0x00F0, 0x00EF,
+    0x00F0, 0x00F0, 0x00EF, 0x00F0, 0x00F0, 0x00EF, 0x00F0, 0x00F0, 0x00EF, 0x00F0,
+    0x00F0, 0x00EF, 0x00F0, 0x00F0, 0x00F1, 0x00F0, 0x00F1, 0x00F0, 0x00F1, 0x00F1,
+    0x00F0, 0x00F1, 0x00F0, 0x00F1, 0x00F0, 0x00F1, 0x00F0, 0x00F1, 0x00F0, 0x00F1,
+    0x00F0, 0x00F1, 0x00F1, 0x00F0, 0x00F2, 0x00F1, 0x00F2, 0x00F2, 0x00F2, 0x00F1,
+    0x00F2, 0x00F2, 0x00F2, 0x00F1, 0x00F2, 0x00F2, 0x00F1, 0x00F2, 0x00F2, 0x00F2,
+    0x00F1, 0x00F2, 0x00F2, 0x00F1, 0x00F3, 0x00F3, 0x00F3, 0x00F3, 0x00F3, 0x00F4,
+    0x00F3, 0x00F3, 0x00F3, 0x00F4, 0x00F3, 0x00F3, 0x00F3, 0x00F3, 0x00F4, 0x00F3,
+    0x00F3, 0x00F3, 0x00F3, 0x00F4, 0x00F3, 0x00F5, 0x00F5, 0x00F5, 0x00F5, 0x00F5,
+    0x00F5, 0x00F5, 0x00F5, 0x00F5, 0x00F5, 0x00F5, 0x00F5, 0x00F5, 0x00F5, 0x00F5,
+    0x00F5, 0x00F5, 0x00F5, 0x00F5, 0x00F5, 0x00F6, 0x00F7, 0x00F7, 0x00F7, 0x00F7,
+    0x00F8, 0x00F7, 0x00F7, 0x00F7, 0x00F7, 0x00F7, 0x00F8, 0x00F7, 0x00F7, 0x00F7,
+    0x00F7, 0x00F7, 0x00F8, 0x00F7, 0x00F7, 0x00F7, 0x00FA, 0x00FA, 0x00F9, 0x00FA,
+    0x00FA, 0x00F9, 0x00FA, 0x00FA, 0x00F9, 0x00FA, 0x00FA, 0x00F9, 0x00FA, 0x00FA,
+    0x00F9, 0x00FA, 0x00FA, 0x00F9, 0x00FA, 0x00FA, 0x00FC, 0x00FD, 0x00FC, 0x00FD,
+    0x00FC, 0x00FD, 0x00FC, 0x00FD, 0x00FC, 0x00FD, 0x00FC, 0x00FD, 0x00FC, 0x00FD,
+    0x00FC, 0x00FD, 0x00FC, 0x00FD, 0x00FC, 0x00FE, 0x00FF, 0x0100, 0x0100, 0x0100,
+    0x00FF, 0x0100, 0x0100, 0x00FF, 0x0100, 0x0100, 0x0100, 0x00FF, 0x0100, 0x0100,
+    0x0100, 0x00FF, 0x0100, 0x0100, 0x00FF, 0x0103, 0x0103, 0x0104, 0x0103, 0x0103,
+    0x0104, 0x0103, 0x0103, 0x0104, 0x0103, 0x0104, 0x0103, 0x0103, 0x0104, 0x0103,
+    0x0103, 0x0104, 0x0103, 0x0103, 0x0106, 0x0107, 0x0107, 0x0108, 0x0107, 0x0108,
+    0x0107, 0x0108, 0x0107, 0x0107, 0x0108, 0x0107, 0x0108, 0x0107, 0x0108, 0x0107,
+    0x0107, 0x0108, 0x0107, 0x010A, 0x010C, 0x010C, 0x010C, 0x010C, 0x010C, 0x010C,
+    0x010B, 0x010C, 0x010C, 0x010C, 0x010C, 0x010C, 0x010C, 0x010C, 0x010C, 0x010C,
+    0x010C, 0x010C, 0x0110, 0x0111, 0x0111, 0x0111, 0x0111, 0x0111, 0x0111, 0x0111,
+    0x0111, 0x0111, 0x0111, 0x0111, 0x0111, 0x0111, 0x0111, 0x0111, 0x0111, 0x0111,
+    0x0113, 0x0117, 0x0116, 0x0117, 0x0116, 0x0117, 0x0116, 0x0117, 0x0116, 0x0117,
+    0x0116, 0x0117, 0x0117, 0x0116, 0x0117, 0x0116, 0x0117, 0x0116, 0x011A, 0x011D,
+    0x011C, 0x011D, 0x011D, 0x011C, 0x011D, 0x011D, 0x011C, 0x011D, 0x011D, 0x011C,
+    0x011D, 0x011D, 0x011C, 0x011D, 0x011D, 0x011C, 0x0124, 0x0123, 0x0124, 0x0123,
+    0x0124, 0x0123, 0x0124, 0x0123, 0x0123, 0x0124, 0x0123, 0x0124, 0x0123, 0x0124,
+    0x0123, 0x0124, 0x0123, 0x012A, 0x012B, 0x012B, 0x012B, 0x012B, 0x012A, 0x012B,
+    0x012B, 0x012B, 0x012B, 0x012B, 0x012B, 0x012B, 0x012B, 0x012B, 0x012B, 0x012C,
+    0x0133, 0x0133, 0x0133, 0x0133, 0x0134, 0x0133, 0x0133, 0x0133, 0x0133, 0x0134,
+    0x0133, 0x0133, 0x0133, 0x0133, 0x0134, 0x0133, 0x013B, 0x013C, 0x013C, 0x013D,
+    0x013C, 0x013C, 0x013D, 0x013C, 0x013C, 0x013D, 0x013C, 0x013D, 0x013C, 0x013C,
+    0x013D, 0x013C, 0x0147, 0x0146, 0x0146, 0x0147, 0x0146, 0x0147, 0x0146, 0x0147,
+    0x0146, 0x0147, 0x0146, 0x0146, 0x0147, 0x0146, 0x0147, 0x014E, 0x0152, 0x0151,
+    0x0152, 0x0152, 0x0151, 0x0152, 0x0151, 0x0152, 0x0152, 0x0151, 0x0152, 0x0152,
+    0x0151, 0x0152, 0x015D, 0x015E, 0x015E, 0x015E, 0x015E, 0x015E, 0x015E, 0x015E,
+    0x015E, 0x015E, 0x015E, 0x015E, 0x015E, 0x015F, 0x0166, 0x016C, 0x016C, 0x016C,
+    0x016C, 0x016C, 0x016B, 0x016C, 0x016C, 0x016C, 0x016C, 0x016C, 0x016C, 0x016C,
+    0x0179, 0x017C, 0x017B, 0x017B, 0x017C, 0x017B, 0x017C, 0x017B, 0x017B, 0x017C,
+    0x017B, 0x017C, 0x017B, 0x0187, 0x018D, 0x018D, 0x018C, 0x018D, 0x018D, 0x018D,
+    0x018C, 0x018D, 0x018D, 0x018C, 0x018D, 0x018E, 0x01A1, 0x01A0, 0x01A0, 0x01A0,
+    0x01A1, 0x01A0, 0x01A0, 0x01A0, 0x01A0, 0x01A1, 0x01A0, 0x01A2, 0x01B6, 0x01B6,
+    0x01B7, 0x01B6, 0x01B7, 0x01B6, 0x01B6, 0x01B7, 0x01B6, 0x01B6, 0x01B7, 0x01C7,
+    0x01D0, 0x01CF, 0x01D0, 0x01CF, 0x01D0, 0x01CF, 0x01D0, 0x01D0, 0x01CF, 0x01D0,
+    0x01E9, 0x01EC, 0x01ED, 0x01EC, 0x01EC, 0x01ED, 0x01EC, 0x01ED, 0x01EC, 0x01ED,
+    0x0204, 0x020E, 0x020E, 0x020E, 0x020E, 0x020E, 0x020E, 0x020E, 0x020E, 0x0217,
+    0x0234, 0x0235, 0x0235, 0x0235, 0x0235, 0x0235, 0x0235, 0x0235, 0x0246, 0x0263,
+    0x0263, 0x0263, 0x0263, 0x0263, 0x0263, 0x0263, 0x026E, 0x029A, 0x029A, 0x029A,
+    0x029A, 0x029A, 0x029A, 0x029B, 0x02C8, 0x02DD, 0x02DD, 0x02DE, 0x02DD, 0x02DD,
+    0x02DE, 0x0325, 0x0331, 0x0330, 0x0331, 0x0331, 0x0330, 0x037F, 0x039B, 0x039A,
+    0x039B, 0x039A, 0x03C8, 0x0425, 0x0425, 0x0425, 0x0425, 0x049A, 0x04E3, 0x04E3,
+    0x04E3, 0x058D, 0x05F6, 0x05F6, 0x0689, 0x07A7, 0x07A8, 0x0A0D, 0x0AB4, 0x118D,
+    0x7DC9, 0x7DC9, 0x7DC9, 0x7DC8, 0x7DC8, 0x7DC8, 0x7DC8, 0x7DC8, 0x7DC8, 0x7DC8,
+    0x7DC8, 0x7DC8, 0x7DC8,
+};
+
+constexpr Waveform EJECTION_60BPM = {EJECTION_60BPM_SCHEDULE, 2413};
+
+#endif // WAVEFORM_EJECTION_60BPM_H
@@ -0,0 +1,14 @@
+#ifndef WAVEFORMS_H
+#define WAVEFORMS_H
+
+// Compiled waveform schedules available to -D PLAY_WAVEFORM builds.
+// Regenerate or add one with tools/waveform_compiler; pick it with
+// -D ACTIVE_WAVEFORM=<NAME>.
+
+#include "ejection_60bpm.h"
+
+#ifndef ACTIVE_WAVEFORM
+#define ACTIVE_WAVEFORM EJECTION_60BPM
+#endif
+
+#endif // WAVEFORMS_H
@@ -0,0 +1,232 @@
+// Host check of the session archive (tools/click_analysis/session_archive.h)
+// round trip: writes a synthetic session, no microphone or rig needed, maps
+// it back with SessionArchive and checks that
+//   - the header, run configuration and chunk table describe the audio written,
+//     with the chunks back to back;
+//   - the mapped samples are the written ones, whole and through every click;
+//   - the click table holds every click added, in onset order, and findClick()
+//     lands on each onset;
+//   - each beat's entry points at exactly the clicks of that beat, and
+//     findBeat() finds every beat and no other;
+//   - a truncated copy of the archive is refused.
+// The clicks and beats are added out of order, as click_extract may. Audio is
+// written on the int16 grid so the comparison is exact. Prints one line per
+// check; exit status 1 when any fails.
+//
+//   pio run -e archive_check && .pio/build/archive_check/program [SCRATCH_DIR]
+
+#include "click_synth.h"
+#include "session_archive.h"
+
+#include <math.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+constexpr double SESSION_SECONDS = 20.0;  // Several chunks, the last one partial
+constexpr size_t WRITE_BLOCK = 1000;      // Not a divisor of the chunk size
+constexpr uint64_t PRE_ROLL = 480;
+constexpr uint64_t POST_ROLL = 4320;
+constexpr int UNGATED_CLICKS = 5;
+
+static bool check(bool ok, const char* what) {
+  std::printf("%-60s %s\n", what, ok ? "ok" : "FAIL");
+  return ok;
+}
+
+static bool sameClick(const ArchiveClick& a, const ArchiveClick& b) {
+  return a.start == b.start && a.onset == b.onset && a.samples == b.samples && a.beat == b.beat &&
+         a.peak == b.peak && a.noiseFloor == b.noiseFloor && a.kind == b.kind;
+}
+
+int main(int argc, char** argv) {
+  const std::string dir = argc > 1 ? argv[1] : "/tmp";
+  const std::string path = dir + "/archive_check." + std::to_string(getpid()) + ".pumpsess";
+  const std::string truncated = path + ".cut";
+
+  SynthConfig synthConfig;
+  synthConfig.seconds = SESSION_SECONDS;
+  ClickSynth synth(synthConfig);
+  const uint32_t sampleRate = static_cast<uint32_t>(synthConfig.sampleRate);
+
+  ArchiveRunConfig run{};
+  setArchiveText(run.variant, sizeof(run.variant), "MainPump");
+  setArchiveText(run.profile, sizeof(run.profile), "tables");
+  run.heartRate = static_cast<uint16_t>(synthConfig.beatsPerMinute);
+  run.strokeSteps = 1600;
+  run.runtimeSeconds = static_cast<uint32_t>(SESSION_SECONDS);
+  setArchiveText(run.note, sizeof(run.note), "archive_check");
+
+  // The audio, on the int16 grid the writer stores
+  std::vector<int16_t> expected;
+  SessionArchiveWriter writer;
+  bool written = writer.open(path.c_str(), sampleRate, run);
+  std::vector<float> block(WRITE_BLOCK);
+  for (size_t n; written && (n = synth.generate(block.data(), block.size())) > 0;) {
+    for (size_t i = 0; i < n; i++) {
+      const float s = std::min(32767.0f, std::max(-32768.0f, block[i] * 32768.0f));
+      expected.push_back(static_cast<int16_t>(lrintf(s)));
+      block[i] = static_cast<float>(expected.back()) / 32768.0f;
+    }
+    written = writer.write(block.data(), n);
+  }
+
+  // Valve clicks in their beats, plus a few tied to none
+  std::vector<ArchiveClick> clicks;
+  std::vector<uint32_t> beatNumbers;
+  uint32_t beat = 0;
+  for (uint64_t onset : synth.valveClicks()) {
+    while (synth.beatStart(beat + 1) <= onset) {
+      beat++;
+    }
+    if (onset < PRE_ROLL || onset + POST_ROLL > expected.size()) {
+      continue;
+    }
+    ArchiveClick click{};
+    click.start = onset - PRE_ROLL;
+    click.onset = onset;
+    click.samples = static_cast<uint32_t>(PRE_ROLL + POST_ROLL);
+    click.beat = static_cast<int32_t>(beat);
+    click.peak = static_cast<float>(clicks.size()) * 0.01f;
+    click.noiseFloor = 0.003f;
+    click.kind = beatNumbers.empty() || beatNumbers.back() != beat ? CLICK_OPENING : CLICK_CLOSURE;
+    clicks.push_back(click);
+    if (beatNumbers.empty() || beatNumbers.back() != beat) {
+      beatNumbers.push_back(beat);
+    }
+  }
+  for (int i = 0; i < UNGATED_CLICKS; i++) {
+    ArchiveClick click{};
+    click.onset = PRE_ROLL + (expected.size() - PRE_ROLL - POST_ROLL) * (2 * i + 1) / (2 * UNGATED_CLICKS);
+    click.start = click.onset - PRE_ROLL;
+    click.samples = static_cast<uint32_t>(PRE_ROLL + POST_ROLL);
+    click.beat = -1;
+    click.peak = 0.3f;
+    clicks.push_back(click);
+  }
+  // A beat with no clicks still gets its entry
+  const uint32_t emptyBeat = beat + 1;
+  beatNumbers.push_back(emptyBeat);
+
+  std::vector<ArchiveClick> shuffled = clicks;
+  std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(7));
+  for (const ArchiveClick& click : shuffled) {
+    writer.addClick(click);
+  }
+  std::vector<uint32_t> beatOrder = beatNumbers;
+  std::shuffle(beatOrder.begin(), beatOrder.end(), std::mt19937(11));
+  for (uint32_t b : beatOrder) {
+    writer.addBeat(b, synth.beatStart(b));
+  }
+  writer.addBeat(beatOrder.front(), synth.beatStart(beatOrder.front()));  // Added twice, kept once
+  written = writer.close() && written;
+  bool allOk = check(written, "archive written");
+
+  SessionArchive archive;
+  const bool opened = written && archive.open(path.c_str());
+  allOk = check(opened, "archive maps") && allOk;
+  if (!opened) {
+    std::printf("  %s\n", archive.error().c_str());
+    unlink(path.c_str());
+    std::printf("\nFAILED\n");
+    return 1;
+  }
+
+  // Header and chunk table
+  const ArchiveHeader& head = archive.header();
+  const uint64_t total = expected.size();
+  bool ok = head.sampleRate == sampleRate && archive.totalSamples() == total &&
+            head.chunkSamples == SESSION_ARCHIVE_CHUNK_SAMPLES && head.audioOffset % SESSION_ARCHIVE_ALIGN == 0 &&
+            std::memcmp(&archive.run(), &run, sizeof(run)) == 0;
+  allOk = check(ok, "header and run configuration") && allOk;
+  const ArchiveChunk* chunks = reinterpret_cast<const ArchiveChunk*>(
+      reinterpret_cast<const uint8_t*>(&head) + head.chunkTableOffset);
+  ok = head.chunkCount == (total + head.chunkSamples - 1) / head.chunkSamples && head.chunkCount > 1;
+  uint64_t covered = 0;
+  for (uint64_t i = 0; ok && i < head.chunkCount; i++) {
+    ok = chunks[i].offset == head.audioOffset + covered * 2 &&
+         (chunks[i].samples == head.chunkSamples || i + 1 == head.chunkCount);
+    covered += chunks[i].samples;
+  }
+  allOk = check(ok && covered == total, "chunks back to back over the audio") && allOk;
+
+  // Samples
+  const int16_t* audio = archive.samples(0, total);
+  ok = audio != nullptr && std::equal(expected.begin(), expected.end(), audio);
+  allOk = check(ok, "samples match the written audio") && allOk;
+  ok = archive.samples(total, 0) != nullptr && archive.samples(total, 1) == nullptr &&
+       archive.samples(1, total) == nullptr;
+  allOk = check(ok, "samples out of range refused") && allOk;
+
+  // Click table
+  std::vector<ArchiveClick> sorted = clicks;
+  std::stable_sort(sorted.begin(), sorted.end(),
+                   [](const ArchiveClick& a, const ArchiveClick& b) { return a.onset < b.onset; });
+  ok = archive.clickCount() == sorted.size();
+  for (size_t i = 0; ok && i < sorted.size(); i++) {
+    ok = sameClick(archive.click(i), sorted[i]);
+  }
+  allOk = check(ok, "click table: every click, in onset order") && allOk;
+  ok = archive.clickCount() == sorted.size();
+  for (size_t i = 0; ok && i < archive.clickCount(); i++) {
+    const ArchiveClick& c = archive.click(i);
+    const int16_t* samples = archive.clickSamples(c);
+    ok = samples != nullptr && std::equal(samples, samples + c.samples, expected.begin() + c.start);
+  }
+  allOk = check(ok, "click samples are the audio at the click") && allOk;
+  ok = archive.findClick(0) == 0 && archive.findClick(total) == archive.clickCount();
+  for (size_t i = 0; ok && i < archive.clickCount(); i++) {
+    const uint64_t onset = archive.click(i).onset;
+    ok = archive.findClick(onset) == i && archive.findClick(onset + 1) == i + 1 &&
+         (i == 0 || archive.findClick(onset - 1) == i);
+  }
+  allOk = check(ok, "findClick lands on every onset") && allOk;
+
+  // Beat index
+  std::sort(beatNumbers.begin(), beatNumbers.end());
+  ok = archive.beatCount() == beatNumbers.size();
+  for (size_t i = 0; ok && i < beatNumbers.size(); i++) {
+    const ArchiveBeat& entry = archive.beat(i);
+    size_t count = 0;
+    for (const ArchiveClick& c : sorted) {
+      count += c.beat == static_cast<int32_t>(entry.beat);
+    }
+    ok = entry.beat == beatNumbers[i] && entry.start == synth.beatStart(entry.beat) && entry.clickCount == count &&
+         archive.findBeat(entry.beat) == &entry;
+    for (uint64_t k = entry.firstClick; ok && k < entry.firstClick + entry.clickCount; k++) {
+      ok = k < archive.clickCount() && archive.click(k).beat == static_cast<int32_t>(entry.beat);
+    }
+  }
+  const ArchiveBeat* empty = archive.findBeat(emptyBeat);
+  ok = ok && empty != nullptr && empty->clickCount == 0 && archive.findBeat(emptyBeat + 1) == nullptr;
+  allOk = check(ok, "beat index: each beat's clicks, findBeat") && allOk;
+  const long cut = static_cast<long>(head.beatIndexOffset + 1);
+  archive.close();
+
+  // A copy cut inside the beat table
+  FILE* in = std::fopen(path.c_str(), "rb");
+  FILE* out = std::fopen(truncated.c_str(), "wb");
+  ok = in != nullptr && out != nullptr;
+  std::vector<char> bytes(static_cast<size_t>(cut));
+  ok = ok && std::fread(bytes.data(), 1, bytes.size(), in) == bytes.size() &&
+       std::fwrite(bytes.data(), 1, bytes.size(), out) == bytes.size();
+  if (in != nullptr) {
+    std::fclose(in);
+  }
+  if (out != nullptr) {
+    ok = std::fclose(out) == 0 && ok;
+  }
+  SessionArchive cutArchive;
+  ok = ok && !cutArchive.open(truncated.c_str());
+  allOk = check(ok, "truncated archive refused") && allOk;
+
+  unlink(path.c_str());
+  unlink(truncated.c_str());
+  std::printf("\n%s\n", allOk ? "archive round trip exact" : "FAILED");
+  return allOk ? 0 : 1;
+}
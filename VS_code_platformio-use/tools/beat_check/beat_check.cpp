@@ -0,0 +1,140 @@
+// Host check of the beat scheduler's interval scaling on the native HAL.
+//
+// Runs the unmodified firmware through one session at three rates, switched
+// with RATE between beats:
+//   - its own heart rate, which every variant's beat fits: the scale must stay
+//     at 1.0 from the first beat on and every beat start on its slot;
+//   - a rate whose period is 3/4 of the beat's motion: the scale must drop
+//     below 1.0 and settle, and the beats keep the rate;
+//   - its own heart rate again: the scale must be back at 1.0 within
+//     RECOVERY_BEATS and stay there, every beat on its slot.
+// A PLAY_WAVEFORM build checks that the schedule's own dwells are not taken
+// for motion that overruns the period. Prints the scale of every beat; exit
+// status 1 when any check fails.
+//
+//   pio run -e beat_check -e beat_check_waveform
+//   .pio/build/beat_check/program && .pio/build/beat_check_waveform/program
+
+#include "beat_scheduler.h"
+#include "command_protocol.h"
+#include "main.h"
+#include "step_timer.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+// Virtual time charged to a loop() pass that makes no progress while the step
+// engine is idle, as in pump_sim
+constexpr unsigned long IDLE_PASS_MICROS = 10;
+
+constexpr int BEATS_PER_RATE = 12;
+constexpr int FAST_BEATS = 24;         // Time to work off a whole beat of lateness, period/16 a beat
+constexpr int SETTLED_BEATS = 4;       // The last beats at a rate, checked for a settled scale
+constexpr int RECOVERY_BEATS = 3;
+constexpr long SETTLED_ERROR_US = 100;  // Worst period error once the scale has settled
+constexpr uint32_t SETTLED_SCALE_SPREAD = 16;
+
+// One loop() pass; jumps the clock to the next step deadline when the pass
+// made no progress, so the beats run at their exact intervals
+static void pass() {
+  const State before = currentState;
+  const uint8_t queuedBefore = stepTimerQueued();
+  loop();
+  if (currentState == before && stepTimerQueued() == queuedBefore) {
+    const unsigned long toNext = stepTimerMicrosToNextStep();
+    halAdvance(toNext != 0 ? toNext : IDLE_PASS_MICROS);
+  }
+}
+
+// Runs until the scheduler has closed `count` more beats, returning their
+// reports; fewer if the session ends or stalls
+static std::vector<BeatReport> runBeats(int count) {
+  std::vector<BeatReport> beats;
+  const unsigned long long limit = halNowMicros() + 2ULL * count * beatSchedulerPeriod() + 10000000ULL;
+  while (static_cast<int>(beats.size()) < count && halNowMicros() < limit) {
+    const State before = currentState;
+    pass();
+    if (before == State::CYCLE_COMPLETE && currentState != State::CYCLE_COMPLETE) {
+      beats.push_back(beatSchedulerLastBeat());  // The scale is only set once the beat may start
+    }
+  }
+  return beats;
+}
+
+static void onSerial(const uint8_t*, size_t) {}  // The replies are not checked
+
+static void setRate(uint16_t beatsPerMinute) {
+  uint8_t payload[2];
+  writeU16(payload, beatsPerMinute);
+  uint8_t frame[COMMAND_MAX_PAYLOAD + 5];
+  halSerialInject(frame, encodeCommandFrame(COMMAND_RATE, payload, sizeof(payload), frame));
+}
+
+static void print(const char* label, const std::vector<BeatReport>& beats) {
+  std::printf("%s\n", label);
+  for (const BeatReport& beat : beats) {
+    std::printf("  beat %3lu  period %8lu  err %6ld  late %6lu  active %8lu  scale %5lu\n", beat.beat, beat.period,
+                beat.error, beat.late, beat.active, static_cast<unsigned long>(beat.scale));
+  }
+}
+
+static bool check(bool ok, const char* what) {
+  std::printf("%-60s %s\n", what, ok ? "ok" : "FAIL");
+  return ok;
+}
+
+// Every beat from `first` on at scale 1.0, starting on its slot
+static bool atFullScale(const std::vector<BeatReport>& beats, size_t first) {
+  bool ok = beats.size() == static_cast<size_t>(BEATS_PER_RATE);
+  for (size_t i = first; i < beats.size(); i++) {
+    ok = ok && beats[i].scale == BEAT_SCALE_ONE && beats[i].late == 0 && beats[i].error == 0;
+  }
+  return ok;
+}
+
+int main() {
+  halReset();
+  halSetSerialListener(onSerial);
+  setup();
+  runtimeMillis = 3600000UL;  // Outlasts every rate
+  const unsigned long ownPeriod = beatSchedulerPeriod();
+  const uint16_t ownRate = static_cast<uint16_t>(60000000UL / ownPeriod);
+  char label[96];
+  bool allOk = true;
+
+  std::vector<BeatReport> beats = runBeats(BEATS_PER_RATE);
+  std::snprintf(label, sizeof(label), "own rate, %u bpm", ownRate);
+  print(label, beats);
+  // The first beat's period runs from setup(), before the schedule's anchor settles
+  allOk = check(atFullScale(beats, 1) && beats.front().scale == BEAT_SCALE_ONE, "fits its period: scale 1.0") && allOk;
+
+  // A period of 3/4 of the beat's motion, which the motion cannot fit at full scale
+  const uint16_t fastRate = static_cast<uint16_t>(60000000ULL * 4 / (3ULL * beats.back().active) + 1);
+  setRate(fastRate);
+  beats = runBeats(FAST_BEATS);
+  std::snprintf(label, sizeof(label), "fast rate, %u bpm", fastRate);
+  print(label, beats);
+  const bool settled = beats.size() == static_cast<size_t>(FAST_BEATS);
+  uint32_t lowest = BEAT_SCALE_ONE;
+  uint32_t highest = 0;
+  long worstError = 0;
+  for (size_t i = settled ? beats.size() - SETTLED_BEATS : beats.size(); i < beats.size(); i++) {
+    lowest = beats[i].scale < lowest ? beats[i].scale : lowest;
+    highest = beats[i].scale > highest ? beats[i].scale : highest;
+    worstError = std::labs(beats[i].error) > worstError ? std::labs(beats[i].error) : worstError;
+  }
+  allOk = check(settled && highest < BEAT_SCALE_ONE && highest - lowest <= SETTLED_SCALE_SPREAD,
+                "too long for its period: scale below 1.0, settled") &&
+          allOk;
+  allOk = check(worstError <= SETTLED_ERROR_US, "too long for its period: beats keep the rate") && allOk;
+
+  setRate(ownRate);
+  beats = runBeats(BEATS_PER_RATE);
+  std::snprintf(label, sizeof(label), "own rate again, %u bpm", ownRate);
+  print(label, beats);
+  allOk = check(atFullScale(beats, RECOVERY_BEATS), "fits its period again: back to scale 1.0") && allOk;
+
+  std::printf("\n%s\n", allOk ? "scale converges" : "FAILED");
+  return allOk ? 0 : 1;
+}
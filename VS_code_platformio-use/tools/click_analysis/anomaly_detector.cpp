@@ -0,0 +1,110 @@
+#include "anomaly_detector.h"
+
+#include <math.h>
+#include <string.h>
+
+constexpr int D = ANOMALY_DIMENSIONS;
+
+void anomalyFeatures(const ClickFeatures& f, double* x) {
+  x[0] = log(f.peak + 1e-9);
+  x[1] = f.durationMs;
+  x[2] = log(f.rms + 1e-9);
+  x[3] = f.kurtosis;
+  x[4] = f.centroidHz * 1e-3;
+  x[5] = f.rolloffHz * 1e-3;
+  x[6] = f.bands[0] + f.bands[1] + f.bands[2];  // Below 2 kHz
+  x[7] = f.bands[5] + f.bands[6] + f.bands[7];  // Above 4 kHz
+}
+
+ClickAnomalyDetector::ClickAnomalyDetector(const AnomalyConfig& config) : config(config) {
+  reset();
+}
+
+void ClickAnomalyDetector::reset() {
+  memset(models, 0, sizeof(models));
+  trippedKind = -1;
+}
+
+void ClickAnomalyDetector::learn(Model& model, const double* x) {
+  model.count++;
+  double delta[D];
+  for (int i = 0; i < D; i++) {
+    delta[i] = x[i] - model.mean[i];
+    model.mean[i] += delta[i] / model.count;
+  }
+  for (int i = 0; i < D; i++) {
+    const double after = x[i] - model.mean[i];
+    for (int j = 0; j <= i; j++) {
+      model.m2[i][j] += after * delta[j];
+    }
+  }
+}
+
+bool ClickAnomalyDetector::freeze(Model& model) {
+  double trace = 0;
+  for (int i = 0; i < D; i++) {
+    trace += model.m2[i][i];
+  }
+  // A feature that never varied in the baseline would make the covariance
+  // singular; grow the ridge until the factor exists
+  double ridge = config.ridge * trace / D / (model.count - 1);
+  for (int attempt = 0; attempt < 8; attempt++, ridge = ridge > 0 ? ridge * 10 : 1e-9) {
+    bool ok = true;
+    for (int i = 0; i < D && ok; i++) {
+      for (int j = 0; j <= i; j++) {
+        double sum = model.m2[i][j] / (model.count - 1) + (i == j ? ridge : 0.0);
+        for (int k = 0; k < j; k++) {
+          sum -= model.factor[i][k] * model.factor[j][k];
+        }
+        if (i == j) {
+          ok = sum > 0;
+          model.factor[i][i] = ok ? sqrt(sum) : 0;
+        } else {
+          model.factor[i][j] = sum / model.factor[j][j];
+        }
+      }
+    }
+    if (ok) {
+      return true;
+    }
+  }
+  return false;
+}
+
+double ClickAnomalyDetector::distance(const Model& model, const double* x) const {
+  // Forward substitution: |L^-1 (x - mean)|^2 is the squared distance
+  double y[D];
+  double squared = 0;
+  for (int i = 0; i < D; i++) {
+    double sum = x[i] - model.mean[i];
+    for (int k = 0; k < i; k++) {
+      sum -= model.factor[i][k] * y[k];
+    }
+    y[i] = sum / model.factor[i][i];
+    squared += y[i] * y[i];
+  }
+  return sqrt(squared);
+}
+
+AnomalyScore ClickAnomalyDetector::add(const ClickFeatures& features, int kind) {
+  AnomalyScore score;
+  Model& model = models[kind >= 0 && kind < ANOMALY_KINDS ? kind : 0];
+  double x[D];
+  anomalyFeatures(features, x);
+  if (!model.ready) {
+    learn(model, x);
+    if (model.count >= config.baselineClicks && model.count >= 2) {
+      model.ready = freeze(model);
+    }
+    return score;
+  }
+  score.scored = true;
+  score.distance = static_cast<float>(distance(model, x));
+  score.atypical = score.distance > config.threshold;
+  model.run = score.atypical ? model.run + 1 : 0;
+  if (model.run >= config.tripClicks && trippedKind < 0) {
+    trippedKind = static_cast<int>(&model - models);
+    score.tripped = true;
+  }
+  return score;
+}
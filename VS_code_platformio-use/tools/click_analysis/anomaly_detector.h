@@ -0,0 +1,76 @@
+#ifndef ANOMALY_DETECTOR_H
+#define ANOMALY_DETECTOR_H
+
+// Online detector for atypical valve clicks, e.g. the dulling closure click of
+// a thrombus forming (click_synth.h).
+//
+// Each click kind (ArchiveClickKind: unknown, opening, closure) has its own
+// baseline, learned from its first baselineClicks clicks as a running mean
+// and covariance (Welford's update) of ANOMALY_DIMENSIONS features. Once the
+// baseline is complete it is frozen, so a slow drift cannot teach itself in,
+// and every further click is scored by its Mahalanobis distance from it
+// through a Cholesky factor of the covariance. Both the update and the score
+// are O(d^2) in fixed storage: memory and time per click do not grow with
+// the session.
+//
+// A click farther than `threshold` is atypical. The detector trips after
+// tripClicks atypical clicks of one kind in a row, so a single knock or
+// bumped microphone does not stop the rig.
+
+#include "click_features.h"
+
+#include <stdint.h>
+
+constexpr int ANOMALY_DIMENSIONS = 8;
+constexpr int ANOMALY_KINDS = 3;
+
+struct AnomalyConfig {
+  uint32_t baselineClicks = 40;  // Per kind
+  float threshold = 6.0f;        // Mahalanobis distance of an atypical click
+  uint32_t tripClicks = 3;       // Atypical clicks of one kind in a row that trip
+  float ridge = 1e-3f;           // Added to the covariance diagonal, times its mean
+};
+
+struct AnomalyScore {
+  bool scored = false;  // False while the kind's baseline is still being learned
+  float distance = 0;
+  bool atypical = false;
+  bool tripped = false;  // This click tripped the detector
+};
+
+// The feature vector the baseline is built on: levels in log, frequencies in kHz
+void anomalyFeatures(const ClickFeatures& features, double* x);
+
+class ClickAnomalyDetector {
+ public:
+  explicit ClickAnomalyDetector(const AnomalyConfig& config = AnomalyConfig());
+
+  // `kind` is an ArchiveClickKind; out of range counts as unknown
+  AnomalyScore add(const ClickFeatures& features, int kind = 0);
+
+  bool tripped() const { return trippedKind >= 0; }
+  int trippedBy() const { return trippedKind; }
+  bool ready(int kind) const { return models[kind].ready; }
+  uint32_t baselineCount(int kind) const { return models[kind].count; }
+  void reset();
+
+ private:
+  struct Model {
+    uint32_t count;
+    double mean[ANOMALY_DIMENSIONS];
+    double m2[ANOMALY_DIMENSIONS][ANOMALY_DIMENSIONS];  // Sum of outer products of deviations
+    double factor[ANOMALY_DIMENSIONS][ANOMALY_DIMENSIONS];  // Lower Cholesky factor of the covariance
+    bool ready;
+    uint32_t run;  // Atypical clicks in a row
+  };
+
+  void learn(Model& model, const double* x);
+  bool freeze(Model& model);
+  double distance(const Model& model, const double* x) const;
+
+  AnomalyConfig config;
+  Model models[ANOMALY_KINDS];
+  int trippedKind = -1;
+};
+
+#endif // ANOMALY_DETECTOR_H
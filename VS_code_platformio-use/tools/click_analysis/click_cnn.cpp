@@ -0,0 +1,426 @@
+#include "click_cnn.h"
+
+#include "simd_kernels.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+
+static bool hasWeights(uint8_t type) {
+  return type == CNN_CONV1D || type == CNN_DENSE;
+}
+
+CnnModel::CnnModel(uint32_t inputLength, uint32_t inputChannels)
+    : inputLength(inputLength), inputChannels(inputChannels) {}
+
+bool CnnModel::add(CnnLayerType type, uint32_t kernel, uint32_t stride, uint32_t outChannels,
+                   CnnActivation activation) {
+  CnnLayer layer;
+  layer.record = CnnLayerRecord{};
+  layer.record.type = type;
+  layer.record.activation = activation;
+  layer.inLength = stack.empty() ? inputLength : stack.back().outLength;
+  layer.inChannels = stack.empty() ? inputChannels : stack.back().outChannels;
+  layer.outChannels = layer.inChannels;
+  layer.outLength = 1;
+  layer.rowLength = 0;
+  if (layer.inLength == 0 || layer.inChannels == 0 || activation > CNN_RELU) {
+    return false;
+  }
+  switch (type) {
+    case CNN_CONV1D:
+      if (kernel == 0 || stride == 0 || outChannels == 0 || kernel > layer.inLength) {
+        return false;
+      }
+      layer.outLength = (layer.inLength - kernel) / stride + 1;
+      layer.outChannels = outChannels;
+      layer.rowLength = kernel * layer.inChannels;
+      break;
+    case CNN_MAXPOOL:
+      if (stride == 0 || stride > layer.inLength) {
+        return false;
+      }
+      kernel = stride;
+      outChannels = 0;
+      layer.outLength = layer.inLength / stride;
+      break;
+    case CNN_GLOBAL_AVERAGE:
+      kernel = stride = outChannels = 0;
+      break;
+    case CNN_DENSE:
+      if (outChannels == 0) {
+        return false;
+      }
+      kernel = stride = 0;
+      layer.outChannels = outChannels;
+      layer.rowLength = layer.inLength * layer.inChannels;
+      break;
+    default:
+      return false;
+  }
+  layer.record.kernel = kernel;
+  layer.record.stride = stride;
+  layer.record.outChannels = outChannels;
+  layer.weights.assign(static_cast<size_t>(layer.outChannels) * layer.rowLength, 0.0f);
+  layer.biases.assign(layer.rowLength > 0 ? layer.outChannels : 0, 0.0f);
+  const size_t largest = std::max<size_t>(ping.size(), static_cast<size_t>(layer.outLength) * layer.outChannels);
+  ping.resize(largest);
+  pong.resize(largest);
+  stack.push_back(std::move(layer));
+  range = 0;
+  return true;
+}
+
+void CnnModel::randomize(uint64_t seed) {
+  uint64_t state = seed * 0x9E3779B97F4A7C15ull + 1;
+  auto uniform = [&state]() {
+    // xorshift64*, top 24 bits to [-1, 1)
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return static_cast<float>((state * 0x2545F4914F6CDD1Dull) >> 40) / 8388608.0f - 1.0f;
+  };
+  for (CnnLayer& layer : stack) {
+    const float limit = sqrtf(6.0f / std::max<uint32_t>(layer.rowLength, 1));
+    for (float& w : layer.weights) {
+      w = limit * uniform();
+    }
+    for (float& b : layer.biases) {
+      b = 0.05f * uniform();
+    }
+    layer.record.outputRange = 0;
+  }
+  range = 0;
+}
+
+bool CnnModel::fail(const char* what) {
+  message = what;
+  return false;
+}
+
+bool CnnModel::load(const char* path) {
+  FILE* file = fopen(path, "rb");
+  if (file == nullptr) {
+    return fail(strerror(errno));
+  }
+  CnnFileHeader header;
+  bool ok = fread(&header, sizeof(header), 1, file) == 1;
+  if (!ok || memcmp(header.magic, CNN_FILE_MAGIC, sizeof(header.magic)) != 0) {
+    fclose(file);
+    return fail("not a CNN weight file (bad magic)");
+  }
+  if (header.version != CNN_FILE_VERSION || header.layerCount == 0 || header.layerCount > CNN_MAX_LAYERS) {
+    fclose(file);
+    return fail("unsupported CNN weight file version or layer count");
+  }
+  *this = CnnModel(header.inputLength, header.inputChannels);
+  for (uint32_t i = 0; i < header.layerCount && ok; i++) {
+    CnnLayerRecord record;
+    if (fread(&record, sizeof(record), 1, file) != 1) {
+      ok = fail("CNN weight file truncated (layer record)");
+      break;
+    }
+    if (!add(static_cast<CnnLayerType>(record.type), record.kernel, record.stride, record.outChannels,
+             static_cast<CnnActivation>(record.activation))) {
+      ok = fail("CNN weight file has a layer that does not fit the shape before it");
+      break;
+    }
+    CnnLayer& layer = stack.back();
+    layer.record.outputRange = record.outputRange;
+    if (fread(layer.weights.data(), sizeof(float), layer.weights.size(), file) != layer.weights.size() ||
+        fread(layer.biases.data(), sizeof(float), layer.biases.size(), file) != layer.biases.size()) {
+      ok = fail("CNN weight file truncated (weights)");
+    }
+  }
+  fclose(file);
+  if (!ok) {
+    stack.clear();
+    return false;
+  }
+  range = header.inputRange;
+  message.clear();
+  return true;
+}
+
+bool CnnModel::save(const char* path) const {
+  FILE* file = fopen(path, "wb");
+  if (file == nullptr) {
+    return false;
+  }
+  CnnFileHeader header{};
+  memcpy(header.magic, CNN_FILE_MAGIC, sizeof(header.magic));
+  header.version = CNN_FILE_VERSION;
+  header.layerCount = static_cast<uint32_t>(stack.size());
+  header.inputLength = inputLength;
+  header.inputChannels = inputChannels;
+  header.inputRange = range;
+  bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+  for (const CnnLayer& layer : stack) {
+    ok = ok && fwrite(&layer.record, sizeof(layer.record), 1, file) == 1 &&
+         fwrite(layer.weights.data(), sizeof(float), layer.weights.size(), file) == layer.weights.size() &&
+         fwrite(layer.biases.data(), sizeof(float), layer.biases.size(), file) == layer.biases.size();
+  }
+  return fclose(file) == 0 && ok;
+}
+
+uint32_t CnnModel::outputs() const {
+  return stack.empty() ? 0 : stack.back().outLength * stack.back().outChannels;
+}
+
+size_t CnnModel::parameters() const {
+  size_t count = 0;
+  for (const CnnLayer& layer : stack) {
+    count += layer.weights.size() + layer.biases.size();
+  }
+  return count;
+}
+
+bool CnnModel::calibrated() const {
+  if (stack.empty() || !(range > 0)) {
+    return false;
+  }
+  for (const CnnLayer& layer : stack) {
+    if (!(layer.record.outputRange > 0)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void CnnModel::run(const float* input, float* logits, float* ranges) {
+  const float* in = input;
+  for (size_t i = 0; i < stack.size(); i++) {
+    const CnnLayer& layer = stack[i];
+    float* out = i + 1 == stack.size() ? logits : (i % 2 == 0 ? ping.data() : pong.data());
+    const uint32_t channels = layer.outChannels;
+    switch (layer.record.type) {
+      case CNN_CONV1D:
+      case CNN_DENSE:
+        for (uint32_t t = 0; t < layer.outLength; t++) {
+          const float* x = in + static_cast<size_t>(t) * layer.record.stride * layer.inChannels;
+          for (uint32_t o = 0; o < channels; o++) {
+            const float* w = layer.weights.data() + static_cast<size_t>(o) * layer.rowLength;
+            out[t * channels + o] = layer.biases[o] + static_cast<float>(simd::dot(w, x, layer.rowLength));
+          }
+        }
+        break;
+      case CNN_MAXPOOL:
+        for (uint32_t t = 0; t < layer.outLength; t++) {
+          const float* x = in + static_cast<size_t>(t) * layer.record.stride * channels;
+          for (uint32_t c = 0; c < channels; c++) {
+            float m = x[c];
+            for (uint32_t k = 1; k < layer.record.stride; k++) {
+              m = std::max(m, x[k * channels + c]);
+            }
+            out[t * channels + c] = m;
+          }
+        }
+        break;
+      case CNN_GLOBAL_AVERAGE:
+        for (uint32_t c = 0; c < channels; c++) {
+          float s = 0;
+          for (uint32_t t = 0; t < layer.inLength; t++) {
+            s += in[t * channels + c];
+          }
+          out[c] = s / layer.inLength;
+        }
+        break;
+    }
+    const size_t count = static_cast<size_t>(layer.outLength) * channels;
+    if (layer.record.activation == CNN_RELU) {
+      for (size_t j = 0; j < count; j++) {
+        out[j] = std::max(out[j], 0.0f);
+      }
+    }
+    if (ranges != nullptr) {
+      ranges[i + 1] = std::max(ranges[i + 1], simd::maxAbs(out, count));
+    }
+    in = out;
+  }
+}
+
+void CnnModel::forward(const float* input, float* logits) {
+  run(input, logits, nullptr);
+}
+
+void CnnModel::calibrate(const float* inputs, size_t count) {
+  std::vector<float> ranges(stack.size() + 1, 0.0f);
+  std::vector<float> logits(outputs());
+  for (size_t n = 0; n < count; n++) {
+    const float* input = inputs + n * this->inputs();
+    ranges[0] = std::max(ranges[0], simd::maxAbs(input, this->inputs()));
+    run(input, logits.data(), ranges.data());
+  }
+  range = ranges[0];
+  for (size_t i = 0; i < stack.size(); i++) {
+    stack[i].record.outputRange = ranges[i + 1];
+  }
+}
+
+static int8_t saturate(float v, int lowest) {
+  const int q = static_cast<int>(v + (v >= 0 ? 0.5f : -0.5f));
+  return static_cast<int8_t>(std::min(127, std::max(lowest, q)));
+}
+
+bool Int8Cnn::build(const CnnModel& model) {
+  stack.clear();
+  if (!model.calibrated()) {
+    return false;
+  }
+  const std::vector<CnnLayer>& layers = model.layers();
+  float inStep = model.inputRange() / 127;  // Input value of one int8 step
+  int32_t inZero = 0;
+  bool nonNegative = false;
+  inputScale = 1 / inStep;
+  inputCount = model.inputs();
+  outputCount = model.outputs();
+  size_t largest = inputCount;
+  size_t columns = 0;
+  size_t pairCount = 0;
+  for (size_t i = 0; i < layers.size(); i++) {
+    const CnnLayer& source = layers[i];
+    const bool last = i + 1 == layers.size();
+    Layer layer;
+    layer.type = static_cast<CnnLayerType>(source.record.type);
+    layer.relu = source.record.activation == CNN_RELU;
+    layer.kernel = source.record.kernel;
+    layer.stride = source.record.stride;
+    layer.inLength = source.inLength;
+    layer.inChannels = source.inChannels;
+    layer.outLength = source.outLength;
+    layer.outChannels = source.outChannels;
+    layer.rowLength = source.rowLength;
+    layer.columns = static_cast<uint32_t>((layer.outChannels + simd::I8_COLUMNS - 1) / simd::I8_COLUMNS *
+                                          simd::I8_COLUMNS);
+    layer.inZero = inZero;
+    // Outputs that cannot be negative use all 255 levels, with -128 as 0
+    nonNegative = layer.relu || (nonNegative && !hasWeights(layer.type));
+    layer.zero = nonNegative ? -128 : 0;
+    // Max pooling commutes with the quantization, so it keeps its input's step
+    float outStep = source.record.outputRange / (nonNegative ? 255 : 127);
+    if (layer.type == CNN_MAXPOOL) {
+      outStep = inStep;
+      layer.zero = inZero;
+    }
+    if (hasWeights(layer.type)) {
+      layer.weights.assign(static_cast<size_t>(layer.rowLength + 1) / 2 * layer.columns * 2, 0);
+      layer.biases.assign(layer.columns, 0);
+      layer.rescale.assign(layer.columns, 0.0f);
+      for (uint32_t o = 0; o < layer.outChannels; o++) {
+        const float* w = source.weights.data() + static_cast<size_t>(o) * layer.rowLength;
+        const float largestWeight = simd::maxAbs(w, layer.rowLength);
+        const float weightStep = largestWeight > 0 ? largestWeight / 127 : 1.0f;
+        int32_t weightSum = 0;
+        for (uint32_t k = 0; k < layer.rowLength; k++) {
+          const int8_t q = saturate(w[k] / weightStep, -127);
+          layer.weights[(static_cast<size_t>(k / 2) * layer.columns + o) * 2 + k % 2] = q;
+          weightSum += q;
+        }
+        // The input zero point times every weight, taken out once here
+        const float accumulatorStep = weightStep * inStep;
+        layer.biases[o] = static_cast<int32_t>(lrint(source.biases[o] / accumulatorStep)) - inZero * weightSum;
+        layer.rescale[o] = last ? accumulatorStep : accumulatorStep / outStep;
+      }
+      columns = std::max<size_t>(columns, layer.columns);
+      pairCount = std::max<size_t>(pairCount, (static_cast<size_t>(layer.inLength) * layer.inChannels + 1) / 2);
+    } else if (layer.type == CNN_GLOBAL_AVERAGE) {
+      layer.rescale.assign(1, inStep / layer.inLength / outStep);
+    }
+    if (!last) {
+      largest = std::max(largest, static_cast<size_t>(layer.outLength) * layer.outChannels);
+    }
+    inStep = outStep;
+    inZero = layer.zero;
+    stack.push_back(std::move(layer));
+  }
+  outputStep = inStep;
+  // Two activation buffers, each with slack for the padding columns the last
+  // output row writes past its end
+  half = (largest + simd::I8_COLUMNS + 63) / 64 * 64;
+  arena.assign(2 * half, 0);
+  accumulators.assign(columns, 0);
+  pairs.assign(pairCount, 0);
+  return true;
+}
+
+size_t Int8Cnn::weightBytes() const {
+  size_t bytes = 0;
+  for (const Layer& layer : stack) {
+    bytes += layer.weights.size() + layer.biases.size() * sizeof(int32_t) + layer.rescale.size() * sizeof(float);
+  }
+  return bytes;
+}
+
+void Int8Cnn::infer(const float* input, float* logits) {
+  int8_t* in = arena.data();
+  simd::quantizeI8(input, inputScale, inputCount, in);
+  for (size_t i = 0; i < stack.size(); i++) {
+    const Layer& layer = stack[i];
+    const bool toLogits = i + 1 == stack.size() && hasWeights(layer.type);
+    int8_t* out = arena.data() + (i % 2 == 0 ? half : 0);
+    const uint32_t channels = layer.outChannels;
+    // Non-negative outputs clamp at their zero point, -128; signed ones are symmetric
+    const int lowest = layer.zero != 0 ? layer.zero : -127;
+    switch (layer.type) {
+      case CNN_CONV1D:
+      case CNN_DENSE: {
+        // When every window starts on an even input, the pairs of the whole
+        // input serve all of them and are packed once
+        const size_t step = static_cast<size_t>(layer.stride) * layer.inChannels;
+        const bool shared = step % 2 == 0;
+        if (shared) {
+          simd::pairI8(in, static_cast<size_t>(layer.inLength) * layer.inChannels, pairs.data());
+        }
+        for (uint32_t t = 0; t < layer.outLength; t++) {
+          const int32_t* window = pairs.data() + (shared ? t * step / 2 : 0);
+          if (!shared) {
+            simd::pairI8(in + t * step, layer.rowLength, pairs.data());
+          }
+          int32_t* acc = accumulators.data();
+          memcpy(acc, layer.biases.data(), layer.columns * sizeof(int32_t));
+          simd::multiplyAccumulateI8(layer.weights.data(), window, (layer.rowLength + 1) / 2, layer.columns, acc);
+          if (toLogits) {
+            for (uint32_t o = 0; o < channels; o++) {
+              const float v = static_cast<float>(acc[o]) * layer.rescale[o];
+              logits[t * channels + o] = layer.relu ? std::max(v, 0.0f) : v;
+            }
+          } else {
+            simd::requantizeI8(acc, layer.rescale.data(), layer.columns, layer.zero, lowest, out + t * channels);
+          }
+        }
+        break;
+      }
+      case CNN_MAXPOOL:
+        for (uint32_t t = 0; t < layer.outLength; t++) {
+          const int8_t* x = in + static_cast<size_t>(t) * layer.stride * channels;
+          int8_t* y = out + static_cast<size_t>(t) * channels;
+          memcpy(y, x, channels);
+          for (uint32_t k = 1; k < layer.stride; k++) {
+            simd::maxI8(x + k * channels, y, channels);
+          }
+          for (uint32_t c = 0; c < channels && layer.relu; c++) {
+            y[c] = static_cast<int8_t>(std::max<int32_t>(y[c], layer.zero));
+          }
+        }
+        break;
+      case CNN_GLOBAL_AVERAGE:
+        for (uint32_t c = 0; c < channels; c++) {
+          int32_t s = -layer.inZero * static_cast<int32_t>(layer.inLength);
+          for (uint32_t t = 0; t < layer.inLength; t++) {
+            s += in[t * channels + c];
+          }
+          out[c] = saturate(static_cast<float>(s) * layer.rescale[0] + layer.zero, lowest);
+        }
+        break;
+    }
+    in = out;
+  }
+  if (!stack.empty() && !hasWeights(stack.back().type)) {
+    for (uint32_t j = 0; j < outputCount; j++) {
+      logits[j] = (in[j] - stack.back().zero) * outputStep;
+    }
+  }
+}
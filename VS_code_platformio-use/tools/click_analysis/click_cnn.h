@@ -0,0 +1,168 @@
+#ifndef CLICK_CNN_H
+#define CLICK_CNN_H
+
+// Small 1D-CNN runtime for classifying valve clicks (the CNN models planned in
+// wiki/future-work), with a float reference and an int8 engine for real time.
+//
+// A model is a chain of layers over channels-last activations
+// [length][channels]: CONV1D (valid, with stride), MAXPOOL (window = stride),
+// GLOBAL_AVERAGE and DENSE (over the flattened input), each optionally
+// followed by a ReLU. The last layer's outputs are the logits. Channels-last
+// makes every conv output a dot product of two contiguous runs,
+// kernel * inChannels long, so both engines run on the vector kernels of
+// simd_kernels.h.
+//
+// Weight file "PUMPCNN1", little endian, as a training script exports it
+// (e.g. numpy tofile of each array in turn):
+//   CnnFileHeader
+//   per layer: CnnLayerRecord, then for CONV1D and DENSE
+//     float weights[outChannels][kernel][inChannels]  (DENSE: [outChannels][inputs])
+//     float biases[outChannels]
+// inputRange and outputRange are the largest |value| the input and each layer
+// output take over calibration data; 0 until CnnModel::calibrate() has run.
+//
+// Int8Cnn quantizes a calibrated model: weights per output channel to int8
+// with a symmetric scale, activations per layer to int8 over +-range, or over
+// [0, range] with -128 as zero after a ReLU so they get all 255 levels, and
+// biases to int32 at the accumulator scale, with the input zero point folded
+// in. Products are summed in int32 and each
+// output is scaled back to int8 once; the last layer's accumulators are
+// scaled to float logits. Its weights are transposed to output channels
+// innermost, so the kernel runs across channels, eight at a time, and loads
+// each input once per output row instead of once per channel: conv rows here
+// are only 9 to 80 inputs long, too short to vectorize along. Every
+// activation lives in one arena allocated when the engine is built, so
+// infer() never allocates.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+enum CnnLayerType : uint8_t {
+  CNN_CONV1D = 1,
+  CNN_MAXPOOL = 2,
+  CNN_GLOBAL_AVERAGE = 3,
+  CNN_DENSE = 4,
+};
+
+enum CnnActivation : uint8_t {
+  CNN_LINEAR = 0,
+  CNN_RELU = 1,
+};
+
+constexpr char CNN_FILE_MAGIC[8] = {'P', 'U', 'M', 'P', 'C', 'N', 'N', '1'};
+constexpr uint32_t CNN_FILE_VERSION = 1;
+constexpr uint32_t CNN_MAX_LAYERS = 64;
+
+struct CnnFileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t layerCount;
+  uint32_t inputLength;
+  uint32_t inputChannels;
+  float inputRange;
+  uint32_t reserved;
+};
+static_assert(sizeof(CnnFileHeader) == 32, "CnnFileHeader layout");
+
+struct CnnLayerRecord {
+  uint8_t type;        // CnnLayerType
+  uint8_t activation;  // CnnActivation
+  uint16_t reserved;
+  uint32_t kernel;       // CONV1D only
+  uint32_t stride;       // CONV1D and MAXPOOL
+  uint32_t outChannels;  // CONV1D and DENSE
+  float outputRange;
+};
+static_assert(sizeof(CnnLayerRecord) == 20, "CnnLayerRecord layout");
+
+struct CnnLayer {
+  CnnLayerRecord record;
+  uint32_t inLength, inChannels;
+  uint32_t outLength, outChannels;
+  uint32_t rowLength;  // Weights per output channel; 0 for layers without
+  std::vector<float> weights;
+  std::vector<float> biases;
+};
+
+class CnnModel {
+ public:
+  CnnModel(uint32_t inputLength = 0, uint32_t inputChannels = 1);
+
+  // Appends a layer after the last; false if it does not fit the shape so far
+  bool add(CnnLayerType type, uint32_t kernel, uint32_t stride, uint32_t outChannels,
+           CnnActivation activation = CNN_LINEAR);
+
+  // He-initialised weights and small biases; deterministic for a given seed
+  void randomize(uint64_t seed);
+
+  bool load(const char* path);
+  bool save(const char* path) const;
+  const std::string& error() const { return message; }
+
+  // Sets inputRange and every outputRange from `count` inputs in a row
+  void calibrate(const float* inputs, size_t count);
+  bool calibrated() const;
+
+  // logits has outputs() values; runs on scratch buffers of the model
+  void forward(const float* input, float* logits);
+
+  uint32_t inputs() const { return inputLength * inputChannels; }
+  uint32_t outputs() const;
+  float inputRange() const { return range; }
+  const std::vector<CnnLayer>& layers() const { return stack; }
+  CnnLayer& layer(size_t i) { return stack[i]; }  // E.g. to set weights fitted elsewhere
+  size_t parameters() const;
+
+ private:
+  bool fail(const char* what);
+  void run(const float* input, float* logits, float* ranges);
+
+  uint32_t inputLength, inputChannels;
+  float range = 0;
+  std::vector<CnnLayer> stack;
+  std::vector<float> ping, pong;
+  std::string message;
+};
+
+class Int8Cnn {
+ public:
+  // False if the model has no layers or is not calibrated
+  bool build(const CnnModel& model);
+
+  // logits has outputs() values
+  void infer(const float* input, float* logits);
+
+  uint32_t outputs() const { return outputCount; }
+  size_t arenaBytes() const { return arena.size(); }
+  size_t weightBytes() const;
+
+ private:
+  struct Layer {
+    CnnLayerType type;
+    bool relu;
+    uint32_t kernel, stride;
+    uint32_t inLength, inChannels, outLength, outChannels;
+    uint32_t rowLength;  // Inputs per output
+    uint32_t columns;    // outChannels padded to whole vectors
+    int32_t inZero;      // int8 value of a 0 input
+    int32_t zero;        // int8 value of a 0 output
+    std::vector<int8_t> weights;  // [input pair][columns][2], padding zero
+    std::vector<int32_t> biases;  // [columns]
+    std::vector<float> rescale;   // Accumulator to output, per output channel
+  };
+
+  float inputScale = 0;  // Input value to int8
+  float outputStep = 0;  // Logit of one int8 step when the last layer has no weights
+  uint32_t inputCount = 0;
+  uint32_t outputCount = 0;
+  size_t half = 0;  // Arena offset of the second activation buffer
+  std::vector<Layer> stack;
+  std::vector<int8_t> arena;
+  std::vector<int32_t> accumulators;  // One output row
+  std::vector<int32_t> pairs;         // A layer's input, packed by simd::pairI8
+};
+
+#endif // CLICK_CNN_H
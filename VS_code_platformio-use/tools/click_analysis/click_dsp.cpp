@@ -0,0 +1,180 @@
+#include "click_dsp.h"
+#include "simd_kernels.h"
+
+#include <math.h>
+
+HighPassFilter::HighPassFilter(float cutoffHz, float sampleRate) {
+  // Butterworth pole pairs of a 4th-order filter as two RBJ biquads
+  const double q[2] = {1.0 / (2.0 * cos(M_PI / 8.0)), 1.0 / (2.0 * cos(3.0 * M_PI / 8.0))};
+  const double w0 = 2.0 * M_PI * cutoffHz / sampleRate;
+  for (int s = 0; s < 2; s++) {
+    const double alpha = sin(w0) / (2.0 * q[s]);
+    const double a0 = 1.0 + alpha;
+    Section& section = sections[s];
+    section.b0 = (1.0 + cos(w0)) / 2.0 / a0;
+    section.b1 = -(1.0 + cos(w0)) / a0;
+    section.b2 = section.b0;
+    section.a1 = -2.0 * cos(w0) / a0;
+    section.a2 = (1.0 - alpha) / a0;
+  }
+}
+
+void HighPassFilter::process(float* x, size_t n) {
+  // Both sections in one pass, transposed direct form II, state in registers
+  Section a = sections[0];
+  Section b = sections[1];
+  for (size_t i = 0; i < n; i++) {
+    const double in = x[i];
+    const double mid = a.b0 * in + a.z1;
+    a.z1 = a.b1 * in - a.a1 * mid + a.z2;
+    a.z2 = a.b2 * in - a.a2 * mid;
+    const double out = b.b0 * mid + b.z1;
+    b.z1 = b.b1 * mid - b.a1 * out + b.z2;
+    b.z2 = b.b2 * mid - b.a2 * out;
+    x[i] = static_cast<float>(out);
+  }
+  sections[0].z1 = a.z1;
+  sections[0].z2 = a.z2;
+  sections[1].z1 = b.z1;
+  sections[1].z2 = b.z2;
+}
+
+void HighPassFilter::reset(float x0) {
+  // Steady state of a DC input: the output is zero and so is everything the
+  // second section sees
+  Section& a = sections[0];
+  a.z2 = a.b2 * x0;
+  a.z1 = a.b1 * x0 + a.z2;
+  sections[1].z1 = 0;
+  sections[1].z2 = 0;
+}
+
+static uint32_t samplesFor(float ms, float sampleRate) {
+  return static_cast<uint32_t>(ms * 1e-3f * sampleRate + 0.5f);
+}
+
+ClickSegmenter::ClickSegmenter(const SegmenterConfig& config, float sampleRate)
+    : onRatio(config.onRatio),
+      offRatio(config.offRatio),
+      preRoll(samplesFor(config.preRollMs, sampleRate)),
+      postRoll(samplesFor(config.postRollMs, sampleRate)),
+      minClick(samplesFor(config.minClickMs, sampleRate)),
+      maxClick(samplesFor(config.maxClickMs, sampleRate)),
+      holdoff(samplesFor(config.holdoffMs, sampleRate)),
+      settle(samplesFor(config.settleMs, sampleRate)),
+      fallCoef(1.0f - expf(-static_cast<float>(SEGMENT_BLOCK) / (config.floorFallMs * 1e-3f * sampleRate))),
+      riseCoef(1.0f - expf(-static_cast<float>(SEGMENT_BLOCK) / (config.floorRiseMs * 1e-3f * sampleRate))),
+      minFloor(config.minFloor),
+      floor(config.minFloor) {
+  size_t size = 1;
+  while (size < preRoll + SEGMENT_BLOCK) {
+    size *= 2;
+  }
+  history.assign(size, 0.0f);
+  historyMask = size - 1;
+  click.samples.reserve(preRoll + maxClick + postRoll + SEGMENT_BLOCK);
+  stage = HOLDOFF;
+  holdoffUntil = settle;
+  settleUntil = settle;
+}
+
+void ClickSegmenter::seek(uint64_t position, uint32_t settleSamples) {
+  pendingCount = 0;
+  consumed = position;
+  stage = HOLDOFF;
+  holdoffUntil = position + settleSamples;
+  settleUntil = position + settleSamples;
+}
+
+void ClickSegmenter::process(const float* x, size_t n, const Sink& sink) {
+  size_t i = 0;
+  if (pendingCount > 0) {
+    while (pendingCount < SEGMENT_BLOCK && i < n) {
+      pending[pendingCount++] = x[i++];
+    }
+    if (pendingCount < SEGMENT_BLOCK) {
+      return;
+    }
+    block(pending, sink);
+    pendingCount = 0;
+  }
+  for (; i + SEGMENT_BLOCK <= n; i += SEGMENT_BLOCK) {
+    block(x + i, sink);
+  }
+  while (i < n) {
+    pending[pendingCount++] = x[i++];
+  }
+}
+
+void ClickSegmenter::block(const float* x, const Sink& sink) {
+  const float peak = simd::maxAbs(x, SEGMENT_BLOCK);
+  const uint64_t blockEnd = consumed + SEGMENT_BLOCK;
+
+  if (stage == ACTIVE) {
+    click.samples.insert(click.samples.end(), x, x + SEGMENT_BLOCK);
+    if (peak > click.noiseFloor * offRatio) {
+      lastActive = blockEnd;
+    }
+    if (blockEnd - lastActive >= postRoll || blockEnd - click.onset >= maxClick) {
+      finish(sink);
+    }
+  } else {
+    // The floor follows the background only while no click is open
+    floor += (peak - floor) * (peak < floor || consumed < settleUntil ? fallCoef : riseCoef);
+    if (floor < minFloor) {
+      floor = minFloor;
+    }
+    if (stage == HOLDOFF && blockEnd >= holdoffUntil) {
+      stage = IDLE;
+    } else if (stage == IDLE && peak > floor * onRatio) {
+      const float threshold = floor * onRatio;
+      size_t first = 0;
+      while (fabsf(x[first]) <= threshold) {
+        first++;
+      }
+      const uint32_t before = consumed < preRoll ? static_cast<uint32_t>(consumed) : preRoll;
+      click.start = consumed - before;
+      click.onset = consumed + first;
+      click.noiseFloor = floor;
+      click.samples.clear();
+      for (uint64_t s = click.start; s < consumed; s++) {
+        click.samples.push_back(history[s & historyMask]);
+      }
+      click.samples.insert(click.samples.end(), x, x + SEGMENT_BLOCK);
+      lastActive = blockEnd;
+      stage = ACTIVE;
+    }
+  }
+
+  for (size_t i = 0; i < SEGMENT_BLOCK; i++) {
+    history[(consumed + i) & historyMask] = x[i];
+  }
+  consumed = blockEnd;
+}
+
+void ClickSegmenter::finish(const Sink& sink) {
+  // Keep postRoll samples after the last active one, no more
+  const uint64_t end = lastActive + postRoll;
+  if (end < click.start + click.samples.size()) {
+    click.samples.resize(static_cast<size_t>(end - click.start));
+  }
+  click.activeSamples = static_cast<uint32_t>(lastActive - click.onset);
+  if (click.activeSamples >= minClick) {
+    sink(click);
+  }
+  stage = HOLDOFF;
+  holdoffUntil = consumed + SEGMENT_BLOCK + holdoff;
+}
+
+void ClickSegmenter::flush(const Sink& sink) {
+  if (pendingCount > 0) {
+    for (size_t i = pendingCount; i < SEGMENT_BLOCK; i++) {
+      pending[i] = 0.0f;
+    }
+    block(pending, sink);
+    pendingCount = 0;
+  }
+  if (stage == ACTIVE) {
+    finish(sink);
+  }
+}
@@ -0,0 +1,110 @@
+#ifndef CLICK_DSP_H
+#define CLICK_DSP_H
+
+// Front end of the valve-click pipeline: high-pass filter and click segmenter.
+//
+// The high-pass (4th-order Butterworth) removes flow rumble and pump vibration
+// below the click band. The segmenter follows the envelope as the peak |x| of
+// each SEGMENT_BLOCK-sample block, tracks the noise floor between clicks (it
+// falls quickly and rises slowly, so it follows the background and not the
+// clicks), and opens a click when a block exceeds onRatio times the floor. The
+// click closes once no block has exceeded offRatio times the floor for
+// postRollMs. For the first settleMs of a stream the floor only settles onto
+// the background and nothing is detected. Only the block peaks feed the serial state machine; the samples
+// themselves are touched by one vectorised max-abs per block.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <functional>
+#include <vector>
+
+class HighPassFilter {
+ public:
+  HighPassFilter(float cutoffHz, float sampleRate);
+
+  // Filters x in place
+  void process(float* x, size_t n);
+
+  // Restarts the filter as if its input had long been steady at x0, for a
+  // stream that resumes after a gap without a step transient
+  void reset(float x0);
+
+ private:
+  struct Section {
+    double b0, b1, b2, a1, a2;
+    double z1 = 0, z2 = 0;
+  };
+  Section sections[2];
+};
+
+struct SegmenterConfig {
+  float onRatio = 6.0f;      // Open a click at this multiple of the noise floor
+  float offRatio = 2.0f;     // Blocks above this multiple keep it open
+  float preRollMs = 1.0f;    // Samples kept before the opening block
+  float postRollMs = 4.0f;   // Quiet time that closes a click, kept as its tail
+  float minClickMs = 0.5f;   // Shorter detections are discarded as spikes
+  float maxClickMs = 60.0f;  // Longer ones are cut here
+  float holdoffMs = 50.0f;   // No new click this soon after one closes
+  float floorFallMs = 20.0f;     // Noise-floor time constants
+  float floorRiseMs = 2000.0f;
+  float settleMs = 500.0f;   // Floor tracks both ways at floorFallMs, no detection
+  float minFloor = 1e-5f;    // Full scale is 1.0
+};
+
+constexpr size_t SEGMENT_BLOCK = 16;
+
+struct Click {
+  uint64_t start;          // Sample index of samples[0] (stream position)
+  uint64_t onset;          // First sample above the opening threshold
+  uint32_t activeSamples;  // Onset to the last sample above the closing threshold
+  float noiseFloor;        // Floor when the click opened
+  std::vector<float> samples;  // Filtered audio, pre-roll through post-roll
+};
+
+class ClickSegmenter {
+ public:
+  using Sink = std::function<void(const Click&)>;
+
+  ClickSegmenter(const SegmenterConfig& config, float sampleRate);
+
+  // Feeds filtered samples; calls sink for each click as it closes
+  void process(const float* x, size_t n, const Sink& sink);
+
+  // Closes a click still open at the end of the stream
+  void flush(const Sink& sink);
+
+  // Continues the stream at `position` after a gap, keeping the noise floor.
+  // The next settleSamples only re-settle the floor. Must not be called while
+  // a click is open.
+  void seek(uint64_t position, uint32_t settleSamples);
+
+  bool active() const { return stage == ACTIVE; }
+
+  float noiseFloor() const { return floor; }
+  uint64_t position() const { return consumed; }
+
+ private:
+  enum Stage { IDLE, ACTIVE, HOLDOFF };
+
+  void block(const float* x, const Sink& sink);
+  void finish(const Sink& sink);
+
+  float onRatio, offRatio;
+  uint32_t preRoll, postRoll, minClick, maxClick, holdoff, settle;
+  float fallCoef, riseCoef, minFloor;
+
+  Stage stage = IDLE;
+  float floor;
+  uint64_t consumed = 0;  // Samples handed to block()
+  uint64_t lastActive = 0;
+  uint64_t holdoffUntil = 0;
+  uint64_t settleUntil;
+  Click click;
+  std::vector<float> history;  // Ring of the most recent samples, for the pre-roll
+  size_t historyMask;
+  float pending[SEGMENT_BLOCK];
+  size_t pendingCount = 0;
+};
+
+#endif // CLICK_DSP_H
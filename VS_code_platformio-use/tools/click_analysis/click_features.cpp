@@ -0,0 +1,94 @@
+#include "click_features.h"
+#include "simd_kernels.h"
+
+#include <math.h>
+#include <stdio.h>
+
+#include <algorithm>
+
+ClickFeatureExtractor::ClickFeatureExtractor(float sampleRate, size_t fftSize)
+    : sampleRate(sampleRate),
+      plan(fftSize),
+      window(fftSize),
+      binHz(fftSize / 2 + 1),
+      bandOfBin(fftSize / 2 + 1),
+      re(fftSize),
+      im(fftSize),
+      spectrum(fftSize) {
+  for (size_t i = 0; i < fftSize; i++) {
+    window[i] = static_cast<float>(0.5 - 0.5 * cos(2.0 * M_PI * static_cast<double>(i) / static_cast<double>(fftSize)));
+  }
+  for (size_t k = 0; k < binHz.size(); k++) {
+    binHz[k] = static_cast<float>(k) * sampleRate / static_cast<float>(fftSize);
+    int band = 0;
+    while (band < CLICK_BAND_COUNT - 1 && binHz[k] >= CLICK_BAND_EDGES_HZ[band]) {
+      band++;
+    }
+    bandOfBin[k] = band;
+  }
+}
+
+ClickFeatures ClickFeatureExtractor::extract(const Click& click) {
+  ClickFeatures f{};
+  const float* x = click.samples.data();
+  const size_t n = click.samples.size();
+  f.timeSeconds = static_cast<double>(click.onset) / sampleRate;
+  f.durationMs = static_cast<float>(click.activeSamples) * 1000.0f / sampleRate;
+  if (n == 0) {
+    return f;
+  }
+
+  // Time domain
+  f.peak = simd::maxAbs(x, n);
+  const float mean = static_cast<float>(simd::sum(x, n) / static_cast<double>(n));
+  const simd::CentralSums sums = simd::centralSums(x, n, mean);
+  const double variance = sums.m2 / static_cast<double>(n);
+  f.rms = static_cast<float>(sqrt(variance + static_cast<double>(mean) * mean));
+  if (variance > 0) {
+    f.skewness = static_cast<float>(sums.m3 / n / (variance * sqrt(variance)));
+    f.kurtosis = static_cast<float>(sums.m4 / n / (variance * variance));
+  }
+
+  // Frequency domain
+  const size_t size = plan.size();
+  const size_t used = std::min(n, size);
+  simd::multiply(x, window.data(), re.data(), used);
+  std::fill(re.begin() + static_cast<std::ptrdiff_t>(used), re.end(), 0.0f);
+  std::fill(im.begin(), im.end(), 0.0f);
+  plan.forward(re.data(), im.data());
+  const size_t bins = size / 2 + 1;
+  simd::power(re.data(), im.data(), spectrum.data(), bins);
+
+  const double total = simd::sum(spectrum.data(), bins);
+  if (total > 0) {
+    f.centroidHz = static_cast<float>(simd::dot(spectrum.data(), binHz.data(), bins) / total);
+    double bandPower[CLICK_BAND_COUNT] = {};
+    double running = 0;
+    bool rolloffFound = false;
+    for (size_t k = 0; k < bins; k++) {
+      bandPower[bandOfBin[k]] += spectrum[k];
+      running += spectrum[k];
+      if (!rolloffFound && running >= CLICK_ROLLOFF_SHARE * total) {
+        f.rolloffHz = binHz[k];
+        rolloffFound = true;
+      }
+    }
+    for (int b = 0; b < CLICK_BAND_COUNT; b++) {
+      f.bands[b] = static_cast<float>(bandPower[b] / total);
+    }
+  }
+  return f;
+}
+
+const char* clickFeaturesCsvHeader() {
+  return "time_s,peak,duration_ms,rms,skewness,kurtosis,centroid_hz,rolloff_hz,"
+         "band0,band1,band2,band3,band4,band5,band6,band7";
+}
+
+void formatClickFeaturesCsv(const ClickFeatures& f, char* line, size_t size) {
+  int used = snprintf(line, size, "%.6f,%.6g,%.3f,%.6g,%.4f,%.4f,%.1f,%.1f", f.timeSeconds, f.peak, f.durationMs, f.rms,
+                      f.skewness, f.kurtosis, f.centroidHz, f.rolloffHz);
+  for (int b = 0; b < CLICK_BAND_COUNT && used > 0 && static_cast<size_t>(used) < size; b++) {
+    used += snprintf(line + used, size - used, ",%.5f", f.bands[b]);
+  }
+}
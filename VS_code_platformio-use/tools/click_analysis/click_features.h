@@ -0,0 +1,57 @@
+#ifndef CLICK_FEATURES_H
+#define CLICK_FEATURES_H
+
+// Per-click features for thrombosis tracking (the "dulling" of the closure
+// click described in wiki/future-work):
+//   peak          max |x| of the filtered click
+//   durationMs    onset to the last block above the closing threshold
+//   rms           over the whole captured click
+//   skewness      third standardised moment
+//   kurtosis      fourth standardised moment (3 for Gaussian noise)
+//   centroidHz    power-weighted mean frequency
+//   rolloffHz     frequency below which 85% of the power lies
+//   bands         share of the power in each CLICK_BAND_EDGES_HZ band
+// The spectrum is a Hann-windowed FFT of the first fftSize samples of the
+// click (zero padded when it is shorter).
+
+#include "click_dsp.h"
+#include "fft.h"
+
+#include <vector>
+
+constexpr int CLICK_BAND_COUNT = 8;
+constexpr float CLICK_BAND_EDGES_HZ[CLICK_BAND_COUNT - 1] = {500, 1000, 2000, 3000, 4000, 6000, 8000};
+constexpr float CLICK_ROLLOFF_SHARE = 0.85f;
+
+struct ClickFeatures {
+  double timeSeconds;  // Onset
+  float peak;
+  float durationMs;
+  float rms;
+  float skewness;
+  float kurtosis;
+  float centroidHz;
+  float rolloffHz;
+  float bands[CLICK_BAND_COUNT];
+};
+
+class ClickFeatureExtractor {
+ public:
+  ClickFeatureExtractor(float sampleRate, size_t fftSize = 1024);
+
+  ClickFeatures extract(const Click& click);
+
+ private:
+  float sampleRate;
+  FftPlan plan;
+  std::vector<float> window;
+  std::vector<float> binHz;
+  std::vector<int> bandOfBin;
+  std::vector<float> re, im, spectrum;
+};
+
+// CSV header and row matching ClickFeatures, shared by the tools that write feature files
+const char* clickFeaturesCsvHeader();
+void formatClickFeaturesCsv(const ClickFeatures& features, char* line, size_t size);
+
+#endif // CLICK_FEATURES_H
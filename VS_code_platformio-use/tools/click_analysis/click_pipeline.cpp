@@ -0,0 +1,55 @@
+#include "click_pipeline.h"
+
+#include <chrono>
+
+using Clock = std::chrono::steady_clock;
+
+static double since(Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+ClickPipeline::ClickPipeline(float sampleRate, const ClickPipelineConfig& config)
+    : rate(sampleRate),
+      filter(config.highPassHz, sampleRate),
+      segmenter(config.segmenter, sampleRate),
+      extractor(sampleRate, config.fftSize) {}
+
+void ClickPipeline::process(float* x, size_t n, const Sink& sink) {
+  const Clock::time_point start = Clock::now();
+  filter.process(x, n);
+  stageTimes.filterSeconds += since(start);
+  stageTimes.samples += n;
+  segment(x, n, sink, false);
+}
+
+void ClickPipeline::finish(const Sink& sink) {
+  segment(nullptr, 0, sink, true);
+}
+
+void ClickPipeline::restart(uint64_t position, float x0, uint32_t settleSamples) {
+  filter.reset(x0);
+  segmenter.seek(position, settleSamples);
+}
+
+void ClickPipeline::segment(const float* x, size_t n, const Sink& sink, bool flush) {
+  // The segmenter calls back per click; feature and sink time come out of its total
+  double featureSeconds = 0;
+  double sinkSeconds = 0;
+  const auto onClick = [&](const Click& click) {
+    const Clock::time_point start = Clock::now();
+    const ClickFeatures features = extractor.extract(click);
+    const Clock::time_point extracted = Clock::now();
+    featureSeconds += std::chrono::duration<double>(extracted - start).count();
+    stageTimes.clicks++;
+    sink(click, features);
+    sinkSeconds += since(extracted);
+  };
+  const Clock::time_point start = Clock::now();
+  if (flush) {
+    segmenter.flush(onClick);
+  } else {
+    segmenter.process(x, n, onClick);
+  }
+  stageTimes.segmentSeconds += since(start) - featureSeconds - sinkSeconds;
+  stageTimes.featureSeconds += featureSeconds;
+}
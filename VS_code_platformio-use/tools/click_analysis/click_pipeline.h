@@ -0,0 +1,62 @@
+#ifndef CLICK_PIPELINE_H
+#define CLICK_PIPELINE_H
+
+// Streaming valve-click pipeline: high-pass -> segmenter -> features.
+//
+// Feed audio in chunks of any size; every click is reported once it closes.
+// Each stage's wall time is accumulated so tools can report per-stage cost.
+
+#include "click_dsp.h"
+#include "click_features.h"
+
+#include <stdint.h>
+
+#include <functional>
+
+struct ClickPipelineConfig {
+  float highPassHz = 150.0f;
+  size_t fftSize = 1024;
+  SegmenterConfig segmenter;
+};
+
+struct StageTimes {
+  double filterSeconds = 0;
+  double segmentSeconds = 0;
+  double featureSeconds = 0;
+  uint64_t samples = 0;
+  uint64_t clicks = 0;
+};
+
+class ClickPipeline {
+ public:
+  using Sink = std::function<void(const Click&, const ClickFeatures&)>;
+
+  ClickPipeline(float sampleRate, const ClickPipelineConfig& config = ClickPipelineConfig());
+
+  // Filters x in place and reports every click that closes in it
+  void process(float* x, size_t n, const Sink& sink);
+
+  // Reports a click still open at the end of the stream
+  void finish(const Sink& sink);
+
+  // Resumes at stream position `position`, whose first sample is x0, after
+  // samples were skipped; detection waits settleSamples for the floor
+  void restart(uint64_t position, float x0, uint32_t settleSamples);
+
+  // True while a click is open
+  bool active() const { return segmenter.active(); }
+
+  const StageTimes& times() const { return stageTimes; }
+  float sampleRate() const { return rate; }
+
+ private:
+  void segment(const float* x, size_t n, const Sink& sink, bool flush);
+
+  float rate;
+  HighPassFilter filter;
+  ClickSegmenter segmenter;
+  ClickFeatureExtractor extractor;
+  StageTimes stageTimes;
+};
+
+#endif // CLICK_PIPELINE_H
@@ -0,0 +1,161 @@
+#include "click_synth.h"
+
+#include <math.h>
+
+#include <algorithm>
+
+constexpr float CLICK_PARTIAL_HZ[3] = {2800.0f, 5200.0f, 9500.0f};
+constexpr float CLICK_PARTIAL_LEVEL[3] = {1.0f, 0.6f, 0.35f};
+constexpr float CLICK_PARTIAL_DECAY_MS[3] = {1.2f, 0.8f, 0.5f};
+constexpr float KNOCK_PARTIAL_HZ[3] = {900.0f, 1700.0f, 3100.0f};
+constexpr float KNOCK_PARTIAL_DECAY_MS[3] = {2.5f, 1.5f, 1.0f};
+constexpr float EVENT_DECAYS = 12.0f;  // Event length in time constants of its slowest partial
+
+ClickSynth::ClickSynth(const SynthConfig& config)
+    : config(config),
+      total(static_cast<uint64_t>(config.seconds * config.sampleRate)),
+      rng(config.seed * 0x9E3779B97F4A7C15ull + 1),
+      rumble(config.beatsPerMinute / 60.0 / config.sampleRate),
+      hum(50.0 / config.sampleRate) {}
+
+ClickSynth::Oscillator::Oscillator(double cyclesPerSample)
+    : stepCos(cos(2.0 * M_PI * cyclesPerSample)), stepSin(sin(2.0 * M_PI * cyclesPerSample)) {}
+
+double ClickSynth::Oscillator::next() {
+  const double value = s;
+  const double nc = c * stepCos - s * stepSin;
+  s = s * stepCos + c * stepSin;
+  c = nc;
+  if (++count == 0) {
+    const double norm = 1.0 / sqrt(c * c + s * s);  // Rotation drift, every 65536 samples
+    c *= norm;
+    s *= norm;
+  }
+  return value;
+}
+
+uint64_t ClickSynth::beatStart(uint64_t beat) const {
+  return static_cast<uint64_t>((config.leadInSeconds + static_cast<double>(beat) * 60.0 / config.beatsPerMinute) *
+                               config.sampleRate);
+}
+
+std::vector<RigReversal> ClickSynth::rigReversals() const {
+  std::vector<RigReversal> reversals;
+  const double scale = 1e6 * (1.0 + config.rigDriftPpm * 1e-6);
+  const auto rigMicros = [&](double seconds) {
+    return static_cast<uint64_t>((seconds + config.rigOffsetSeconds) * scale);
+  };
+  for (uint64_t beat = 0;; beat++) {
+    const uint64_t start = beatStart(beat);
+    if (start >= total) {
+      break;
+    }
+    const double seconds = static_cast<double>(start) / config.sampleRate;
+    reversals.push_back({rigMicros(seconds), true});
+    reversals.push_back({rigMicros(seconds + config.closureDelaySeconds), false});
+  }
+  return reversals;
+}
+
+float ClickSynth::random() {
+  rng ^= rng << 13;
+  rng ^= rng >> 7;
+  rng ^= rng << 17;
+  return static_cast<float>(static_cast<int64_t>(rng >> 11) - (1ll << 52)) / static_cast<float>(1ll << 52);
+}
+
+float ClickSynth::gaussian() {
+  // Sum of four uniforms: cheap and close enough to normal for background noise
+  return (random() + random() + random() + random()) * 0.866f;
+}
+
+void ClickSynth::scheduleBeat(uint64_t beat) {
+  const float rate = config.sampleRate;
+  const uint64_t start = beatStart(beat);
+  const double seconds = static_cast<double>(start) / rate;
+  float dull = 0;
+  if (config.dullFromSeconds >= 0 && seconds > config.dullFromSeconds && config.seconds > config.dullFromSeconds) {
+    dull = static_cast<float>((seconds - config.dullFromSeconds) / (config.seconds - config.dullFromSeconds));
+  }
+
+  for (int kind = 0; kind < 2; kind++) {
+    const bool closure = kind == 1;
+    Event event{};
+    const float jitter = closure ? config.closureDelaySeconds + 0.001f * random() : 0.0005f * (random() + 1.0f);
+    event.start = start + static_cast<uint64_t>(jitter * rate);
+    float level = (closure ? config.closureLevel : config.openingLevel) * (1.0f + 0.1f * random());
+    float slowest = 0;
+    for (int p = 0; p < 3; p++) {
+      float amplitude = CLICK_PARTIAL_LEVEL[p];
+      float decayMs = CLICK_PARTIAL_DECAY_MS[p];
+      if (closure) {
+        amplitude *= p == 0 ? 1.0f - 0.3f * dull : 1.0f - 0.85f * dull;
+        decayMs *= 1.0f + dull;
+      }
+      const float decaySamples = decayMs * 1e-3f * rate;
+      const double decay = exp(-1.0 / decaySamples);
+      const double omega = 2.0 * M_PI * CLICK_PARTIAL_HZ[p] * (closure ? 1.0f : 0.8f) / rate;
+      event.partials[p] = {level * amplitude * (1.0f - 0.4f * dull), 0.0, decay * cos(omega), decay * sin(omega)};
+      slowest = std::max(slowest, decaySamples);
+    }
+    event.end = event.start + static_cast<uint64_t>(EVENT_DECAYS * slowest);
+    events.push_back(event);
+    valveOnsets.push_back(event.start);
+  }
+
+  // Knocks anywhere in the beat, knocksPerSecond on average
+  const double period = 60.0 / config.beatsPerMinute * rate;
+  const float expected = config.knocksPerSecond * 60.0f / config.beatsPerMinute;
+  for (float left = expected; left > 0; left -= 1.0f) {
+    if (left >= 1.0f || (random() + 1.0f) * 0.5f < left) {
+      scheduleKnock(start + static_cast<uint64_t>((random() + 1.0f) * 0.5f * period));
+    }
+  }
+}
+
+void ClickSynth::scheduleKnock(uint64_t start) {
+  const float rate = config.sampleRate;
+  Event event{};
+  event.start = start;
+  const float level = config.knockLevel * (0.75f + 0.25f * random());
+  float slowest = 0;
+  for (int p = 0; p < 3; p++) {
+    const float decaySamples = KNOCK_PARTIAL_DECAY_MS[p] * 1e-3f * rate;
+    const double decay = exp(-1.0 / decaySamples);
+    const double omega = 2.0 * M_PI * KNOCK_PARTIAL_HZ[p] / rate;
+    event.partials[p] = {level * CLICK_PARTIAL_LEVEL[p], 0.0, decay * cos(omega), decay * sin(omega)};
+    slowest = std::max(slowest, decaySamples);
+  }
+  event.end = event.start + static_cast<uint64_t>(EVENT_DECAYS * slowest);
+  events.push_back(event);
+}
+
+size_t ClickSynth::generate(float* out, size_t n) {
+  if (produced + n > total) {
+    n = static_cast<size_t>(total - produced);
+  }
+  for (size_t i = 0; i < n; i++) {
+    const uint64_t t = produced + i;
+    if (t >= beatStart(nextBeat)) {
+      scheduleBeat(nextBeat++);
+    }
+    float sample = 0.2f * static_cast<float>(rumble.next()) + 0.03f * static_cast<float>(hum.next()) +
+                   config.noiseLevel * gaussian();
+    for (Event& event : events) {
+      if (t < event.start || t >= event.end) {
+        continue;
+      }
+      for (Partial& partial : event.partials) {
+        sample += static_cast<float>(partial.im);
+        const double re = partial.re * partial.stepRe - partial.im * partial.stepIm;
+        partial.im = partial.re * partial.stepIm + partial.im * partial.stepRe;
+        partial.re = re;
+      }
+    }
+    out[i] = sample;
+  }
+  produced += n;
+  events.erase(std::remove_if(events.begin(), events.end(), [&](const Event& e) { return e.end <= produced; }),
+               events.end());
+  return n;
+}
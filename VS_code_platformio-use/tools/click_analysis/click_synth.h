@@ -0,0 +1,102 @@
+#ifndef CLICK_SYNTH_H
+#define CLICK_SYNTH_H
+
+// Synthetic microphone signal of the blood loop, for benchmarks and for
+// exercising the click tools without a recording.
+//
+// Every beat has a soft opening click at the beat start and a closure click
+// closureDelaySeconds later, each a sum of three damped sinusoids with a
+// little amplitude and timing jitter. Underneath are flow rumble at the beat
+// rate, mains hum and white noise. From dullFromSeconds on, the closure click
+// dulls steadily until the end of the session: its high partials fade and
+// ring longer and its level drops, the signature of a thrombus forming on the
+// valve. Optional knocks (pump and stepper noise) land at random times with
+// the same envelope as a click but a lower, duller spectrum.
+//
+// The pump runs on its own clock: rigReversals() gives the motor reversals a
+// TELEMETRY build would log for the session, in rig micros() that start at
+// rigOffsetSeconds before the recording and run rigDriftPpm fast. Each
+// opening click follows a clockwise reversal, each closure a counter-clockwise
+// one. Output is deterministic for a given seed.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "phase_gate.h"
+
+struct SynthConfig {
+  float sampleRate = 48000.0f;
+  double seconds = 2700.0;
+  float beatsPerMinute = 60.0f;
+  float closureDelaySeconds = 0.35f;
+  float closureLevel = 0.5f;
+  float openingLevel = 0.15f;
+  double dullFromSeconds = -1.0;  // Negative: the valve stays clean
+  float noiseLevel = 0.003f;
+  double leadInSeconds = 1.0;    // Recording before the first beat
+  float knocksPerSecond = 0.0f;
+  float knockLevel = 0.3f;
+  double rigOffsetSeconds = 7.5;
+  double rigDriftPpm = 150.0;
+  uint64_t seed = 1;
+};
+
+class ClickSynth {
+ public:
+  explicit ClickSynth(const SynthConfig& config);
+
+  // Writes up to n samples; returns how many (0 once the session is over)
+  size_t generate(float* out, size_t n);
+
+  uint64_t totalSamples() const { return total; }
+
+  // Sample index at which beat `beat` starts
+  uint64_t beatStart(uint64_t beat) const;
+
+  // Motor reversals of the whole session on the rig's clock
+  std::vector<RigReversal> rigReversals() const;
+
+  // Onset sample of every valve click scheduled so far, in order; a beat's
+  // clicks are scheduled when generate() reaches its start
+  const std::vector<uint64_t>& valveClicks() const { return valveOnsets; }
+
+ private:
+  // Damped sinusoid as a phasor: each sample multiplies it by step
+  // (decay * e^(i w)) and the output is its imaginary part
+  struct Partial {
+    double re, im;
+    double stepRe, stepIm;
+  };
+  struct Event {
+    uint64_t start;
+    uint64_t end;
+    Partial partials[3];
+  };
+
+  // Sine by rotation, one complex multiply per sample
+  struct Oscillator {
+    explicit Oscillator(double cyclesPerSample);
+    double next();
+    double stepCos, stepSin;
+    double c = 1, s = 0;
+    uint16_t count = 0;
+  };
+
+  void scheduleBeat(uint64_t beat);
+  void scheduleKnock(uint64_t start);
+  float random();  // Uniform in [-1, 1)
+  float gaussian();
+
+  SynthConfig config;
+  uint64_t total;
+  uint64_t produced = 0;
+  uint64_t nextBeat = 0;
+  uint64_t rng;
+  Oscillator rumble, hum;
+  std::vector<Event> events;
+  std::vector<uint64_t> valveOnsets;
+};
+
+#endif // CLICK_SYNTH_H
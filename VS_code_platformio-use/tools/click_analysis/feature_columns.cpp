@@ -0,0 +1,221 @@
+#include "feature_columns.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/types.h>
+
+static const uint64_t FNV_OFFSET = 14695981039346656037ull;
+static const uint64_t FNV_PRIME = 1099511628211ull;
+
+size_t featureColumnBytes(FeatureColumnType type) {
+  switch (type) {
+    case COLUMN_U8:
+      return 1;
+    case COLUMN_I32:
+    case COLUMN_U32:
+    case COLUMN_F32:
+      return 4;
+    case COLUMN_U64:
+    case COLUMN_F64:
+      return 8;
+  }
+  return 0;
+}
+
+static uint64_t align8(uint64_t bytes) {
+  return (bytes + 7) / 8 * 8;
+}
+
+FeatureColumn featureColumn(const char* name, FeatureColumnType type) {
+  FeatureColumn column{};
+  strncpy(column.name, name, sizeof(column.name) - 1);
+  column.type = type;
+  return column;
+}
+
+FeatureColumnWriter::~FeatureColumnWriter() {
+  close();
+}
+
+bool FeatureColumnWriter::open(const char* path, const std::vector<FeatureColumn>& columns) {
+  close();
+  discard = path == nullptr;
+  if (!discard) {
+    file = fopen(path, "wb");
+    if (file == nullptr) {
+      return false;
+    }
+  }
+  layout = columns;
+  groups.clear();
+  footer = FeatureFileFooter{};
+  offset = 0;
+  hash = FNV_OFFSET;
+  FeatureFileHeader header{};
+  memcpy(header.magic, FEATURE_FILE_MAGIC, sizeof(header.magic));
+  header.version = FEATURE_FILE_VERSION;
+  header.columnCount = static_cast<uint32_t>(layout.size());
+  return put(&header, sizeof(header)) && put(layout.data(), layout.size() * sizeof(FeatureColumn));
+}
+
+bool FeatureColumnWriter::put(const void* data, size_t bytes) {
+  const uint8_t* p = static_cast<const uint8_t*>(data);
+  for (size_t i = 0; i < bytes; i++) {
+    hash = (hash ^ p[i]) * FNV_PRIME;
+  }
+  offset += bytes;
+  return discard || bytes == 0 || fwrite(data, 1, bytes, file) == bytes;
+}
+
+bool FeatureColumnWriter::writeGroup(const void* const* columns, size_t rows) {
+  static const uint8_t zeros[8] = {};
+  if (file == nullptr && !discard) {
+    return false;
+  }
+  bool ok = put(zeros, static_cast<size_t>(align8(offset) - offset));
+  groups.push_back({offset, rows});
+  for (size_t c = 0; c < layout.size() && ok; c++) {
+    const size_t bytes = rows * featureColumnBytes(static_cast<FeatureColumnType>(layout[c].type));
+    ok = put(columns[c], bytes) && put(zeros, static_cast<size_t>(align8(bytes) - bytes));
+  }
+  footer.rows += rows;
+  return ok;
+}
+
+bool FeatureColumnWriter::close() {
+  if (file == nullptr && !discard) {
+    return true;
+  }
+  footer.groupTableOffset = offset;
+  footer.groupCount = groups.size();
+  memcpy(footer.magic, FEATURE_FILE_MAGIC, sizeof(footer.magic));
+  bool ok = put(groups.data(), groups.size() * sizeof(FeatureGroup)) && put(&footer, sizeof(footer));
+  if (file != nullptr) {
+    ok = fclose(file) == 0 && ok;
+  }
+  file = nullptr;
+  discard = false;
+  return ok;
+}
+
+FeatureColumnReader::~FeatureColumnReader() {
+  close();
+}
+
+void FeatureColumnReader::close() {
+  if (file != nullptr) {
+    fclose(file);
+  }
+  file = nullptr;
+  layout.clear();
+  groups.clear();
+  totalRows = 0;
+}
+
+bool FeatureColumnReader::fail(const char* what) {
+  close();
+  message = what;
+  return false;
+}
+
+bool FeatureColumnReader::open(const char* path) {
+  close();
+  file = fopen(path, "rb");
+  if (file == nullptr) {
+    return fail(strerror(errno));
+  }
+  FeatureFileHeader header;
+  FeatureFileFooter footer;
+  if (fread(&header, sizeof(header), 1, file) != 1 ||
+      memcmp(header.magic, FEATURE_FILE_MAGIC, sizeof(header.magic)) != 0) {
+    return fail("not a feature file (bad magic)");
+  }
+  if (header.version != FEATURE_FILE_VERSION) {
+    return fail("unsupported feature file version");
+  }
+  layout.resize(header.columnCount);
+  if (fread(layout.data(), sizeof(FeatureColumn), layout.size(), file) != layout.size() ||
+      fseeko(file, -static_cast<off_t>(sizeof(footer)), SEEK_END) != 0 || fread(&footer, sizeof(footer), 1, file) != 1 ||
+      memcmp(footer.magic, FEATURE_FILE_MAGIC, sizeof(footer.magic)) != 0) {
+    return fail("feature file truncated (no footer)");
+  }
+  for (FeatureColumn& column : layout) {
+    column.name[sizeof(column.name) - 1] = '\0';
+    if (featureColumnBytes(static_cast<FeatureColumnType>(column.type)) == 0) {
+      return fail("feature file has a column of unknown type");
+    }
+  }
+  groups.resize(footer.groupCount);
+  if (fseeko(file, static_cast<off_t>(footer.groupTableOffset), SEEK_SET) != 0 ||
+      fread(groups.data(), sizeof(FeatureGroup), groups.size(), file) != groups.size()) {
+    return fail("feature file truncated (group table)");
+  }
+  totalRows = footer.rows;
+  message.clear();
+  return true;
+}
+
+size_t FeatureColumnReader::find(const char* name) const {
+  for (size_t c = 0; c < layout.size(); c++) {
+    if (strcmp(layout[c].name, name) == 0) {
+      return c;
+    }
+  }
+  return layout.size();
+}
+
+template <typename T>
+static void widen(const std::vector<uint8_t>& raw, size_t rows, double* out) {
+  for (size_t i = 0; i < rows; i++) {
+    T value;
+    memcpy(&value, raw.data() + i * sizeof(T), sizeof(T));
+    out[i] = static_cast<double>(value);
+  }
+}
+
+bool FeatureColumnReader::read(size_t column, std::vector<double>& values) {
+  if (file == nullptr || column >= layout.size()) {
+    return false;
+  }
+  const FeatureColumnType type = static_cast<FeatureColumnType>(layout[column].type);
+  values.resize(static_cast<size_t>(totalRows));
+  std::vector<uint8_t> raw;
+  size_t filled = 0;
+  for (const FeatureGroup& group : groups) {
+    uint64_t at = group.offset;
+    for (size_t c = 0; c < column; c++) {
+      at += align8(group.rows * featureColumnBytes(static_cast<FeatureColumnType>(layout[c].type)));
+    }
+    const size_t rows = static_cast<size_t>(group.rows);
+    if (filled + rows > values.size()) {
+      return false;
+    }
+    raw.resize(rows * featureColumnBytes(type));
+    if (fseeko(file, static_cast<off_t>(at), SEEK_SET) != 0 || fread(raw.data(), 1, raw.size(), file) != raw.size()) {
+      return false;
+    }
+    double* out = values.data() + filled;
+    switch (type) {
+      case COLUMN_U8:
+        widen<uint8_t>(raw, rows, out);
+        break;
+      case COLUMN_I32:
+        widen<int32_t>(raw, rows, out);
+        break;
+      case COLUMN_U32:
+        widen<uint32_t>(raw, rows, out);
+        break;
+      case COLUMN_U64:
+        widen<uint64_t>(raw, rows, out);
+        break;
+      case COLUMN_F32:
+        widen<float>(raw, rows, out);
+        break;
+      case COLUMN_F64:
+        widen<double>(raw, rows, out);
+        break;
+    }
+    filled += rows;
+  }
+  return filled == values.size();
+}
@@ -0,0 +1,127 @@
+#ifndef FEATURE_COLUMNS_H
+#define FEATURE_COLUMNS_H
+
+// Columnar feature file: one array per feature instead of one row per click,
+// so reading a single feature across a whole catalogue reads only that
+// feature's bytes.
+//
+//   FeatureFileHeader              magic, version, column count
+//   FeatureColumn[columnCount]     name and type of each column
+//   row groups, each holding every column's values for its rows, column
+//   after column, every array starting on an 8-byte boundary
+//   FeatureGroup[groupCount]       file offset and rows of each group
+//   FeatureFileFooter              where the group table is, total rows, magic
+//
+// Groups are appended as they are produced and the group table goes at the
+// end, so the writer streams and never seeks; a reader starts at the footer.
+// Values are little endian, as in the session archive.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+constexpr char FEATURE_FILE_MAGIC[8] = {'P', 'U', 'M', 'P', 'C', 'O', 'L', 'S'};
+constexpr uint32_t FEATURE_FILE_VERSION = 1;
+
+enum FeatureColumnType : uint32_t {
+  COLUMN_U8 = 0,
+  COLUMN_I32 = 1,
+  COLUMN_U32 = 2,
+  COLUMN_U64 = 3,
+  COLUMN_F32 = 4,
+  COLUMN_F64 = 5,
+};
+
+size_t featureColumnBytes(FeatureColumnType type);
+
+struct FeatureFileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t columnCount;
+};
+
+struct FeatureColumn {
+  char name[24];  // NUL-padded
+  uint32_t type;  // FeatureColumnType
+  uint32_t reserved;
+};
+
+struct FeatureGroup {
+  uint64_t offset;  // File offset of the group's first column
+  uint64_t rows;
+};
+
+struct FeatureFileFooter {
+  uint64_t groupTableOffset;
+  uint64_t groupCount;
+  uint64_t rows;
+  char magic[8];
+};
+
+static_assert(sizeof(FeatureFileHeader) == 16, "FeatureFileHeader layout");
+static_assert(sizeof(FeatureColumn) == 32, "FeatureColumn layout");
+static_assert(sizeof(FeatureFileFooter) == 32, "FeatureFileFooter layout");
+
+FeatureColumn featureColumn(const char* name, FeatureColumnType type);
+
+class FeatureColumnWriter {
+ public:
+  FeatureColumnWriter() = default;
+  ~FeatureColumnWriter();
+  FeatureColumnWriter(const FeatureColumnWriter&) = delete;
+  FeatureColumnWriter& operator=(const FeatureColumnWriter&) = delete;
+
+  // A null path writes nothing but still keeps the checksum
+  bool open(const char* path, const std::vector<FeatureColumn>& columns);
+  // columns[c] points at `rows` values of column c's type
+  bool writeGroup(const void* const* columns, size_t rows);
+  bool close();
+
+  uint64_t rows() const { return footer.rows; }
+  // FNV-1a of every byte of the file, to compare runs without keeping them
+  uint64_t checksum() const { return hash; }
+
+ private:
+  bool put(const void* data, size_t bytes);
+
+  FILE* file = nullptr;
+  bool discard = false;
+  std::vector<FeatureColumn> layout;
+  std::vector<FeatureGroup> groups;
+  FeatureFileFooter footer{};
+  uint64_t offset = 0;
+  uint64_t hash = 0;
+};
+
+class FeatureColumnReader {
+ public:
+  FeatureColumnReader() = default;
+  ~FeatureColumnReader();
+  FeatureColumnReader(const FeatureColumnReader&) = delete;
+  FeatureColumnReader& operator=(const FeatureColumnReader&) = delete;
+
+  bool open(const char* path);
+  void close();
+  const std::string& error() const { return message; }
+
+  const std::vector<FeatureColumn>& columns() const { return layout; }
+  uint64_t rows() const { return totalRows; }
+  // Index of the column called `name`, or columns().size()
+  size_t find(const char* name) const;
+  // Every row of column `column`, converted to double
+  bool read(size_t column, std::vector<double>& values);
+
+ private:
+  bool fail(const char* what);
+
+  FILE* file = nullptr;
+  std::vector<FeatureColumn> layout;
+  std::vector<FeatureGroup> groups;
+  uint64_t totalRows = 0;
+  std::string message;
+};
+
+#endif // FEATURE_COLUMNS_H
@@ -0,0 +1,109 @@
+#include "fft.h"
+#include "simd_kernels.h"
+
+#include <math.h>
+
+#include <utility>
+
+FftPlan::FftPlan(size_t size) : n(size), bitReverse(size), twiddleRe(size - 1), twiddleIm(size - 1) {
+  int bits = 0;
+  while ((static_cast<size_t>(1) << bits) < n) {
+    bits++;
+  }
+  for (size_t i = 0; i < n; i++) {
+    uint32_t r = 0;
+    for (int b = 0; b < bits; b++) {
+      r |= ((i >> b) & 1u) << (bits - 1 - b);
+    }
+    bitReverse[i] = r;
+  }
+  for (size_t half = 1; half < n; half *= 2) {
+    for (size_t j = 0; j < half; j++) {
+      const double angle = -M_PI * static_cast<double>(j) / static_cast<double>(half);
+      twiddleRe[half - 1 + j] = static_cast<float>(cos(angle));
+      twiddleIm[half - 1 + j] = static_cast<float>(sin(angle));
+    }
+  }
+}
+
+void FftPlan::forward(float* re, float* im) const {
+  for (size_t i = 0; i < n; i++) {
+    const size_t j = bitReverse[i];
+    if (j > i) {
+      std::swap(re[i], re[j]);
+      std::swap(im[i], im[j]);
+    }
+  }
+  for (size_t half = 1; half < n; half *= 2) {
+    const float* wr = &twiddleRe[half - 1];
+    const float* wi = &twiddleIm[half - 1];
+    for (size_t block = 0; block < n; block += 2 * half) {
+      float* ar = re + block;
+      float* ai = im + block;
+      float* br = ar + half;
+      float* bi = ai + half;
+      size_t j = 0;
+      if (half >= simd::LANES) {
+        for (; j < half; j += simd::LANES) {
+          const f32v xr = simd::load(br + j), xi = simd::load(bi + j);
+          const f32v cr = simd::load(wr + j), ci = simd::load(wi + j);
+          const f32v tr = xr * cr - xi * ci;
+          const f32v ti = xr * ci + xi * cr;
+          const f32v ur = simd::load(ar + j), ui = simd::load(ai + j);
+          simd::store(ar + j, ur + tr);
+          simd::store(ai + j, ui + ti);
+          simd::store(br + j, ur - tr);
+          simd::store(bi + j, ui - ti);
+        }
+      }
+      for (; j < half; j++) {
+        const float tr = br[j] * wr[j] - bi[j] * wi[j];
+        const float ti = br[j] * wi[j] + bi[j] * wr[j];
+        br[j] = ar[j] - tr;
+        bi[j] = ai[j] - ti;
+        ar[j] += tr;
+        ai[j] += ti;
+      }
+    }
+  }
+}
+
+RealFftPlan::RealFftPlan(size_t size) : half(size / 2), twiddleRe(size / 2), twiddleIm(size / 2) {
+  for (size_t k = 0; k < size / 2; k++) {
+    const double angle = -2.0 * M_PI * static_cast<double>(k) / static_cast<double>(size);
+    twiddleRe[k] = static_cast<float>(cos(angle));
+    twiddleIm[k] = static_cast<float>(sin(angle));
+  }
+}
+
+void RealFftPlan::power(float* re, float* im, float* out) const {
+  const size_t m = half.size();
+  half.forward(re, im);
+  out[0] = (re[0] + im[0]) * (re[0] + im[0]);
+  out[m] = (re[0] - im[0]) * (re[0] - im[0]);
+
+  // With a = Z[k] and b = Z[m - k], the even samples' spectrum is
+  // (a + conj b) / 2 and the odd samples' (a - conj b) / 2i; bin k is
+  // even + w^k odd. The vector loop reads b backwards, a vector at a time.
+  const f32v h = simd::splat(0.5f);
+  size_t k = 1;
+  for (; k + simd::LANES <= m; k += simd::LANES) {
+    const size_t mirror = m - k - (simd::LANES - 1);
+    const f32v ar = simd::load(re + k), ai = simd::load(im + k);
+    const f32v br = simd::reverse(simd::load(re + mirror)), bi = simd::reverse(simd::load(im + mirror));
+    const f32v er = (ar + br) * h, ei = (ai - bi) * h;
+    const f32v or_ = (ai + bi) * h, oi = (br - ar) * h;
+    const f32v c = simd::load(&twiddleRe[k]), s = simd::load(&twiddleIm[k]);
+    const f32v xr = er + c * or_ - s * oi;
+    const f32v xi = ei + c * oi + s * or_;
+    simd::store(out + k, xr * xr + xi * xi);
+  }
+  for (; k < m; k++) {
+    const float ar = re[k], ai = im[k], br = re[m - k], bi = im[m - k];
+    const float er = (ar + br) * 0.5f, ei = (ai - bi) * 0.5f;
+    const float or_ = (ai + bi) * 0.5f, oi = (br - ar) * 0.5f;
+    const float xr = er + twiddleRe[k] * or_ - twiddleIm[k] * oi;
+    const float xi = ei + twiddleRe[k] * oi + twiddleIm[k] * or_;
+    out[k] = xr * xr + xi * xi;
+  }
+}
@@ -0,0 +1,53 @@
+#ifndef FFT_H
+#define FFT_H
+
+// Radix-2 complex FFT with precomputed plan.
+//
+// The plan keeps the bit-reversal permutation and, for every stage, its
+// twiddle factors in one contiguous run, so each butterfly loop walks memory
+// linearly and runs a vector of lanes at a time. Build a plan once per size and
+// reuse it; transforms on one plan may run concurrently.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+class FftPlan {
+ public:
+  explicit FftPlan(size_t size);  // size is a power of two, at least 2
+
+  size_t size() const { return n; }
+
+  // In-place forward transform of split real/imaginary arrays of size()
+  void forward(float* re, float* im) const;
+
+ private:
+  size_t n;
+  std::vector<uint32_t> bitReverse;
+  std::vector<float> twiddleRe;  // Stage with half-size h starts at h - 1
+  std::vector<float> twiddleIm;
+};
+
+// Power spectrum of a real frame through a complex FFT of half its size: the
+// frame goes in as z[k] = x[2k] + i x[2k + 1], and one pass over the result
+// separates the spectra of the even and odd samples and combines them into
+// bins 0 .. size() / 2, half the work of a complex transform of the frame.
+class RealFftPlan {
+ public:
+  explicit RealFftPlan(size_t size);  // size is a power of two, at least 4
+
+  size_t size() const { return 2 * half.size(); }
+  size_t bins() const { return half.size() + 1; }
+
+  // even and odd hold x[2k] and x[2k + 1], size() / 2 each, and are
+  // overwritten; power gets bins() values |X[k]|^2
+  void power(float* even, float* odd, float* power) const;
+
+ private:
+  FftPlan half;
+  std::vector<float> twiddleRe;  // e^(-2 pi i k / size()) for k < size() / 2
+  std::vector<float> twiddleIm;
+};
+
+#endif // FFT_H
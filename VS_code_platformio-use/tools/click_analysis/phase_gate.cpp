@@ -0,0 +1,299 @@
+#include "phase_gate.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+#include <utility>
+
+std::vector<RigReversal> readRigReversals(FILE* session) {
+  std::vector<RigReversal> reversals;
+  char line[256];
+  while (fgets(line, sizeof(line), session) != nullptr) {
+    unsigned long long micros;
+    char direction[4];
+    if (sscanf(line, "reversal %llu %3s", &micros, direction) == 2) {
+      reversals.push_back({micros, strcmp(direction, "cw") == 0});
+    }
+  }
+  return reversals;
+}
+
+void writeRigReversals(FILE* session, const std::vector<RigReversal>& reversals) {
+  for (const RigReversal& reversal : reversals) {
+    fprintf(session, "reversal %llu %s position 0\n", static_cast<unsigned long long>(reversal.micros),
+            reversal.clockwise ? "cw" : "ccw");
+  }
+}
+
+void RigClockFit::reset() {
+  n = st = stt = sk = stk = sr = str = skr = 0;
+  count = 0;
+  offset = 0;
+  rate = 1;
+  lag = 0;
+}
+
+void RigClockFit::add(double rigSeconds, bool clockwise, double audioSeconds) {
+  const double t = rigSeconds;
+  const double k = clockwise ? 0.0 : 1.0;
+  const double r = audioSeconds - rigSeconds;  // Small numbers keep the sums well conditioned
+  n = n * forgetting + 1;
+  st = st * forgetting + t;
+  stt = stt * forgetting + t * t;
+  sk = sk * forgetting + k;
+  stk = stk * forgetting + t * k;
+  sr = sr * forgetting + r;
+  str = str * forgetting + t * r;
+  skr = skr * forgetting + k * r;
+  count++;
+}
+
+static double det3(double a, double b, double c, double d, double e, double f, double g, double h, double i) {
+  return a * (e * i - f * h) - b * (d * i - f * g) + c * (d * h - e * g);
+}
+
+bool RigClockFit::solve() {
+  // Normal equations of r = offset' + (rate - 1) t + lag k; k * k == k
+  if (sk < 1.5 || n - sk < 1.5) {
+    return false;
+  }
+  const double det = det3(n, st, sk, st, stt, stk, sk, stk, sk);
+  if (!(fabs(det) > 1e-12 * n * stt * sk)) {
+    return false;  // All matches at nearly one rig time: no rate yet
+  }
+  const double a = det3(sr, st, sk, str, stt, stk, skr, stk, sk) / det;
+  const double c = det3(n, sr, sk, st, str, stk, sk, skr, sk) / det;
+  const double d = det3(n, st, sr, st, stt, str, sk, stk, skr) / det;
+  offset = a;
+  rate = 1.0 + c;
+  lag = d;
+  return true;
+}
+
+double RigClockFit::predict(double rigSeconds, bool clockwise) const {
+  return offset + rate * rigSeconds + (clockwise ? 0.0 : lag);
+}
+
+GatedClickPipeline::GatedClickPipeline(float sampleRate, std::vector<RigReversal> reversals, const GateConfig& gate,
+                                       const ClickPipelineConfig& config)
+    : rate(sampleRate),
+      reversals(std::move(reversals)),
+      gate(gate),
+      leadSamples(static_cast<uint32_t>(gate.leadMs * 1e-3f * sampleRate)),
+      searchSamples(static_cast<uint32_t>(gate.searchMs * 1e-3f * sampleRate)),
+      pipeline(sampleRate, config),
+      clockFit(gate.forgetting) {
+  uint32_t beat = 0;
+  bool started = false;
+  for (const RigReversal& r : this->reversals) {
+    if (r.clockwise) {
+      beat += started ? 1 : 0;
+      started = true;
+    }
+    reversalBeats.push_back(beat);
+  }
+}
+
+uint64_t GatedClickPipeline::predictedSample(size_t reversal) const {
+  const double onset = clockFit.predict(rigSeconds(reversal), reversals[reversal].clockwise) * rate;
+  return onset > 0 ? static_cast<uint64_t>(onset) : 0;
+}
+
+double GatedClickPipeline::rigSeconds(size_t reversal) const {
+  return static_cast<double>(reversals[reversal].micros - reversals[0].micros) * 1e-6;
+}
+
+void GatedClickPipeline::process(float* x, size_t n, const Sink& sink) {
+  gateStats.audioSamples += n;
+  size_t i = 0;
+  while (i < n) {
+    if (mode == ACQUIRE) {
+      acquire(x + i, n - i, position + i, sink);
+      break;
+    }
+    track(x, n, sink, i);
+  }
+  position += n;
+  // Switch over between chunks, and never in the middle of a click
+  if (mode == ACQUIRE && !pipeline.active() && tryAcquire()) {
+    mode = TRACK;
+    inWindow = false;
+    misses = 0;
+    next = 0;
+    gateStats.acquisitions++;
+  }
+}
+
+void GatedClickPipeline::acquire(float* x, size_t n, uint64_t at, const Sink& sink) {
+  if (processed != at) {
+    pipeline.restart(at, x[0], leadSamples);
+  }
+  pipeline.process(x, n, [&](const Click& click, const ClickFeatures& features) {
+    acquired.push_back(static_cast<double>(click.onset) / rate);
+    sink(click, features);
+  });
+  gateStats.ungatedSamples += n;
+  processed = at + n;
+}
+
+void GatedClickPipeline::track(float* x, size_t n, const Sink& sink, size_t& i) {
+  const auto collect = [&](const Click& click, const ClickFeatures& features) { found.push_back({click, features}); };
+  while (i < n && mode == TRACK) {
+    const uint64_t at = position + i;
+    if (!inWindow) {
+      if (!planWindow(at)) {
+        i = n;  // Past the last reversal: nothing more to listen for
+        return;
+      }
+      if (windowStart >= position + n) {
+        i = n;  // Opens in a later chunk
+        return;
+      }
+      const uint64_t start = std::max(windowStart, at);
+      i = static_cast<size_t>(start - position);
+      if (processed != start) {
+        pipeline.restart(start, x[i], leadSamples);
+      }
+      inWindow = true;
+      continue;
+    }
+    uint64_t end = searchEnd;
+    if (at >= searchEnd) {
+      if (!pipeline.active()) {
+        closeWindow(sink);
+        continue;
+      }
+      end = at + SEGMENT_BLOCK;  // Let an open click run to its end
+    }
+    const size_t stop = static_cast<size_t>(std::min<uint64_t>(position + n, end) - position);
+    pipeline.process(x + i, stop - i, collect);
+    processed = position + stop;
+    i = stop;
+  }
+}
+
+bool GatedClickPipeline::planWindow(uint64_t at) {
+  for (; next < reversals.size(); next++) {
+    predicted = clockFit.predict(rigSeconds(next), reversals[next].clockwise);
+    const double onset = predicted * rate;
+    if (onset + searchSamples <= static_cast<double>(at)) {
+      continue;  // Already behind the stream
+    }
+    const double start = onset - searchSamples - leadSamples;
+    windowStart = start > 0 ? static_cast<uint64_t>(start) : 0;
+    searchEnd = static_cast<uint64_t>(onset + searchSamples);
+    return true;
+  }
+  return false;
+}
+
+void GatedClickPipeline::closeWindow(const Sink& sink) {
+  inWindow = false;
+  gateStats.windows++;
+  const Found* best = nullptr;
+  double bestError = gate.searchMs * 1e-3;
+  for (const Found& f : found) {
+    const double error = fabs(static_cast<double>(f.click.onset) / rate - predicted);
+    if (error <= bestError) {
+      bestError = error;
+      best = &f;
+    }
+  }
+  gateStats.dropped += found.size() - (best != nullptr ? 1 : 0);
+  if (best != nullptr) {
+    reporting = static_cast<long>(next);
+    sink(best->click, best->features);
+    reporting = -1;
+    clockFit.add(rigSeconds(next), reversals[next].clockwise, static_cast<double>(best->click.onset) / rate);
+    clockFit.solve();
+    gateStats.matched++;
+    misses = 0;
+  } else if (++misses >= gate.maxMisses) {
+    // Lost the rig: listen to everything again, starting from here
+    haveOffset = true;
+    lastOffset = predicted - rigSeconds(next);
+    mode = ACQUIRE;
+    acquired.clear();
+    acquiredTried = 0;
+  }
+  found.clear();
+  next++;
+}
+
+bool GatedClickPipeline::tryAcquire() {
+  const size_t scored = gate.acquireReversals;
+  if (acquired.size() < scored || acquired.size() == acquiredTried || reversals.size() < scored) {
+    return false;
+  }
+  acquiredTried = acquired.size();
+  const double tolerance = gate.acquireToleranceMs * 1e-3;
+  const double last = acquired.back();
+
+  // Nearest acquired click to t, or -1
+  const auto nearest = [&](double t) -> ptrdiff_t {
+    const auto it = std::lower_bound(acquired.begin(), acquired.end(), t);
+    ptrdiff_t index = -1;
+    double error = tolerance;
+    if (it != acquired.end() && *it - t <= error) {
+      error = *it - t;
+      index = it - acquired.begin();
+    }
+    if (it != acquired.begin() && t - *(it - 1) <= error) {
+      index = it - 1 - acquired.begin();
+    }
+    return index;
+  };
+
+  // Pair one of the first clicks with each reversal as the offset
+  size_t bestScore = 0;
+  double bestCost = 0;
+  double bestOffset = 0;
+  size_t bestReversal = 0;
+  const size_t anchors = std::min<size_t>(4, acquired.size());
+  for (size_t a = 0; a < anchors; a++) {
+    for (size_t j = 0; j + scored <= reversals.size(); j++) {
+      const double offset = acquired[a] - rigSeconds(j);
+      if (rigSeconds(j + scored - 1) + offset > last + tolerance) {
+        break;  // Not heard far enough yet to score
+      }
+      size_t score = 0;
+      for (size_t k = j; k < j + scored; k++) {
+        score += nearest(rigSeconds(k) + offset) >= 0 ? 1 : 0;
+      }
+      const double cost = haveOffset ? fabs(offset - lastOffset) : static_cast<double>(j);
+      if (score > bestScore || (score == bestScore && cost < bestCost)) {
+        bestScore = score;
+        bestCost = cost;
+        bestOffset = offset;
+        bestReversal = j;
+      }
+    }
+  }
+  if (bestScore * 4 < scored * 3) {
+    // Forget the oldest clicks so a bad start cannot hold acquisition up forever
+    if (acquired.size() > 4 * scored) {
+      acquired.erase(acquired.begin(), acquired.end() - static_cast<ptrdiff_t>(2 * scored));
+      acquiredTried = acquired.size();
+    }
+    return false;
+  }
+
+  clockFit.reset();
+  for (size_t k = bestReversal; k < reversals.size() && rigSeconds(k) + bestOffset <= last + tolerance; k++) {
+    const ptrdiff_t match = nearest(rigSeconds(k) + bestOffset);
+    if (match >= 0) {
+      clockFit.add(rigSeconds(k), reversals[k].clockwise, acquired[static_cast<size_t>(match)]);
+    }
+  }
+  return clockFit.solve();
+}
+
+void GatedClickPipeline::finish(const Sink& sink) {
+  if (mode == ACQUIRE) {
+    pipeline.finish(sink);
+  } else if (inWindow) {
+    pipeline.finish([&](const Click& click, const ClickFeatures& features) { found.push_back({click, features}); });
+    closeWindow(sink);
+  }
+}
@@ -0,0 +1,162 @@
+#ifndef PHASE_GATE_H
+#define PHASE_GATE_H
+
+// Phase-gated click detection.
+//
+// A valve can only close just after the pump reverses, and a TELEMETRY build
+// logs every reversal with the micros() of its first pulse (REVERSAL records,
+// "reversal" lines of a pump_link session file). The gate maps those stamps
+// onto the audio clock and runs the click pipeline only in a short window
+// around each predicted click; the samples in between are never filtered or
+// searched, and knocks that fall outside a window cannot become clicks.
+//
+// The rig clock and the sound card's clock differ in offset and rate (an Uno
+// resonator is off by up to a few hundred ppm), and each valve lags its
+// reversal by its own delay, so the predicted onset in audio seconds is
+//
+//   offset + rate * rig + lag   (lag only for counter-clockwise reversals)
+//
+// fitted by least squares over the matched clicks, with older matches slowly
+// forgotten so a drifting rate is followed.
+//
+// Acquisition runs the ungated pipeline until it has clicks for a few beats,
+// then tries every pairing of an early click with a reversal as the offset
+// and keeps the one that explains the most clicks. Since beats are periodic,
+// pairings a whole number of beats apart score alike; the earliest reversal
+// wins, so the recording must start before the session (start the microphone
+// first). While tracking, each window takes the click nearest its prediction
+// and drops the rest; after maxMisses empty windows in a row the gate falls
+// back to acquisition, preferring the offset it had before.
+
+#include "click_pipeline.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <vector>
+
+struct RigReversal {
+  uint64_t micros;  // Rig micros() widened to 64 bits
+  bool clockwise;
+};
+
+// Collects the reversal lines of a session file, skipping everything else
+std::vector<RigReversal> readRigReversals(FILE* session);
+
+// Writes reversals in the session file format
+void writeRigReversals(FILE* session, const std::vector<RigReversal>& reversals);
+
+// Least-squares map from rig seconds to audio seconds (see above)
+class RigClockFit {
+ public:
+  explicit RigClockFit(double forgetting = 0.999) : forgetting(forgetting) {}
+
+  void reset();
+  void add(double rigSeconds, bool clockwise, double audioSeconds);
+  // True once both directions have matches and the rate can be solved
+  bool solve();
+  double predict(double rigSeconds, bool clockwise) const;
+
+  // How fast the rig clock runs against the audio clock
+  double driftPpm() const { return (1.0 / rate - 1.0) * 1e6; }
+  double lagSeconds() const { return lag; }
+  size_t matches() const { return count; }
+
+ private:
+  double forgetting;
+  // Weighted sums of t (rig), k (1 for counter-clockwise) and r = audio - rig
+  double n = 0, st = 0, stt = 0, sk = 0, stk = 0, sr = 0, str = 0, skr = 0;
+  size_t count = 0;
+  double offset = 0, rate = 1, lag = 0;
+};
+
+struct GateConfig {
+  float leadMs = 10.0f;     // Before each window: the filter and floor re-settle
+  float searchMs = 10.0f;   // Window half-width around the predicted onset
+  float acquireToleranceMs = 30.0f;
+  size_t acquireReversals = 12;  // Reversals each acquisition pairing is scored on
+  size_t maxMisses = 6;
+  double forgetting = 0.999;
+};
+
+struct GateStats {
+  uint64_t audioSamples = 0;
+  uint64_t ungatedSamples = 0;  // Run through the pipeline while acquiring
+  uint64_t windows = 0;
+  uint64_t matched = 0;
+  uint64_t dropped = 0;  // Clicks in a window other than its match
+  uint64_t acquisitions = 0;
+};
+
+class GatedClickPipeline {
+ public:
+  using Sink = ClickPipeline::Sink;
+
+  GatedClickPipeline(float sampleRate, std::vector<RigReversal> reversals, const GateConfig& gate = GateConfig(),
+                     const ClickPipelineConfig& config = ClickPipelineConfig());
+
+  // Filters the windowed parts of x in place and reports their clicks
+  void process(float* x, size_t n, const Sink& sink);
+  void finish(const Sink& sink);
+
+  const StageTimes& times() const { return pipeline.times(); }
+  const GateStats& stats() const { return gateStats; }
+  const RigClockFit& fit() const { return clockFit; }
+  bool tracking() const { return mode == TRACK; }
+
+  // While the sink runs: the reversal the click answers, or -1 for a click
+  // heard while acquiring
+  long matchedReversal() const { return reporting; }
+  // Beats count clockwise reversals from 0; a counter-clockwise reversal
+  // belongs to the beat before it
+  uint32_t beatOf(size_t reversal) const { return reversalBeats[reversal]; }
+  const RigReversal& reversal(size_t index) const { return reversals[index]; }
+  // Audio sample the current fit puts a reversal's click at
+  uint64_t predictedSample(size_t reversal) const;
+
+ private:
+  enum Mode { ACQUIRE, TRACK };
+
+  // x[0] is stream sample `at`
+  void acquire(float* x, size_t n, uint64_t at, const Sink& sink);
+  // Works through x from index i until the chunk ends or the lock is lost
+  void track(float* x, size_t n, const Sink& sink, size_t& i);
+  bool tryAcquire();
+  // Sets up the window of the first reversal from `next` whose window is not
+  // behind stream sample `at`, or returns false when none are left
+  bool planWindow(uint64_t at);
+  void closeWindow(const Sink& sink);
+  double rigSeconds(size_t reversal) const;
+
+  float rate;
+  std::vector<RigReversal> reversals;
+  std::vector<uint32_t> reversalBeats;
+  GateConfig gate;
+  uint32_t leadSamples, searchSamples;
+  ClickPipeline pipeline;
+  RigClockFit clockFit;
+  GateStats gateStats;
+
+  Mode mode = ACQUIRE;
+  uint64_t position = 0;   // Stream index of the next sample to arrive
+  uint64_t processed = 0;  // Stream index after the last sample the pipeline saw
+  std::vector<double> acquired;  // Click onsets (audio seconds) while acquiring
+  size_t acquiredTried = 0;
+  bool haveOffset = false;
+  double lastOffset = 0;  // Audio minus rig seconds when the lock was lost
+
+  size_t next = 0;  // Reversal of the current or next window
+  bool inWindow = false;
+  uint64_t windowStart = 0, searchEnd = 0;
+  double predicted = 0;  // Audio seconds
+  size_t misses = 0;
+  long reporting = -1;
+  struct Found {
+    Click click;
+    ClickFeatures features;
+  };
+  std::vector<Found> found;
+};
+
+#endif // PHASE_GATE_H
@@ -0,0 +1,270 @@
+#include "session_archive.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+void setArchiveText(char* field, size_t size, const char* text) {
+  memset(field, 0, size);
+  if (text != nullptr) {
+    strncpy(field, text, size - 1);
+  }
+}
+
+bool readSessionRun(FILE* session, ArchiveRunConfig& run) {
+  char line[256];
+  bool any = false;
+  unsigned long long first = 0, last = 0;
+  while (fgets(line, sizeof(line), session) != nullptr) {
+    unsigned beat, steps;
+    unsigned long long time, period;
+    if (sscanf(line, "beat_start %u %llu period %llu", &beat, &time, &period) == 3) {
+      if (!any) {
+        first = time;
+      }
+      any = true;
+      if (period > 0) {
+        run.heartRate = static_cast<uint16_t>((60000000ull + period / 2) / period);
+      }
+    } else if (sscanf(line, "beat_end %u %llu steps %u", &beat, &time, &steps) == 3) {
+      last = time;
+      run.strokeSteps = static_cast<uint16_t>(steps / 2);  // Systole out, diastole back
+    }
+  }
+  if (any && last > first) {
+    run.runtimeSeconds = static_cast<uint32_t>((last - first + 500000) / 1000000);
+  }
+  return any;
+}
+
+static uint64_t alignUp(uint64_t offset, uint64_t align) {
+  return (offset + align - 1) / align * align;
+}
+
+// Zero bytes up to the next multiple of `align`
+static bool pad(FILE* file, uint64_t& offset, uint64_t align) {
+  static const uint8_t zeros[SESSION_ARCHIVE_ALIGN] = {};
+  const uint64_t target = alignUp(offset, align);
+  const size_t gap = static_cast<size_t>(target - offset);
+  offset = target;
+  return gap == 0 || fwrite(zeros, 1, gap, file) == gap;
+}
+
+SessionArchiveWriter::~SessionArchiveWriter() {
+  close();
+}
+
+bool SessionArchiveWriter::open(const char* path, uint32_t sampleRate, const ArchiveRunConfig& run) {
+  file = fopen(path, "wb");
+  if (file == nullptr) {
+    return false;
+  }
+  header = ArchiveHeader{};
+  memcpy(header.magic, SESSION_ARCHIVE_MAGIC, sizeof(header.magic));
+  header.version = SESSION_ARCHIVE_VERSION;
+  header.headerBytes = sizeof(ArchiveHeader);
+  header.sampleRate = sampleRate;
+  header.chunkSamples = SESSION_ARCHIVE_CHUNK_SAMPLES;
+  header.audioOffset = SESSION_ARCHIVE_ALIGN;
+  header.run = run;
+  chunks.clear();
+  clicks.clear();
+  beats.clear();
+  // The header is rewritten on close(); reserve its page now
+  uint64_t offset = sizeof(header);
+  return fwrite(&header, sizeof(header), 1, file) == 1 && pad(file, offset, SESSION_ARCHIVE_ALIGN);
+}
+
+bool SessionArchiveWriter::write(const float* samples, size_t count) {
+  pcm.resize(count);
+  for (size_t i = 0; i < count; i++) {
+    float s = samples[i] * 32768.0f;
+    s = s > 32767.0f ? 32767.0f : (s < -32768.0f ? -32768.0f : s);
+    pcm[i] = static_cast<int16_t>(lrintf(s));
+  }
+  header.totalSamples += count;
+  return fwrite(pcm.data(), 2, count, file) == count;
+}
+
+void SessionArchiveWriter::addClick(const ArchiveClick& click) {
+  clicks.push_back(click);
+}
+
+void SessionArchiveWriter::addBeat(uint32_t beat, uint64_t start) {
+  beats.push_back({beat, 0, 0, start});
+}
+
+bool SessionArchiveWriter::close() {
+  if (file == nullptr) {
+    return true;
+  }
+  // Chunks are contiguous: the table only records where each one lies
+  const uint64_t total = header.totalSamples;
+  for (uint64_t first = 0; first < total; first += header.chunkSamples) {
+    const uint64_t samples = std::min<uint64_t>(header.chunkSamples, total - first);
+    chunks.push_back({header.audioOffset + first * 2, static_cast<uint32_t>(samples), 0});
+  }
+  header.chunkCount = chunks.size();
+
+  std::stable_sort(clicks.begin(), clicks.end(),
+                   [](const ArchiveClick& a, const ArchiveClick& b) { return a.onset < b.onset; });
+  std::stable_sort(beats.begin(), beats.end(), [](const ArchiveBeat& a, const ArchiveBeat& b) { return a.beat < b.beat; });
+  beats.erase(std::unique(beats.begin(), beats.end(),
+                          [](const ArchiveBeat& a, const ArchiveBeat& b) { return a.beat == b.beat; }),
+              beats.end());
+  // A beat's clicks are consecutive in onset order
+  for (size_t i = 0; i < clicks.size(); i++) {
+    if (clicks[i].beat < 0) {
+      continue;
+    }
+    const auto it = std::lower_bound(beats.begin(), beats.end(), static_cast<uint32_t>(clicks[i].beat),
+                                     [](const ArchiveBeat& b, uint32_t beat) { return b.beat < beat; });
+    if (it != beats.end() && it->beat == static_cast<uint32_t>(clicks[i].beat)) {
+      if (it->clickCount == 0) {
+        it->firstClick = i;
+      }
+      it->clickCount++;
+    }
+  }
+  header.clickCount = clicks.size();
+  header.beatCount = beats.size();
+
+  uint64_t offset = header.audioOffset + total * 2;
+  bool ok = pad(file, offset, 8);
+  header.chunkTableOffset = offset;
+  ok = ok && fwrite(chunks.data(), sizeof(ArchiveChunk), chunks.size(), file) == chunks.size();
+  offset += chunks.size() * sizeof(ArchiveChunk);
+  header.clickIndexOffset = offset;
+  ok = ok && fwrite(clicks.data(), sizeof(ArchiveClick), clicks.size(), file) == clicks.size();
+  offset += clicks.size() * sizeof(ArchiveClick);
+  header.beatIndexOffset = offset;
+  ok = ok && fwrite(beats.data(), sizeof(ArchiveBeat), beats.size(), file) == beats.size();
+  ok = ok && fseek(file, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, file) == 1;
+  ok = fclose(file) == 0 && ok;
+  file = nullptr;
+  return ok;
+}
+
+SessionArchive::~SessionArchive() {
+  close();
+}
+
+SessionArchive::SessionArchive(SessionArchive&& other) noexcept {
+  *this = static_cast<SessionArchive&&>(other);
+}
+
+SessionArchive& SessionArchive::operator=(SessionArchive&& other) noexcept {
+  if (this != &other) {
+    close();
+    base = other.base;
+    size = other.size;
+    head = other.head;
+    audio = other.audio;
+    clickTable = other.clickTable;
+    beatTable = other.beatTable;
+    message.swap(other.message);
+    other.base = nullptr;
+    other.size = 0;
+    other.head = nullptr;
+  }
+  return *this;
+}
+
+void SessionArchive::close() {
+  if (base != nullptr) {
+    munmap(const_cast<uint8_t*>(base), size);
+  }
+  base = nullptr;
+  size = 0;
+  head = nullptr;
+}
+
+bool SessionArchive::fail(const char* what) {
+  close();
+  message = what;
+  return false;
+}
+
+// True when [offset, offset + count * item) lies inside the file and is 8-byte aligned
+static bool sectionFits(uint64_t offset, uint64_t count, uint64_t item, size_t size) {
+  return offset % 8 == 0 && offset <= size && count <= (size - offset) / item;
+}
+
+bool SessionArchive::open(const char* path) {
+  close();
+  const int fd = ::open(path, O_RDONLY);
+  if (fd < 0) {
+    return fail(strerror(errno));
+  }
+  struct stat info;
+  if (fstat(fd, &info) != 0) {
+    ::close(fd);
+    return fail(strerror(errno));
+  }
+  size = static_cast<size_t>(info.st_size);
+  if (size < sizeof(ArchiveHeader)) {
+    ::close(fd);
+    return fail("not a session archive (too short)");
+  }
+  void* mapped = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (mapped == MAP_FAILED) {
+    size = 0;
+    return fail(strerror(errno));
+  }
+  base = static_cast<const uint8_t*>(mapped);
+  // Access is by click, scattered over the file: do not read ahead
+  madvise(mapped, size, MADV_RANDOM);
+
+  head = reinterpret_cast<const ArchiveHeader*>(base);
+  if (memcmp(head->magic, SESSION_ARCHIVE_MAGIC, sizeof(head->magic)) != 0) {
+    return fail("not a session archive (bad magic)");
+  }
+  if (head->version != SESSION_ARCHIVE_VERSION || head->headerBytes != sizeof(ArchiveHeader)) {
+    return fail("unsupported session archive version");
+  }
+  if (head->sampleRate == 0 || !sectionFits(head->audioOffset, head->totalSamples, 2, size) ||
+      !sectionFits(head->chunkTableOffset, head->chunkCount, sizeof(ArchiveChunk), size) ||
+      !sectionFits(head->clickIndexOffset, head->clickCount, sizeof(ArchiveClick), size) ||
+      !sectionFits(head->beatIndexOffset, head->beatCount, sizeof(ArchiveBeat), size)) {
+    return fail("session archive truncated or corrupt");
+  }
+  audio = reinterpret_cast<const int16_t*>(base + head->audioOffset);
+  clickTable = reinterpret_cast<const ArchiveClick*>(base + head->clickIndexOffset);
+  beatTable = reinterpret_cast<const ArchiveBeat*>(base + head->beatIndexOffset);
+  message.clear();
+  return true;
+}
+
+void SessionArchive::adviseSequential() {
+  if (base != nullptr) {
+    madvise(const_cast<uint8_t*>(base), size, MADV_SEQUENTIAL);
+  }
+}
+
+size_t SessionArchive::findClick(uint64_t sample) const {
+  const ArchiveClick* end = clickTable + clickCount();
+  return static_cast<size_t>(
+      std::lower_bound(clickTable, end, sample, [](const ArchiveClick& c, uint64_t s) { return c.onset < s; }) -
+      clickTable);
+}
+
+const ArchiveBeat* SessionArchive::findBeat(uint32_t number) const {
+  const ArchiveBeat* end = beatTable + beatCount();
+  const ArchiveBeat* it =
+      std::lower_bound(beatTable, end, number, [](const ArchiveBeat& b, uint32_t n) { return b.beat < n; });
+  return it != end && it->beat == number ? it : nullptr;
+}
+
+const int16_t* SessionArchive::samples(uint64_t start, uint64_t count) const {
+  if (start > head->totalSamples || count > head->totalSamples - start) {
+    return nullptr;
+  }
+  return audio + start;
+}
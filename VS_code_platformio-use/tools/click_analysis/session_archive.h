@@ -0,0 +1,182 @@
+#ifndef SESSION_ARCHIVE_H
+#define SESSION_ARCHIVE_H
+
+// Session archive: one experiment's recording, run configuration and click
+// index in a single file that is read through mmap.
+//
+//   ArchiveHeader (magic, layout, ArchiveRunConfig), padded to a page
+//   audio: mono int16, in chunks of chunkSamples back to back
+//   ArchiveChunk[chunkCount]   file offset and length of each audio chunk
+//   ArchiveClick[clickCount]   sorted by onset
+//   ArchiveBeat[beatCount]     sorted by beat number
+//
+// All fields are little endian with fixed sizes, and every section starts on
+// an 8-byte boundary, so the reader uses the mapped bytes in place: opening a
+// session maps the file and checks the header, and nothing else is read until
+// a click is asked for. Click N is an array lookup, the clicks of a beat or
+// near a time are a binary search, and a click's samples are a pointer into
+// the mapping. Chunks are written back to back with no gaps, so any run of
+// samples is contiguous. The chunk table is there so a later version can
+// compress chunks without changing the index.
+//
+// SessionArchiveWriter streams the audio to disk as it arrives and writes the
+// tables and the header on close(), like WavWriter.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+constexpr char SESSION_ARCHIVE_MAGIC[8] = {'P', 'U', 'M', 'P', 'S', 'E', 'S', 'S'};
+constexpr uint32_t SESSION_ARCHIVE_VERSION = 1;
+constexpr uint32_t SESSION_ARCHIVE_CHUNK_SAMPLES = 65536;
+constexpr uint32_t SESSION_ARCHIVE_ALIGN = 4096;  // Audio starts on a page
+
+// How the pump was driven; text fields are NUL-padded
+struct ArchiveRunConfig {
+  char variant[24];  // PUMP_VARIANT of the firmware, e.g. "MainPump"
+  char profile[16];  // Motion profile: "tables", "live_ramp" or "waveform"
+  uint16_t heartRate;      // Beats per minute
+  uint16_t strokeSteps;    // Steps per systole
+  uint16_t systoleAccel;   // Ramp parameters (COMMAND_RAMPS), 0 when not used
+  uint16_t systoleFloor;
+  uint16_t diastoleAccel;
+  uint16_t diastoleFloor;
+  uint32_t runtimeSeconds;
+  char note[72];
+};
+
+struct ArchiveHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t headerBytes;  // sizeof(ArchiveHeader)
+  uint32_t sampleRate;
+  uint32_t chunkSamples;
+  uint64_t totalSamples;
+  uint64_t audioOffset;
+  uint64_t chunkTableOffset;
+  uint64_t chunkCount;
+  uint64_t clickIndexOffset;
+  uint64_t clickCount;
+  uint64_t beatIndexOffset;
+  uint64_t beatCount;
+  ArchiveRunConfig run;
+};
+
+struct ArchiveChunk {
+  uint64_t offset;  // File offset of the chunk's first sample
+  uint32_t samples;
+  uint32_t reserved;
+};
+
+enum ArchiveClickKind : uint8_t {
+  CLICK_UNKNOWN = 0,  // Ungated: not tied to a reversal
+  CLICK_OPENING = 1,  // After a clockwise reversal (systole starts)
+  CLICK_CLOSURE = 2,  // After a counter-clockwise reversal
+};
+
+struct ArchiveClick {
+  uint64_t start;    // First stored sample (pre-roll included)
+  uint64_t onset;
+  uint32_t samples;  // Pre-roll through post-roll
+  int32_t beat;      // -1 when not tied to a beat
+  float peak;        // Of the filtered click
+  float noiseFloor;
+  uint8_t kind;      // ArchiveClickKind
+  uint8_t reserved[7];
+};
+
+struct ArchiveBeat {
+  uint32_t beat;
+  uint32_t clickCount;
+  uint64_t firstClick;  // Index into the click table
+  uint64_t start;       // Sample of the beat's clockwise reversal
+};
+
+static_assert(sizeof(ArchiveRunConfig) == 128, "ArchiveRunConfig layout");
+static_assert(sizeof(ArchiveHeader) == 216, "ArchiveHeader layout");
+static_assert(sizeof(ArchiveClick) == 40, "ArchiveClick layout");
+static_assert(sizeof(ArchiveBeat) == 24, "ArchiveBeat layout");
+
+// Copies text into a fixed NUL-padded field, truncating it
+void setArchiveText(char* field, size_t size, const char* text);
+
+// Fills heart rate, stroke and runtime from the beat records of a pump_link
+// session file (tools/pump_link/telemetry_decoder.h); false when it has none
+bool readSessionRun(FILE* session, ArchiveRunConfig& run);
+
+class SessionArchiveWriter {
+ public:
+  SessionArchiveWriter() = default;
+  ~SessionArchiveWriter();
+  SessionArchiveWriter(const SessionArchiveWriter&) = delete;
+  SessionArchiveWriter& operator=(const SessionArchiveWriter&) = delete;
+
+  bool open(const char* path, uint32_t sampleRate, const ArchiveRunConfig& run);
+  // Appends audio in [-1, 1); stored as int16
+  bool write(const float* samples, size_t count);
+  // Clicks may be added in any order; the beat is -1 for none
+  void addClick(const ArchiveClick& click);
+  // Beats may be added in any order, before or after their clicks
+  void addBeat(uint32_t beat, uint64_t start);
+  bool close();
+
+ private:
+  FILE* file = nullptr;
+  ArchiveHeader header{};
+  std::vector<ArchiveChunk> chunks;
+  std::vector<ArchiveClick> clicks;
+  std::vector<ArchiveBeat> beats;
+  std::vector<int16_t> pcm;
+};
+
+class SessionArchive {
+ public:
+  SessionArchive() = default;
+  ~SessionArchive();
+  SessionArchive(SessionArchive&& other) noexcept;
+  SessionArchive& operator=(SessionArchive&& other) noexcept;
+  SessionArchive(const SessionArchive&) = delete;
+  SessionArchive& operator=(const SessionArchive&) = delete;
+
+  // Maps `path` and checks its header and section bounds
+  bool open(const char* path);
+  void close();
+  const std::string& error() const { return message; }
+  // open() tells the kernel access is random; a scan of the whole audio
+  // (tools/click_batch) asks for read-ahead instead
+  void adviseSequential();
+
+  const ArchiveHeader& header() const { return *head; }
+  const ArchiveRunConfig& run() const { return head->run; }
+  uint64_t totalSamples() const { return head->totalSamples; }
+
+  size_t clickCount() const { return static_cast<size_t>(head->clickCount); }
+  const ArchiveClick& click(size_t index) const { return clickTable[index]; }
+  // First click whose onset is at or after `sample`, or clickCount()
+  size_t findClick(uint64_t sample) const;
+
+  size_t beatCount() const { return static_cast<size_t>(head->beatCount); }
+  const ArchiveBeat& beat(size_t index) const { return beatTable[index]; }
+  // The entry of beat number `beat`, or nullptr
+  const ArchiveBeat* findBeat(uint32_t beat) const;
+
+  // Samples [start, start + count) in place; nullptr when out of range
+  const int16_t* samples(uint64_t start, uint64_t count) const;
+  const int16_t* clickSamples(const ArchiveClick& c) const { return samples(c.start, c.samples); }
+
+ private:
+  bool fail(const char* what);
+
+  const uint8_t* base = nullptr;
+  size_t size = 0;
+  const ArchiveHeader* head = nullptr;
+  const int16_t* audio = nullptr;
+  const ArchiveClick* clickTable = nullptr;
+  const ArchiveBeat* beatTable = nullptr;
+  std::string message;
+};
+
+#endif // SESSION_ARCHIVE_H
@@ -0,0 +1,321 @@
+#ifndef SIMD_KERNELS_H
+#define SIMD_KERNELS_H
+
+// Vector kernels for the click-analysis pipeline.
+//
+// Written with the GCC/Clang vector extension instead of ISA intrinsics: the
+// compiler lowers f32v to SSE or NEON registers (4 lanes), or AVX (8 lanes)
+// when the build enables it (-mavx2 / -march=native), so one source runs
+// vectorised on a lab PC and on an ARM laptop. Every kernel takes any length
+// and any alignment; the tail runs scalar. The one exception is the int16
+// pair multiply-add of the int8 kernels, which the extension cannot express:
+// it is SSE2's pmaddwd on x86 and two widening shuffles elsewhere.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <math.h>
+
+namespace simd {
+
+#ifdef __AVX__
+constexpr size_t LANES = 8;
+#else
+constexpr size_t LANES = 4;
+#endif
+
+}  // namespace simd
+
+typedef float f32v __attribute__((vector_size(simd::LANES * sizeof(float))));
+
+typedef int8_t i8x16 __attribute__((vector_size(16)));
+typedef int16_t i16x8 __attribute__((vector_size(16)));
+typedef int32_t i32x4 __attribute__((vector_size(16)));
+typedef float f32x4 __attribute__((vector_size(16)));
+
+namespace simd {
+
+inline f32v load(const float* p) {
+  f32v v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+inline void store(float* p, f32v v) {
+  memcpy(p, &v, sizeof(v));
+}
+
+inline f32v splat(float x) {
+  f32v v;
+  for (size_t i = 0; i < LANES; i++) {
+    v[i] = x;
+  }
+  return v;
+}
+
+inline f32v abs(f32v v) {
+  return v < 0 ? -v : v;
+}
+
+inline f32v max(f32v a, f32v b) {
+  return a > b ? a : b;
+}
+
+inline float horizontalSum(f32v v) {
+  float s = 0;
+  for (size_t i = 0; i < LANES; i++) {
+    s += v[i];
+  }
+  return s;
+}
+
+inline float horizontalMax(f32v v) {
+  float m = v[0];
+  for (size_t i = 1; i < LANES; i++) {
+    m = v[i] > m ? v[i] : m;
+  }
+  return m;
+}
+
+// max |x[i]|
+inline float maxAbs(const float* x, size_t n) {
+  const size_t whole = n - n % LANES;
+  f32v acc = splat(0);
+  for (size_t i = 0; i < whole; i += LANES) {
+    acc = max(acc, abs(load(x + i)));
+  }
+  float m = horizontalMax(acc);
+  for (size_t i = whole; i < n; i++) {
+    m = fabsf(x[i]) > m ? fabsf(x[i]) : m;
+  }
+  return m;
+}
+
+inline double sum(const float* x, size_t n) {
+  f32v acc = splat(0);
+  size_t i = 0;
+  for (; i + LANES <= n; i += LANES) {
+    acc += load(x + i);
+  }
+  double s = horizontalSum(acc);
+  for (; i < n; i++) {
+    s += x[i];
+  }
+  return s;
+}
+
+// Sums of (x - mean)^2, ^3 and ^4 in one pass
+struct CentralSums {
+  double m2, m3, m4;
+};
+
+inline CentralSums centralSums(const float* x, size_t n, float mean) {
+  const f32v mu = splat(mean);
+  f32v a2 = splat(0), a3 = splat(0), a4 = splat(0);
+  size_t i = 0;
+  for (; i + LANES <= n; i += LANES) {
+    const f32v d = load(x + i) - mu;
+    const f32v d2 = d * d;
+    a2 += d2;
+    a3 += d2 * d;
+    a4 += d2 * d2;
+  }
+  CentralSums s{horizontalSum(a2), horizontalSum(a3), horizontalSum(a4)};
+  for (; i < n; i++) {
+    const double d = x[i] - mean;
+    s.m2 += d * d;
+    s.m3 += d * d * d;
+    s.m4 += d * d * d * d;
+  }
+  return s;
+}
+
+// out[i] = x[i] * w[i]
+inline void multiply(const float* x, const float* w, float* out, size_t n) {
+  size_t i = 0;
+  for (; i + LANES <= n; i += LANES) {
+    store(out + i, load(x + i) * load(w + i));
+  }
+  for (; i < n; i++) {
+    out[i] = x[i] * w[i];
+  }
+}
+
+// Lanes in reverse order
+inline f32v reverse(f32v v) {
+#ifdef __AVX__
+  return __builtin_shufflevector(v, v, 7, 6, 5, 4, 3, 2, 1, 0);
+#else
+  return __builtin_shufflevector(v, v, 3, 2, 1, 0);
+#endif
+}
+
+// even[i] = x[2i] * wEven[i], odd[i] = x[2i + 1] * wOdd[i] for i < pairs
+inline void multiplySplit(const float* x, const float* wEven, const float* wOdd, float* even, float* odd,
+                          size_t pairs) {
+  size_t i = 0;
+  for (; i + LANES <= pairs; i += LANES) {
+    const f32v a = load(x + 2 * i), b = load(x + 2 * i + LANES);
+#ifdef __AVX__
+    const f32v e = __builtin_shufflevector(a, b, 0, 2, 4, 6, 8, 10, 12, 14);
+    const f32v o = __builtin_shufflevector(a, b, 1, 3, 5, 7, 9, 11, 13, 15);
+#else
+    const f32v e = __builtin_shufflevector(a, b, 0, 2, 4, 6);
+    const f32v o = __builtin_shufflevector(a, b, 1, 3, 5, 7);
+#endif
+    store(even + i, e * load(wEven + i));
+    store(odd + i, o * load(wOdd + i));
+  }
+  for (; i < pairs; i++) {
+    even[i] = x[2 * i] * wEven[i];
+    odd[i] = x[2 * i + 1] * wOdd[i];
+  }
+}
+
+// out[i] = re[i]^2 + im[i]^2
+inline void power(const float* re, const float* im, float* out, size_t n) {
+  size_t i = 0;
+  for (; i + LANES <= n; i += LANES) {
+    const f32v r = load(re + i);
+    const f32v m = load(im + i);
+    store(out + i, r * r + m * m);
+  }
+  for (; i < n; i++) {
+    out[i] = re[i] * re[i] + im[i] * im[i];
+  }
+}
+
+// sum of a[i] * b[i]
+inline double dot(const float* a, const float* b, size_t n) {
+  f32v acc = splat(0);
+  size_t i = 0;
+  for (; i + LANES <= n; i += LANES) {
+    acc += load(a + i) * load(b + i);
+  }
+  double s = horizontalSum(acc);
+  for (; i < n; i++) {
+    s += static_cast<double>(a[i]) * b[i];
+  }
+  return s;
+}
+
+// The int8 kernels (click_cnn.h) run across output channels, I8_COLUMNS at a
+// time, two inputs per step: weights are laid out [input pair][channel][2],
+// so one 16-byte load holds both weights of eight channels, and each step is
+// two multiply-adds of int16 pairs into int32 lanes. Weights are in
+// [-127, 127] and activations in [-128, 127], so products and sums are exact.
+constexpr size_t I8_COLUMNS = 8;
+
+// a[2i] * b[2i] + a[2i + 1] * b[2i + 1] for i < 4
+inline i32x4 multiplyAddPairs(i16x8 a, i16x8 b) {
+#ifdef __SSE2__
+  return __builtin_ia32_pmaddwd128(a, b);
+#else
+  const i16x8 p = a * b;
+  return __builtin_convertvector(__builtin_shufflevector(p, p, 0, 2, 4, 6), i32x4) +
+         __builtin_convertvector(__builtin_shufflevector(p, p, 1, 3, 5, 7), i32x4);
+#endif
+}
+
+// pairs[p] holds x[2p] in its low and x[2p + 1] in its high 16 bits, as the
+// multiply-add takes them; an odd last input is paired with 0
+inline void pairI8(const int8_t* x, size_t n, int32_t* pairs) {
+  for (size_t p = 0; p < n / 2; p++) {
+    pairs[p] = static_cast<int32_t>(static_cast<uint16_t>(x[2 * p]) | static_cast<uint32_t>(x[2 * p + 1]) << 16);
+  }
+  if (n % 2 != 0) {
+    pairs[n / 2] = static_cast<uint16_t>(x[n - 1]);
+  }
+}
+
+// acc[c] += sum over p of w[p][c][0] * x[2p] + w[p][c][1] * x[2p + 1], for
+// every c < columns (a multiple of I8_COLUMNS); x as pairI8 packs it
+inline void multiplyAccumulateI8(const int8_t* w, const int32_t* pairs, size_t pairCount, size_t columns,
+                                 int32_t* acc) {
+  for (size_t c = 0; c < columns; c += I8_COLUMNS) {
+    i32x4 low, high;
+    memcpy(&low, acc + c, sizeof(low));
+    memcpy(&high, acc + c + 4, sizeof(high));
+    const int8_t* column = w + 2 * c;
+    for (size_t p = 0; p < pairCount; p++, column += 2 * columns) {
+      i8x16 weights;
+      memcpy(&weights, column, sizeof(weights));
+      const i32x4 broadcast = {pairs[p], pairs[p], pairs[p], pairs[p]};
+      const i16x8 x = (i16x8)broadcast;  // Same bits as eight int16
+      // Sign extension as an interleave with itself and an arithmetic shift,
+      // which every ISA has (a plain int8 -> int16 convert is not in SSE2)
+      const i16x8 first = (i16x8)__builtin_shufflevector(weights, weights, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7);
+      const i16x8 second =
+          (i16x8)__builtin_shufflevector(weights, weights, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13, 14, 14, 15, 15);
+      low += multiplyAddPairs(first >> 8, x);
+      high += multiplyAddPairs(second >> 8, x);
+    }
+    memcpy(acc + c, &low, sizeof(low));
+    memcpy(acc + c + 4, &high, sizeof(high));
+  }
+}
+
+// v rounded half away from zero and clamped to [lowest, 127]
+inline i32x4 roundClamp(f32x4 v, int32_t lowest) {
+  const f32x4 half = {0.5f, 0.5f, 0.5f, 0.5f};
+  i32x4 q = __builtin_convertvector(v >= 0 ? v + half : v - half, i32x4);
+  q = q > 127 ? 127 : q;
+  return q < lowest ? lowest : q;
+}
+
+// out[i] = x[i] * scale rounded and clamped to [-127, 127]
+inline void quantizeI8(const float* x, float scale, size_t n, int8_t* out) {
+  const f32x4 s = {scale, scale, scale, scale};
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    f32x4 v;
+    memcpy(&v, x + i, sizeof(v));
+    const i32x4 q = roundClamp(v * s, -127);
+    for (size_t k = 0; k < 4; k++) {
+      out[i + k] = static_cast<int8_t>(q[k]);
+    }
+  }
+  for (; i < n; i++) {
+    const float v = x[i] * scale;
+    const int32_t q = static_cast<int32_t>(v >= 0 ? v + 0.5f : v - 0.5f);
+    out[i] = static_cast<int8_t>(q > 127 ? 127 : q < -127 ? -127 : q);
+  }
+}
+
+// out[i] = acc[i] * scale[i] + zero rounded and clamped to [lowest, 127],
+// for a multiple of 4 values
+inline void requantizeI8(const int32_t* acc, const float* scale, size_t n, int32_t zero, int32_t lowest,
+                         int8_t* out) {
+  const f32x4 offset = {static_cast<float>(zero), static_cast<float>(zero), static_cast<float>(zero),
+                        static_cast<float>(zero)};
+  for (size_t i = 0; i < n; i += 4) {
+    i32x4 a;
+    f32x4 s;
+    memcpy(&a, acc + i, sizeof(a));
+    memcpy(&s, scale + i, sizeof(s));
+    const i32x4 q = roundClamp(__builtin_convertvector(a, f32x4) * s + offset, lowest);
+    for (size_t k = 0; k < 4; k++) {
+      out[i + k] = static_cast<int8_t>(q[k]);
+    }
+  }
+}
+
+// out[i] = max(out[i], x[i]) over int8
+inline void maxI8(const int8_t* x, int8_t* out, size_t n) {
+  size_t i = 0;
+  for (; i + sizeof(i8x16) <= n; i += sizeof(i8x16)) {
+    i8x16 a, b;
+    memcpy(&a, x + i, sizeof(a));
+    memcpy(&b, out + i, sizeof(b));
+    b = a > b ? a : b;
+    memcpy(out + i, &b, sizeof(b));
+  }
+  for (; i < n; i++) {
+    out[i] = x[i] > out[i] ? x[i] : out[i];
+  }
+}
+
+}  // namespace simd
+
+#endif // SIMD_KERNELS_H
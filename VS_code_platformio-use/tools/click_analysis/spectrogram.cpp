@@ -0,0 +1,130 @@
+#include "spectrogram.h"
+#include "simd_kernels.h"
+
+#include <math.h>
+#include <string.h>
+
+#include <algorithm>
+
+static double hzToMel(double hz) {
+  return 2595.0 * log10(1.0 + hz / 700.0);
+}
+
+static double melToHz(double mel) {
+  return 700.0 * (pow(10.0, mel / 2595.0) - 1.0);
+}
+
+Spectrogram::Spectrogram(const SpectrogramConfig& config)
+    : config(config),
+      plan(config.fftSize),
+      windowEven(config.fftSize / 2),
+      windowOdd(config.fftSize / 2),
+      even(config.fftSize / 2),
+      odd(config.fftSize / 2),
+      binPower(config.fftSize / 2 + 1) {
+  const size_t size = config.fftSize;
+  for (size_t i = 0; i < size; i++) {
+    const float w = static_cast<float>(0.5 - 0.5 * cos(2.0 * M_PI * static_cast<double>(i) / static_cast<double>(size)));
+    (i % 2 == 0 ? windowEven : windowOdd)[i / 2] = w;
+  }
+  carry.reserve(size);
+
+  if (config.melBands > 0) {
+    const double top = config.maxHz > 0 ? config.maxHz : config.sampleRate / 2;
+    const double low = hzToMel(config.minHz), high = hzToMel(top);
+    for (size_t b = 0; b < config.melBands + 2; b++) {
+      melHz.push_back(static_cast<float>(melToHz(low + (high - low) * b / (config.melBands + 1))));
+    }
+    const double binHz = config.sampleRate / static_cast<double>(size);
+    for (size_t b = 0; b < config.melBands; b++) {
+      const double left = melHz[b], centre = melHz[b + 1], right = melHz[b + 2];
+      MelBand band{0, 0, static_cast<uint32_t>(melWeights.size())};
+      for (size_t k = 0; k < plan.bins(); k++) {
+        const double hz = k * binHz;
+        if (hz <= left || hz >= right) {
+          continue;
+        }
+        if (band.count == 0) {
+          band.first = static_cast<uint32_t>(k);
+        }
+        band.count++;
+        melWeights.push_back(static_cast<float>(hz < centre ? (hz - left) / (centre - left) : (right - hz) / (right - centre)));
+      }
+      melBands.push_back(band);
+    }
+  }
+}
+
+size_t Spectrogram::maxFrames(size_t n) const {
+  const size_t available = carry.size() + n;
+  return available < config.fftSize ? 0 : (available - config.fftSize) / config.hop + 1;
+}
+
+void Spectrogram::reset() {
+  carry.clear();
+  produced = 0;
+}
+
+std::vector<float> Spectrogram::melCentresHz() const {
+  return melHz.empty() ? std::vector<float>() : std::vector<float>(melHz.begin() + 1, melHz.end() - 1);
+}
+
+void Spectrogram::window(const float* x, size_t first, size_t count) {
+  if (count == 0) {
+    return;
+  }
+  size_t j = first;
+  if (j % 2 != 0) {
+    odd[j / 2] = x[0] * windowOdd[j / 2];
+    x++;
+    j++;
+    count--;
+  }
+  const size_t p = j / 2;
+  simd::multiplySplit(x, &windowEven[p], &windowOdd[p], &even[p], &odd[p], count / 2);
+  if (count % 2 != 0) {
+    const size_t last = (j + count - 1) / 2;
+    even[last] = x[count - 1] * windowEven[last];
+  }
+}
+
+void Spectrogram::finish(float* out) {
+  if (melBands.empty()) {
+    plan.power(even.data(), odd.data(), out);
+  } else {
+    plan.power(even.data(), odd.data(), binPower.data());
+    for (size_t b = 0; b < melBands.size(); b++) {
+      const MelBand& band = melBands[b];
+      out[b] = static_cast<float>(simd::dot(&binPower[band.first], &melWeights[band.offset], band.count));
+    }
+  }
+  if (config.logScale) {
+    for (size_t i = 0; i < frameValues(); i++) {
+      out[i] = logf(out[i] + SPECTROGRAM_LOG_FLOOR);
+    }
+  }
+  produced++;
+}
+
+size_t Spectrogram::process(const float* x, size_t n, float* out) {
+  const size_t size = config.fftSize;
+  const size_t held = carry.size();
+  size_t start = 0;  // Of the next frame, from the first carried sample
+  size_t written = 0;
+  for (; start + size <= held + n; start += config.hop, written++) {
+    if (start < held) {
+      window(&carry[start], 0, held - start);
+      window(x, held - start, size - (held - start));
+    } else {
+      window(x + (start - held), 0, size);
+    }
+    finish(out + written * frameValues());
+  }
+  if (start < held) {
+    carry.erase(carry.begin(), carry.begin() + static_cast<std::ptrdiff_t>(start));
+    carry.insert(carry.end(), x, x + n);
+  } else {
+    carry.assign(x + (start - held), x + n);
+  }
+  return written;
+}
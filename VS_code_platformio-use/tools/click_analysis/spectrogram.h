@@ -0,0 +1,83 @@
+#ifndef SPECTROGRAM_H
+#define SPECTROGRAM_H
+
+// Streaming STFT and mel-spectrogram front end for the spectral click
+// features and models in wiki/future-work.
+//
+// Frame f covers samples [f * hop, f * hop + fftSize) of the stream, Hann
+// windowed. Its output is melBands log (or linear) mel energies, or with
+// melBands 0 the fftSize / 2 + 1 bin powers. Mel filters are triangles on the
+// HTK mel scale between minHz and maxHz, unnormalised; a filter narrower than
+// the bin spacing may catch no bin and stay 0.
+//
+// process() takes blocks of any size. Frames that lie inside the caller's
+// block are windowed straight from it; only the samples a frame still needs at
+// the end of a block (fewer than fftSize) are kept for the next one, so
+// overlapping frames never copy the stream. Windowing splits each frame into
+// even and odd samples for the half-size FFT of RealFftPlan, and every filter
+// is a dot product over its contiguous run of bins, all on the vector kernels
+// of simd_kernels.h. The plan, window and filters are built once; process()
+// writes into the caller's buffer and never allocates.
+
+#include "fft.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+struct SpectrogramConfig {
+  float sampleRate = 48000.0f;
+  size_t fftSize = 1024;  // Power of two, at least 4
+  size_t hop = 256;       // 1 .. fftSize
+  size_t melBands = 40;   // 0: bin powers instead
+  float minHz = 100.0f;
+  float maxHz = 0.0f;     // 0: Nyquist
+  bool logScale = true;   // ln(energy + SPECTROGRAM_LOG_FLOOR)
+};
+
+constexpr float SPECTROGRAM_LOG_FLOOR = 1e-10f;
+
+class Spectrogram {
+ public:
+  explicit Spectrogram(const SpectrogramConfig& config);
+
+  // Floats per frame: melBands, or fftSize / 2 + 1
+  size_t frameValues() const { return melBands.empty() ? plan.bins() : melBands.size(); }
+
+  // Most frames the next n samples can complete
+  size_t maxFrames(size_t n) const;
+
+  // Feeds n samples; writes each frame they complete to out, frameValues()
+  // apiece, and returns how many. out holds at least maxFrames(n) frames.
+  size_t process(const float* x, size_t n, float* out);
+
+  uint64_t frames() const { return produced; }  // Written since the start
+  void reset();
+
+  // Centre of each mel band, for labelling
+  std::vector<float> melCentresHz() const;
+
+ private:
+  struct MelBand {
+    uint32_t first;   // First bin
+    uint32_t count;   // Bins
+    uint32_t offset;  // Into melWeights
+  };
+
+  // Windows count samples of the frame from sample `first` on into even/odd
+  void window(const float* x, size_t first, size_t count);
+  void finish(float* out);
+
+  SpectrogramConfig config;
+  RealFftPlan plan;
+  std::vector<float> windowEven, windowOdd;
+  std::vector<MelBand> melBands;
+  std::vector<float> melWeights;
+  std::vector<float> melHz;  // Band edges, melBands + 2
+  std::vector<float> even, odd, binPower;
+  std::vector<float> carry;  // From the next frame's start to the end of the last block
+  uint64_t produced = 0;
+};
+
+#endif // SPECTROGRAM_H
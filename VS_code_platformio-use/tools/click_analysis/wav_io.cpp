@@ -0,0 +1,200 @@
+#include "wav_io.h"
+
+#include <math.h>
+#include <string.h>
+
+static uint16_t le16(const uint8_t* p) {
+  return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+static uint32_t le32(const uint8_t* p) {
+  return static_cast<uint32_t>(le16(p)) | (static_cast<uint32_t>(le16(p + 2)) << 16);
+}
+
+WavReader::~WavReader() {
+  close();
+}
+
+void WavReader::close() {
+  if (file != nullptr && ownsFile) {
+    fclose(file);
+  }
+  file = nullptr;
+  ownsFile = false;
+}
+
+bool WavReader::fail(const char* what) {
+  message = what;
+  close();
+  return false;
+}
+
+bool WavReader::readExact(void* data, size_t size) {
+  return fread(data, 1, size, file) == size;
+}
+
+bool WavReader::skip(uint32_t size) {
+  uint8_t scratch[4096];
+  while (size > 0) {
+    const size_t piece = size < sizeof(scratch) ? size : sizeof(scratch);
+    if (!readExact(scratch, piece)) {
+      return false;
+    }
+    size -= static_cast<uint32_t>(piece);
+  }
+  return true;
+}
+
+bool WavReader::open(const char* path) {
+  close();
+  if (strcmp(path, "-") == 0) {
+    file = stdin;
+  } else {
+    file = fopen(path, "rb");
+    ownsFile = true;
+    if (file == nullptr) {
+      ownsFile = false;
+      return fail("cannot open file");
+    }
+  }
+
+  uint8_t header[12];
+  if (!readExact(header, sizeof(header)) || memcmp(header, "RIFF", 4) != 0 || memcmp(header + 8, "WAVE", 4) != 0) {
+    return fail("not a RIFF/WAVE file");
+  }
+  bool haveFormat = false;
+  for (;;) {
+    uint8_t chunk[8];
+    if (!readExact(chunk, sizeof(chunk))) {
+      return fail("no data chunk");
+    }
+    const uint32_t size = le32(chunk + 4);
+    if (memcmp(chunk, "fmt ", 4) == 0) {
+      uint8_t format[40] = {};
+      if (size < 16 || size > sizeof(format) || !readExact(format, size) || ((size & 1) && !skip(1))) {
+        return fail("bad fmt chunk");
+      }
+      uint16_t tag = le16(format);
+      channelCount = le16(format + 2);
+      rate = static_cast<int>(le32(format + 4));
+      const int bits = le16(format + 14);
+      if (tag == 0xFFFE && size >= 26) {
+        tag = le16(format + 24);  // Sub-format GUID starts with the real tag
+      }
+      isFloat = tag == 3;
+      bytesPerSample = (bits + 7) / 8;
+      if ((tag != 1 && tag != 3) || channelCount < 1 || rate <= 0 || bytesPerSample < 1 || bytesPerSample > 4 ||
+          (isFloat && bytesPerSample != 4)) {
+        return fail("unsupported sample format (PCM 8/16/24/32 or float32 only)");
+      }
+      haveFormat = true;
+    } else if (memcmp(chunk, "data", 4) == 0) {
+      if (!haveFormat) {
+        return fail("data chunk before fmt chunk");
+      }
+      dataRemaining = (size == 0 || size == 0xFFFFFFFFu) ? UINT64_MAX : size;
+      return true;
+    } else if (!skip(size + (size & 1))) {
+      return fail("truncated chunk");
+    }
+  }
+}
+
+size_t WavReader::read(float* out, size_t frames) {
+  if (file == nullptr || dataRemaining == 0) {
+    return 0;
+  }
+  const size_t frameBytes = static_cast<size_t>(bytesPerSample) * channelCount;
+  uint64_t wanted = static_cast<uint64_t>(frames) * frameBytes;
+  if (wanted > dataRemaining) {
+    wanted = dataRemaining - dataRemaining % frameBytes;
+  }
+  raw.resize(static_cast<size_t>(wanted));
+  const size_t got = fread(raw.data(), 1, raw.size(), file) / frameBytes;
+  if (dataRemaining != UINT64_MAX) {
+    dataRemaining -= got * frameBytes;
+  }
+  if (got * frameBytes < wanted) {
+    dataRemaining = 0;  // End of input
+  }
+
+  const float mix = 1.0f / static_cast<float>(channelCount);
+  const uint8_t* p = raw.data();
+  for (size_t f = 0; f < got; f++) {
+    float sum = 0;
+    for (int c = 0; c < channelCount; c++, p += bytesPerSample) {
+      switch (bytesPerSample) {
+        case 1:
+          sum += (static_cast<int>(p[0]) - 128) * (1.0f / 128.0f);
+          break;
+        case 2:
+          sum += static_cast<int16_t>(le16(p)) * (1.0f / 32768.0f);
+          break;
+        case 3: {
+          const uint32_t bits = static_cast<uint32_t>(p[0]) << 8 | static_cast<uint32_t>(p[1]) << 16 |
+                                static_cast<uint32_t>(p[2]) << 24;
+          sum += static_cast<float>(static_cast<int32_t>(bits) >> 8) * (1.0f / 8388608.0f);
+          break;
+        }
+        default:
+          if (isFloat) {
+            float value;
+            memcpy(&value, p, sizeof(value));
+            sum += value;
+          } else {
+            sum += static_cast<float>(static_cast<int32_t>(le32(p))) * (1.0f / 2147483648.0f);
+          }
+          break;
+      }
+    }
+    out[f] = sum * mix;
+  }
+  return got;
+}
+
+WavWriter::~WavWriter() {
+  close();
+}
+
+bool WavWriter::open(const char* path, int sampleRate) {
+  close();
+  file = fopen(path, "wb");
+  if (file == nullptr) {
+    return false;
+  }
+  dataBytes = 0;
+  uint8_t header[44] = {'R', 'I', 'F', 'F', 0, 0, 0, 0, 'W', 'A', 'V', 'E', 'f', 'm', 't', ' ', 16, 0, 0, 0,
+                        1,   0,   1,   0};
+  const uint32_t rate = static_cast<uint32_t>(sampleRate);
+  const uint32_t byteRate = rate * 2;
+  memcpy(header + 24, &rate, 4);  // Little-endian hosts only, like the rest of the tools
+  memcpy(header + 28, &byteRate, 4);
+  header[32] = 2;   // Block align
+  header[34] = 16;  // Bits per sample
+  memcpy(header + 36, "data", 4);
+  return fwrite(header, 1, sizeof(header), file) == sizeof(header);
+}
+
+bool WavWriter::write(const float* samples, size_t count) {
+  pcm.resize(count);
+  for (size_t i = 0; i < count; i++) {
+    float s = samples[i] * 32768.0f;
+    s = s > 32767.0f ? 32767.0f : (s < -32768.0f ? -32768.0f : s);
+    pcm[i] = static_cast<int16_t>(lrintf(s));
+  }
+  dataBytes += count * 2;
+  return fwrite(pcm.data(), 2, count, file) == count;
+}
+
+bool WavWriter::close() {
+  if (file == nullptr) {
+    return true;
+  }
+  const uint32_t data = dataBytes > 0xFFFFFFF0u ? 0xFFFFFFFFu : static_cast<uint32_t>(dataBytes);
+  const uint32_t riff = data == 0xFFFFFFFFu ? data : data + 36;
+  bool ok = fseek(file, 4, SEEK_SET) == 0 && fwrite(&riff, 4, 1, file) == 1 && fseek(file, 40, SEEK_SET) == 0 &&
+            fwrite(&data, 4, 1, file) == 1;
+  ok = fclose(file) == 0 && ok;
+  file = nullptr;
+  return ok;
+}
@@ -0,0 +1,71 @@
+#ifndef WAV_IO_H
+#define WAV_IO_H
+
+// Streaming WAV input and output for the click-analysis tools.
+//
+// WavReader reads 8/16/24/32-bit integer PCM and 32-bit float files, plain or
+// WAVE_FORMAT_EXTENSIBLE, from a file or from stdin ("-"). It never seeks, so
+// piped recordings work, and a data chunk whose size is 0 or 0xFFFFFFFF (as
+// written by recorders that stream to a pipe) is read to the end of input.
+// Multichannel input is mixed down to mono.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <string>
+#include <vector>
+
+class WavReader {
+ public:
+  WavReader() = default;
+  ~WavReader();
+  WavReader(const WavReader&) = delete;
+  WavReader& operator=(const WavReader&) = delete;
+
+  // Opens `path` ("-" for stdin) and parses the header up to the sample data
+  bool open(const char* path);
+  void close();
+
+  int sampleRate() const { return rate; }
+  int channels() const { return channelCount; }
+  const std::string& error() const { return message; }
+
+  // Reads up to `frames` frames as mono floats in [-1, 1); 0 at the end
+  size_t read(float* out, size_t frames);
+
+ private:
+  bool fail(const char* what);
+  bool readExact(void* data, size_t size);
+  bool skip(uint32_t size);
+
+  FILE* file = nullptr;
+  bool ownsFile = false;
+  int rate = 0;
+  int channelCount = 0;
+  int bytesPerSample = 0;
+  bool isFloat = false;
+  uint64_t dataRemaining = 0;  // Bytes; UINT64_MAX when read to the end of input
+  std::vector<uint8_t> raw;
+  std::string message;
+};
+
+// Writes a mono 16-bit PCM file as samples arrive; the header is patched on close()
+class WavWriter {
+ public:
+  WavWriter() = default;
+  ~WavWriter();
+  WavWriter(const WavWriter&) = delete;
+  WavWriter& operator=(const WavWriter&) = delete;
+
+  bool open(const char* path, int sampleRate);
+  bool write(const float* samples, size_t count);
+  bool close();
+
+ private:
+  FILE* file = nullptr;
+  uint64_t dataBytes = 0;
+  std::vector<int16_t> pcm;
+};
+
+#endif // WAV_IO_H
@@ -0,0 +1,108 @@
+#include "work_stealing_pool.h"
+
+#include <utility>
+
+using Clock = std::chrono::steady_clock;
+
+WorkStealingPool::WorkStealingPool(unsigned workers) {
+  for (unsigned w = 0; w < (workers > 0 ? workers : 1); w++) {
+    shares.push_back(std::make_unique<Share>());
+  }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+  wait();
+}
+
+void WorkStealingPool::start(size_t count, Task work) {
+  wait();
+  task = std::move(work);
+  const size_t n = shares.size();
+  for (size_t w = 0; w < n; w++) {
+    shares[w]->next = count * w / n;
+    shares[w]->end = count * (w + 1) / n;
+  }
+  workerStats.assign(n, WorkerStats());
+  started = Clock::now();
+  for (unsigned w = 0; w < n; w++) {
+    threads.emplace_back(&WorkStealingPool::work, this, w);
+  }
+}
+
+double WorkStealingPool::wait() {
+  if (threads.empty()) {
+    return 0;
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  threads.clear();
+  const double seconds = std::chrono::duration<double>(Clock::now() - started).count();
+  for (WorkerStats& stats : workerStats) {
+    stats.idleSeconds = seconds > stats.busySeconds ? seconds - stats.busySeconds : 0;
+  }
+  return seconds;
+}
+
+void WorkStealingPool::work(unsigned worker) {
+  WorkerStats& stats = workerStats[worker];
+  size_t index;
+  while (take(worker, index) || steal(worker, index)) {
+    const Clock::time_point begin = Clock::now();
+    task(index, worker);
+    stats.busySeconds += std::chrono::duration<double>(Clock::now() - begin).count();
+    stats.tasks++;
+  }
+}
+
+bool WorkStealingPool::take(unsigned worker, size_t& index) {
+  Share& share = *shares[worker];
+  std::lock_guard<std::mutex> guard(share.lock);
+  if (share.next == share.end) {
+    return false;
+  }
+  index = share.next++;
+  return true;
+}
+
+// Runs the first stolen task itself, so no other thief can take it from the
+// new share before this worker gets to it
+bool WorkStealingPool::steal(unsigned worker, size_t& index) {
+  // Keep trying while anyone has work left: a victim may empty between the
+  // scan and the lock
+  for (;;) {
+    size_t victim = shares.size();
+    size_t most = 0;
+    for (size_t w = 0; w < shares.size(); w++) {
+      if (w == worker) {
+        continue;
+      }
+      std::lock_guard<std::mutex> guard(shares[w]->lock);
+      if (shares[w]->end - shares[w]->next > most) {
+        most = shares[w]->end - shares[w]->next;
+        victim = w;
+      }
+    }
+    if (victim == shares.size()) {
+      return false;
+    }
+    size_t first, last;
+    {
+      // The back half; a single task left goes to the thief, as its owner is busy
+      std::lock_guard<std::mutex> guard(shares[victim]->lock);
+      Share& share = *shares[victim];
+      if (share.next == share.end) {
+        continue;
+      }
+      last = share.end;
+      first = share.end - (share.end - share.next + 1) / 2;
+      share.end = first;
+    }
+    index = first;
+    std::lock_guard<std::mutex> guard(shares[worker]->lock);
+    shares[worker]->next = first + 1;
+    shares[worker]->end = last;
+    workerStats[worker].steals++;
+    return true;
+  }
+}
@@ -0,0 +1,70 @@
+#ifndef WORK_STEALING_POOL_H
+#define WORK_STEALING_POOL_H
+
+// Work-stealing thread pool for batch jobs over a fixed list of tasks.
+//
+// start() numbers the tasks 0..count-1 and gives each worker a contiguous
+// share. A worker runs its share from the front, so neighbouring tasks (the
+// chunks of one session) stay on one core and results come out roughly in
+// task order. A worker whose share runs dry steals the back half of the
+// largest remaining share, so a slow session spreads over every worker
+// instead of holding up the batch. Shares are index ranges behind one mutex
+// per worker: taking a task is a lock and an increment, which is nothing next
+// to a task that processes seconds of audio.
+//
+// The caller's thread is free between start() and wait(), e.g. to write
+// results in task order as they complete.
+
+#include <stddef.h>
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct WorkerStats {
+  size_t tasks = 0;
+  size_t steals = 0;
+  double busySeconds = 0;  // Running tasks
+  double idleSeconds = 0;  // Looking for work or out of it, until the batch ended
+};
+
+class WorkStealingPool {
+ public:
+  // task(index, worker) runs once for every index
+  using Task = std::function<void(size_t, unsigned)>;
+
+  explicit WorkStealingPool(unsigned workers);
+  ~WorkStealingPool();
+  WorkStealingPool(const WorkStealingPool&) = delete;
+  WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+  unsigned workers() const { return static_cast<unsigned>(shares.size()); }
+
+  void start(size_t count, Task task);
+  // Blocks until every task has run; returns the batch's wall time
+  double wait();
+
+  const std::vector<WorkerStats>& stats() const { return workerStats; }
+
+ private:
+  struct Share {
+    std::mutex lock;
+    size_t next = 0;
+    size_t end = 0;
+  };
+
+  void work(unsigned worker);
+  bool take(unsigned worker, size_t& index);
+  bool steal(unsigned worker, size_t& index);
+
+  std::vector<std::unique_ptr<Share>> shares;
+  std::vector<std::thread> threads;
+  std::vector<WorkerStats> workerStats;
+  Task task;
+  std::chrono::steady_clock::time_point started;
+};
+
+#endif // WORK_STEALING_POOL_H
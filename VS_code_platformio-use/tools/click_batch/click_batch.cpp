@@ -0,0 +1,440 @@
+// Batch feature extraction over a catalogue of session archives, on every core.
+//
+//   pio run -e click_batch
+//   .pio/build/click_batch/program ARCHIVE... [--list FILE] [--out FEATURES.cols] [options]
+//   .pio/build/click_batch/program ARCHIVE... --scaling [--threads N] [options]
+//   .pio/build/click_batch/program --dump FEATURES.cols
+//
+// Options:
+//   --list FILE       also read archive paths from FILE, one per line
+//   --out FILE        features of every click as a columnar file
+//                     (tools/click_analysis/feature_columns.h)
+//   --threads N       workers (default: one per core)
+//   --chunk SECONDS   audio per task (default 30)
+//   --highpass HZ, --on-ratio R, --off-ratio R, --fft N   as for click_extract
+//   --scaling         run the whole batch with 1, 2, 4 ... N workers and
+//                     report throughput, speedup and per-worker idle time
+//
+// This re-runs the click pipeline over the audio of archives written by
+// click_extract --archive, for when the detector or the feature set changes.
+// Each session is cut into chunks of about --chunk seconds, every cut midway
+// between two clicks of the archive's index, so no click spans a cut. A chunk
+// starts its filter and noise floor afresh one settle time (settleMs) before
+// its first sample and keeps only the clicks whose onset falls inside it, and
+// runs past its end while a click is open. Its clicks therefore depend only on
+// the archive and the options, never on which worker ran it or when: chunks
+// run on a work-stealing pool (tools/click_analysis/work_stealing_pool.h), the
+// main thread writes their rows in chunk order as they complete, one row group
+// per session, and the file is the same byte for byte for any thread count.
+// Each row also carries the beat and kind of the archived click at the same
+// onset (within 3 ms), or -1 and 0 when the archive has none there.
+
+#include "click_pipeline.h"
+#include "feature_columns.h"
+#include "session_archive.h"
+#include "work_stealing_pool.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+constexpr size_t BLOCK_SAMPLES = 8192;
+constexpr double MATCH_TOLERANCE_SECONDS = 0.003;  // Detected onset to archived click
+constexpr int FEATURE_VALUES = 7 + CLICK_BAND_COUNT;  // The float fields of ClickFeatures
+
+struct Options {
+  std::vector<std::string> paths;
+  const char* outPath = nullptr;
+  const char* dumpPath = nullptr;
+  unsigned threads = 0;
+  double chunkSeconds = 30;
+  bool scaling = false;
+  ClickPipelineConfig config;
+};
+
+// A run of one session's audio; `last` marks the session's final chunk
+struct BatchChunk {
+  uint32_t session;
+  bool last;
+  uint64_t begin;
+  uint64_t end;
+};
+
+// Rows in column order: the layout of the output file
+struct FeatureTable {
+  std::vector<uint32_t> session;
+  std::vector<uint64_t> onset;
+  std::vector<double> time;
+  std::vector<int32_t> beat;
+  std::vector<uint8_t> kind;
+  std::vector<float> values[FEATURE_VALUES];
+
+  static std::vector<FeatureColumn> columns() {
+    static const char* const names[FEATURE_VALUES] = {
+        "peak",  "duration_ms", "rms",   "skewness", "kurtosis", "centroid_hz", "rolloff_hz", "band0",
+        "band1", "band2",       "band3", "band4",    "band5",    "band6",       "band7"};
+    std::vector<FeatureColumn> layout = {featureColumn("session", COLUMN_U32), featureColumn("onset", COLUMN_U64),
+                                         featureColumn("time_s", COLUMN_F64), featureColumn("beat", COLUMN_I32),
+                                         featureColumn("kind", COLUMN_U8)};
+    for (const char* name : names) {
+      layout.push_back(featureColumn(name, COLUMN_F32));
+    }
+    return layout;
+  }
+
+  size_t rows() const { return onset.size(); }
+
+  void add(uint32_t s, const Click& click, const ClickFeatures& f, const ArchiveClick* match) {
+    const float fields[FEATURE_VALUES] = {f.peak,     f.durationMs, f.rms,      f.skewness, f.kurtosis,
+                                          f.centroidHz, f.rolloffHz, f.bands[0], f.bands[1], f.bands[2],
+                                          f.bands[3], f.bands[4],   f.bands[5], f.bands[6], f.bands[7]};
+    session.push_back(s);
+    onset.push_back(click.onset);
+    time.push_back(f.timeSeconds);
+    beat.push_back(match != nullptr ? match->beat : -1);
+    kind.push_back(match != nullptr ? match->kind : static_cast<uint8_t>(CLICK_UNKNOWN));
+    for (int v = 0; v < FEATURE_VALUES; v++) {
+      values[v].push_back(fields[v]);
+    }
+  }
+
+  void append(const FeatureTable& other) {
+    const auto extend = [](auto& to, const auto& from) { to.insert(to.end(), from.begin(), from.end()); };
+    extend(session, other.session);
+    extend(onset, other.onset);
+    extend(time, other.time);
+    extend(beat, other.beat);
+    extend(kind, other.kind);
+    for (int v = 0; v < FEATURE_VALUES; v++) {
+      extend(values[v], other.values[v]);
+    }
+  }
+
+  std::vector<const void*> pointers() const {
+    std::vector<const void*> p = {session.data(), onset.data(), time.data(), beat.data(), kind.data()};
+    for (const std::vector<float>& v : values) {
+      p.push_back(v.data());
+    }
+    return p;
+  }
+};
+
+struct BatchResult {
+  double wall = 0;
+  uint64_t rows = 0;
+  uint64_t checksum = 0;
+  std::vector<WorkerStats> workers;
+};
+
+static int usage(const char* program) {
+  std::fprintf(stderr,
+               "usage: %s ARCHIVE... [--list FILE] [--out FEATURES.cols] [--threads N] [--chunk SECONDS]\n"
+               "          [--highpass HZ] [--on-ratio R] [--off-ratio R] [--fft N] [--scaling]\n"
+               "       %s --dump FEATURES.cols\n",
+               program, program);
+  return 2;
+}
+
+static bool readList(const char* path, std::vector<std::string>& paths) {
+  FILE* list = std::fopen(path, "r");
+  if (list == nullptr) {
+    std::perror(path);
+    return false;
+  }
+  char line[4096];
+  while (std::fgets(line, sizeof(line), list) != nullptr) {
+    line[std::strcspn(line, "\r\n")] = '\0';
+    if (line[0] != '\0' && line[0] != '#') {
+      paths.push_back(line);
+    }
+  }
+  std::fclose(list);
+  return true;
+}
+
+// Cuts a session about every `target` samples, midway in the gap between two
+// indexed clicks; a session without clicks is one chunk
+static void planChunks(const SessionArchive& archive, uint32_t session, uint64_t target,
+                       std::vector<BatchChunk>& chunks) {
+  uint64_t begin = 0;
+  for (size_t i = 1; i < archive.clickCount(); i++) {
+    const ArchiveClick& before = archive.click(i - 1);
+    const ArchiveClick& after = archive.click(i);
+    const uint64_t gap = before.start + before.samples;
+    if (after.start < begin + target || after.start <= gap) {
+      continue;
+    }
+    const uint64_t cut = gap + (after.start - gap) / 2;
+    chunks.push_back({session, false, begin, cut});
+    begin = cut;
+  }
+  chunks.push_back({session, true, begin, archive.totalSamples()});
+}
+
+// The archived click within MATCH_TOLERANCE_SECONDS of `onset`, or nullptr
+static const ArchiveClick* archivedClick(const SessionArchive& archive, uint64_t onset) {
+  const uint64_t tolerance = static_cast<uint64_t>(MATCH_TOLERANCE_SECONDS * archive.header().sampleRate);
+  const ArchiveClick* best = nullptr;
+  for (size_t i = archive.findClick(onset > tolerance ? onset - tolerance : 0);
+       i < archive.clickCount() && archive.click(i).onset <= onset + tolerance; i++) {
+    const ArchiveClick& c = archive.click(i);
+    if (best == nullptr || (c.onset > onset ? c.onset - onset : onset - c.onset) <
+                               (best->onset > onset ? best->onset - onset : onset - best->onset)) {
+      best = &c;
+    }
+  }
+  return best;
+}
+
+static void processChunk(const SessionArchive& archive, const BatchChunk& chunk, const ClickPipelineConfig& config,
+                         std::vector<float>& scratch, FeatureTable& rows) {
+  const float rate = static_cast<float>(archive.header().sampleRate);
+  const uint64_t total = archive.totalSamples();
+  const uint64_t lead = static_cast<uint64_t>(config.segmenter.settleMs * 1e-3f * rate);
+  const uint64_t from = chunk.begin > lead ? chunk.begin - lead : 0;
+  if (from >= total) {
+    return;
+  }
+  const int16_t* pcm = archive.samples(from, total - from);
+  ClickPipeline pipeline(rate, config);
+  pipeline.restart(from, pcm[0] / 32768.0f, static_cast<uint32_t>(chunk.begin > 0 ? chunk.begin - from : lead));
+  const auto keep = [&](const Click& click, const ClickFeatures& features) {
+    if (click.onset >= chunk.begin && click.onset < chunk.end) {
+      rows.add(chunk.session, click, features, archivedClick(archive, click.onset));
+    }
+  };
+
+  scratch.resize(BLOCK_SAMPLES);
+  uint64_t at = from;
+  while (at < total && (at < chunk.end || pipeline.active())) {
+    // Past the end only a block at a time, until the open click closes
+    const uint64_t stop = at < chunk.end ? std::min<uint64_t>(chunk.end, at + BLOCK_SAMPLES) : at + SEGMENT_BLOCK;
+    const size_t n = static_cast<size_t>(std::min(stop, total) - at);
+    const int16_t* x = pcm + (at - from);
+    for (size_t i = 0; i < n; i++) {
+      scratch[i] = x[i] / 32768.0f;
+    }
+    pipeline.process(scratch.data(), n, keep);
+    at += n;
+  }
+  if (at == total) {
+    pipeline.finish(keep);
+  }
+}
+
+static bool runBatch(const std::vector<SessionArchive>& catalogue, const std::vector<BatchChunk>& chunks,
+                     const ClickPipelineConfig& config, unsigned threads, const char* outPath, BatchResult& result) {
+  FeatureColumnWriter writer;
+  if (!writer.open(outPath, FeatureTable::columns())) {
+    std::perror(outPath);
+    return false;
+  }
+  std::vector<FeatureTable> tables(chunks.size());
+  std::vector<char> done(chunks.size(), 0);
+  std::vector<std::vector<float>> scratch(threads);
+  std::mutex lock;
+  std::condition_variable finished;
+
+  WorkStealingPool pool(threads);
+  pool.start(chunks.size(), [&](size_t index, unsigned worker) {
+    const BatchChunk& chunk = chunks[index];
+    processChunk(catalogue[chunk.session], chunk, config, scratch[worker], tables[index]);
+    std::lock_guard<std::mutex> guard(lock);
+    done[index] = 1;
+    finished.notify_one();
+  });
+
+  // Rows leave in chunk order whatever order the chunks finish in
+  bool ok = true;
+  FeatureTable group;
+  for (size_t index = 0; index < chunks.size(); index++) {
+    {
+      std::unique_lock<std::mutex> guard(lock);
+      finished.wait(guard, [&] { return done[index] != 0; });
+    }
+    group.append(tables[index]);
+    tables[index] = FeatureTable();
+    if (chunks[index].last) {
+      ok = writer.writeGroup(group.pointers().data(), group.rows()) && ok;
+      group = FeatureTable();
+    }
+  }
+  result.wall = pool.wait();
+  result.workers = pool.stats();
+  ok = writer.close() && ok;
+  result.rows = writer.rows();
+  result.checksum = writer.checksum();
+  if (!ok) {
+    std::fprintf(stderr, "%s: write failed\n", outPath);
+  }
+  return ok;
+}
+
+static void printWorkers(const BatchResult& result) {
+  for (size_t w = 0; w < result.workers.size(); w++) {
+    const WorkerStats& s = result.workers[w];
+    std::fprintf(stderr, "  worker %2zu  %5zu chunks  %3zu steals  busy %7.3f s  idle %7.3f s (%4.1f%%)\n", w, s.tasks,
+                 s.steals, s.busySeconds, s.idleSeconds, result.wall > 0 ? 100.0 * s.idleSeconds / result.wall : 0.0);
+  }
+}
+
+static double audioSeconds(const std::vector<SessionArchive>& catalogue) {
+  uint64_t samples = 0;
+  for (const SessionArchive& archive : catalogue) {
+    samples += archive.totalSamples();
+  }
+  return catalogue.empty() ? 0 : static_cast<double>(samples) / catalogue[0].header().sampleRate;
+}
+
+static int scaling(const std::vector<SessionArchive>& catalogue, const std::vector<BatchChunk>& chunks,
+                   const Options& options, unsigned maxThreads) {
+  std::vector<unsigned> counts;
+  for (unsigned n = 1; n < maxThreads; n *= 2) {
+    counts.push_back(n);
+  }
+  counts.push_back(maxThreads);
+
+  // An untimed pass first, so every run reads the archives from the page cache
+  BatchResult warm;
+  if (!runBatch(catalogue, chunks, options.config, maxThreads, nullptr, warm)) {
+    return 1;
+  }
+  std::fprintf(stderr, "threads   wall s   x realtime  clicks/s  speedup  efficiency  idle mean/max  steals  checksum\n");
+  double single = 0;
+  bool same = true;
+  for (unsigned n : counts) {
+    BatchResult result;
+    if (!runBatch(catalogue, chunks, options.config, n, n == maxThreads ? options.outPath : nullptr, result)) {
+      return 1;
+    }
+    single = n == 1 ? result.wall : single;
+    double idleSum = 0, idleMax = 0;
+    size_t steals = 0;
+    for (const WorkerStats& s : result.workers) {
+      idleSum += s.idleSeconds;
+      idleMax = std::max(idleMax, s.idleSeconds);
+      steals += s.steals;
+    }
+    const double speedup = single / result.wall;
+    same = same && result.checksum == warm.checksum;
+    std::fprintf(stderr, "%7u %8.3f %12.0f %9.0f %8.2f %10.0f%% %6.1f%%/%4.1f%% %7zu  %016llx%s\n", n, result.wall,
+                 audioSeconds(catalogue) / result.wall, result.rows / result.wall, speedup,
+                 100.0 * speedup / n, 100.0 * idleSum / n / result.wall, 100.0 * idleMax / result.wall, steals,
+                 static_cast<unsigned long long>(result.checksum), result.checksum == warm.checksum ? "" : "  DIFFERS");
+    if (n == maxThreads) {
+      printWorkers(result);
+    }
+  }
+  std::fprintf(stderr, "output %s for every thread count\n", same ? "identical" : "NOT identical");
+  return same ? 0 : 1;
+}
+
+static int dump(const char* path) {
+  FeatureColumnReader reader;
+  if (!reader.open(path)) {
+    std::fprintf(stderr, "%s: %s\n", path, reader.error().c_str());
+    return 1;
+  }
+  const std::vector<FeatureColumn>& columns = reader.columns();
+  std::vector<std::vector<double>> values(columns.size());
+  for (size_t c = 0; c < columns.size(); c++) {
+    if (!reader.read(c, values[c])) {
+      std::fprintf(stderr, "%s: cannot read column %s\n", path, columns[c].name);
+      return 1;
+    }
+    std::printf("%s%s", c > 0 ? "," : "", columns[c].name);
+  }
+  std::printf("\n");
+  for (uint64_t r = 0; r < reader.rows(); r++) {
+    for (size_t c = 0; c < columns.size(); c++) {
+      std::printf(columns[c].type == COLUMN_F32 || columns[c].type == COLUMN_F64 ? "%s%.6g" : "%s%.0f",
+                  c > 0 ? "," : "", values[c][r]);
+    }
+    std::printf("\n");
+  }
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  Options options;
+  ClickPipelineConfig& config = options.config;
+  for (int i = 1; i < argc; i++) {
+    const bool hasValue = i + 1 < argc;
+    if (std::strcmp(argv[i], "--list") == 0 && hasValue) {
+      if (!readList(argv[++i], options.paths)) {
+        return 1;
+      }
+    } else if (std::strcmp(argv[i], "--out") == 0 && hasValue) {
+      options.outPath = argv[++i];
+    } else if (std::strcmp(argv[i], "--dump") == 0 && hasValue) {
+      options.dumpPath = argv[++i];
+    } else if (std::strcmp(argv[i], "--threads") == 0 && hasValue) {
+      options.threads = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+    } else if (std::strcmp(argv[i], "--chunk") == 0 && hasValue) {
+      options.chunkSeconds = std::strtod(argv[++i], nullptr);
+    } else if (std::strcmp(argv[i], "--highpass") == 0 && hasValue) {
+      config.highPassHz = std::strtof(argv[++i], nullptr);
+    } else if (std::strcmp(argv[i], "--on-ratio") == 0 && hasValue) {
+      config.segmenter.onRatio = std::strtof(argv[++i], nullptr);
+    } else if (std::strcmp(argv[i], "--off-ratio") == 0 && hasValue) {
+      config.segmenter.offRatio = std::strtof(argv[++i], nullptr);
+    } else if (std::strcmp(argv[i], "--fft") == 0 && hasValue) {
+      config.fftSize = std::strtoul(argv[++i], nullptr, 10);
+    } else if (std::strcmp(argv[i], "--scaling") == 0) {
+      options.scaling = true;
+    } else if (argv[i][0] != '-') {
+      options.paths.push_back(argv[i]);
+    } else {
+      return usage(argv[0]);
+    }
+  }
+  if (options.dumpPath != nullptr) {
+    return options.paths.empty() ? dump(options.dumpPath) : usage(argv[0]);
+  }
+  // A chunk must be longer than its settle lead-in to be worth cutting
+  if (options.paths.empty() || options.chunkSeconds < 2 * config.segmenter.settleMs * 1e-3f || config.fftSize < 16 ||
+      (config.fftSize & (config.fftSize - 1)) != 0) {
+    return usage(argv[0]);
+  }
+  const unsigned threads =
+      options.threads > 0 ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+
+  std::vector<SessionArchive> catalogue(options.paths.size());
+  std::vector<BatchChunk> chunks;
+  for (size_t k = 0; k < catalogue.size(); k++) {
+    if (!catalogue[k].open(options.paths[k].c_str())) {
+      std::fprintf(stderr, "%s: %s\n", options.paths[k].c_str(), catalogue[k].error().c_str());
+      return 1;
+    }
+    if (catalogue[k].header().sampleRate != catalogue[0].header().sampleRate) {
+      std::fprintf(stderr, "%s: sample rate differs from the rest of the catalogue\n", options.paths[k].c_str());
+      return 1;
+    }
+    // Sequential now: chunks read their audio front to back
+    catalogue[k].adviseSequential();
+    planChunks(catalogue[k], static_cast<uint32_t>(k),
+               static_cast<uint64_t>(options.chunkSeconds * catalogue[k].header().sampleRate), chunks);
+  }
+  std::fprintf(stderr, "catalogue %zu sessions, %.1f h of audio in %zu chunks, %u workers\n", catalogue.size(),
+               audioSeconds(catalogue) / 3600, chunks.size(), threads);
+
+  if (options.scaling) {
+    return scaling(catalogue, chunks, options, threads);
+  }
+  BatchResult result;
+  if (!runBatch(catalogue, chunks, config, threads, options.outPath, result)) {
+    return 1;
+  }
+  const double seconds = audioSeconds(catalogue);
+  std::fprintf(stderr, "%llu clicks in %.3f s: %.0f clicks/s, %.0fx real time\n",
+               static_cast<unsigned long long>(result.rows), result.wall, result.rows / result.wall,
+               seconds / result.wall);
+  printWorkers(result);
+  return 0;
+}
@@ -0,0 +1,497 @@
+// Valve-click feature extractor for microphone recordings of the blood loop.
+//
+//   pio run -e click_extract
+//   .pio/build/click_extract/program RECORDING.wav|- [--session FILE] [options]
+//   .pio/build/click_extract/program --synth SECONDS [--dull-from SECONDS] [--knocks RATE] [--gate]
+//                                    [--write-wav OUT.wav] [--write-session OUT.txt] [options]
+//   .pio/build/click_extract/program --synth SECONDS --compare [synth options]
+//
+// Options:
+//   --csv FILE        one row of features per click ("-" for stdout)
+//   --highpass HZ     high-pass cutoff (default 150)
+//   --on-ratio R      click threshold over the noise floor (default 6)
+//   --off-ratio R     level that keeps a click open (default 2)
+//   --fft N           spectrum size, a power of two (default 1024)
+//   --bench           per-stage cost
+//   --session FILE    listen only around the motor reversals logged in a
+//                     pump_link session file (tools/click_analysis/phase_gate.h)
+//   --window MS       half-width of each listening window (default 10)
+//   --archive OUT     also pack the audio and click index into a session
+//                     archive (tools/click_analysis/session_archive.h)
+//   --variant NAME, --profile NAME, --ramps SA,SF,DA,DF, --note TEXT
+//                     run configuration stored in the archive; heart rate,
+//                     stroke and runtime come from --session when given
+//
+// --synth runs the pipeline on a synthetic session (tools/click_analysis/
+// click_synth.h) instead of a recording; --write-wav also saves that audio and
+// --write-session the reversals its rig would have logged. --knocks adds that
+// many pump knocks per second, --gate listens only around the synthetic
+// reversals, and --compare runs the session ungated and then gated and scores
+// both against the clicks the synthesiser placed.
+// The summary on stderr gives clicks per second and the real-time factor of
+// the pipeline (audio seconds processed per second of one core), and the mean
+// features of the first and last 100 clicks.
+
+#include "click_pipeline.h"
+#include "click_synth.h"
+#include "phase_gate.h"
+#include "session_archive.h"
+#include "wav_io.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <utility>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t CHUNK_FRAMES = 4096;
+constexpr size_t SUMMARY_CLICKS = 100;  // Clicks averaged at each end of the session
+constexpr double SCORE_TOLERANCE_SECONDS = 0.003;  // Detected onset to synthesised click
+
+struct Summary {
+  double peak = 0, centroid = 0, rolloff = 0, kurtosis = 0;
+  size_t count = 0;
+
+  void add(const ClickFeatures& f) {
+    peak += f.peak;
+    centroid += f.centroidHz;
+    rolloff += f.rolloffHz;
+    kurtosis += f.kurtosis;
+    count++;
+  }
+
+  void print(const char* label) const {
+    if (count == 0) {
+      return;
+    }
+    std::fprintf(stderr, "  %-10s peak %.4f  centroid %6.0f Hz  rolloff %6.0f Hz  kurtosis %5.2f  (%zu clicks)\n", label,
+                 peak / count, centroid / count, rolloff / count, kurtosis / count, count);
+  }
+};
+
+// Detected clicks against the synthesiser's; both arrive in stream order
+struct Score {
+  uint64_t hits = 0, falseClicks = 0, missed = 0;
+  size_t nextTruth = 0;
+
+  void add(const std::vector<uint64_t>& truth, uint64_t onset, float sampleRate) {
+    const double tolerance = SCORE_TOLERANCE_SECONDS * sampleRate;
+    while (nextTruth < truth.size() && truth[nextTruth] + tolerance < onset) {
+      nextTruth++;
+      missed++;
+    }
+    if (nextTruth < truth.size() && static_cast<double>(truth[nextTruth]) <= onset + tolerance) {
+      nextTruth++;
+      hits++;
+    } else {
+      falseClicks++;
+    }
+  }
+
+  // Counts the clicks left over once the stream has ended at sample `end`
+  void finish(const std::vector<uint64_t>& truth, uint64_t end) {
+    for (; nextTruth < truth.size() && truth[nextTruth] < end; nextTruth++) {
+      missed++;
+    }
+  }
+};
+
+struct Options {
+  const char* input = nullptr;
+  const char* csvPath = nullptr;
+  const char* wavOut = nullptr;
+  const char* sessionIn = nullptr;
+  const char* sessionOut = nullptr;
+  const char* archivePath = nullptr;
+  ArchiveRunConfig run{};
+  bool bench = false;
+  bool gate = false;
+  bool compare = false;
+  double synthSeconds = 0;
+  SynthConfig synth;
+  ClickPipelineConfig config;
+  GateConfig gateConfig;
+};
+
+struct RunResult {
+  float sampleRate = 0;
+  StageTimes times;
+  uint64_t audioSamples = 0;
+  double wall = 0;
+  double sourceSeconds = 0;
+  bool gated = false;
+  GateStats gate;
+  double driftPpm = 0;
+  double lagMs = 0;
+  Score score;
+  Summary first, last;
+};
+
+static int usage(const char* program) {
+  std::fprintf(stderr,
+               "usage: %s RECORDING.wav|- [--session FILE] [--window MS] [--csv FILE] [--highpass HZ] [--on-ratio R]\n"
+               "          [--off-ratio R] [--fft N] [--bench]\n"
+               "          [--archive OUT [--variant NAME] [--profile NAME] [--ramps SA,SF,DA,DF] [--note TEXT]]\n"
+               "       %s --synth SECONDS [--dull-from SECONDS] [--knocks RATE] [--gate] [--write-wav OUT.wav]\n"
+               "          [--write-session OUT.txt] [options]\n"
+               "       %s --synth SECONDS --compare [synth options]\n",
+               program, program, program);
+  return 2;
+}
+
+// Ties an archived click to its reversal and beat; returns the beat's start
+// sample, or false when the click answers no reversal
+static bool describeMatch(const ClickPipeline&, ArchiveClick&, uint64_t&) {
+  return false;
+}
+
+static bool describeMatch(const GatedClickPipeline& pipeline, ArchiveClick& click, uint64_t& beatStart) {
+  const long matched = pipeline.matchedReversal();
+  if (matched < 0) {
+    return false;
+  }
+  size_t opening = static_cast<size_t>(matched);
+  while (opening > 0 && !pipeline.reversal(opening).clockwise) {
+    opening--;
+  }
+  click.beat = static_cast<int32_t>(pipeline.beatOf(static_cast<size_t>(matched)));
+  click.kind = pipeline.reversal(static_cast<size_t>(matched)).clockwise ? CLICK_OPENING : CLICK_CLOSURE;
+  beatStart = pipeline.predictedSample(opening);
+  return true;
+}
+
+// Streams the whole source through one pipeline; returns false on an I/O error
+template <typename Pipeline>
+static bool runPipeline(Pipeline& pipeline, const Options& options, WavReader& reader, ClickSynth& synthesizer,
+                        FILE* csv, RunResult& result) {
+  WavWriter writer;
+  const float sampleRate = result.sampleRate;
+  if (options.wavOut != nullptr && !writer.open(options.wavOut, static_cast<int>(sampleRate))) {
+    std::perror(options.wavOut);
+    return false;
+  }
+  SessionArchiveWriter archive;
+  if (options.archivePath != nullptr && !archive.open(options.archivePath, static_cast<uint32_t>(sampleRate), options.run)) {
+    std::perror(options.archivePath);
+    return false;
+  }
+  std::deque<ClickFeatures> recent;
+  char line[256];
+  const auto sink = [&](const Click& click, const ClickFeatures& features) {
+    if (csv != nullptr) {
+      formatClickFeaturesCsv(features, line, sizeof(line));
+      std::fputs(line, csv);
+      std::fputc('\n', csv);
+    }
+    if (options.input == nullptr) {
+      result.score.add(synthesizer.valveClicks(), click.onset, sampleRate);
+    }
+    if (options.archivePath != nullptr) {
+      ArchiveClick entry{};
+      entry.start = click.start;
+      entry.onset = click.onset;
+      entry.samples = static_cast<uint32_t>(click.samples.size());
+      entry.beat = -1;
+      entry.peak = features.peak;
+      entry.noiseFloor = click.noiseFloor;
+      uint64_t beatStart;
+      if (describeMatch(pipeline, entry, beatStart)) {
+        archive.addBeat(static_cast<uint32_t>(entry.beat), beatStart);
+      }
+      archive.addClick(entry);
+    }
+    if (result.first.count < SUMMARY_CLICKS) {
+      result.first.add(features);
+    }
+    recent.push_back(features);
+    if (recent.size() > SUMMARY_CLICKS) {
+      recent.pop_front();
+    }
+  };
+
+  std::vector<float> chunk(CHUNK_FRAMES);
+  const Clock::time_point start = Clock::now();
+  for (;;) {
+    const Clock::time_point read = Clock::now();
+    const size_t got = options.input != nullptr ? reader.read(chunk.data(), chunk.size())
+                                                : synthesizer.generate(chunk.data(), chunk.size());
+    if (options.wavOut != nullptr) {
+      writer.write(chunk.data(), got);
+    }
+    if (options.archivePath != nullptr) {
+      archive.write(chunk.data(), got);
+    }
+    result.sourceSeconds += std::chrono::duration<double>(Clock::now() - read).count();
+    if (got == 0) {
+      break;
+    }
+    result.audioSamples += got;
+    pipeline.process(chunk.data(), got, sink);
+  }
+  pipeline.finish(sink);
+  result.wall = std::chrono::duration<double>(Clock::now() - start).count();
+  result.times = pipeline.times();
+  if (options.input == nullptr) {
+    result.score.finish(synthesizer.valveClicks(), result.audioSamples);
+  }
+  for (const ClickFeatures& f : recent) {
+    result.last.add(f);
+  }
+  if (options.wavOut != nullptr && !writer.close()) {
+    std::perror(options.wavOut);
+  }
+  if (options.archivePath != nullptr && !archive.close()) {
+    std::perror(options.archivePath);
+    return false;
+  }
+  return true;
+}
+
+// One pass over the input, gated when the options ask for it
+static bool runOnce(const Options& options, bool gated, FILE* csv, RunResult& result) {
+  WavReader reader;
+  float sampleRate = options.synth.sampleRate;
+  if (options.input != nullptr) {
+    if (!reader.open(options.input)) {
+      std::fprintf(stderr, "%s: %s\n", options.input, reader.error().c_str());
+      return false;
+    }
+    sampleRate = static_cast<float>(reader.sampleRate());
+  }
+  ClickSynth synthesizer(options.synth);
+  result.sampleRate = sampleRate;
+  result.gated = gated;
+  if (!gated) {
+    ClickPipeline pipeline(sampleRate, options.config);
+    return runPipeline(pipeline, options, reader, synthesizer, csv, result);
+  }
+
+  std::vector<RigReversal> reversals;
+  if (options.sessionIn != nullptr) {
+    FILE* session = std::fopen(options.sessionIn, "r");
+    if (session == nullptr) {
+      std::perror(options.sessionIn);
+      return false;
+    }
+    reversals = readRigReversals(session);
+    std::fclose(session);
+    if (reversals.empty()) {
+      std::fprintf(stderr, "%s: no reversal records (record with a TELEMETRY build and the PHASES class)\n",
+                   options.sessionIn);
+      return false;
+    }
+  } else {
+    reversals = synthesizer.rigReversals();
+  }
+  GatedClickPipeline pipeline(sampleRate, std::move(reversals), options.gateConfig, options.config);
+  if (!runPipeline(pipeline, options, reader, synthesizer, csv, result)) {
+    return false;
+  }
+  result.gate = pipeline.stats();
+  result.driftPpm = pipeline.fit().driftPpm();
+  result.lagMs = pipeline.fit().lagSeconds() * 1e3;
+  return true;
+}
+
+static void printResult(const Options& options, const RunResult& result) {
+  const float sampleRate = result.sampleRate;
+  const StageTimes& t = result.times;
+  const double audioSeconds = static_cast<double>(result.audioSamples) / sampleRate;
+  const double pipelineSeconds = t.filterSeconds + t.segmentSeconds + t.featureSeconds;
+  std::fprintf(stderr, "audio         %.1f s at %.0f Hz\n", audioSeconds, sampleRate);
+  std::fprintf(stderr, "clicks        %llu (%.1f per audio second)\n", static_cast<unsigned long long>(t.clicks),
+               audioSeconds > 0 ? t.clicks / audioSeconds : 0.0);
+  std::fprintf(stderr, "wall clock    %.3f s total, %.3f s in the pipeline\n", result.wall, pipelineSeconds);
+  std::fprintf(stderr, "throughput    %.0fx real time, %.0f clicks/s\n",
+               pipelineSeconds > 0 ? audioSeconds / pipelineSeconds : 0.0,
+               pipelineSeconds > 0 ? t.clicks / pipelineSeconds : 0.0);
+  if (result.gated) {
+    const GateStats& g = result.gate;
+    std::fprintf(stderr, "gate          %.1f%% of the audio filtered, %llu windows, %llu matched, %llu dropped\n",
+                 result.audioSamples > 0 ? 100.0 * t.samples / result.audioSamples : 0.0,
+                 static_cast<unsigned long long>(g.windows), static_cast<unsigned long long>(g.matched),
+                 static_cast<unsigned long long>(g.dropped));
+    std::fprintf(stderr, "rig clock     %llu acquisitions (%.1f s ungated), drift %+.1f ppm, closure lag %+.2f ms\n",
+                 static_cast<unsigned long long>(g.acquisitions), g.ungatedSamples / sampleRate, result.driftPpm,
+                 result.lagMs);
+  }
+  if (options.input == nullptr) {
+    std::fprintf(stderr, "score         %llu valve clicks found, %llu missed, %llu false\n",
+                 static_cast<unsigned long long>(result.score.hits),
+                 static_cast<unsigned long long>(result.score.missed),
+                 static_cast<unsigned long long>(result.score.falseClicks));
+  }
+  result.first.print("first");
+  result.last.print("last");
+
+  if (options.bench) {
+    const double samples = t.samples > 0 ? static_cast<double>(t.samples) : 1.0;
+    struct Row {
+      const char* name;
+      double seconds;
+    } rows[] = {
+        {options.input != nullptr ? "decode" : "synthesis", result.sourceSeconds},
+        {"high-pass", t.filterSeconds},
+        {"segment", t.segmentSeconds},
+        {"features", t.featureSeconds},
+    };
+    std::fprintf(stderr, "stage           seconds   ns/sample   share\n");
+    for (const Row& row : rows) {
+      std::fprintf(stderr, "  %-12s %9.3f %11.2f %6.1f%%\n", row.name, row.seconds, row.seconds * 1e9 / samples,
+                   result.wall > 0 ? 100.0 * row.seconds / result.wall : 0.0);
+    }
+    if (t.clicks > 0) {
+      std::fprintf(stderr, "features      %.2f us per click\n", t.featureSeconds * 1e6 / t.clicks);
+    }
+  }
+}
+
+// Ungated against gated on the same synthetic session
+static int compare(const Options& options) {
+  RunResult runs[2];
+  for (int gated = 0; gated < 2; gated++) {
+    if (!runOnce(options, gated != 0, nullptr, runs[gated])) {
+      return 1;
+    }
+  }
+  std::fprintf(stderr, "%.0f s synthetic session, %.2f knocks/s, rig clock %+.0f ppm\n", options.synth.seconds,
+               options.synth.knocksPerSecond, options.synth.rigDriftPpm);
+  std::fprintf(stderr, "              samples filtered   pipeline s   realtime   clicks    found  missed   false\n");
+  for (int gated = 0; gated < 2; gated++) {
+    const RunResult& r = runs[gated];
+    const StageTimes& t = r.times;
+    const double pipelineSeconds = t.filterSeconds + t.segmentSeconds + t.featureSeconds;
+    std::fprintf(stderr, "  %-10s %12llu %5.1f%% %11.3f %9.0fx %8llu %8llu %7llu %7llu\n", gated ? "gated" : "ungated",
+                 static_cast<unsigned long long>(t.samples),
+                 r.audioSamples > 0 ? 100.0 * t.samples / r.audioSamples : 0.0, pipelineSeconds,
+                 pipelineSeconds > 0 ? r.audioSamples / r.sampleRate / pipelineSeconds : 0.0,
+                 static_cast<unsigned long long>(t.clicks), static_cast<unsigned long long>(r.score.hits),
+                 static_cast<unsigned long long>(r.score.missed),
+                 static_cast<unsigned long long>(r.score.falseClicks));
+  }
+  const RunResult& g = runs[1];
+  std::fprintf(stderr, "gate          %llu acquisitions, drift %+.1f ppm, closure lag %+.2f ms, %llu dropped in windows\n",
+               static_cast<unsigned long long>(g.gate.acquisitions), g.driftPpm, g.lagMs,
+               static_cast<unsigned long long>(g.gate.dropped));
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  Options options;
+  ClickPipelineConfig& config = options.config;
+  SynthConfig& synth = options.synth;
+
+  for (int i = 1; i < argc; i++) {
+    const bool hasValue = i + 1 < argc;
+    if (std::strcmp(argv[i], "--csv") == 0 && hasValue) {
+      options.csvPath = argv[++i];
+    } else if (std::strcmp(argv[i], "--highpass") == 0 && hasValue) {
+      config.highPassHz = std::strtof(argv[++i], nullptr);
+    } else if (std::strcmp(argv[i], "--on-ratio") == 0 && hasValue) {
+      config.segmenter.onRatio = std::strtof(argv[++i], nullptr);
+    } else if (std::strcmp(argv[i], "--off-ratio") == 0 && hasValue) {
+      config.segmenter.offRatio = std::strtof(argv[++i], nullptr);
+    } else if (std::strcmp(argv[i], "--fft") == 0 && hasValue) {
+      config.fftSize = std::strtoul(argv[++i], nullptr, 10);
+    } else if (std::strcmp(argv[i], "--session") == 0 && hasValue) {
+      options.sessionIn = argv[++i];
+      options.gate = true;
+    } else if (std::strcmp(argv[i], "--window") == 0 && hasValue) {
+      options.gateConfig.searchMs = std::strtof(argv[++i], nullptr);
+    } else if (std::strcmp(argv[i], "--synth") == 0 && hasValue) {
+      options.synthSeconds = std::strtod(argv[++i], nullptr);
+    } else if (std::strcmp(argv[i], "--dull-from") == 0 && hasValue) {
+      synth.dullFromSeconds = std::strtod(argv[++i], nullptr);
+    } else if (std::strcmp(argv[i], "--knocks") == 0 && hasValue) {
+      synth.knocksPerSecond = std::strtof(argv[++i], nullptr);
+    } else if (std::strcmp(argv[i], "--write-wav") == 0 && hasValue) {
+      options.wavOut = argv[++i];
+    } else if (std::strcmp(argv[i], "--write-session") == 0 && hasValue) {
+      options.sessionOut = argv[++i];
+    } else if (std::strcmp(argv[i], "--archive") == 0 && hasValue) {
+      options.archivePath = argv[++i];
+    } else if (std::strcmp(argv[i], "--variant") == 0 && hasValue) {
+      setArchiveText(options.run.variant, sizeof(options.run.variant), argv[++i]);
+    } else if (std::strcmp(argv[i], "--profile") == 0 && hasValue) {
+      setArchiveText(options.run.profile, sizeof(options.run.profile), argv[++i]);
+    } else if (std::strcmp(argv[i], "--note") == 0 && hasValue) {
+      setArchiveText(options.run.note, sizeof(options.run.note), argv[++i]);
+    } else if (std::strcmp(argv[i], "--ramps") == 0 && hasValue) {
+      unsigned ramps[4];
+      if (std::sscanf(argv[++i], "%u,%u,%u,%u", &ramps[0], &ramps[1], &ramps[2], &ramps[3]) != 4) {
+        return usage(argv[0]);
+      }
+      options.run.systoleAccel = static_cast<uint16_t>(ramps[0]);
+      options.run.systoleFloor = static_cast<uint16_t>(ramps[1]);
+      options.run.diastoleAccel = static_cast<uint16_t>(ramps[2]);
+      options.run.diastoleFloor = static_cast<uint16_t>(ramps[3]);
+    } else if (std::strcmp(argv[i], "--gate") == 0) {
+      options.gate = true;
+    } else if (std::strcmp(argv[i], "--compare") == 0) {
+      options.compare = true;
+    } else if (std::strcmp(argv[i], "--bench") == 0) {
+      options.bench = true;
+    } else if (options.input == nullptr && (argv[i][0] != '-' || argv[i][1] == '\0')) {
+      options.input = argv[i];
+    } else {
+      return usage(argv[0]);
+    }
+  }
+  const bool synthetic = options.synthSeconds > 0;
+  if ((options.input != nullptr) == synthetic || config.fftSize < 16 || (config.fftSize & (config.fftSize - 1)) != 0 ||
+      (options.input != nullptr && options.gate && options.sessionIn == nullptr) ||
+      (options.compare && (!synthetic || options.sessionIn != nullptr))) {
+    return usage(argv[0]);
+  }
+  synth.seconds = options.synthSeconds;
+  if (synthetic) {
+    if (options.run.variant[0] == '\0') {
+      setArchiveText(options.run.variant, sizeof(options.run.variant), "synthetic");
+    }
+    options.run.heartRate = static_cast<uint16_t>(synth.beatsPerMinute + 0.5f);
+    options.run.runtimeSeconds = static_cast<uint32_t>(synth.seconds);
+  } else if (options.sessionIn != nullptr) {
+    FILE* session = std::fopen(options.sessionIn, "r");
+    if (session != nullptr) {
+      readSessionRun(session, options.run);
+      std::fclose(session);
+    }
+  }
+
+  if (options.sessionOut != nullptr) {
+    FILE* session = std::fopen(options.sessionOut, "w");
+    if (session == nullptr || !synthetic) {
+      std::perror(options.sessionOut);
+      return 1;
+    }
+    writeRigReversals(session, ClickSynth(synth).rigReversals());
+    std::fclose(session);
+  }
+  if (options.compare) {
+    return compare(options);
+  }
+
+  FILE* csv = nullptr;
+  if (options.csvPath != nullptr) {
+    csv = std::strcmp(options.csvPath, "-") == 0 ? stdout : std::fopen(options.csvPath, "w");
+    if (csv == nullptr) {
+      std::perror(options.csvPath);
+      return 1;
+    }
+    std::fprintf(csv, "%s\n", clickFeaturesCsvHeader());
+  }
+  RunResult result;
+  const bool ok = runOnce(options, options.gate, csv, result);
+  if (csv != nullptr && csv != stdout) {
+    std::fclose(csv);
+  }
+  if (!ok) {
+    return 1;
+  }
+  printResult(options, result);
+  return 0;
+}
@@ -0,0 +1,354 @@
+// Watches the valve clicks of a running session and stops the rig when they
+// turn atypical (tools/click_analysis/anomaly_detector.h).
+//
+//   pio run -e click_watch
+//   .pio/build/click_watch/program RECORDING.wav|- [--session FILE] [--port PORT] [options]
+//   .pio/build/click_watch/program --synth SECONDS [--dull-from SECONDS] [--knocks RATE] [--gate]
+//                                  [--port PORT] [options]
+//
+// Options:
+//   --port PORT       send COMMAND_ABORT to the rig (or pump_sim --pty) when
+//                     the detector trips, and time the rig's ramp-down
+//   --realtime        pace the input at real time, as a live microphone
+//                     would deliver it; "-" is paced by whoever writes it
+//   --baseline N      clicks of each kind learned before scoring (default 40)
+//   --threshold D     Mahalanobis distance of an atypical click (default 6)
+//   --trip N          atypical clicks of one kind in a row that trip (default 3)
+//   --max-latency MS  fail (exit 3) when click to rig at rest took longer
+//   --csv FILE        one row per scored click: time, kind, distance
+//   --session FILE, --gate, --window MS, --highpass HZ, --on-ratio R,
+//   --off-ratio R     as for click_extract
+//
+// Gating (--session for a recording, --gate for --synth) ties each click to a
+// reversal, so opening and closure clicks get their own baselines; ungated,
+// every click shares one.
+//
+// With --realtime the latency from the onset of the click that tripped the
+// detector to the rig at rest is reported in parts: detection (the click has
+// to close, plus the audio still buffered), the abort command's round trip,
+// and the ramp-down, which ends when the rig reports SHUTDOWN (no longer
+// pumping; it then returns home and holds). The firmware ramps an ACCEL phase
+// down over as many steps as it has run and lets a DECEL phase finish, so the
+// ramp-down never takes longer than one phase of the beat. A PLAY_WAVEFORM
+// beat has no phases: a stroke still near its fastest is walked back down
+// over the steps it has run and one already slowing plays on to its end, so
+// there the bound is one stroke (a systole or a diastole), not the beat.
+
+#include "anomaly_detector.h"
+#include "click_pipeline.h"
+#include "click_synth.h"
+#include "phase_gate.h"
+#include "pump_link.h"
+#include "session_archive.h"
+#include "wav_io.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t CHUNK_FRAMES = 4096;
+constexpr double REALTIME_CHUNK_SECONDS = 0.01;  // Audio per read when paced like a live input
+constexpr int ABORT_TIMEOUT_MILLIS = 10000;      // Rig at rest and home within this
+
+// COMMAND_STATUS state values (State in src/main.h)
+constexpr uint8_t RIG_SHUTDOWN = 6;
+constexpr uint8_t RIG_HOLD_POSITION = 7;
+
+static const char* const KIND_NAME[] = {"click", "opening", "closure"};
+
+struct Options {
+  const char* input = nullptr;
+  const char* sessionIn = nullptr;
+  const char* port = nullptr;
+  const char* csvPath = nullptr;
+  bool gate = false;
+  bool realtime = false;
+  double maxLatencyMs = 0;
+  double synthSeconds = 0;
+  SynthConfig synth;
+  ClickPipelineConfig config;
+  GateConfig gateConfig;
+  AnomalyConfig anomaly;
+};
+
+// What tripped the detector, and when
+struct Trip {
+  bool tripped = false;
+  uint64_t onset = 0;
+  int kind = 0;
+  float distance = 0;
+  uint64_t clicks = 0;
+  Clock::time_point at;
+};
+
+static int usage(const char* program) {
+  std::fprintf(stderr,
+               "usage: %s RECORDING.wav|- [--session FILE] [--window MS] [--port PORT] [--realtime] [options]\n"
+               "       %s --synth SECONDS [--dull-from SECONDS] [--knocks RATE] [--gate] [--port PORT] [options]\n"
+               "options: [--baseline N] [--threshold D] [--trip N] [--max-latency MS] [--csv FILE]\n"
+               "         [--highpass HZ] [--on-ratio R] [--off-ratio R]\n",
+               program, program);
+  return 2;
+}
+
+static int clickKind(const ClickPipeline&) {
+  return CLICK_UNKNOWN;
+}
+
+static int clickKind(const GatedClickPipeline& pipeline) {
+  const long matched = pipeline.matchedReversal();
+  if (matched < 0) {
+    return CLICK_UNKNOWN;
+  }
+  return pipeline.reversal(static_cast<size_t>(matched)).clockwise ? CLICK_OPENING : CLICK_CLOSURE;
+}
+
+static double millisBetween(Clock::time_point from, Clock::time_point to) {
+  return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+// Streams the source until the detector trips or the source ends
+template <typename Pipeline>
+static void watch(Pipeline& pipeline, const Options& options, WavReader& reader, ClickSynth& synthesizer, float rate,
+                  FILE* csv, Trip& trip, Clock::time_point& started) {
+  ClickAnomalyDetector detector(options.anomaly);
+  uint64_t scored = 0;
+  const auto sink = [&](const Click& click, const ClickFeatures& features) {
+    if (trip.tripped) {
+      return;
+    }
+    const int kind = clickKind(pipeline);
+    const AnomalyScore score = detector.add(features, kind);
+    if (!score.scored) {
+      return;
+    }
+    scored++;
+    if (csv != nullptr) {
+      std::fprintf(csv, "%.6f,%s,%.3f\n", features.timeSeconds, KIND_NAME[kind], score.distance);
+    }
+    if (score.tripped) {
+      trip.tripped = true;
+      trip.at = Clock::now();
+      trip.onset = click.onset;
+      trip.kind = kind;
+      trip.distance = score.distance;
+      trip.clicks = scored;
+    }
+  };
+
+  const size_t frames = options.realtime ? static_cast<size_t>(REALTIME_CHUNK_SECONDS * rate) : CHUNK_FRAMES;
+  std::vector<float> chunk(frames);
+  uint64_t position = 0;
+  started = Clock::now();
+  while (!trip.tripped) {
+    const size_t got = options.input != nullptr ? reader.read(chunk.data(), chunk.size())
+                                                : synthesizer.generate(chunk.data(), chunk.size());
+    if (got == 0) {
+      break;
+    }
+    position += got;
+    if (options.realtime) {
+      // The chunk's last sample has only just been "heard"
+      std::this_thread::sleep_until(started + std::chrono::duration_cast<Clock::duration>(
+                                                  std::chrono::duration<double>(position / rate)));
+    }
+    pipeline.process(chunk.data(), got, sink);
+  }
+  if (!trip.tripped) {
+    pipeline.finish(sink);
+  }
+  std::fprintf(stderr, "watched       %.1f s of audio, %llu clicks scored\n", position / rate,
+               static_cast<unsigned long long>(scored));
+}
+
+// Aborts the session on the rig; false unless it came to rest (SHUTDOWN),
+// which `atRest` then tells the time of
+static bool abortRig(PumpLink& link, Clock::time_point& atRest) {
+  const Clock::time_point sent = Clock::now();
+  const uint8_t status = link.abort();
+  const Clock::time_point replied = Clock::now();
+  if (status != STATUS_OK) {
+    std::fprintf(stderr, "abort         %s\n",
+                 status == PumpLink::STATUS_TIMEOUT ? "no reply" : "refused (no session running)");
+    return false;
+  }
+  std::fprintf(stderr, "abort         acknowledged in %.2f ms\n", millisBetween(sent, replied));
+
+  // Poll back to back: each status is one round trip on the link
+  bool rested = false;
+  PumpStatus rig{};
+  while (millisBetween(sent, Clock::now()) < ABORT_TIMEOUT_MILLIS) {
+    if (!link.status(rig)) {
+      continue;
+    }
+    if (!rested && (rig.state == RIG_SHUTDOWN || rig.state == RIG_HOLD_POSITION)) {
+      rested = true;
+      atRest = Clock::now();
+      std::fprintf(stderr, "rig at rest   %.2f ms after the abort, position %ld\n", millisBetween(sent, atRest),
+                   static_cast<long>(rig.position));
+    }
+    if (rig.state == RIG_HOLD_POSITION) {
+      std::fprintf(stderr, "rig home      %.2f ms after the abort, holding at %ld\n", millisBetween(sent, Clock::now()),
+                   static_cast<long>(rig.position));
+      break;
+    }
+  }
+  if (!rested) {
+    std::fprintf(stderr, "rig           still pumping %d ms after the abort\n", ABORT_TIMEOUT_MILLIS);
+  }
+  return rested;
+}
+
+static int run(const Options& options, FILE* csv) {
+  WavReader reader;
+  float rate = options.synth.sampleRate;
+  if (options.input != nullptr) {
+    if (!reader.open(options.input)) {
+      std::fprintf(stderr, "%s: %s\n", options.input, reader.error().c_str());
+      return 1;
+    }
+    rate = static_cast<float>(reader.sampleRate());
+  }
+  // Open the port before listening: opening it resets an Uno
+  PumpLink link;
+  if (options.port != nullptr) {
+    PumpStatus rig{};
+    if (!link.open(options.port)) {
+      std::perror(options.port);
+      return 1;
+    }
+    if (!link.status(rig)) {
+      std::fprintf(stderr, "%s: no reply from the rig\n", options.port);
+      return 1;
+    }
+  }
+  ClickSynth synthesizer(options.synth);
+  Trip trip;
+  Clock::time_point started;
+  if (options.gate) {
+    std::vector<RigReversal> reversals;
+    if (options.sessionIn != nullptr) {
+      FILE* session = std::fopen(options.sessionIn, "r");
+      if (session == nullptr) {
+        std::perror(options.sessionIn);
+        return 1;
+      }
+      reversals = readRigReversals(session);
+      std::fclose(session);
+    } else {
+      reversals = synthesizer.rigReversals();
+    }
+    if (reversals.empty()) {
+      std::fprintf(stderr, "%s: no reversal records\n", options.sessionIn);
+      return 1;
+    }
+    GatedClickPipeline pipeline(rate, std::move(reversals), options.gateConfig, options.config);
+    watch(pipeline, options, reader, synthesizer, rate, csv, trip, started);
+  } else {
+    ClickPipeline pipeline(rate, options.config);
+    watch(pipeline, options, reader, synthesizer, rate, csv, trip, started);
+  }
+
+  if (!trip.tripped) {
+    std::fprintf(stderr, "no atypical clicks\n");
+    return 0;
+  }
+  const double onsetSeconds = static_cast<double>(trip.onset) / rate;
+  std::fprintf(stderr, "tripped       %s at %.3f s, distance %.1f, after %llu scored clicks\n", KIND_NAME[trip.kind],
+               onsetSeconds, trip.distance, static_cast<unsigned long long>(trip.clicks));
+  // Paced input: sample t was heard at started + t
+  const Clock::time_point heard =
+      started + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(onsetSeconds));
+  if (options.realtime) {
+    std::fprintf(stderr, "detection     %.2f ms from the click's onset\n", millisBetween(heard, trip.at));
+  }
+  if (options.port == nullptr) {
+    return 0;
+  }
+  Clock::time_point atRest;
+  if (!abortRig(link, atRest)) {
+    return 1;
+  }
+  if (!options.realtime) {
+    return 0;
+  }
+  const double total = millisBetween(heard, atRest);
+  std::fprintf(stderr, "click to rest %.2f ms\n", total);
+  if (options.maxLatencyMs > 0 && total > options.maxLatencyMs) {
+    std::fprintf(stderr, "over the %.0f ms bound\n", options.maxLatencyMs);
+    return 3;
+  }
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  Options options;
+  ClickPipelineConfig& config = options.config;
+  for (int i = 1; i < argc; i++) {
+    const bool hasValue = i + 1 < argc;
+    if (std::strcmp(argv[i], "--port") == 0 && hasValue) {
+      options.port = argv[++i];
+    } else if (std::strcmp(argv[i], "--csv") == 0 && hasValue) {
+      options.csvPath = argv[++i];
+    } else if (std::strcmp(argv[i], "--session") == 0 && hasValue) {
+      options.sessionIn = argv[++i];
+      options.gate = true;
+    } else if (std::strcmp(argv[i], "--window") == 0 && hasValue) {
+      options.gateConfig.searchMs = std::strtof(argv[++i], nullptr);
+    } else if (std::strcmp(argv[i], "--baseline") == 0 && hasValue) {
+      options.anomaly.baselineClicks = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+    } else if (std::strcmp(argv[i], "--threshold") == 0 && hasValue) {
+      options.anomaly.threshold = std::strtof(argv[++i], nullptr);
+    } else if (std::strcmp(argv[i], "--trip") == 0 && hasValue) {
+      options.anomaly.tripClicks = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+    } else if (std::strcmp(argv[i], "--max-latency") == 0 && hasValue) {
+      options.maxLatencyMs = std::strtod(argv[++i], nullptr);
+    } else if (std::strcmp(argv[i], "--highpass") == 0 && hasValue) {
+      config.highPassHz = std::strtof(argv[++i], nullptr);
+    } else if (std::strcmp(argv[i], "--on-ratio") == 0 && hasValue) {
+      config.segmenter.onRatio = std::strtof(argv[++i], nullptr);
+    } else if (std::strcmp(argv[i], "--off-ratio") == 0 && hasValue) {
+      config.segmenter.offRatio = std::strtof(argv[++i], nullptr);
+    } else if (std::strcmp(argv[i], "--synth") == 0 && hasValue) {
+      options.synthSeconds = std::strtod(argv[++i], nullptr);
+    } else if (std::strcmp(argv[i], "--dull-from") == 0 && hasValue) {
+      options.synth.dullFromSeconds = std::strtod(argv[++i], nullptr);
+    } else if (std::strcmp(argv[i], "--knocks") == 0 && hasValue) {
+      options.synth.knocksPerSecond = std::strtof(argv[++i], nullptr);
+    } else if (std::strcmp(argv[i], "--gate") == 0) {
+      options.gate = true;
+    } else if (std::strcmp(argv[i], "--realtime") == 0) {
+      options.realtime = true;
+    } else if (options.input == nullptr && (argv[i][0] != '-' || argv[i][1] == '\0')) {
+      options.input = argv[i];
+    } else {
+      return usage(argv[0]);
+    }
+  }
+  const bool synthetic = options.synthSeconds > 0;
+  if ((options.input != nullptr) == synthetic || options.anomaly.tripClicks == 0 ||
+      (options.input != nullptr && options.gate && options.sessionIn == nullptr)) {
+    return usage(argv[0]);
+  }
+  options.synth.seconds = options.synthSeconds;
+
+  FILE* csv = nullptr;
+  if (options.csvPath != nullptr) {
+    csv = std::strcmp(options.csvPath, "-") == 0 ? stdout : std::fopen(options.csvPath, "w");
+    if (csv == nullptr) {
+      std::perror(options.csvPath);
+      return 1;
+    }
+    std::fprintf(csv, "time_s,kind,distance\n");
+  }
+  const int status = run(options, csv);
+  if (csv != nullptr && csv != stdout) {
+    std::fclose(csv);
+  }
+  return status;
+}
@@ -0,0 +1,361 @@
+// Latency, throughput and accuracy of the int8 click CNN against its float
+// reference.
+//
+//   pio run -e cnn_bench
+//   .pio/build/cnn_bench/program [--model FILE] [--save FILE] [--clicks N] [--seed N]
+//
+// Options:
+//   --model FILE   PUMPCNN1 weights (tools/click_analysis/click_cnn.h) of a
+//                  three-class model (opening, closure, knock); a model without
+//                  ranges is calibrated here. Default: the reference model below
+//   --save FILE    write the calibrated model, e.g. as a loader test vector
+//   --clicks N     clicks to detect (default 4000), half for fitting and
+//                  calibration, half for the measurements
+//   --seed N       synthetic session and random weights (default 1)
+//
+// Clicks come from the click pipeline run over a synthetic session with
+// knocks (click_synth.h): the first CNN_WINDOW filtered samples of each click
+// from its pre-roll on, zero padded and scaled to a peak of 1, labelled
+// opening, closure or knock from the session's schedule. Even clicks fit and
+// calibrate, odd clicks are timed one at a time through both engines, as a
+// monitor would run them as each click closes.
+//
+// Until there is a trained model, the reference model is random conv filters
+// with a linear readout fitted to the labels by ridge regression on their
+// pooled outputs: a real classifier, so the comparison is over logits that
+// carry the decision rather than over noise.
+//
+// The int8 engine passes when its top class matches the float reference on at
+// least 99% of the clicks and its accuracy is within 1 point of the float
+// model's; otherwise the exit status is 1. The logit error is reported as a
+// share of the float logits' range but not judged: int8 weights leave each
+// channel's gain off by a few tenths of a percent, which a readout leaning on
+// small feature differences turns into an offset of several percent that
+// moves every logit together and rarely the decision.
+
+#include "click_cnn.h"
+#include "click_pipeline.h"
+#include "click_synth.h"
+#include "simd_kernels.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+constexpr uint32_t CNN_WINDOW = 1024;  // 21 ms at 48 kHz: a whole click
+constexpr uint32_t CNN_CLASSES = 3;    // Opening, closure, knock
+constexpr uint8_t CLASS_KNOCK = 2;
+constexpr size_t BLOCK_SAMPLES = 4800;
+constexpr double MATCH_TOLERANCE_SECONDS = 0.003;  // Detected onset to scheduled valve click
+constexpr double RIDGE = 1e-2;
+constexpr double MIN_AGREEMENT = 0.99;
+constexpr double MAX_ACCURACY_LOSS = 0.01;
+
+using Clock = std::chrono::steady_clock;
+
+struct ClickSet {
+  std::vector<float> inputs;  // CNN_WINDOW per click, one after another
+  std::vector<uint8_t> labels;
+};
+
+// conv 8x9/2 -> pool 2 -> conv 16x5 -> pool 2 -> conv 32x5 -> average, random
+static CnnModel featureModel(uint64_t seed) {
+  CnnModel model(CNN_WINDOW, 1);
+  model.add(CNN_CONV1D, 9, 2, 8, CNN_RELU);
+  model.add(CNN_MAXPOOL, 0, 2, 0);
+  model.add(CNN_CONV1D, 5, 1, 16, CNN_RELU);
+  model.add(CNN_MAXPOOL, 0, 2, 0);
+  model.add(CNN_CONV1D, 5, 1, 32, CNN_RELU);
+  model.add(CNN_GLOBAL_AVERAGE, 0, 0, 0);
+  model.randomize(seed);
+  return model;
+}
+
+// Solves a x = b in place by Gaussian elimination with partial pivoting;
+// a is n x n, b is n x m, both row major
+static void solve(std::vector<double>& a, std::vector<double>& b, size_t n, size_t m) {
+  for (size_t k = 0; k < n; k++) {
+    size_t pivot = k;
+    for (size_t i = k + 1; i < n; i++) {
+      pivot = std::fabs(a[i * n + k]) > std::fabs(a[pivot * n + k]) ? i : pivot;
+    }
+    std::swap_ranges(a.begin() + k * n, a.begin() + (k + 1) * n, a.begin() + pivot * n);
+    std::swap_ranges(b.begin() + k * m, b.begin() + (k + 1) * m, b.begin() + pivot * m);
+    for (size_t i = k + 1; i < n; i++) {
+      const double f = a[i * n + k] / a[k * n + k];
+      for (size_t j = k; j < n; j++) {
+        a[i * n + j] -= f * a[k * n + j];
+      }
+      for (size_t j = 0; j < m; j++) {
+        b[i * m + j] -= f * b[k * m + j];
+      }
+    }
+  }
+  for (size_t k = n; k-- > 0;) {
+    for (size_t j = 0; j < m; j++) {
+      double s = b[k * m + j];
+      for (size_t i = k + 1; i < n; i++) {
+        s -= a[k * n + i] * b[i * m + j];
+      }
+      b[k * m + j] = s / a[k * n + k];
+    }
+  }
+}
+
+// The feature model plus a DENSE readout fitted to one-hot labels by ridge
+// regression on centred and scaled features, folded back into plain weights
+static CnnModel referenceModel(uint64_t seed, const ClickSet& training) {
+  CnnModel features = featureModel(seed);
+  const size_t d = features.outputs();
+  const size_t n = training.labels.size();
+  std::vector<double> x(n * d);
+  std::vector<float> row(d);
+  for (size_t i = 0; i < n; i++) {
+    features.forward(training.inputs.data() + i * CNN_WINDOW, row.data());
+    std::copy(row.begin(), row.end(), x.begin() + i * d);
+  }
+  std::vector<double> mean(d, 0.0), deviation(d, 0.0);
+  for (size_t i = 0; i < n; i++) {
+    for (size_t j = 0; j < d; j++) {
+      mean[j] += x[i * d + j] / n;
+    }
+  }
+  for (size_t i = 0; i < n; i++) {
+    for (size_t j = 0; j < d; j++) {
+      deviation[j] += (x[i * d + j] - mean[j]) * (x[i * d + j] - mean[j]) / n;
+    }
+  }
+  // One scale for every feature, so the ridge keeps the weights of nearly
+  // constant features small instead of blowing their noise up to unit variance
+  double variance = 0;
+  for (size_t j = 0; j < d; j++) {
+    variance += deviation[j] / d;
+  }
+  std::fill(deviation.begin(), deviation.end(), std::max(std::sqrt(variance), 1e-9));
+  // Normal equations over [scaled features, 1]
+  const size_t k = d + 1;
+  std::vector<double> a(k * k, 0.0), b(k * CNN_CLASSES, 0.0), z(k, 1.0);
+  for (size_t i = 0; i < n; i++) {
+    for (size_t j = 0; j < d; j++) {
+      z[j] = (x[i * d + j] - mean[j]) / deviation[j];
+    }
+    for (size_t r = 0; r < k; r++) {
+      for (size_t c = 0; c < k; c++) {
+        a[r * k + c] += z[r] * z[c];
+      }
+      b[r * CNN_CLASSES + training.labels[i]] += z[r];
+    }
+  }
+  for (size_t j = 0; j < d; j++) {
+    a[j * k + j] += RIDGE * n;
+  }
+  solve(a, b, k, CNN_CLASSES);
+
+  CnnModel model = featureModel(seed);
+  model.add(CNN_DENSE, 0, 0, CNN_CLASSES);
+  CnnLayer& readout = model.layer(model.layers().size() - 1);
+  for (size_t o = 0; o < CNN_CLASSES; o++) {
+    double bias = b[d * CNN_CLASSES + o];
+    for (size_t j = 0; j < d; j++) {
+      const double w = b[j * CNN_CLASSES + o] / deviation[j];
+      readout.weights[o * d + j] = static_cast<float>(w);
+      bias -= w * mean[j];
+    }
+    readout.biases[o] = static_cast<float>(bias);
+  }
+  return model;
+}
+
+// `count` clicks of `window` samples with their classes
+static ClickSet collectClicks(size_t count, uint32_t window, uint64_t seed) {
+  SynthConfig synth;
+  synth.seconds = 1e6;  // Stopped once there are enough clicks
+  synth.knocksPerSecond = 0.5f;
+  synth.seed = seed;
+  ClickSynth source(synth);
+  ClickPipeline pipeline(synth.sampleRate);
+  const uint64_t tolerance = static_cast<uint64_t>(MATCH_TOLERANCE_SECONDS * synth.sampleRate);
+  ClickSet set;
+  set.inputs.reserve(count * window);
+  std::vector<float> block(BLOCK_SAMPLES);
+  auto sink = [&](const Click& click, const ClickFeatures&) {
+    if (set.labels.size() == count) {
+      return;
+    }
+    // Valve clicks are scheduled opening, closure, opening ...; anything else is a knock
+    const std::vector<uint64_t>& valve = source.valveClicks();
+    const auto next = std::lower_bound(valve.begin(), valve.end(), click.onset > tolerance ? click.onset - tolerance : 0);
+    uint8_t label = CLASS_KNOCK;
+    if (next != valve.end() && *next <= click.onset + tolerance) {
+      label = static_cast<uint8_t>((next - valve.begin()) % 2);
+    }
+    set.labels.push_back(label);
+    const size_t n = std::min<size_t>(click.samples.size(), window);
+    const float peak = std::max(simd::maxAbs(click.samples.data(), n), 1e-9f);
+    for (size_t i = 0; i < window; i++) {
+      set.inputs.push_back(i < n ? click.samples[i] / peak : 0.0f);
+    }
+  };
+  while (set.labels.size() < count) {
+    const size_t n = source.generate(block.data(), block.size());
+    if (n == 0) {
+      break;
+    }
+    pipeline.process(block.data(), n, sink);
+  }
+  return set;
+}
+
+static size_t argmax(const float* x, size_t n) {
+  return static_cast<size_t>(std::max_element(x, x + n) - x);
+}
+
+struct Latency {
+  double mean, p99, worst, total;
+};
+
+static Latency summarise(std::vector<double>& seconds) {
+  Latency latency{};
+  for (double s : seconds) {
+    latency.total += s;
+  }
+  std::sort(seconds.begin(), seconds.end());
+  latency.mean = latency.total / seconds.size();
+  latency.p99 = seconds[std::min(seconds.size() - 1, seconds.size() * 99 / 100)];
+  latency.worst = seconds.back();
+  return latency;
+}
+
+static void report(const char* engine, const Latency& latency, size_t clicks, double accuracy) {
+  std::printf("%-6s  mean %7.1f us  p99 %7.1f us  max %7.1f us  %8.0f clicks/s  accuracy %6.2f%%\n", engine,
+              latency.mean * 1e6, latency.p99 * 1e6, latency.worst * 1e6, clicks / latency.total, accuracy * 100);
+}
+
+static int usage(const char* program) {
+  std::fprintf(stderr, "usage: %s [--model FILE] [--save FILE] [--clicks N] [--seed N]\n", program);
+  return 2;
+}
+
+int main(int argc, char** argv) {
+  const char* modelPath = nullptr;
+  const char* savePath = nullptr;
+  size_t clickCount = 4000;
+  uint64_t seed = 1;
+  for (int i = 1; i < argc; i++) {
+    if (i + 1 < argc && std::strcmp(argv[i], "--model") == 0) {
+      modelPath = argv[++i];
+    } else if (i + 1 < argc && std::strcmp(argv[i], "--save") == 0) {
+      savePath = argv[++i];
+    } else if (i + 1 < argc && std::strcmp(argv[i], "--clicks") == 0) {
+      clickCount = std::strtoul(argv[++i], nullptr, 10);
+    } else if (i + 1 < argc && std::strcmp(argv[i], "--seed") == 0) {
+      seed = std::strtoull(argv[++i], nullptr, 10);
+    } else {
+      return usage(argv[0]);
+    }
+  }
+  if (clickCount < 2) {
+    return usage(argv[0]);
+  }
+
+  CnnModel model;
+  if (modelPath != nullptr && !model.load(modelPath)) {
+    std::fprintf(stderr, "%s: %s\n", modelPath, model.error().c_str());
+    return 1;
+  }
+  if (modelPath != nullptr && model.outputs() != CNN_CLASSES) {
+    std::fprintf(stderr, "%s: model has %u outputs, not %u classes\n", modelPath, model.outputs(), CNN_CLASSES);
+    return 1;
+  }
+  const uint32_t window = modelPath != nullptr ? model.inputs() : CNN_WINDOW;
+  const ClickSet clicks = collectClicks(clickCount, window, seed);
+  ClickSet training, evaluation;
+  for (size_t n = 0; n < clicks.labels.size(); n++) {
+    ClickSet& half = n % 2 == 0 ? training : evaluation;
+    half.inputs.insert(half.inputs.end(), clicks.inputs.begin() + n * window, clicks.inputs.begin() + (n + 1) * window);
+    half.labels.push_back(clicks.labels[n]);
+  }
+  if (evaluation.labels.empty()) {
+    std::fprintf(stderr, "too few clicks detected\n");
+    return 1;
+  }
+  if (modelPath == nullptr) {
+    model = referenceModel(seed, training);
+  }
+  if (!model.calibrated()) {
+    model.calibrate(training.inputs.data(), training.labels.size());
+  }
+  if (savePath != nullptr && !model.save(savePath)) {
+    std::fprintf(stderr, "%s: write failed\n", savePath);
+    return 1;
+  }
+  Int8Cnn engine;
+  if (!engine.build(model)) {
+    std::fprintf(stderr, "model has no layers or a zero activation range\n");
+    return 1;
+  }
+  std::printf("model %zu layers, %zu parameters, input %u, %u outputs\n", model.layers().size(),
+              model.parameters(), window, model.outputs());
+  std::printf("int8  %zu bytes of weights, %zu byte activation arena\n", engine.weightBytes(), engine.arenaBytes());
+
+  const size_t evaluated = evaluation.labels.size();
+  std::vector<float> reference(evaluated * CNN_CLASSES), quantized(evaluated * CNN_CLASSES);
+  std::vector<double> floatSeconds(evaluated), int8Seconds(evaluated);
+  for (size_t n = 0; n < evaluated; n++) {
+    const float* input = evaluation.inputs.data() + n * window;
+    const Clock::time_point start = Clock::now();
+    model.forward(input, reference.data() + n * CNN_CLASSES);
+    const Clock::time_point middle = Clock::now();
+    engine.infer(input, quantized.data() + n * CNN_CLASSES);
+    const Clock::time_point end = Clock::now();
+    floatSeconds[n] = std::chrono::duration<double>(middle - start).count();
+    int8Seconds[n] = std::chrono::duration<double>(end - middle).count();
+  }
+
+  size_t agree = 0, floatRight = 0, int8Right = 0;
+  size_t perClass[CNN_CLASSES] = {};
+  float lowest = reference[0], highest = reference[0];
+  double totalError = 0, largestError = 0;
+  for (size_t n = 0; n < evaluated; n++) {
+    const float* f = reference.data() + n * CNN_CLASSES;
+    const float* q = quantized.data() + n * CNN_CLASSES;
+    const size_t top = argmax(f, CNN_CLASSES);
+    const size_t int8Top = argmax(q, CNN_CLASSES);
+    agree += top == int8Top;
+    floatRight += top == evaluation.labels[n];
+    int8Right += int8Top == evaluation.labels[n];
+    perClass[evaluation.labels[n]]++;
+    for (uint32_t o = 0; o < CNN_CLASSES; o++) {
+      lowest = std::min(lowest, f[o]);
+      highest = std::max(highest, f[o]);
+      totalError += std::fabs(f[o] - q[o]);
+      largestError = std::max(largestError, static_cast<double>(std::fabs(f[o] - q[o])));
+    }
+  }
+  const double floatAccuracy = static_cast<double>(floatRight) / evaluated;
+  const double int8Accuracy = static_cast<double>(int8Right) / evaluated;
+  const Latency floatLatency = summarise(floatSeconds);
+  const Latency int8Latency = summarise(int8Seconds);
+  std::printf("%zu clicks fitted and calibrated, %zu timed one at a time (%zu opening, %zu closure, %zu knock)\n",
+              clicks.labels.size() - evaluated, evaluated, perClass[0], perClass[1], perClass[2]);
+  report("float", floatLatency, evaluated, floatAccuracy);
+  report("int8", int8Latency, evaluated, int8Accuracy);
+  std::printf("int8 speedup %.2fx; p99 is %.4f%% of a beat at 60 bpm\n", floatLatency.total / int8Latency.total,
+              int8Latency.p99 * 100);
+
+  const double range = highest > lowest ? highest - lowest : 1.0;
+  const double agreement = static_cast<double>(agree) / evaluated;
+  const double meanError = totalError / (evaluated * CNN_CLASSES) / range;
+  const double worstError = largestError / range;
+  std::printf("agreement %.2f%% (min %.0f%%), accuracy loss %.2f points (max %.0f)\n", agreement * 100,
+              MIN_AGREEMENT * 100, (floatAccuracy - int8Accuracy) * 100, MAX_ACCURACY_LOSS * 100);
+  std::printf("logit error, of the float logits' range: mean %.2f%%, worst %.2f%%\n", meanError * 100,
+              worstError * 100);
+  const bool pass = agreement >= MIN_AGREEMENT && floatAccuracy - int8Accuracy <= MAX_ACCURACY_LOSS;
+  std::printf("%s\n", pass ? "PASS" : "FAIL");
+  return pass ? 0 : 1;
+}
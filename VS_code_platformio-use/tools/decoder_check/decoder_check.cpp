@@ -0,0 +1,208 @@
+// Host check of the telemetry decoder's recovery (tools/pump_link/telemetry_decoder.h).
+//
+// Builds one telemetry stream in memory, no rig or capture needed, that has
+// everything a real link throws at the decoder between good records:
+// diagnostic text, a command reply, a sequence gap across the 255 -> 0 wrap,
+// a frame with a flipped payload byte, a frame cut short by the next one, and
+// rig timestamps wrapping past 2^32. Feeds it in chunks of several sizes, down
+// to a byte at a time, and checks that every run
+//   - decodes exactly the intact records, to the same session lines;
+//   - counts every damaged or missing record as lost, once;
+//   - counts a corrupt frame for each damaged one (a CRC byte that happens to
+//     be the sync byte may add more).
+// Prints one line per chunk size; exit status 1 when any check fails.
+//
+//   pio run -e decoder_check && .pio/build/decoder_check/program
+
+#include "command_protocol.h"
+#include "telemetry.h"
+#include "telemetry_decoder.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+static const size_t CHUNK_SIZES[] = {1, 2, 3, 7, 64, 0};  // 0 feeds the whole stream at once
+
+struct Stream {
+  std::vector<uint8_t> bytes;
+  std::string session;      // Lines the decoder must write
+  uint64_t records = 0;
+  uint64_t lost = 0;
+  uint64_t damagedFrames = 0;
+};
+
+static std::vector<uint8_t> frame(uint8_t code, const uint8_t* payload, uint8_t length) {
+  uint8_t out[COMMAND_MAX_PAYLOAD + 5];
+  return std::vector<uint8_t>(out, out + encodeCommandFrame(code, payload, length, out));
+}
+
+static void append(Stream& stream, const std::vector<uint8_t>& bytes) {
+  stream.bytes.insert(stream.bytes.end(), bytes.begin(), bytes.end());
+}
+
+static void text(Stream& stream, const char* line) {
+  stream.bytes.insert(stream.bytes.end(), line, line + std::strlen(line));
+}
+
+static void expect(Stream& stream, const char* line) {
+  stream.session += line;
+  stream.session += '\n';
+}
+
+static std::vector<uint8_t> beatStart(uint8_t sequence, uint16_t beat, uint32_t start, uint32_t period) {
+  uint8_t payload[11] = {sequence};
+  writeU16(payload + 1, beat);
+  writeU32(payload + 3, start);
+  writeU32(payload + 7, period);
+  return frame(TELEMETRY_BEAT_START, payload, sizeof(payload));
+}
+
+static std::vector<uint8_t> beatEnd(uint8_t sequence, uint16_t beat, uint16_t steps, uint32_t end,
+                                    int32_t position) {
+  uint8_t payload[13] = {sequence};
+  writeU16(payload + 1, beat);
+  writeU16(payload + 3, steps);
+  writeU32(payload + 5, end);
+  writeU32(payload + 9, static_cast<uint32_t>(position));
+  return frame(TELEMETRY_BEAT_END, payload, sizeof(payload));
+}
+
+static std::vector<uint8_t> stateRecord(uint8_t code, uint8_t sequence, uint8_t value, uint32_t time,
+                                        int32_t position) {
+  uint8_t payload[10] = {sequence, value};
+  writeU32(payload + 2, time);
+  writeU32(payload + 6, static_cast<uint32_t>(position));
+  return frame(code, payload, sizeof(payload));
+}
+
+static std::vector<uint8_t> timing(uint8_t sequence, uint16_t beat, int32_t error, uint32_t dwell, uint32_t scale) {
+  uint8_t payload[15] = {sequence};
+  writeU16(payload + 1, beat);
+  writeU32(payload + 3, static_cast<uint32_t>(error));
+  writeU32(payload + 7, dwell);
+  writeU32(payload + 11, scale);
+  return frame(TELEMETRY_BEAT_TIMING, payload, sizeof(payload));
+}
+
+// Rig times start just short of the 32-bit wrap; the decoder widens them past it
+static Stream buildStream() {
+  constexpr uint64_t WRAP = 1ULL << 32;
+  Stream stream;
+
+  text(stream, "pump ready\r\n");
+  append(stream, beatStart(250, 7, 0xFFFFF000u, 1000000));
+  expect(stream, "beat_start 7 4294963200 period 1000000");
+  append(stream, stateRecord(TELEMETRY_PHASE, 251, 0, 0xFFFFF100u, 0));
+  expect(stream, "phase 4294963456 SYSTOLE_ACCEL position 0");
+
+  const uint8_t status = STATUS_OK;
+  append(stream, frame(COMMAND_STATUS | COMMAND_REPLY, &status, 1));  // A reply, skipped whole
+
+  append(stream, stateRecord(TELEMETRY_PHASE, 252, 1, 0x00000100u, -600));
+  char line[96];
+  std::snprintf(line, sizeof(line), "phase %llu SYSTOLE_DECEL position -600",
+                static_cast<unsigned long long>(WRAP + 0x100));
+  expect(stream, line);
+  append(stream, stateRecord(TELEMETRY_REVERSAL, 253, 0, 0x00000200u, -1200));
+  std::snprintf(line, sizeof(line), "reversal %llu ccw position -1200",
+                static_cast<unsigned long long>(WRAP + 0x200));
+  expect(stream, line);
+  stream.records += 4;
+
+  // Gap: 254 and 255 never arrive; the sequence wraps to 0
+  append(stream, stateRecord(TELEMETRY_PHASE, 0, 2, 0x00000300u, -1200));
+  expect(stream, "lost 2");
+  std::snprintf(line, sizeof(line), "phase %llu DIASTOLE_ACCEL position -1200",
+                static_cast<unsigned long long>(WRAP + 0x300));
+  expect(stream, line);
+  stream.records += 1;
+  stream.lost += 2;
+
+  // Record 1 with a flipped byte: fails its CRC
+  std::vector<uint8_t> flipped = stateRecord(TELEMETRY_PHASE, 1, 3, 0x00000380u, -600);
+  flipped[6] ^= 0x10;
+  append(stream, flipped);
+  stream.damagedFrames++;
+
+  append(stream, beatEnd(2, 7, 4800, 0x00000400u, 0));
+  expect(stream, "lost 1");
+  std::snprintf(line, sizeof(line), "beat_end 7 %llu steps 4800 position 0",
+                static_cast<unsigned long long>(WRAP + 0x400));
+  expect(stream, line);
+  stream.records += 1;
+  stream.lost += 1;
+
+  // Record 3 cut short: its length reaches into the next frame, which must still be found
+  std::vector<uint8_t> cut = timing(3, 7, 12, 500, 65536);
+  cut.resize(cut.size() - 6);
+  append(stream, cut);
+  stream.damagedFrames++;
+
+  append(stream, timing(4, 7, -25, 1000, 65536));
+  expect(stream, "lost 1");
+  expect(stream, "timing 7 error -25 dwell 1000 scale 65536");
+  text(stream, "J\n");
+  append(stream, beatStart(5, 8, 0x000F4500u, 1000000));
+  std::snprintf(line, sizeof(line), "beat_start 8 %llu period 1000000",
+                static_cast<unsigned long long>(WRAP + 0xF4500));
+  expect(stream, line);
+  stream.records += 2;
+  stream.lost += 1;
+  return stream;
+}
+
+// Everything the decoder wrote to its session file
+static std::string decode(const Stream& stream, size_t chunk, TelemetryDecoder::Counters& counters) {
+  FILE* session = std::tmpfile();
+  if (session == nullptr) {
+    std::perror("tmpfile");
+    return {};
+  }
+  TelemetryDecoder decoder(session);
+  const size_t size = stream.bytes.size();
+  const size_t step = chunk != 0 ? chunk : size;
+  for (size_t at = 0; at < size; at += step) {
+    decoder.feed(&stream.bytes[at], std::min(step, size - at));
+  }
+  counters = decoder.counters();
+
+  std::string lines;
+  std::rewind(session);
+  char buffer[256];
+  size_t read;
+  while ((read = std::fread(buffer, 1, sizeof(buffer), session)) > 0) {
+    lines.append(buffer, read);
+  }
+  std::fclose(session);
+  return lines;
+}
+
+int main() {
+  const Stream stream = buildStream();
+  std::printf("stream: %zu bytes, %llu records, %llu lost, %llu damaged frames\n\n", stream.bytes.size(),
+              static_cast<unsigned long long>(stream.records), static_cast<unsigned long long>(stream.lost),
+              static_cast<unsigned long long>(stream.damagedFrames));
+  std::printf("%6s %8s %6s %8s %6s %9s\n", "chunk", "records", "lost", "corrupt", "text", "session");
+
+  bool allOk = true;
+  for (size_t chunk : CHUNK_SIZES) {
+    TelemetryDecoder::Counters counters;
+    const std::string session = decode(stream, chunk, counters);
+    const bool sameSession = session == stream.session;
+    const bool ok = sameSession && counters.records == stream.records && counters.lost == stream.lost &&
+                    counters.corrupt >= stream.damagedFrames;
+    std::printf("%6zu %8llu %6llu %8llu %6llu %9s  %s\n", chunk != 0 ? chunk : stream.bytes.size(),
+                static_cast<unsigned long long>(counters.records), static_cast<unsigned long long>(counters.lost),
+                static_cast<unsigned long long>(counters.corrupt), static_cast<unsigned long long>(counters.textBytes),
+                sameSession ? "same" : "differs", ok ? "ok" : "FAIL");
+    if (!sameSession) {
+      std::printf("--- expected\n%s--- decoded\n%s---\n", stream.session.c_str(), session.c_str());
+    }
+    allOk = allOk && ok;
+  }
+  std::printf("\n%s\n", allOk ? "decoder recovers" : "FAILED");
+  return allOk ? 0 : 1;
+}
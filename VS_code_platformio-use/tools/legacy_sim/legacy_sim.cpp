@@ -0,0 +1,146 @@
+// Host replay of a code_versions/ sketch against the firmware that replaced it.
+//
+// Runs the sketch's unmodified setup()/loop() on the native HAL, one
+// microsecond per loop() pass, so it steps exactly when its busy-wait on
+// micros() would. Each of its STEP pulses is matched against the next one in a
+// pump_sim trace of the firmware variant built from it, in order:
+//   - the direction must be the same;
+//   - the interval from the pulse before must be the sketch's, clamped to the
+//     step timer's [MIN_STEP_INTERVAL_US, MAX_STEP_INTERVAL_US].
+// The first pulse of every beat is only checked for direction: the sketch ran
+// its beats back to back, the firmware starts each on the beat scheduler's
+// clock. Run the firmware at --bpm 1 so no beat is scaled to fit its period.
+// Prints the counts; exit status 1 on any mismatch or when the trace has no
+// complete beat, 2 on bad arguments.
+//
+//   pio run -e native_100ml_sv -e legacy_100ml_sv
+//   .pio/build/native_100ml_sv/program --bpm 1 --seconds 130 --trace 100ml_sv.trace
+//   .pio/build/legacy_100ml_sv/program 100ml_sv.trace
+//
+// tools/legacy_sim/run_compare.sh does this for every sketch.
+
+#include "hal.h"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+void setup();
+void loop();
+
+// The step timer's limits (src/step_timer.h); the sketch includes none of src/
+constexpr unsigned long MIN_STEP_INTERVAL_US = 20;
+constexpr unsigned long MAX_STEP_INTERVAL_US = 32000;
+
+// The sketch steps from loop() itself; hal_native.cpp's step-timer hooks have
+// nothing to drive
+unsigned long stepTimerMicrosToNextStep() {
+  return 0;
+}
+
+unsigned int stepTimerAdvance(unsigned long) {
+  return 0;
+}
+
+struct Pulse {
+  unsigned long long micros;
+  int delta;
+  bool beatStart;
+};
+
+static std::vector<Pulse> expected;
+static size_t matched = 0;
+static unsigned long long lastMicros = 0;
+static unsigned long directionMismatches = 0;
+static unsigned long intervalMismatches = 0;
+static unsigned long intervalsChecked = 0;
+
+// The sketch's DIR and STEP pins (its own constants are local to it)
+constexpr uint8_t DIR_PIN = 2;
+constexpr uint8_t STEP_PIN = 5;
+
+static unsigned long long clampInterval(unsigned long long micros) {
+  return micros < MIN_STEP_INTERVAL_US ? MIN_STEP_INTERVAL_US
+                                       : (micros > MAX_STEP_INTERVAL_US ? MAX_STEP_INTERVAL_US : micros);
+}
+
+static void onPinChange(uint8_t pin, uint8_t level, unsigned long long nowMicros) {
+  if (pin != STEP_PIN || level != HIGH || matched == expected.size()) {
+    return;
+  }
+  const Pulse& pulse = expected[matched];
+  const int delta = digitalRead(DIR_PIN) == HIGH ? -1 : 1;  // DIR high is clockwise, counted down
+  if (delta != pulse.delta) {
+    directionMismatches++;
+    if (directionMismatches <= 5) {
+      std::printf("step %zu: direction %+d, firmware %+d\n", matched, delta, pulse.delta);
+    }
+  }
+  if (matched > 0 && !pulse.beatStart) {
+    const unsigned long long interval = clampInterval(nowMicros - lastMicros);
+    const unsigned long long firmware = pulse.micros - expected[matched - 1].micros;
+    intervalsChecked++;
+    if (interval != firmware) {
+      intervalMismatches++;
+      if (intervalMismatches <= 5) {
+        std::printf("step %zu: interval %llu us, firmware %llu us\n", matched, interval, firmware);
+      }
+    }
+  }
+  lastMicros = nowMicros;
+  matched++;
+}
+
+// Reads the STEP pulses of a pump_sim trace, marking the first of each beat
+static bool readTrace(const char* path, unsigned long& beats) {
+  FILE* file = std::fopen(path, "r");
+  if (file == nullptr) {
+    std::perror(path);
+    return false;
+  }
+  char line[128];
+  bool beatPending = false;
+  beats = 0;
+  while (std::fgets(line, sizeof(line), file) != nullptr) {
+    unsigned long long micros = 0;
+    int delta = 0;
+    char state[64];
+    if (std::sscanf(line, "S %llu %d", &micros, &delta) == 2) {
+      expected.push_back({micros, delta, beatPending});
+      beatPending = false;
+    } else if (std::sscanf(line, "T %llu %63s", &micros, state) == 2 && std::strcmp(state, "SYSTOLE_ACCEL") == 0) {
+      beatPending = true;
+      beats++;
+    }
+  }
+  std::fclose(file);
+  return true;
+}
+
+int main(int argc, char** argv) {
+  if (argc != 2) {
+    std::fprintf(stderr, "usage: %s TRACE\n", argv[0]);
+    return 2;
+  }
+  unsigned long beats = 0;
+  if (!readTrace(argv[1], beats)) {
+    return 2;
+  }
+
+  halReset();
+  halSetPinListener(onPinChange);
+  setup();
+  // Every pulse is due within MAX_STEP_INTERVAL_US of the one before
+  while (matched < expected.size() && halNowMicros() - lastMicros <= 10 * MAX_STEP_INTERVAL_US) {
+    loop();
+    halAdvance(1);
+  }
+
+  std::printf("beats         %lu\n", beats);
+  std::printf("steps         %zu of %zu\n", matched, expected.size());
+  std::printf("intervals     %lu checked, %lu differ\n", intervalsChecked, intervalMismatches);
+  std::printf("directions    %lu differ\n", directionMismatches);
+  const bool ok = beats > 0 && matched == expected.size() && intervalMismatches == 0 && directionMismatches == 0;
+  std::printf("%s\n", ok ? "same steps as the sketch" : "FAILED");
+  return ok ? 0 : 1;
+}
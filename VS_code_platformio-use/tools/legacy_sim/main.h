@@ -0,0 +1,15 @@
+#ifndef LEGACY_MAIN_H
+#define LEGACY_MAIN_H
+
+// Stands in for the main.h the code_versions/ sketches were written against:
+// the Arduino core they took from it, provided here by the native HAL. Found
+// ahead of src/main.h through -iquote (see env:legacy_100ml_sv).
+
+#include "hal.h"
+
+#include <math.h>
+#include <stdlib.h>
+
+#define PI 3.1415926535897932384626433832795  // As in Arduino.h
+
+#endif // LEGACY_MAIN_H
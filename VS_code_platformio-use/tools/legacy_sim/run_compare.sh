@@ -0,0 +1,39 @@
+#!/bin/sh
+# Replays every code_versions/ sketch against the firmware variant built from
+# it (see legacy_sim.cpp): runs the variant through pump_sim for three beats at
+# --bpm 1 and checks that the sketch takes the same steps at the same
+# intervals. MainPump has no sketch; the golden suite covers it.
+#
+#   tools/legacy_sim/run_compare.sh
+#
+# Traces and logs are left in .pio/legacy_sim/.
+set -e
+cd "$(dirname "$0")/../.."
+
+OUT=.pio/legacy_sim
+
+# name:firmware environment:sketch environment
+CONFIGS="100ml_sv:native_100ml_sv:legacy_100ml_sv sinusoidal:native_sinusoidal:legacy_sinusoidal"
+
+ENVS=""
+for config in $CONFIGS; do
+  rest=${config#*:}
+  ENVS="$ENVS -e ${rest%%:*} -e ${rest#*:}"
+done
+pio run -s $ENVS
+
+mkdir -p "$OUT"
+status=0
+for config in $CONFIGS; do
+  name=${config%%:*}
+  rest=${config#*:}
+  ".pio/build/${rest%%:*}/program" --bpm 1 --seconds 130 --trace "$OUT/$name.trace" > "$OUT/$name.log"
+  if ".pio/build/${rest#*:}/program" "$OUT/$name.trace" > "$OUT/$name.compare"; then
+    echo "$name PASS  $(grep '^steps' "$OUT/$name.compare")"
+  else
+    echo "$name FAIL"
+    cat "$OUT/$name.compare"
+    status=1
+  fi
+done
+exit $status
@@ -0,0 +1,338 @@
+// Host check of the framed command protocol over a live serial port.
+//
+// Talks to a rig, normally pump_sim --pty --idle, through the PumpLink library
+// exactly as a host would (tools/link_check/run_link_check.sh starts one per
+// configuration and runs this against it), and checks that
+//   - a frame with a bad CRC, and one whose length is over COMMAND_MAX_PAYLOAD,
+//     is dropped without a reply, counted in STATUS and not executed;
+//   - every command is answered under its own reply code, with the status its
+//     payload and the rig's state call for and the payload its reply carries;
+//   - an unknown command is answered STATUS_UNKNOWN_COMMAND;
+//   - START, STOP, ABORT, RATE and JOG are answered as the rig's state calls
+//     for and take it through the states they should, as STATUS reports them
+//     while it runs: an ABORT in the systole's acceleration ramps the stroke
+//     down and homes without a diastole, a STOP lets the beat finish but starts
+//     no other, RATE applies from the next session, JOG lands on its target.
+// The state sequences are sampled by polling STATUS, so a state shorter than
+// a round trip may be missed; each check only asks for the order the states
+// come in and where the rig ends up.
+// What a build leaves out (the live ramp, PLAY_WAVEFORM, TELEMETRY) decides
+// some replies; the check learns it from the first reply that depends on it
+// and holds every related reply to that.
+// Prints one line per check; exit status 1 when any fails, 2 on bad arguments
+// or when the port cannot be opened.
+//
+//   pio run -e link_check && .pio/build/link_check/program PORT
+
+#include "pump_link.h"
+
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+// The rig's states as STATUS reports them (src/main.h)
+enum RigState : uint8_t {
+  RIG_SYSTOLE_ACCEL = 0,
+  RIG_SYSTOLE_DECEL = 1,
+  RIG_DIASTOLE_ACCEL = 2,
+  RIG_DIASTOLE_DECEL = 3,
+  RIG_RETURN_TO_START = 4,
+  RIG_CYCLE_COMPLETE = 5,
+  RIG_SHUTDOWN = 6,
+  RIG_HOLD_POSITION = 7,
+  RIG_RETURN_TO_MANUAL_POSITION = 8,
+};
+
+static const char* const STATE_NAMES[] = {
+    "SYSTOLE_ACCEL",  "SYSTOLE_DECEL", "DIASTOLE_ACCEL", "DIASTOLE_DECEL",           "RETURN_TO_START",
+    "CYCLE_COMPLETE", "SHUTDOWN",      "HOLD_POSITION",  "RETURN_TO_MANUAL_POSITION", "WAVEFORM_PLAYBACK",
+};
+static const char* const STATUS_NAMES[] = {"OK", "UNKNOWN_COMMAND", "BAD_PAYLOAD", "REFUSED"};
+
+static int failures = 0;
+static unsigned long replies[128];  // Reply frames seen on the port, by command
+
+static void check(bool ok, const char* what) {
+  std::printf("%-58s %s\n", what, ok ? "ok" : "FAIL");
+  failures += ok ? 0 : 1;
+}
+
+static const char* statusName(uint8_t status) {
+  return status < sizeof(STATUS_NAMES) / sizeof(STATUS_NAMES[0]) ? STATUS_NAMES[status] : "no reply";
+}
+
+// Sends a command and checks its reply status and how many bytes follow it
+static uint8_t expectReply(PumpLink& link, const char* what, uint8_t command, const uint8_t* payload, uint8_t length,
+                           uint8_t want, size_t replyBytes = 0) {
+  uint8_t status = PumpLink::STATUS_TIMEOUT;
+  std::vector<uint8_t> reply;
+  const bool answered = link.transact(command, payload, length, status, &reply);
+  char line[128];
+  std::snprintf(line, sizeof(line), "%s -> %s", what, statusName(answered ? status : PumpLink::STATUS_TIMEOUT));
+  check(answered && status == want && reply.size() == replyBytes, line);
+  return answered ? status : PumpLink::STATUS_TIMEOUT;
+}
+
+// A reply that depends on how the rig was built: OK with the option, REFUSED without
+static uint8_t learnOption(uint8_t status, const char* what, const char* option) {
+  char line[128];
+  std::snprintf(line, sizeof(line), "%s -> %s (%s)", what, statusName(status), option);
+  check(status == STATUS_OK || status == STATUS_REFUSED, line);
+  return status;
+}
+
+static PumpStatus readStatus(PumpLink& link) {
+  PumpStatus status{};
+  if (!link.status(status)) {
+    check(false, "STATUS answered");
+    status.state = 0xFF;
+  }
+  return status;
+}
+
+using Clock = std::chrono::steady_clock;
+
+struct StateChange {
+  uint8_t state;
+  Clock::time_point at;
+};
+
+// Polls STATUS, recording each state change, until `done` holds for a reply or
+// `millis` pass; `last` is the final reply
+static std::vector<StateChange> watch(PumpLink& link, int millis, const std::function<bool(const PumpStatus&)>& done,
+                                      PumpStatus& last) {
+  std::vector<StateChange> changes;
+  const Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(millis);
+  do {
+    if (!link.status(last)) {
+      break;
+    }
+    if (changes.empty() || changes.back().state != last.state) {
+      changes.push_back({last.state, Clock::now()});
+    }
+  } while (!done(last) && Clock::now() < deadline);
+  return changes;
+}
+
+static bool resting(const PumpStatus& status) {
+  return status.state == RIG_HOLD_POSITION;
+}
+
+static std::string describe(const std::vector<StateChange>& changes) {
+  std::string text;
+  for (const StateChange& change : changes) {
+    text += text.empty() ? "" : " ";
+    text += change.state < sizeof(STATE_NAMES) / sizeof(STATE_NAMES[0]) ? STATE_NAMES[change.state] : "?";
+  }
+  return text;
+}
+
+// True when the states come in the order of `allowed`, each any number of
+// times or not at all, and nothing else does
+static bool inOrder(const std::vector<StateChange>& changes, std::initializer_list<uint8_t> allowed) {
+  auto next = allowed.begin();
+  for (const StateChange& change : changes) {
+    while (next != allowed.end() && *next != change.state) {
+      ++next;
+    }
+    if (next == allowed.end()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Entries into `state` after the first recorded change
+static int entries(const std::vector<StateChange>& changes, uint8_t state) {
+  int count = 0;
+  for (size_t i = 1; i < changes.size(); i++) {
+    count += changes[i].state == state ? 1 : 0;
+  }
+  return count;
+}
+
+static void checkSequence(bool ok, const char* what, const std::vector<StateChange>& changes) {
+  check(ok, what);
+  std::printf("    %s\n", describe(changes).c_str());
+}
+
+static void checkProtocol(PumpLink& link) {
+  PumpStatus before = readStatus(link);
+  check(before.state == RIG_HOLD_POSITION, "rig idles in HOLD_POSITION (pump_sim --idle)");
+
+  // A START with its CRC damaged, then a frame too long for the parser
+  uint8_t frame[COMMAND_MAX_PAYLOAD + 5];
+  const size_t size = encodeCommandFrame(COMMAND_START, nullptr, 0, frame);
+  frame[size - 1] ^= 0x01;
+  const unsigned long startReplies = replies[COMMAND_START];
+  link.sendRaw(frame, size);
+  // Everything after the length byte is read as text; zeros are no diagnostic command
+  const uint8_t oversize[] = {COMMAND_SYNC, COMMAND_MAX_PAYLOAD + 1, COMMAND_STATUS, 0, 0, 0, 0, 0, 0, 0,
+                              0,            0,                       0,              0, 0, 0, 0, 0, 0, 0,
+                              0,            0};
+  link.sendRaw(oversize, sizeof(oversize));
+  PumpStatus after = readStatus(link);
+  check(after.droppedFrames == before.droppedFrames + 2, "bad CRC and oversize frames counted as dropped");
+  check(replies[COMMAND_START] == startReplies, "no reply to the frame with a bad CRC");
+  check(after.state == RIG_HOLD_POSITION, "the START with a bad CRC did not run");
+
+  // Every command, from HOLD_POSITION
+  expectReply(link, "STATUS", COMMAND_STATUS, nullptr, 0, STATUS_OK, 10);
+  expectReply(link, "STOP while idle", COMMAND_STOP, nullptr, 0, STATUS_REFUSED);
+  expectReply(link, "ABORT while idle", COMMAND_ABORT, nullptr, 0, STATUS_REFUSED);
+
+  uint8_t payload[COMMAND_MAX_PAYLOAD] = {};
+  writeU32(payload, 0);
+  expectReply(link, "JOG to 0 (where it stands)", COMMAND_JOG, payload, 4, STATUS_OK);
+  expectReply(link, "JOG with 3 payload bytes", COMMAND_JOG, payload, 3, STATUS_BAD_PAYLOAD);
+
+  payload[0] = PROFILE_TABLES;
+  expectReply(link, "PROFILE tables", COMMAND_PROFILE, payload, 1, STATUS_OK);
+  payload[0] = PROFILE_COUNT;
+  expectReply(link, "PROFILE out of range", COMMAND_PROFILE, payload, 1, STATUS_BAD_PAYLOAD);
+  expectReply(link, "PROFILE without payload", COMMAND_PROFILE, payload, 0, STATUS_BAD_PAYLOAD);
+  learnOption(link.selectProfile(PROFILE_WAVEFORM), "PROFILE waveform", "PLAY_WAVEFORM builds");
+  const uint8_t liveRamp = learnOption(link.selectProfile(PROFILE_LIVE_RAMP), "PROFILE live ramp", "AVR446 variants");
+
+  writeU16(payload, 50);
+  writeU16(payload + 2, 1);
+  writeU16(payload + 4, 20);
+  writeU16(payload + 6, 15);
+  expectReply(link, "RAMPS (50, 1, 20, 15), as PROFILE live ramp", COMMAND_RAMPS, payload, 8, liveRamp);
+  expectReply(link, "RAMPS with 7 payload bytes", COMMAND_RAMPS, payload, 7, STATUS_BAD_PAYLOAD);
+  writeU16(payload + 4, 0);
+  expectReply(link, "RAMPS with no diastole acceleration", COMMAND_RAMPS, payload, 8, STATUS_BAD_PAYLOAD);
+
+  writeU16(payload, 60);
+  expectReply(link, "RATE 60", COMMAND_RATE, payload, 2, STATUS_OK);
+  expectReply(link, "RATE with 1 payload byte", COMMAND_RATE, payload, 1, STATUS_BAD_PAYLOAD);
+  writeU16(payload, 0);
+  expectReply(link, "RATE 0", COMMAND_RATE, payload, 2, STATUS_BAD_PAYLOAD);
+  writeU16(payload, 601);
+  expectReply(link, "RATE 601", COMMAND_RATE, payload, 2, STATUS_BAD_PAYLOAD);
+
+  writeU32(payload, 3600);
+  expectReply(link, "RUNTIME 3600", COMMAND_RUNTIME, payload, 4, STATUS_OK);
+  writeU32(payload, 0);
+  expectReply(link, "RUNTIME 0", COMMAND_RUNTIME, payload, 4, STATUS_BAD_PAYLOAD);
+  writeU32(payload, 4000001);
+  expectReply(link, "RUNTIME 4000001", COMMAND_RUNTIME, payload, 4, STATUS_BAD_PAYLOAD);
+
+  const uint8_t telemetry = learnOption(link.setTelemetry(0), "TELEMETRY off", "TELEMETRY builds");
+  payload[0] = 0x80;
+  expectReply(link, "TELEMETRY unknown class", COMMAND_TELEMETRY, payload, 1,
+              telemetry == STATUS_OK ? STATUS_BAD_PAYLOAD : STATUS_REFUSED);
+  expectReply(link, "TELEMETRY without payload", COMMAND_TELEMETRY, payload, 0,
+              telemetry == STATUS_OK ? STATUS_BAD_PAYLOAD : STATUS_REFUSED);
+
+  expectReply(link, "unknown command 0x33", 0x33, nullptr, 0, STATUS_UNKNOWN_COMMAND);
+
+  // The configuration waits for the next session; leave it on the tables
+  link.selectProfile(PROFILE_TABLES);
+  after = readStatus(link);
+  check(after.configPending && after.profile == before.profile, "configuration pending, active profile unchanged");
+  check(after.droppedFrames == before.droppedFrames + 2, "no frame dropped since");
+}
+
+static void checkSession(PumpLink& link) {
+  PumpStatus last{};
+
+  // START, then ABORT at once: it lands in the systole's acceleration
+  check(link.start() == STATUS_OK, "START from HOLD_POSITION -> OK");
+  PumpStatus running = readStatus(link);
+  check(running.state == RIG_SYSTOLE_ACCEL && !running.configPending && running.profile == PROFILE_TABLES,
+        "session starts in SYSTOLE_ACCEL with the pending configuration");
+  check(link.start() == STATUS_REFUSED, "START while running -> REFUSED");
+  check(link.jog(100) == STATUS_REFUSED, "JOG while running -> REFUSED");
+  check(readStatus(link).state == RIG_SYSTOLE_ACCEL, "still in SYSTOLE_ACCEL");
+  check(link.abort() == STATUS_OK, "ABORT in the systole's acceleration -> OK");
+  std::vector<StateChange> changes = watch(link, 5000, resting, last);
+  checkSequence(!changes.empty() && changes.front().state != RIG_DIASTOLE_ACCEL &&
+                    inOrder(changes, {RIG_SYSTOLE_ACCEL, RIG_SYSTOLE_DECEL, RIG_SHUTDOWN, RIG_HOLD_POSITION}) &&
+                    resting(last) && last.position == 0,
+                "ABORT ramps the stroke down and homes, no diastole", changes);
+  check(link.abort() == STATUS_REFUSED, "ABORT while idle -> REFUSED");
+
+  // RATE waits for the next session
+  check(link.setRate(80) == STATUS_OK, "RATE 80 -> OK");
+  check(readStatus(link).configPending, "RATE pending until START");
+  check(link.start() == STATUS_OK, "START -> OK");
+  check(!readStatus(link).configPending, "START applies RATE");
+  changes.clear();
+  {
+    // Three beat starts after the first, two periods of 750 ms at 80 bpm (a
+    // rate every variant's beat fits in; a faster one is held to the beat)
+    const Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(4000);
+    while (entries(changes, RIG_SYSTOLE_ACCEL) < 3 && Clock::now() < deadline && link.status(last)) {
+      if (changes.empty() || changes.back().state != last.state) {
+        changes.push_back({last.state, Clock::now()});
+      }
+    }
+  }
+  std::vector<Clock::time_point> beats;
+  for (size_t i = 1; i < changes.size(); i++) {
+    if (changes[i].state == RIG_SYSTOLE_ACCEL) {
+      beats.push_back(changes[i].at);
+    }
+  }
+  const double period =
+      beats.size() >= 3 ? std::chrono::duration<double, std::milli>(beats[2] - beats[0]).count() / 2 : 0;
+  char line[128];
+  std::snprintf(line, sizeof(line), "beats at RATE 80 every 750 ms (%.0f ms)", period);
+  check(period > 710 && period < 790, line);
+  check(link.setRate(60) == STATUS_OK && readStatus(link).configPending, "RATE while running -> OK, pending");
+
+  // STOP finishes the beat in progress and starts no other
+  check(link.stop() == STATUS_OK, "STOP while running -> OK");
+  check(readStatus(link).stopping, "STATUS reports the session stopping");
+  changes = watch(link, 5000, resting, last);
+  checkSequence(!changes.empty() && entries(changes, RIG_SYSTOLE_ACCEL) == 0 &&
+                    inOrder(changes, {RIG_SYSTOLE_ACCEL, RIG_SYSTOLE_DECEL, RIG_DIASTOLE_ACCEL, RIG_DIASTOLE_DECEL,
+                                      RIG_RETURN_TO_START, RIG_CYCLE_COMPLETE, RIG_SHUTDOWN, RIG_HOLD_POSITION}) &&
+                    resting(last) && last.position == 0,
+                "STOP ends the session after the beat, at home", changes);
+  check(link.stop() == STATUS_REFUSED, "STOP while idle -> REFUSED");
+
+  // JOG out to both sides and back; a JOG while one moves is refused
+  for (int32_t target : {250, -120, 5000, 0}) {
+    std::snprintf(line, sizeof(line), "JOG to %ld -> OK", static_cast<long>(target));
+    check(link.jog(target) == STATUS_OK, line);
+    if (target == 5000) {
+      check(link.jog(0) == STATUS_REFUSED, "JOG while moving -> REFUSED");
+    }
+    changes = watch(link, 5000, resting, last);
+    std::snprintf(line, sizeof(line), "JOG lands on %ld (%ld)", static_cast<long>(target), static_cast<long>(last.position));
+    checkSequence(inOrder(changes, {RIG_RETURN_TO_MANUAL_POSITION, RIG_HOLD_POSITION}) && resting(last) &&
+                      last.position == target,
+                  line, changes);
+  }
+}
+
+int main(int argc, char** argv) {
+  if (argc != 2) {
+    std::fprintf(stderr, "usage: %s PORT\n", argv[0]);
+    return 2;
+  }
+  PumpLink link;
+  if (!link.open(argv[1])) {
+    std::perror(argv[1]);
+    return 2;
+  }
+  CommandParser parser;
+  CommandFrame seen{};
+  link.setMonitor([&parser, &seen](const uint8_t* data, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+      if (parser.feed(data[i], seen) == CommandParser::FRAME && (seen.command & COMMAND_REPLY) != 0) {
+        replies[seen.command & ~COMMAND_REPLY]++;
+      }
+    }
+  });
+
+  checkProtocol(link);
+  checkSession(link);
+
+  std::printf("\n%s\n", failures == 0 ? "all checks passed" : "FAILED");
+  return failures == 0 ? 0 : 1;
+}
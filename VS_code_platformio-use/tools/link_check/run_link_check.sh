@@ -0,0 +1,46 @@
+#!/bin/sh
+# Runs tools/link_check against pump_sim --pty --idle for each configuration:
+# starts the simulated rig, waits for it to print its pty and hands that to
+# the check as its serial port.
+#
+#   tools/link_check/run_link_check.sh
+#
+# Check output and pump_sim logs are left in .pio/link_check/.
+set -e
+cd "$(dirname "$0")/../.."
+
+OUT=.pio/link_check
+
+# name:environment
+CONFIGS="main:native sinusoidal:native_sinusoidal"
+
+ENVS="-e link_check"
+for config in $CONFIGS; do
+  ENVS="$ENVS -e ${config#*:}"
+done
+pio run -s $ENVS
+
+mkdir -p "$OUT"
+status=0
+for config in $CONFIGS; do
+  name=${config%%:*}
+  ".pio/build/${config#*:}/program" --pty --idle --seconds 3600 > "$OUT/$name.log" 2> "$OUT/$name.err" &
+  sim=$!
+  port=""
+  tries=0
+  while [ -z "$port" ] && [ $tries -lt 50 ]; do
+    sleep 0.1
+    port=$(sed -n 's/^serial port on //p' "$OUT/$name.err")
+    tries=$((tries + 1))
+  done
+  if [ -n "$port" ] && .pio/build/link_check/program "$port" > "$OUT/$name.check"; then
+    echo "$name PASS"
+  else
+    echo "$name FAIL"
+    cat "$OUT/$name.check" "$OUT/$name.err" 2> /dev/null || true
+    status=1
+  fi
+  kill $sim 2> /dev/null || true
+  wait $sim 2> /dev/null || true
+done
+exit $status
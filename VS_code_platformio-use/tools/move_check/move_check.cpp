@@ -0,0 +1,256 @@
+// Host check of the homing moves on the native HAL.
+//
+// Runs the unmodified firmware and makes it home in every way it can: JOG
+// commands from HOLD_POSITION to targets on both sides of home and back
+// (RETURN_TO_MANUAL_POSITION), and sessions aborted at points throughout the
+// first beat, which SHUTDOWN homes from mid-stroke. Every move must
+//   - stop exactly on its target, after exactly as many steps as it is long,
+//     all in one direction;
+//   - step at the intervals of its planned PointMove, to the microsecond;
+//   - take the time of the float AVR446 reference walked the same way, within
+//     the fixed-point ramp's 1 us per step;
+//   - once it is long enough to get there, cruise at MOVE_FLOOR_MICROS.
+// Prints one line per move; exit status 1 when any check fails.
+//
+//   pio run -e move_check && .pio/build/move_check/program
+
+#include "command_protocol.h"
+#include "fixed_ramp.h"
+#include "main.h"
+#include "point_move.h"
+#include "step_timer.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+// Virtual time charged to a loop() pass that makes no progress while the step
+// engine is idle, as in pump_sim
+constexpr unsigned long IDLE_PASS_MICROS = 10;
+constexpr unsigned long long MOVE_TIMEOUT_MICROS = 10ULL * 1000000ULL;
+
+static const long JOG_DISTANCES[] = {1, 2, 3, 10, 100, 400, 807, 1200, 5000};
+static const unsigned long ABORT_AFTER_MICROS[] = {5000, 50000, 120000, 200000, 300000, 450000, 650000};
+
+struct Move {
+  State state;
+  long from;
+  long target;
+  std::vector<unsigned long long> pulses;
+  bool oneDirection;
+  int delta;  // Of the first pulse
+};
+
+static std::vector<Move> moves;
+static long tracedPosition = 0;
+static long homingTarget = 0;
+static std::vector<uint8_t> serialOut;
+
+static bool isHoming(State state) {
+  return state == State::RETURN_TO_START || state == State::SHUTDOWN || state == State::RETURN_TO_MANUAL_POSITION;
+}
+
+static void onPinChange(uint8_t pin, uint8_t level, unsigned long long nowMicros) {
+  if (pin != STEP_PIN || level != HIGH) {
+    return;
+  }
+  const int delta = digitalRead(DIR_PIN) == HIGH ? -1 : 1;  // DIR high is clockwise, counted down
+  tracedPosition += delta;
+  if (isHoming(currentState) && !moves.empty()) {
+    Move& move = moves.back();
+    if (move.pulses.empty()) {
+      move.delta = delta;
+    }
+    move.oneDirection = move.oneDirection && delta == move.delta;
+    move.pulses.push_back(nowMicros);
+  }
+}
+
+static void onSerial(const uint8_t* data, size_t size) {
+  serialOut.insert(serialOut.end(), data, data + size);
+}
+
+// Status byte of the last reply to `command` the firmware has sent, -1 if none
+static int replyStatus(uint8_t command) {
+  CommandParser parser;
+  CommandFrame frame{};
+  int status = -1;
+  for (uint8_t byte : serialOut) {
+    if (parser.feed(byte, frame) == CommandParser::FRAME && frame.command == (command | COMMAND_REPLY) &&
+        frame.length > 0) {
+      status = frame.payload[0];
+    }
+  }
+  return status;
+}
+
+// One loop() pass; jumps the clock to the next step deadline when the pass
+// made no progress, so the moves run at their exact intervals
+static void pass() {
+  const State before = currentState;
+  const uint8_t queuedBefore = stepTimerQueued();
+  loop();
+  if (currentState != before) {
+    if (isHoming(currentState)) {
+      const long target = currentState == State::RETURN_TO_MANUAL_POSITION ? homingTarget : 0;
+      moves.push_back({currentState, readCyclePosition(), target, {}, true, 0});
+    }
+  } else if (stepTimerQueued() == queuedBefore) {
+    const unsigned long toNext = stepTimerMicrosToNextStep();
+    halAdvance(toNext != 0 ? toNext : IDLE_PASS_MICROS);
+  }
+}
+
+// Sends a command and runs until the firmware has answered it; its status, -1 on timeout
+static int sendCommand(uint8_t command, const uint8_t* payload, uint8_t length) {
+  uint8_t frame[COMMAND_MAX_PAYLOAD + 5];
+  serialOut.clear();
+  halSerialInject(frame, encodeCommandFrame(command, payload, length, frame));
+  const unsigned long long limit = halNowMicros() + MOVE_TIMEOUT_MICROS;
+  while (replyStatus(command) < 0 && halNowMicros() < limit) {
+    pass();
+  }
+  return replyStatus(command);
+}
+
+// Runs until the firmware rests in HOLD_POSITION; false on timeout
+static bool runToHold() {
+  const unsigned long long limit = halNowMicros() + MOVE_TIMEOUT_MICROS;
+  do {
+    pass();
+  } while ((currentState != State::HOLD_POSITION || !stepTimerIdle()) && halNowMicros() < limit);
+  return currentState == State::HOLD_POSITION;
+}
+
+// Float AVR446 reference of the move's time, first pulse to last
+static double modelMicros(long length) {
+  FloatRamp ramp;
+  ramp.begin(MOVE_ACCEL_MILLI / 1000.0f, MOVE_FLOOR_MICROS);
+  double total = 0;
+  for (long step = 1; step < length; step++) {
+    const long index = std::min<long>(std::min(step, length - 1 - step), FIXED_RAMP_MAX_STEPS - 1);
+    total += ramp.delayAt(static_cast<int>(index));
+  }
+  return total;
+}
+
+// Steps the reference needs to reach the floor, accelerating from rest
+static long stepsToFloor() {
+  FloatRamp ramp;
+  ramp.begin(MOVE_ACCEL_MILLI / 1000.0f, MOVE_FLOOR_MICROS);
+  for (int index = 0; index < FIXED_RAMP_MAX_STEPS; index++) {
+    if (ramp.delayAt(index) <= MOVE_FLOOR_MICROS) {
+      return index + 1;
+    }
+  }
+  return FIXED_RAMP_MAX_STEPS + 1;
+}
+
+static unsigned int clampInterval(unsigned int micros) {
+  return std::min(std::max(micros, MIN_STEP_INTERVAL_US), MAX_STEP_INTERVAL_US);
+}
+
+static const char* stateName(State state) {
+  switch (state) {
+    case State::RETURN_TO_START:
+      return "RETURN_TO_START";
+    case State::SHUTDOWN:
+      return "SHUTDOWN";
+    default:
+      return "RETURN_TO_MANUAL_POSITION";
+  }
+}
+
+// Checks one finished move; prints it and returns false on any failure
+static bool checkMove(const Move& move, long landed, const char* label) {
+  const long length = std::labs(move.target - move.from);
+  const long steps = static_cast<long>(move.pulses.size());
+  bool ok = steps == length && landed == move.target && (length == 0 || move.oneDirection) &&
+            (length == 0 || move.delta == (move.target < move.from ? -1 : 1));
+
+  PointMove planned;
+  planned.begin(move.from, move.target, MOVE_ACCEL_MILLI, MOVE_FLOOR_MICROS);
+  long mismatches = 0;
+  unsigned long long shortest = 0;
+  for (long s = 0; s < steps && !planned.done(); s++) {
+    const unsigned int expected = clampInterval(planned.delay());
+    planned.advance();
+    if (s > 0) {
+      const unsigned long long interval = move.pulses[s] - move.pulses[s - 1];
+      mismatches += interval != expected;
+      shortest = shortest == 0 ? interval : std::min(shortest, interval);
+    }
+  }
+  ok = ok && mismatches == 0;
+
+  const double micros = steps > 1 ? static_cast<double>(move.pulses.back() - move.pulses.front()) : 0;
+  const double model = modelMicros(length);
+  ok = ok && std::abs(micros - model) <= static_cast<double>(std::max(0L, length - 1));
+
+  const bool cruises = length >= 2 * stepsToFloor();
+  ok = ok && (!cruises || shortest == MOVE_FLOOR_MICROS);
+
+  std::printf("%-28s %-26s %6ld -> %6ld %6ld %11.0f %11.0f %6llu %10ld  %s\n", label, stateName(move.state), move.from,
+              move.target, steps, micros, model, shortest, mismatches, ok ? "ok" : "FAIL");
+  return ok;
+}
+
+int main() {
+  halReset();
+  halSetPinListener(onPinChange);
+  halSetSerialListener(onSerial);
+  setup();
+
+  std::printf("limits: accel %u milli, floor %u us, floor reached after %ld steps\n\n", MOVE_ACCEL_MILLI,
+              MOVE_FLOOR_MICROS, stepsToFloor());
+  std::printf("%-28s %-26s %16s %6s %11s %11s %6s %10s\n", "scenario", "state", "from -> to", "steps", "time us",
+              "model us", "peak", "mismatches");
+  bool allOk = true;
+  char label[64];
+
+  // Sessions aborted throughout the first beat; the first is the one setup() starts
+  for (size_t i = 0; i < sizeof(ABORT_AFTER_MICROS) / sizeof(ABORT_AFTER_MICROS[0]); i++) {
+    const unsigned long long startedAt = halNowMicros();
+    const bool started = i == 0 || sendCommand(COMMAND_START, nullptr, 0) == STATUS_OK;
+    while (halNowMicros() < startedAt + ABORT_AFTER_MICROS[i]) {
+      pass();
+    }
+    const size_t first = moves.size();
+    const bool aborted = sendCommand(COMMAND_ABORT, nullptr, 0) == STATUS_OK;
+    const bool held = runToHold();
+    std::snprintf(label, sizeof(label), "abort %lu ms into the beat", ABORT_AFTER_MICROS[i] / 1000);
+    if (!started || !aborted || !held || moves.size() != first + 1) {
+      std::printf("%-28s did not home in one move (state %d, %zu moves)  FAIL\n", label, static_cast<int>(currentState),
+                  moves.size() - first);
+      allOk = false;
+      continue;
+    }
+    allOk = checkMove(moves.back(), readCyclePosition(), label) && allOk;
+    allOk = tracedPosition == readCyclePosition() && allOk;
+  }
+
+  // JOG out to each distance on both sides and back home
+  for (long distance : JOG_DISTANCES) {
+    for (long target : {distance, 0L, -distance, 0L}) {
+      homingTarget = target;
+      uint8_t payload[4];
+      writeU32(payload, static_cast<uint32_t>(target));
+      const size_t first = moves.size();
+      const bool jogged = sendCommand(COMMAND_JOG, payload, sizeof(payload)) == STATUS_OK;
+      const bool held = runToHold();
+      std::snprintf(label, sizeof(label), "jog to %ld", target);
+      if (!jogged || !held || moves.size() != first + 1) {
+        std::printf("%-28s did not move in one go (state %d, %zu moves)  FAIL\n", label,
+                    static_cast<int>(currentState), moves.size() - first);
+        allOk = false;
+        continue;
+      }
+      allOk = checkMove(moves.back(), readCyclePosition(), label) && allOk;
+      allOk = tracedPosition == readCyclePosition() && allOk;
+    }
+  }
+
+  std::printf("\n%s\n", allOk ? "all moves exact" : "FAILED");
+  return allOk ? 0 : 1;
+}
@@ -0,0 +1,204 @@
+#include "pump_link.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <chrono>
+
+PumpLink::~PumpLink() {
+  close();
+}
+
+bool PumpLink::open(const char* path) {
+  close();
+  fd = ::open(path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+  if (fd < 0) {
+    return false;
+  }
+  termios tio{};
+  if (tcgetattr(fd, &tio) == 0) {
+    cfmakeraw(&tio);
+    cfsetispeed(&tio, B115200);
+    cfsetospeed(&tio, B115200);
+    tcsetattr(fd, TCSANOW, &tio);
+  }
+  parser = CommandParser();
+  return true;
+}
+
+void PumpLink::close() {
+  if (fd >= 0) {
+    ::close(fd);
+    fd = -1;
+  }
+}
+
+bool PumpLink::sendRaw(const uint8_t* data, size_t size) {
+  size_t written = 0;
+  while (written < size) {
+    const ssize_t put = ::write(fd, data + written, size - written);
+    if (put < 0) {
+      pollfd waiter{fd, POLLOUT, 0};
+      if (::poll(&waiter, 1, 100) <= 0) {
+        return false;
+      }
+      continue;
+    }
+    written += static_cast<size_t>(put);
+  }
+  return true;
+}
+
+bool PumpLink::consume(uint8_t command, CommandFrame& reply) {
+  while (!backlog.empty()) {
+    const uint8_t byte = backlog.front();
+    backlog.pop_front();
+    switch (parser.feed(byte, frame)) {
+      case CommandParser::FRAME:
+        if (command != 0 && frame.command == (command | COMMAND_REPLY) && frame.length >= 1) {
+          reply = frame;
+          return true;  // Anything after the reply stays in the backlog
+        }
+        break;
+      case CommandParser::TEXT:
+        if (byte == '\n') {
+          lines.push_back(partialLine);
+          partialLine.clear();
+        } else if (byte != '\r') {
+          partialLine += static_cast<char>(byte);
+        }
+        break;
+      default:
+        break;
+    }
+  }
+  return false;
+}
+
+bool PumpLink::pump(int timeoutMillis, uint8_t command, CommandFrame& reply) {
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMillis);
+  for (;;) {
+    if (consume(command, reply)) {
+      return true;
+    }
+    const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+    if (left.count() <= 0) {
+      return false;
+    }
+    pollfd waiter{fd, POLLIN, 0};
+    if (::poll(&waiter, 1, static_cast<int>(left.count())) <= 0) {
+      return false;
+    }
+    uint8_t buffer[256];
+    const ssize_t got = ::read(fd, buffer, sizeof(buffer));
+    if (got <= 0) {
+      return false;
+    }
+    if (monitor) {
+      monitor(buffer, static_cast<size_t>(got));
+    }
+    backlog.insert(backlog.end(), buffer, buffer + got);
+  }
+}
+
+bool PumpLink::transact(uint8_t command, const uint8_t* payload, uint8_t length, uint8_t& status,
+                        std::vector<uint8_t>* reply, int timeoutMillis) {
+  uint8_t out[COMMAND_MAX_PAYLOAD + 5];
+  if (fd < 0 || length > COMMAND_MAX_PAYLOAD || !sendRaw(out, encodeCommandFrame(command, payload, length, out))) {
+    return false;
+  }
+  CommandFrame answer{};
+  if (!pump(timeoutMillis, command, answer)) {
+    return false;
+  }
+  status = answer.payload[0];
+  if (reply != nullptr) {
+    reply->assign(answer.payload + 1, answer.payload + answer.length);
+  }
+  return true;
+}
+
+uint8_t PumpLink::simple(uint8_t command, const uint8_t* payload, uint8_t length) {
+  uint8_t status = STATUS_TIMEOUT;
+  if (!transact(command, payload, length, status)) {
+    return STATUS_TIMEOUT;
+  }
+  return status;
+}
+
+bool PumpLink::status(PumpStatus& out) {
+  uint8_t status = STATUS_TIMEOUT;
+  std::vector<uint8_t> reply;
+  if (!transact(COMMAND_STATUS, nullptr, 0, status, &reply) || status != STATUS_OK || reply.size() < 10) {
+    return false;
+  }
+  out.state = reply[0];
+  out.profile = reply[1];
+  out.position = static_cast<int32_t>(readU32(&reply[2]));
+  out.stopping = reply[6] != 0;
+  out.droppedFrames = readU16(&reply[7]);
+  out.configPending = reply[9] != 0;
+  return true;
+}
+
+uint8_t PumpLink::start() {
+  return simple(COMMAND_START, nullptr, 0);
+}
+
+uint8_t PumpLink::stop() {
+  return simple(COMMAND_STOP, nullptr, 0);
+}
+
+uint8_t PumpLink::abort() {
+  return simple(COMMAND_ABORT, nullptr, 0);
+}
+
+uint8_t PumpLink::jog(int32_t position) {
+  uint8_t payload[4];
+  writeU32(payload, static_cast<uint32_t>(position));
+  return simple(COMMAND_JOG, payload, sizeof(payload));
+}
+
+uint8_t PumpLink::selectProfile(uint8_t profile) {
+  return simple(COMMAND_PROFILE, &profile, 1);
+}
+
+uint8_t PumpLink::setRamps(uint16_t systoleAccelMilli, uint16_t systoleFloor, uint16_t diastoleAccelMilli,
+                           uint16_t diastoleFloor) {
+  uint8_t payload[8];
+  writeU16(&payload[0], systoleAccelMilli);
+  writeU16(&payload[2], systoleFloor);
+  writeU16(&payload[4], diastoleAccelMilli);
+  writeU16(&payload[6], diastoleFloor);
+  return simple(COMMAND_RAMPS, payload, sizeof(payload));
+}
+
+uint8_t PumpLink::setRate(uint16_t beatsPerMinute) {
+  uint8_t payload[2];
+  writeU16(payload, beatsPerMinute);
+  return simple(COMMAND_RATE, payload, sizeof(payload));
+}
+
+uint8_t PumpLink::setRuntime(uint32_t seconds) {
+  uint8_t payload[4];
+  writeU32(payload, seconds);
+  return simple(COMMAND_RUNTIME, payload, sizeof(payload));
+}
+
+uint8_t PumpLink::setTelemetry(uint8_t classes) {
+  return simple(COMMAND_TELEMETRY, &classes, 1);
+}
+
+std::vector<std::string> PumpLink::readText(int timeoutMillis) {
+  CommandFrame ignored{};
+  pump(timeoutMillis, 0, ignored);
+  return takeText();
+}
+
+std::vector<std::string> PumpLink::takeText() {
+  std::vector<std::string> out;
+  out.swap(lines);
+  return out;
+}
@@ -0,0 +1,88 @@
+#ifndef PUMP_LINK_H
+#define PUMP_LINK_H
+
+// Host side of the framed command protocol (src/command_protocol.h).
+//
+// PumpLink owns a serial port (a real /dev/ttyACM* or the pty printed by
+// pump_sim --pty), sends command frames and waits for the matching reply.
+// Text the firmware prints between frames (diagnostic dumps, beat reports) is
+// collected line by line instead of being mistaken for frame bytes.
+
+#include "command_protocol.h"
+
+#include <stdint.h>
+
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+struct PumpStatus {
+  uint8_t state;
+  uint8_t profile;
+  int32_t position;
+  bool stopping;
+  uint16_t droppedFrames;
+  bool configPending;
+};
+
+class PumpLink {
+ public:
+  PumpLink() = default;
+  ~PumpLink();
+  PumpLink(const PumpLink&) = delete;
+  PumpLink& operator=(const PumpLink&) = delete;
+
+  // Opens the port raw at 115200 baud; false (with errno set) on failure
+  bool open(const char* path);
+  void close();
+
+  // Sends a command and waits for its reply. Returns false on timeout;
+  // otherwise `status` holds the reply status and `reply` the bytes after it.
+  bool transact(uint8_t command, const uint8_t* payload, uint8_t length, uint8_t& status,
+                std::vector<uint8_t>* reply = nullptr, int timeoutMillis = 1000);
+
+  bool status(PumpStatus& out);
+  uint8_t start();
+  uint8_t stop();
+  uint8_t abort();
+  uint8_t jog(int32_t position);
+  uint8_t selectProfile(uint8_t profile);
+  uint8_t setRamps(uint16_t systoleAccelMilli, uint16_t systoleFloor, uint16_t diastoleAccelMilli,
+                   uint16_t diastoleFloor);
+  uint8_t setRate(uint16_t beatsPerMinute);
+  uint8_t setRuntime(uint32_t seconds);
+  uint8_t setTelemetry(uint8_t classes);  // TelemetryClass mask, 0 to stop
+
+  // Called with every chunk read from the port, before it is parsed (e.g. a
+  // TelemetryDecoder watching the same stream)
+  void setMonitor(std::function<void(const uint8_t*, size_t)> callback) { monitor = std::move(callback); }
+
+  // Sends raw bytes, e.g. a single-letter diagnostic command
+  bool sendRaw(const uint8_t* data, size_t size);
+
+  // Reads for up to timeoutMillis and returns the complete text lines received
+  std::vector<std::string> readText(int timeoutMillis);
+
+  // Text lines received while waiting for replies, oldest first
+  std::vector<std::string> takeText();
+
+  static const uint8_t STATUS_TIMEOUT = 0xFF;  // Returned by the helpers when no reply came
+
+ private:
+  // Reads for up to timeoutMillis; true as soon as a reply frame for `command`
+  // has been parsed (command 0 only collects text)
+  bool pump(int timeoutMillis, uint8_t command, CommandFrame& reply);
+  bool consume(uint8_t command, CommandFrame& reply);
+  uint8_t simple(uint8_t command, const uint8_t* payload, uint8_t length);
+
+  int fd = -1;
+  CommandParser parser;
+  CommandFrame frame{};
+  std::deque<uint8_t> backlog;  // Received but not yet parsed
+  std::string partialLine;
+  std::vector<std::string> lines;
+  std::function<void(const uint8_t*, size_t)> monitor;
+};
+
+#endif // PUMP_LINK_H
@@ -0,0 +1,131 @@
+// Command-line client for a pump rig (or pump_sim --pty).
+//
+//   pio run -e pump_link
+//   .pio/build/pump_link/program PORT status
+//   .pio/build/pump_link/program PORT start | stop | abort
+//   .pio/build/pump_link/program PORT jog POSITION
+//   .pio/build/pump_link/program PORT profile tables|ramp|waveform
+//   .pio/build/pump_link/program PORT ramps SYS_ACCEL SYS_FLOOR DIA_ACCEL DIA_FLOOR
+//   .pio/build/pump_link/program PORT rate BPM
+//   .pio/build/pump_link/program PORT runtime SECONDS
+//   .pio/build/pump_link/program PORT text LETTERS [SECONDS]
+//   .pio/build/pump_link/program PORT record FILE SECONDS [CLASSES]
+//
+// "text" sends single-letter diagnostic commands ('B', 'J', 'P') and prints
+// the lines that come back for SECONDS (default 2).
+//
+// "record" turns on the telemetry classes in CLASSES (a TelemetryClass mask,
+// default all) of a TELEMETRY build, writes the decoded records to FILE for
+// SECONDS, then turns the stream off again and prints the record counters.
+
+#include "pump_link.h"
+#include "telemetry.h"
+#include "telemetry_decoder.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static const char* const STATUS_TEXT[] = {"ok", "unknown command", "bad payload", "refused"};
+
+static int report(uint8_t status) {
+  if (status == PumpLink::STATUS_TIMEOUT) {
+    std::puts("no reply");
+    return 1;
+  }
+  std::puts(status < sizeof(STATUS_TEXT) / sizeof(STATUS_TEXT[0]) ? STATUS_TEXT[status] : "?");
+  return status == STATUS_OK ? 0 : 1;
+}
+
+static int usage(const char* program) {
+  std::fprintf(stderr,
+               "usage: %s PORT status|start|stop|abort|jog N|profile tables|ramp|waveform|"
+               "ramps A F A F|rate BPM|runtime S|text LETTERS [S]|record FILE S [CLASSES]\n",
+               program);
+  return 2;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    return usage(argv[0]);
+  }
+  PumpLink link;
+  if (!link.open(argv[1])) {
+    std::perror(argv[1]);
+    return 1;
+  }
+  const char* verb = argv[2];
+  auto arg = [&](int index) { return index < argc ? std::strtol(argv[index], nullptr, 10) : 0L; };
+
+  if (std::strcmp(verb, "status") == 0) {
+    PumpStatus status{};
+    if (!link.status(status)) {
+      std::puts("no reply");
+      return 1;
+    }
+    std::printf("state %u profile %u position %ld stopping %d dropped %u pending %d\n", status.state, status.profile,
+                static_cast<long>(status.position), status.stopping, status.droppedFrames, status.configPending);
+    return 0;
+  }
+  if (std::strcmp(verb, "start") == 0) {
+    return report(link.start());
+  }
+  if (std::strcmp(verb, "stop") == 0) {
+    return report(link.stop());
+  }
+  if (std::strcmp(verb, "abort") == 0) {
+    return report(link.abort());
+  }
+  if (std::strcmp(verb, "jog") == 0 && argc == 4) {
+    return report(link.jog(static_cast<int32_t>(arg(3))));
+  }
+  if (std::strcmp(verb, "profile") == 0 && argc == 4) {
+    const char* name = argv[3];
+    const uint8_t profile = std::strcmp(name, "ramp") == 0       ? PROFILE_LIVE_RAMP
+                            : std::strcmp(name, "waveform") == 0 ? PROFILE_WAVEFORM
+                                                                 : PROFILE_TABLES;
+    return report(link.selectProfile(profile));
+  }
+  if (std::strcmp(verb, "ramps") == 0 && argc == 7) {
+    return report(link.setRamps(static_cast<uint16_t>(arg(3)), static_cast<uint16_t>(arg(4)),
+                                static_cast<uint16_t>(arg(5)), static_cast<uint16_t>(arg(6))));
+  }
+  if (std::strcmp(verb, "rate") == 0 && argc == 4) {
+    return report(link.setRate(static_cast<uint16_t>(arg(3))));
+  }
+  if (std::strcmp(verb, "runtime") == 0 && argc == 4) {
+    return report(link.setRuntime(static_cast<uint32_t>(arg(3))));
+  }
+  if (std::strcmp(verb, "text") == 0 && argc >= 4) {
+    link.sendRaw(reinterpret_cast<const uint8_t*>(argv[3]), std::strlen(argv[3]));
+    const int seconds = argc >= 5 ? static_cast<int>(arg(4)) : 2;
+    for (const std::string& line : link.readText(seconds * 1000)) {
+      std::puts(line.c_str());
+    }
+    return 0;
+  }
+  if (std::strcmp(verb, "record") == 0 && argc >= 5) {
+    FILE* session = std::fopen(argv[3], "w");
+    if (session == nullptr) {
+      std::perror(argv[3]);
+      return 1;
+    }
+    TelemetryDecoder decoder(session);
+    link.setMonitor([&decoder](const uint8_t* data, size_t size) { decoder.feed(data, size); });
+    const uint8_t classes = argc >= 6 ? static_cast<uint8_t>(std::strtol(argv[5], nullptr, 0)) : static_cast<uint8_t>(TELEMETRY_ALL);
+    const uint8_t status = link.setTelemetry(classes);
+    if (status != STATUS_OK) {
+      std::fclose(session);
+      return report(status);
+    }
+    link.readText(static_cast<int>(arg(4)) * 1000);
+    link.setTelemetry(0);
+    std::fclose(session);
+    const TelemetryDecoder::Counters& counters = decoder.counters();
+    std::printf("records %llu lost %llu corrupt %llu text bytes %llu\n",
+                static_cast<unsigned long long>(counters.records), static_cast<unsigned long long>(counters.lost),
+                static_cast<unsigned long long>(counters.corrupt), static_cast<unsigned long long>(counters.textBytes));
+    return 0;
+  }
+  return usage(argv[0]);
+}
@@ -0,0 +1,141 @@
+#include "rig_channel.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+RigChannel::~RigChannel() {
+  pending.clear();  // Owners may be half destroyed; nobody is told
+  close();
+}
+
+bool RigChannel::open(const char* path) {
+  close();
+  port = ::open(path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+  if (port < 0) {
+    return false;
+  }
+  termios tio{};
+  if (tcgetattr(port, &tio) == 0) {
+    cfmakeraw(&tio);
+    cfsetispeed(&tio, B115200);
+    cfsetospeed(&tio, B115200);
+    tcsetattr(port, TCSANOW, &tio);
+  }
+  parser = CommandParser();
+  return true;
+}
+
+void RigChannel::close() {
+  if (port >= 0) {
+    ::close(port);
+    port = -1;
+  }
+  // Whoever is waiting hears about it
+  while (!pending.empty()) {
+    finish(STATUS_TIMEOUT, nullptr, 0);
+  }
+}
+
+bool RigChannel::send(uint8_t command, const uint8_t* payload, uint8_t length, ReplyHandler done,
+                      uint64_t timeoutMicros) {
+  if (port < 0 || length > COMMAND_MAX_PAYLOAD || pending.size() >= RIG_QUEUE_DEPTH) {
+    return false;
+  }
+  pending.emplace_back();
+  Pending& next = pending.back();
+  next.size = static_cast<uint8_t>(encodeCommandFrame(command, payload, length, next.frame));
+  next.command = command;
+  next.timeoutMicros = timeoutMicros;
+  next.done = std::move(done);
+  return true;
+}
+
+bool RigChannel::onWritable(uint64_t nowMicros) {
+  while (wantsWrite()) {
+    const Pending& front = pending.front();
+    const ssize_t put = ::write(port, front.frame + written, front.size - written);
+    if (put < 0) {
+      return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    }
+    written += static_cast<size_t>(put);
+    stats.bytesOut += static_cast<uint64_t>(put);
+    if (written == front.size) {
+      replyDue = nowMicros + front.timeoutMicros;
+    }
+  }
+  return true;
+}
+
+bool RigChannel::onReadable(size_t budget, uint64_t) {
+  uint8_t buffer[256];
+  while (budget > 0) {
+    const ssize_t got = ::read(port, buffer, budget < sizeof(buffer) ? budget : sizeof(buffer));
+    if (got == 0) {
+      return false;
+    }
+    if (got < 0) {
+      return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+    }
+    budget -= static_cast<size_t>(got);
+    stats.bytesIn += static_cast<uint64_t>(got);
+    if (monitor) {
+      monitor(buffer, static_cast<size_t>(got));
+    }
+    for (ssize_t i = 0; i < got; i++) {
+      const uint8_t byte = buffer[i];
+      switch (parser.feed(byte, frame)) {
+        case CommandParser::FRAME:
+          // Telemetry records share the framing; only a reply to the command
+          // in flight completes it
+          if (written > 0 && !pending.empty() && frame.command == (pending.front().command | COMMAND_REPLY) &&
+              frame.length >= 1) {
+            stats.replies++;
+            finish(frame.payload[0], frame.payload + 1, static_cast<uint8_t>(frame.length - 1));
+          }
+          break;
+        case CommandParser::TEXT:
+          if (byte == '\n' || partialLine.size() >= RIG_MAX_LINE) {
+            if (text) {
+              text(partialLine);
+            }
+            partialLine.clear();
+          }
+          if (byte != '\n' && byte != '\r') {
+            partialLine += static_cast<char>(byte);
+          }
+          break;
+        case CommandParser::DROPPED:
+          stats.dropped++;
+          break;
+        default:
+          break;
+      }
+    }
+  }
+  return true;
+}
+
+void RigChannel::expire(uint64_t nowMicros) {
+  if (nowMicros >= replyDue) {
+    stats.timeouts++;
+    finish(STATUS_TIMEOUT, nullptr, 0);
+  }
+}
+
+uint64_t RigChannel::deadline() const {
+  return replyDue;
+}
+
+void RigChannel::finish(uint8_t status, const uint8_t* reply, uint8_t length) {
+  // The handler may queue the next command, so take it off first
+  ReplyHandler done = std::move(pending.front().done);
+  pending.pop_front();
+  written = 0;
+  replyDue = UINT64_MAX;
+  if (done) {
+    done(status, reply, length);
+  }
+}
@@ -0,0 +1,100 @@
+#ifndef RIG_CHANNEL_H
+#define RIG_CHANNEL_H
+
+// Non-blocking host side of the framed command protocol, for driving many
+// rigs from one event loop (tools/rig_daemon).
+//
+// PumpLink waits for each reply; a RigChannel never blocks. The loop watches
+// fd() for input, and for output while wantsWrite(), and calls onReadable(),
+// onWritable() and expire() as they are due. Commands are queued with a
+// handler for their reply and go out one at a time, the next when the last is
+// answered or has timed out, since replies carry no sequence number. The queue
+// holds at most RIG_QUEUE_DEPTH commands: send() refuses more, so a rig that
+// stops answering pushes back on whoever commands it instead of growing a
+// backlog. Every byte read is parsed at once; nothing received is buffered
+// beyond a partial text line.
+
+#include "command_protocol.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <deque>
+#include <functional>
+#include <string>
+
+constexpr size_t RIG_QUEUE_DEPTH = 8;
+constexpr size_t RIG_MAX_LINE = 256;  // Longer text lines are split
+
+class RigChannel {
+ public:
+  // status is STATUS_TIMEOUT when no reply came; reply holds the bytes after the status
+  using ReplyHandler = std::function<void(uint8_t status, const uint8_t* reply, uint8_t length)>;
+
+  static const uint8_t STATUS_TIMEOUT = 0xFF;
+
+  RigChannel() = default;
+  ~RigChannel();
+  RigChannel(const RigChannel&) = delete;
+  RigChannel& operator=(const RigChannel&) = delete;
+
+  // Opens the port raw and non-blocking at 115200 baud; false (with errno set) on failure
+  bool open(const char* path);
+  void close();
+  int fd() const { return port; }
+
+  // Queues a command; false when the queue is full or the payload too long
+  bool send(uint8_t command, const uint8_t* payload, uint8_t length, ReplyHandler done,
+            uint64_t timeoutMicros = 1000000);
+  size_t queued() const { return pending.size(); }
+  bool wantsWrite() const { return !pending.empty() && written < pending.front().size; }
+
+  // Reads at most `budget` bytes and dispatches what they complete; false when
+  // the port has closed or failed
+  bool onReadable(size_t budget, uint64_t nowMicros);
+  // Writes as much of the command in flight as the port takes; false on failure
+  bool onWritable(uint64_t nowMicros);
+  // Fails the command in flight if its reply is overdue
+  void expire(uint64_t nowMicros);
+  // When expire() next has work, or UINT64_MAX
+  uint64_t deadline() const;
+
+  // Every chunk read, before it is parsed (e.g. a TelemetryDecoder)
+  void setMonitor(std::function<void(const uint8_t*, size_t)> callback) { monitor = std::move(callback); }
+  // Every complete text line between frames
+  void setTextHandler(std::function<void(const std::string&)> callback) { text = std::move(callback); }
+
+  struct Counters {
+    uint64_t bytesIn = 0;
+    uint64_t bytesOut = 0;
+    uint64_t replies = 0;
+    uint64_t timeouts = 0;
+    uint64_t dropped = 0;  // Frames that failed their length or CRC check
+  };
+  const Counters& counters() const { return stats; }
+
+ private:
+  struct Pending {
+    uint8_t frame[COMMAND_MAX_PAYLOAD + 5];
+    uint8_t size;
+    uint8_t command;
+    uint64_t timeoutMicros;
+    ReplyHandler done;
+  };
+
+  // Completes the command in flight and moves on to the next
+  void finish(uint8_t status, const uint8_t* reply, uint8_t length);
+
+  int port = -1;
+  CommandParser parser;
+  CommandFrame frame{};
+  std::deque<Pending> pending;  // Front is in flight once its first byte is written
+  size_t written = 0;           // Bytes of the front frame sent
+  uint64_t replyDue = UINT64_MAX;
+  std::string partialLine;
+  std::function<void(const uint8_t*, size_t)> monitor;
+  std::function<void(const std::string&)> text;
+  Counters stats;
+};
+
+#endif // RIG_CHANNEL_H
@@ -0,0 +1,154 @@
+#include "telemetry_decoder.h"
+
+#include "command_protocol.h"
+#include "telemetry.h"
+
+static const char* const STATE_NAMES[] = {
+    "SYSTOLE_ACCEL",   "SYSTOLE_DECEL", "DIASTOLE_ACCEL", "DIASTOLE_DECEL",           "RETURN_TO_START",
+    "CYCLE_COMPLETE",  "SHUTDOWN",      "HOLD_POSITION",  "RETURN_TO_MANUAL_POSITION", "WAVEFORM_PLAYBACK",
+};
+constexpr unsigned STATE_COUNT = sizeof(STATE_NAMES) / sizeof(STATE_NAMES[0]);
+
+static uint8_t expectedLength(uint8_t code) {
+  switch (code) {
+    case TELEMETRY_BEAT_START:
+      return 11;
+    case TELEMETRY_BEAT_END:
+      return 13;
+    case TELEMETRY_PHASE:
+    case TELEMETRY_REVERSAL:
+      return 10;
+    case TELEMETRY_BEAT_TIMING:
+      return 15;
+    default:
+      return 0;
+  }
+}
+
+void TelemetryDecoder::feed(const uint8_t* data, size_t size) {
+  buffer.insert(buffer.end(), data, data + size);
+  while (scanOne()) {
+  }
+  // Drop what has been consumed once it is most of the buffer
+  if (start > 0 && start * 2 >= buffer.size()) {
+    buffer.erase(buffer.begin(), buffer.begin() + static_cast<std::ptrdiff_t>(start));
+    start = 0;
+  }
+}
+
+bool TelemetryDecoder::scanOne() {
+  while (start < buffer.size() && buffer[start] != COMMAND_SYNC) {
+    stats.textBytes++;
+    start++;
+  }
+  const size_t available = buffer.size() - start;
+  if (available < 2) {
+    return false;
+  }
+  const uint8_t* frame = &buffer[start];
+  const uint8_t length = frame[1];
+  if (length > COMMAND_MAX_PAYLOAD) {
+    stats.corrupt++;
+    start++;
+    return true;
+  }
+  const size_t size = static_cast<size_t>(length) + 5;
+  if (available < size) {
+    return false;
+  }
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 1; i < size - 2; i++) {
+    crc = crc16Update(crc, frame[i]);
+  }
+  if (crc != static_cast<uint16_t>(frame[size - 2] << 8 | frame[size - 1])) {
+    stats.corrupt++;
+    start++;  // Resume the search right after this sync byte
+    return true;
+  }
+  const uint8_t code = frame[2];
+  if (expectedLength(code) != 0) {
+    if (length == expectedLength(code)) {
+      record(code, frame + 3, length);
+    } else {
+      stats.corrupt++;
+    }
+  }
+  start += size;  // Replies to commands are valid frames too; skip them whole
+  return true;
+}
+
+uint64_t TelemetryDecoder::widen(uint32_t micros) {
+  if (!haveTime) {
+    haveTime = true;
+    lastTime = micros;
+    return lastTime;
+  }
+  // Records arrive within a few seconds of each other, far less than half the
+  // 71-minute wrap, so the signed 32-bit difference is the true step
+  const int32_t delta = static_cast<int32_t>(micros - static_cast<uint32_t>(lastTime));
+  lastTime = static_cast<uint64_t>(static_cast<int64_t>(lastTime) + delta);
+  return lastTime;
+}
+
+void TelemetryDecoder::record(uint8_t code, const uint8_t* payload, uint8_t) {
+  const uint8_t sequence = payload[0];
+  if (haveSequence && sequence != nextSequence) {
+    const uint8_t gap = static_cast<uint8_t>(sequence - nextSequence);
+    stats.lost += gap;
+    if (session != nullptr) {
+      fprintf(session, "lost %u\n", gap);
+    }
+  }
+  haveSequence = true;
+  nextSequence = static_cast<uint8_t>(sequence + 1);
+  stats.records++;
+
+  const uint8_t* p = payload + 1;
+  uint64_t time = 0;
+  switch (code) {
+    case TELEMETRY_BEAT_START: {
+      time = widen(readU32(p + 2));
+      if (session != nullptr) {
+        fprintf(session, "beat_start %u %llu period %lu\n", readU16(p), static_cast<unsigned long long>(time),
+                static_cast<unsigned long>(readU32(p + 6)));
+      }
+      break;
+    }
+    case TELEMETRY_BEAT_END: {
+      time = widen(readU32(p + 4));
+      if (session != nullptr) {
+        fprintf(session, "beat_end %u %llu steps %u position %ld\n", readU16(p), static_cast<unsigned long long>(time),
+                readU16(p + 2), static_cast<long>(static_cast<int32_t>(readU32(p + 8))));
+      }
+      break;
+    }
+    case TELEMETRY_PHASE: {
+      time = widen(readU32(p + 1));
+      if (session != nullptr) {
+        fprintf(session, "phase %llu %s position %ld\n", static_cast<unsigned long long>(time),
+                p[0] < STATE_COUNT ? STATE_NAMES[p[0]] : "?", static_cast<long>(static_cast<int32_t>(readU32(p + 5))));
+      }
+      break;
+    }
+    case TELEMETRY_REVERSAL: {
+      time = widen(readU32(p + 1));
+      if (session != nullptr) {
+        fprintf(session, "reversal %llu %s position %ld\n", static_cast<unsigned long long>(time), p[0] ? "cw" : "ccw",
+                static_cast<long>(static_cast<int32_t>(readU32(p + 5))));
+      }
+      break;
+    }
+    case TELEMETRY_BEAT_TIMING:
+      if (session != nullptr) {
+        fprintf(session, "timing %u error %ld dwell %lu scale %lu\n", readU16(p),
+                static_cast<long>(static_cast<int32_t>(readU32(p + 2))), static_cast<unsigned long>(readU32(p + 6)),
+                static_cast<unsigned long>(readU32(p + 10)));
+      }
+      break;
+    default:
+      break;
+  }
+  if (listener) {
+    listener(code, time);
+  }
+}
@@ -0,0 +1,69 @@
+#ifndef TELEMETRY_DECODER_H
+#define TELEMETRY_DECODER_H
+
+// Streaming decoder for the firmware's telemetry records (src/telemetry.h).
+//
+// Feed it the raw bytes from the serial port in chunks of any size. It finds
+// frames by their sync byte and CRC on its own, so it can watch the same
+// stream PumpLink is parsing: replies are skipped, text is counted and
+// ignored. A frame that fails its CRC costs only its sync byte; the scan
+// restarts at the next byte, so a real frame hidden inside a corrupted one is
+// still found. Gaps in the record sequence number are counted as lost records
+// (ring overflow on the rig or bytes lost on the link); more than 255 in a row
+// cannot be told apart.
+//
+// Each record becomes one line of the session file, with the rig's 32-bit
+// micros() timestamps widened to 64 bits across wraparound:
+//
+//   beat_start <beat> <us> period <us>
+//   beat_end <beat> <us> steps <n> position <steps>
+//   phase <us> <STATE> position <steps>
+//   reversal <us> cw|ccw position <steps>
+//   timing <beat> error <us> dwell <us> scale <q16>
+//   lost <records>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <functional>
+#include <vector>
+
+class TelemetryDecoder {
+ public:
+  struct Counters {
+    uint64_t records = 0;
+    uint64_t lost = 0;       // Sequence numbers never seen
+    uint64_t corrupt = 0;    // Sync bytes that did not start a valid frame
+    uint64_t textBytes = 0;  // Bytes outside frames (diagnostic text)
+  };
+
+  // `session` receives one line per record; it may be null
+  explicit TelemetryDecoder(FILE* session) : session(session) {}
+
+  void feed(const uint8_t* data, size_t size);
+
+  // Called after each record is written with its code and widened rig time
+  // (0 for TIMING, which carries none)
+  void setListener(std::function<void(uint8_t code, uint64_t micros)> callback) { listener = std::move(callback); }
+
+  const Counters& counters() const { return stats; }
+
+ private:
+  // Tries to take one frame at the front of the buffer; false when more bytes are needed
+  bool scanOne();
+  void record(uint8_t code, const uint8_t* payload, uint8_t length);
+  uint64_t widen(uint32_t micros);
+
+  FILE* session;
+  std::function<void(uint8_t, uint64_t)> listener;
+  std::vector<uint8_t> buffer;
+  size_t start = 0;
+  Counters stats;
+  bool haveSequence = false;
+  uint8_t nextSequence = 0;
+  bool haveTime = false;
+  uint64_t lastTime = 0;
+};
+
+#endif // TELEMETRY_DECODER_H
@@ -0,0 +1,263 @@
+// Host simulation of a full pump session on the virtual clock.
+//
+// Runs the unmodified firmware setup()/loop() against the native HAL. Whenever
+// a loop() pass makes no progress the clock jumps straight to the next step
+// deadline instead of spinning, so a 45-minute session takes well under a
+// second. Every STEP pulse and state transition can be written to a trace file.
+//
+//   pio run -e native && .pio/build/native/program [--seconds 2700] [--trace trace.txt]
+//                                                 [--rx-at SECONDS TEXT] [--command-at SECONDS HEX]
+//                                                 [--bpm N]
+//                                                 [--pty [--speed X] [--idle]]
+//
+// --rx-at sends TEXT to the firmware's serial port once the virtual clock
+// reaches SECONDS (or when the session ends, if sooner). Whatever the firmware
+// writes back is copied to stdout. --command-at does the same with a framed
+// command: HEX is the command byte followed by its payload (0a is
+// COMMAND_ABORT). --bpm overrides HEART_RATE for the run.
+//
+// --pty connects the firmware's serial port to a new pseudo-terminal (its path
+// is printed on stderr) and paces the virtual clock at --speed times real
+// time, so tools/pump_link can drive the simulated rig like a real one. The
+// simulation then keeps serving commands after HOLD_POSITION until --seconds
+// plus a minute of virtual time have passed. --idle skips the session that
+// setup() starts and waits in HOLD_POSITION for COMMAND_START, as a rig does
+// between sessions, so a host can configure it first (tools/rig_daemon).
+//
+// The summary includes the beat period (start of one beat's motion to the
+// next) against the beat scheduler's target, early in the run and at the end,
+// to show the regulation converging.
+//
+// Trace lines are "S <us> <+1|-1>" for a step (position change) and
+// "T <us> <state>" for a state transition.
+
+#include "beat_scheduler.h"
+#include "command_protocol.h"
+#include "main.h"
+#include "step_timer.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// Virtual time charged to a loop() pass that neither queued a step nor changed
+// state while the step engine is idle
+constexpr unsigned long IDLE_PASS_MICROS = 10;
+
+// loop() passes run after HOLD_POSITION so pending serial output can drain
+constexpr int TAIL_PASSES = 10000;
+
+// Hard stop in case the session never reaches HOLD_POSITION
+constexpr unsigned long long SESSION_GRACE_MICROS = 60ULL * 1000000ULL;
+
+static const char* const STATE_NAMES[] = {
+    "SYSTOLE_ACCEL",   "SYSTOLE_DECEL", "DIASTOLE_ACCEL", "DIASTOLE_DECEL",           "RETURN_TO_START",
+    "CYCLE_COMPLETE",  "SHUTDOWN",      "HOLD_POSITION",  "RETURN_TO_MANUAL_POSITION", "WAVEFORM_PLAYBACK",
+};
+constexpr int STATE_COUNT = sizeof(STATE_NAMES) / sizeof(STATE_NAMES[0]);
+
+static FILE* traceFile = nullptr;
+static unsigned long long stepCount = 0;
+static unsigned long long stateSteps[STATE_COUNT];
+static long tracedPosition = 0;
+static bool beatMotionPending = false;
+static std::vector<unsigned long long> beatStarts;  // First STEP pulse of each beat
+
+static void onPinChange(uint8_t pin, uint8_t level, unsigned long long nowMicros) {
+  if (pin != STEP_PIN || level != HIGH) {
+    return;
+  }
+  // DIR high is clockwise, which the firmware counts as -1
+  const int delta = digitalRead(DIR_PIN) == HIGH ? -1 : 1;
+  tracedPosition += delta;
+  stepCount++;
+  if (beatMotionPending) {
+    beatStarts.push_back(nowMicros);
+    beatMotionPending = false;
+  }
+  stateSteps[static_cast<int>(stepTimerArmedState())]++;  // The state that queued it, not the one now running
+  if (traceFile != nullptr) {
+    std::fprintf(traceFile, "S %llu %+d\n", nowMicros, delta);
+  }
+}
+
+static void traceState(State state) {
+  if (traceFile != nullptr) {
+    std::fprintf(traceFile, "T %llu %s\n", halNowMicros(), STATE_NAMES[static_cast<int>(state)]);
+  }
+}
+
+int main(int argc, char** argv) {
+  unsigned long seconds = 2700;
+  const char* tracePath = nullptr;
+  unsigned long long rxAtMicros = 0;
+  std::vector<uint8_t> rxBytes;  // Sent once the clock reaches rxAtMicros
+  unsigned long bpm = 0;
+  bool usePty = false;
+  bool idle = false;
+  double speed = 1.0;
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+      seconds = std::strtoul(argv[++i], nullptr, 10);
+    } else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc) {
+      tracePath = argv[++i];
+    } else if (std::strcmp(argv[i], "--rx-at") == 0 && i + 2 < argc) {
+      rxAtMicros = static_cast<unsigned long long>(std::strtod(argv[++i], nullptr) * 1e6);
+      const char* text = argv[++i];
+      rxBytes.assign(text, text + std::strlen(text));
+    } else if (std::strcmp(argv[i], "--command-at") == 0 && i + 2 < argc) {
+      rxAtMicros = static_cast<unsigned long long>(std::strtod(argv[++i], nullptr) * 1e6);
+      const char* hex = argv[++i];
+      uint8_t command[COMMAND_MAX_PAYLOAD + 1];
+      size_t length = 0;
+      for (; length < sizeof(command) && std::isxdigit(static_cast<unsigned char>(hex[0])) &&
+                std::isxdigit(static_cast<unsigned char>(hex[1])); hex += 2) {
+        const char digits[3] = {hex[0], hex[1], '\0'};
+        command[length++] = static_cast<uint8_t>(std::strtoul(digits, nullptr, 16));
+      }
+      if (length == 0 || *hex != '\0') {
+        std::fprintf(stderr, "--command-at: HEX is the command byte and payload, e.g. 0a\n");
+        return 2;
+      }
+      rxBytes.resize(COMMAND_MAX_PAYLOAD + 5);
+      rxBytes.resize(encodeCommandFrame(command[0], command + 1, static_cast<uint8_t>(length - 1), rxBytes.data()));
+    } else if (std::strcmp(argv[i], "--bpm") == 0 && i + 1 < argc) {
+      bpm = std::strtoul(argv[++i], nullptr, 10);
+    } else if (std::strcmp(argv[i], "--pty") == 0) {
+      usePty = true;
+    } else if (std::strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+      speed = std::strtod(argv[++i], nullptr);
+    } else if (std::strcmp(argv[i], "--idle") == 0) {
+      idle = true;
+    } else {
+      std::fprintf(stderr, "usage: %s [--seconds N] [--trace FILE] [--rx-at SECONDS TEXT] [--command-at SECONDS HEX] [--bpm N]\n"
+                   "          [--pty [--speed X] [--idle]]\n",
+                   argv[0]);
+      return 2;
+    }
+  }
+  if (tracePath != nullptr) {
+    traceFile = std::fopen(tracePath, "w");
+    if (traceFile == nullptr) {
+      std::perror(tracePath);
+      return 1;
+    }
+    static char buffer[1 << 16];
+    std::setvbuf(traceFile, buffer, _IOFBF, sizeof(buffer));
+  }
+
+  const auto wallStart = std::chrono::steady_clock::now();
+  halReset();
+  if (usePty) {
+    const int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+      std::perror("pty");
+      return 1;
+    }
+    std::fprintf(stderr, "serial port on %s\n", ptsname(master));
+    halSerialAttach(master);
+  }
+  halSetPinListener(onPinChange);
+  setup();
+  runtimeMillis = seconds * 1000UL;
+  if (bpm != 0) {
+    beatSchedulerBegin(60000000UL / bpm);
+  }
+  idle = idle && usePty;
+  if (idle) {
+    currentState = State::HOLD_POSITION;  // Nothing is queued before the first loop()
+  }
+  traceState(currentState);
+  beatMotionPending = !idle;
+
+  const unsigned long long limit = seconds * 1000000ULL + SESSION_GRACE_MICROS;
+  unsigned long beats = 0;
+  unsigned long long passes = 0;
+  while ((usePty || currentState != State::HOLD_POSITION) && halNowMicros() < limit) {
+    if (usePty) {
+      // Hold the virtual clock to real time so a host on the pty sees a live rig
+      const double wallMicros =
+          std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - wallStart).count();
+      const double ahead = halNowMicros() / speed - wallMicros;
+      if (ahead > 1000.0) {
+        const timespec pause = {0, static_cast<long>(std::min(ahead, 100000.0) * 1000.0)};
+        nanosleep(&pause, nullptr);
+      }
+    }
+    if (!rxBytes.empty() && halNowMicros() >= rxAtMicros) {
+      halSerialInject(rxBytes.data(), rxBytes.size());
+      rxBytes.clear();
+    }
+    const State before = currentState;
+    const uint8_t queuedBefore = stepTimerQueued();
+    loop();
+    passes++;
+    if (currentState != before) {
+      traceState(currentState);
+      if (currentState == State::SYSTOLE_ACCEL || currentState == State::WAVEFORM_PLAYBACK) {
+        beats++;
+        beatMotionPending = true;
+      }
+    } else if (stepTimerQueued() == queuedBefore) {
+      // Nothing to do until the engine frees a slot (or, when idle, the next pass)
+      const unsigned long toNext = stepTimerMicrosToNextStep();
+      halAdvance(toNext != 0 ? toNext : IDLE_PASS_MICROS);
+    }
+  }
+  // Let anything still in flight land
+  while (stepTimerMicrosToNextStep() != 0) {
+    halAdvance(stepTimerMicrosToNextStep());
+  }
+  if (!rxBytes.empty()) {
+    halSerialInject(rxBytes.data(), rxBytes.size());
+  }
+  for (int pass = 0; pass < TAIL_PASSES; pass++) {
+    loop();
+    halAdvance(IDLE_PASS_MICROS);
+  }
+  const double wallSeconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+
+  if (traceFile != nullptr) {
+    std::fclose(traceFile);
+  }
+
+  std::printf("simulated     %.3f s\n", halNowMicros() / 1e6);
+  std::printf("wall clock    %.3f s\n", wallSeconds);
+  std::printf("final state   %s\n", STATE_NAMES[static_cast<int>(currentState)]);
+  std::printf("beats         %lu\n", beats + (idle ? 0 : 1));
+  std::printf("loop passes   %llu\n", passes);
+  std::printf("steps         %llu\n", stepCount);
+  for (int s = 0; s < STATE_COUNT; s++) {
+    if (stateSteps[s] != 0) {
+      std::printf("  %-26s %llu\n", STATE_NAMES[s], stateSteps[s]);
+    }
+  }
+  const double target = static_cast<double>(beatSchedulerPeriod());
+  auto printPeriods = [&](const char* label, size_t first, size_t last) {
+    if (last <= first + 1 || last > beatStarts.size()) {
+      return;
+    }
+    double worst = 0;
+    for (size_t b = first + 1; b < last; b++) {
+      worst = std::max(worst, std::abs(static_cast<double>(beatStarts[b] - beatStarts[b - 1]) - target));
+    }
+    const double mean = static_cast<double>(beatStarts[last - 1] - beatStarts[first]) / (last - 1 - first);
+    std::printf("  %-12s mean %.1f us (%+.1f ppm), worst beat %+.0f us\n", label, mean, (mean - target) / target * 1e6,
+                worst);
+  };
+  std::printf("beat period   target %.0f us\n", target);
+  printPeriods("first 10", 0, std::min<size_t>(10, beatStarts.size()));
+  printPeriods("last 100", beatStarts.size() > 100 ? beatStarts.size() - 100 : 0, beatStarts.size());
+  printPeriods("session", 0, beatStarts.size());
+  std::printf("position      %ld (firmware %ld)\n", tracedPosition, readCyclePosition());
+  return currentState == State::HOLD_POSITION ? 0 : 1;
+}
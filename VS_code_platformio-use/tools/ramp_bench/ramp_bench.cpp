@@ -0,0 +1,320 @@
+// Host benchmark: fixed-point vs float on-the-fly ramp.
+//
+// For each ramp the firmware uses, walks an ACCEL phase up and the mirrored
+// DECEL phase back down with both engines, reports the time per step and the
+// largest deviation from the compile-time tables (which equal the old runtime
+// calculateDelays() output).
+//
+// Checks that claim too: every variant's compile-time tables against the
+// runtime calculateDelays() they replaced, transcribed below from the old
+// src/main.cpp, code_versions/100mlSV.cpp and code_versions/sinusoidaltest.cpp,
+// value for value.
+//
+// Then checks every variant's flash tables in their byte-coded CompactTable
+// form against the plain tables, entry for entry, along the walks the phases
+// make (ACCEL up, DECEL down from the last entry, an abort turning an ACCEL
+// around mid-ramp) and in scrambled order. Prints flash bytes per table both
+// ways, and the SRAM: none for the tables in either form, as both are in
+// PROGMEM, but each byte-coded table is walked through a CompactTableReader.
+// Exits 1 on any mismatch.
+//
+//   pio run -e ramp_bench && .pio/build/ramp_bench/program
+//
+// tools/ramp_bench/size_report.sh gives the firmware's own .data/.bss.
+
+#include "compact_table.h"
+#include "fixed_ramp.h"
+#include "motion_profiles.h"
+#include "pulsatile_driver.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#endif
+
+constexpr int STEPS = 600;
+constexpr int REPEATS = 2000;
+
+struct RampCase {
+  const char* name;
+  uint16_t accelMilli;
+  uint16_t highSpeed;
+  DelayTable<STEPS> reference;
+};
+
+static const RampCase CASES[] = {
+    {"systole (0.05, 1)", 50, 1, makeAccelTable<STEPS>(0.05f, 1)},
+    {"diastole (0.02, 15)", 20, 15, makeAccelTable<STEPS>(0.02f, 15)},
+    {"100mlSV systole (0.045, 1)", 45, 1, makeAccelTable<STEPS>(0.045f, 1)},
+    {"100mlSV diastole (0.015, 15)", 15, 15, makeAccelTable<STEPS>(0.015f, 15)},
+    {"steep (0.5, 100)", 500, 100, makeAccelTable<STEPS>(0.5f, 100)},
+};
+
+struct Timing {
+  double nsPerStep;
+  double cyclesPerStep;
+};
+
+// Runs accel then decel `REPEATS` times; `sink` keeps the optimiser honest
+template <typename Ramp, typename Begin>
+static Timing timeRamp(Begin begin, unsigned long& sink) {
+  Ramp ramp;
+  auto start = std::chrono::steady_clock::now();
+#ifdef HAVE_TSC
+  unsigned long long tscStart = __rdtsc();
+#endif
+  for (int r = 0; r < REPEATS; r++) {
+    begin(ramp);
+    for (int i = 0; i < STEPS; i++) {
+      sink += ramp.delayAt(i);
+    }
+    for (int i = STEPS - 1; i >= 0; i--) {
+      sink += ramp.delayAt(i);
+    }
+  }
+  double steps = 2.0 * STEPS * REPEATS;
+  Timing timing{};
+#ifdef HAVE_TSC
+  timing.cyclesPerStep = static_cast<double>(__rdtsc() - tscStart) / steps;
+#endif
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  timing.nsPerStep = std::chrono::duration<double, std::nano>(elapsed).count() / steps;
+  return timing;
+}
+
+// Largest |engine - table| over the accel walk and the mirrored decel walk
+template <typename Ramp, typename Begin>
+static int maxError(Begin begin, const DelayTable<STEPS>& reference) {
+  Ramp ramp;
+  begin(ramp);
+  int worst = 0;
+  for (int i = 0; i < STEPS; i++) {
+    worst = std::max(worst, std::abs(ramp.delayAt(i) - reference.delays[i]));
+  }
+  for (int i = STEPS - 1; i >= 0; i--) {
+    worst = std::max(worst, std::abs(ramp.delayAt(i) - reference.delays[i]));
+  }
+  return worst;
+}
+
+// The old firmware's calculateDelays() variants, as they ran: filling the
+// shared delays[] at every phase change. The AVR's double is 32 bits, so
+// its sqrt(), sin() and PI are written out in single precision here.
+namespace legacy {
+
+constexpr float PI = 3.1415926535897932384626433832795f;
+constexpr float angle = 1;  // Angle of rotation per step
+int delays[STEPS];
+
+// src/main.cpp, code_versions/100mlSV.cpp
+void calculateDelays(float accel, int highSpeed) {
+  const float c0 = 900 * std::sqrt(2 * angle / accel) * 0.67703f;  // Calculate initial delay
+  float lastDelay = 0;
+
+  // Calculate delay array for acceleration
+  for (int i = 0; i < STEPS; i++) {
+    float d = c0;
+    if (i > 0) {
+      d = lastDelay - (2 * lastDelay) / (4 * i + 1);
+    }
+    if (d < highSpeed) {
+      d = highSpeed;
+    }
+    delays[i] = static_cast<int>(d);
+    lastDelay = d;
+  }
+}
+
+// code_versions/sinusoidaltest.cpp
+void calculateDelays(float maxSpeed, float minSpeed, bool fullSine) {
+  if (fullSine) {
+    float speedAmplitude = (minSpeed - maxSpeed) / 2.0f;
+    float midSpeed = maxSpeed + speedAmplitude;
+    for (int i = 0; i < STEPS; i++) {
+      float angle = PI * static_cast<float>(i) / static_cast<float>(STEPS - 1);
+      float delay = midSpeed - speedAmplitude * std::sin(angle);
+      if (delay < maxSpeed) delay = maxSpeed;
+      if (delay > minSpeed) delay = minSpeed;
+      delays[i] = static_cast<int>(delay);
+    }
+  } else {
+    for (int i = 0; i < STEPS; i++) {
+      float angle = PI / 2 * static_cast<float>(i) / static_cast<float>(STEPS - 1);
+      float ratio = std::sin(angle);
+      float delay = minSpeed - (minSpeed - maxSpeed) * ratio;
+      if (delay < maxSpeed) delay = maxSpeed;
+      if (delay > minSpeed) delay = minSpeed;
+      delays[i] = static_cast<int>(delay);
+    }
+  }
+}
+
+}  // namespace legacy
+
+// Entries of `table` that differ from legacy::delays, with the largest difference
+template <int N>
+static int reportLegacy(const char* name, const char* call, const DelayTable<N>& table) {
+  static_assert(N == STEPS, "the old firmware filled STEPS entries");
+  int mismatches = 0;
+  int worst = 0;
+  for (int i = 0; i < N; i++) {
+    const int difference = std::abs(readDelay(table, i) - legacy::delays[i]);
+    mismatches += difference != 0;
+    worst = std::max(worst, difference);
+  }
+  std::printf("%-22s %-36s %10d %9d\n", name, call, mismatches, worst);
+  return mismatches;
+}
+
+// One plain table and its byte-coded form
+template <int N, int HEAD>
+struct CompactCase {
+  const char* name;
+  int phaseSteps;
+  DelayTable<N> plain;
+  CompactTable<N, HEAD> compact;
+};
+
+template <int HEAD, int N>
+static CompactCase<N, HEAD> compactCase(const char* name, int phaseSteps, const DelayTable<N>& plain) {
+  return {name, phaseSteps, plain, compactTable<HEAD>(plain)};
+}
+
+// Mismatches between reader and plain table over the phase walks and a scrambled sweep
+template <int N, int HEAD>
+static int compactMismatches(const CompactCase<N, HEAD>& c) {
+  CompactTableReader reader;
+  int mismatches = 0;
+  auto check = [&](int index) { mismatches += reader.delayAt(index) != c.plain.delays[index]; };
+
+  reader.begin(c.compact);
+  for (int step = 0; step < c.phaseSteps; step++) {
+    check(step);  // ACCEL
+  }
+  for (int step = 0; step < c.phaseSteps; step++) {
+    check(N - 1 - step);  // DECEL
+  }
+  // Abort at every ACCEL step: the DECEL walks back down from where it stood
+  for (int at = 0; at < c.phaseSteps; at += 7) {
+    reader.begin(c.compact);
+    for (int step = 0; step <= at; step++) {
+      check(step);
+    }
+    for (int index = at; index >= 0; index--) {
+      check(index);
+    }
+  }
+  reader.begin(c.compact);
+  for (int i = 0; i < N; i++) {
+    check((i * 263) % N);  // 263 is prime to 600: every index, out of order
+  }
+  return mismatches;
+}
+
+// Time per step of an ACCEL walk up and a DECEL walk down
+template <int N, int HEAD>
+static double compactNsPerStep(const CompactCase<N, HEAD>& c, unsigned long& sink) {
+  CompactTableReader reader;
+  auto start = std::chrono::steady_clock::now();
+  for (int r = 0; r < REPEATS; r++) {
+    reader.begin(c.compact);
+    for (int i = 0; i < N; i++) {
+      sink += reader.delayAt(i);
+    }
+    for (int i = N - 1; i >= 0; i--) {
+      sink += reader.delayAt(i);
+    }
+  }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  return std::chrono::duration<double, std::nano>(elapsed).count() / (2.0 * N * REPEATS);
+}
+
+template <int N, int HEAD>
+static int reportCompact(const CompactCase<N, HEAD>& c, unsigned long& sink) {
+  int mismatches = compactMismatches(c);
+  std::printf("%-30s %5d %11zu %11zu %9.2f %10d\n", c.name, HEAD, sizeof(c.plain), sizeof(c.compact),
+              compactNsPerStep(c, sink), mismatches);
+  return mismatches;
+}
+
+// HEAD of a driver's tables, fixed at compile time as in main.cpp
+template <class Pump>
+struct Heads {
+  static constexpr int SYSTOLE = compactHead(Pump::systoleTable());
+  static constexpr int DIASTOLE = compactHead(Pump::diastoleTable());
+};
+
+template <class Pump>
+static int reportPump(const char* systole, const char* diastole, unsigned long& sink) {
+  int mismatches = reportCompact(compactCase<Heads<Pump>::SYSTOLE>(systole, Pump::PHASE_STEPS, Pump::systoleTable()), sink);
+  mismatches += reportCompact(compactCase<Heads<Pump>::DIASTOLE>(diastole, Pump::PHASE_STEPS, Pump::diastoleTable()), sink);
+  return mismatches;
+}
+
+int main() {
+  unsigned long sink = 0;
+  std::printf("%-30s %12s %12s %12s %12s %9s %9s\n", "ramp", "fixed ns", "float ns",
+              "fixed cyc", "float cyc", "fixed err", "float err");
+  for (const RampCase& c : CASES) {
+    auto beginFixed = [&c](FixedRamp& ramp) { ramp.begin(c.accelMilli, c.highSpeed); };
+    auto beginFloat = [&c](FloatRamp& ramp) { ramp.begin(c.accelMilli / 1000.0f, c.highSpeed); };
+
+    Timing fixed = timeRamp<FixedRamp>(beginFixed, sink);
+    Timing reference = timeRamp<FloatRamp>(beginFloat, sink);
+    int fixedError = maxError<FixedRamp>(beginFixed, c.reference);
+    int floatError = maxError<FloatRamp>(beginFloat, c.reference);
+
+    std::printf("%-30s %12.2f %12.2f %12.1f %12.1f %9d %9d\n", c.name, fixed.nsPerStep,
+                reference.nsPerStep, fixed.cyclesPerStep, reference.cyclesPerStep, fixedError,
+                floatError);
+  }
+
+  std::printf("\n%-22s %-36s %10s %9s\n", "compile-time table", "runtime original", "mismatches", "worst us");
+  int legacyMismatches = 0;
+  legacy::calculateDelays(0.05f, 1);
+  legacyMismatches += reportLegacy("main systole", "calculateDelays(0.05, 1)", MainPump::systoleTable());
+  legacy::calculateDelays(0.02f, 15);
+  legacyMismatches += reportLegacy("main diastole", "calculateDelays(0.02, 15)", MainPump::diastoleTable());
+  legacy::calculateDelays(0.045f, 1);
+  legacyMismatches += reportLegacy("100mlSV systole", "calculateDelays(0.045, 1)", Pump100mlSV::systoleTable());
+  legacy::calculateDelays(0.015f, 15);
+  legacyMismatches += reportLegacy("100mlSV diastole", "calculateDelays(0.015, 15)", Pump100mlSV::diastoleTable());
+  legacy::calculateDelays(1, 300, false);
+  legacyMismatches += reportLegacy("sinusoidal systole", "calculateDelays(1, 300, false)", SinusoidalPump::systoleTable());
+  legacy::calculateDelays(15, 400, false);
+  legacyMismatches +=
+      reportLegacy("sinusoidal diastole", "calculateDelays(15, 400, false)", SinusoidalPump::diastoleTable());
+  legacy::calculateDelays(1, 300, true);
+  legacyMismatches += reportLegacy("full sine systole", "calculateDelays(1, 300, true)", FullSinePump::systoleTable());
+  legacy::calculateDelays(15, 400, true);
+  legacyMismatches += reportLegacy("full sine diastole", "calculateDelays(15, 400, true)", FullSinePump::diastoleTable());
+
+  std::printf("\n%-30s %5s %11s %11s %9s %10s\n", "compact table", "head", "plain bytes", "flash bytes",
+              "ns", "mismatches");
+  int mismatches = reportPump<MainPump>("main systole", "main diastole", sink);
+  mismatches += reportPump<Pump100mlSV>("100mlSV systole", "100mlSV diastole", sink);
+  mismatches += reportPump<SinusoidalPump>("sinusoidal systole", "sinusoidal diastole", sink);
+  mismatches += reportPump<FullSinePump>("full sine systole", "full sine diastole", sink);
+  constexpr DelayTable<STEPS> steep = makeAccelTable<STEPS>(0.5f, 100);
+  mismatches += reportCompact(compactCase<compactHead(steep)>("steep (0.5, 100)", STEPS, steep), sink);
+
+  // CompactTableReader on the Uno: three 2-byte pointers, three 2-byte ints, a uint16_t
+  constexpr size_t UNO_READER_BYTES = 3 * 2 + 3 * 2 + 2;
+  std::printf("\nSRAM per table: plain 0 bytes, compact 0 bytes + a CompactTableReader"
+              " (%zu bytes here, %zu on the Uno)\n",
+              sizeof(CompactTableReader), UNO_READER_BYTES);
+  std::printf("(checksum %lu)\n", sink);
+  if (legacyMismatches != 0) {
+    std::printf("compile-time tables differ from the runtime calculateDelays()\n");
+  }
+  if (mismatches != 0) {
+    std::printf("compact tables differ from the plain tables\n");
+  }
+  return legacyMismatches != 0 || mismatches != 0 ? 1 : 0;
+}
@@ -0,0 +1,54 @@
+#!/bin/sh
+# Section sizes of the firmware before and after a change: builds each
+# environment at BASE and at AFTER (in scratch git worktrees) and prints
+# .text, .rodata, .data and .bss of both, with the difference. On the Uno,
+# flash is .text + .data and static SRAM is .data + .bss (PROGMEM tables are
+# in .text).
+#
+#   [ENVS="uno ..."] [SIZE=avr-size] tools/ramp_bench/size_report.sh [BASE [AFTER]]
+#
+# BASE defaults to HEAD~1 and AFTER to HEAD; ENVS to the Uno variants. SIZE
+# names the size tool: PlatformIO's avr-size by default, size for native
+# environments. Builds are left in .pio/size_report/.
+set -e
+cd "$(dirname "$0")/../.."
+
+BASE=${1:-HEAD~1}
+AFTER=${2:-HEAD}
+ENVS=${ENVS:-uno uno_100ml_sv uno_sinusoidal}
+OUT=$(pwd)/.pio/size_report
+PROJECT=$(git rev-parse --show-prefix)
+
+AVR_SIZE="$HOME/.platformio/packages/toolchain-atmelavr/bin/avr-size"
+[ -x "$AVR_SIZE" ] || AVR_SIZE=avr-size
+
+mkdir -p "$OUT"
+git worktree prune
+for side in before after; do
+  rm -rf "${OUT:?}/$side"
+done
+trap 'git worktree remove --force "$OUT/before"; git worktree remove --force "$OUT/after"' EXIT
+git worktree add -q --detach "$OUT/before" "$BASE"
+git worktree add -q --detach "$OUT/after" "$AFTER"
+
+# Prints "section bytes", sorted, for the build of environment $1 in project $2
+sections() {
+  elf="$2/.pio/build/$1/firmware.elf"
+  size=${SIZE:-$AVR_SIZE}
+  if [ ! -f "$elf" ]; then
+    elf="$2/.pio/build/$1/program"
+    size=${SIZE:-size}
+  fi
+  "$size" -A "$elf" | awk '$1 == ".text" || $1 == ".rodata" || $1 == ".data" || $1 == ".bss" { print $1, $2 }' | sort
+}
+
+echo "$(git rev-parse --short "$BASE") -> $(git rev-parse --short "$AFTER")"
+printf '%-18s %-8s %8s %8s %8s\n' environment section before after delta
+for env in $ENVS; do
+  for side in before after; do
+    (cd "$OUT/$side/$PROJECT" && pio run -s -e "$env" > /dev/null)
+    sections "$env" "$OUT/$side/$PROJECT" > "$OUT/$env.$side"
+  done
+  join -a 1 -a 2 -e 0 -o 0,1.2,2.2 "$OUT/$env.before" "$OUT/$env.after" |
+    awk -v env="$env" '{ printf "%-18s %-8s %8d %8d %+8d\n", env, $1, $2, $3, $3 - $2 }'
+done
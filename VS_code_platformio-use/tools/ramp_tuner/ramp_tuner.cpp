@@ -0,0 +1,384 @@
+// Parameter sweep for the AVR446 ramp profiles against a kinematic model of
+// the drive, on every core.
+//
+//   pio run -e ramp_tuner
+//   .pio/build/ramp_tuner/program [--volume ML] [--tolerance ML] [--bpm N] [--ml-per-step X]
+//                                 [--systole-accel R] [--systole-floor R] [--diastole-accel R]
+//                                 [--diastole-floor R] [--steps R] [--threads N] [--show N] [--csv FILE]
+//
+// A candidate is one (accel, highSpeed) pair per stroke, in the units of
+// Avr446Profile::Ramp (accel in thousandths, floor in microseconds), and the
+// steps per phase (TABLE_STEPS = PHASE_STEPS). Ranges R are LO:HI:STEP or a
+// single value; the defaults span the hand-tuned settings of MainStroke and
+// Stroke100mlSV (src/pulsatile_driver.h) several times over.
+//
+// The model plays a beat as the firmware does: each stroke walks its delay
+// table up (ACCEL) and back down (DECEL), the table being the float recurrence
+// of makeAccelTable() truncated to integers, and each interval clamped to
+// what the step timer takes. From the pulse times it gets:
+//   stroke volume    steps per stroke * --ml-per-step (a linear drive; the
+//                    default 100/1200 mL is the 100 mL the 600-step builds
+//                    were tuned to reach)
+//   motion time      both strokes; the beat scheduler aims it at 15/16 of the
+//                    period, so 16/15 of it is the shortest period the
+//                    setting sustains without compressing its steps
+//   peak flow        fastest step rate, in mL/s
+//   peak accel       largest change of step rate between neighbouring steps
+//                    of one stroke, in mL/s^2; a reversal is a single step in
+//                    this model, so it is left out
+// Candidates within --tolerance of --volume whose shortest period fits the
+// --bpm period are feasible. The report is their Pareto front over (volume
+// error, shortest period, peak accel), gentlest first, and where the shipped
+// settings sit against it. Candidates are evaluated in tasks of
+// TASK_CANDIDATES on the work-stealing pool (tools/click_analysis).
+
+#include "pulsatile_driver.h"
+#include "step_timer.h"
+#include "work_stealing_pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+constexpr size_t TASK_CANDIDATES = 1024;
+constexpr double SCHEDULER_SHARE = 15.0 / 16.0;  // Of the period the motion is aimed at (BEAT_GUARD_SHIFT)
+
+struct Range {
+  int low, high, step;
+  size_t count() const { return static_cast<size_t>((high - low) / step + 1); }
+  int at(size_t i) const { return low + static_cast<int>(i) * step; }
+};
+
+struct Candidate {
+  uint16_t systoleAccel, systoleFloor;
+  uint16_t diastoleAccel, diastoleFloor;
+  uint16_t steps;
+};
+
+struct Outcome {
+  Candidate candidate;
+  float strokeMl;
+  float systoleMs, diastoleMs;
+  float shortestPeriodMs;
+  float peakFlow;   // mL/s
+  float peakAccel;  // mL/s^2
+  float volumeError;
+  bool feasible;
+};
+
+struct Stroke {
+  double micros;     // ACCEL and DECEL
+  double peakRate;   // Steps/s
+  double peakAccel;  // Steps/s^2
+};
+
+// One stroke: the table entries as makeAccelTable() computes them, played
+// through the step timer's clamp; `intervals` gets them when not null
+static Stroke walkStroke(uint16_t accelMilli, uint16_t floorMicros, int steps, uint16_t* intervals = nullptr) {
+  const float accel = accelMilli / 1000.0f;
+  const float angle = 1;
+  const float c0 = 900.0f * std::sqrt(2 * angle / accel) * 0.67703f;
+  Stroke stroke{0, 0, 0};
+  float lastDelay = 0;
+  double lastInterval = 0;
+  for (int i = 0; i < steps; i++) {
+    float d = i == 0 ? c0 : lastDelay - (2 * lastDelay) / (4 * i + 1);
+    if (d < floorMicros) {
+      d = floorMicros;
+    }
+    lastDelay = d;
+    const unsigned entry = static_cast<uint16_t>(static_cast<int>(d));
+    const unsigned interval = std::min(std::max(entry, MIN_STEP_INTERVAL_US), MAX_STEP_INTERVAL_US);
+    if (intervals != nullptr) {
+      intervals[i] = static_cast<uint16_t>(entry);
+    }
+    stroke.micros += interval;
+    const double rate = 1e6 / interval;
+    if (i > 0) {
+      const double accelNow = (rate - 1e6 / lastInterval) / ((interval + lastInterval) * 0.5e-6);
+      stroke.peakAccel = std::max(stroke.peakAccel, std::fabs(accelNow));
+    }
+    stroke.peakRate = std::max(stroke.peakRate, rate);
+    lastInterval = interval;
+  }
+  stroke.micros *= 2;  // DECEL walks the same intervals back
+  return stroke;
+}
+
+struct Model {
+  double mlPerStep;
+  double targetMl;
+  double toleranceMl;
+  double periodMs;
+
+  Outcome evaluate(const Candidate& c) const {
+    const Stroke systole = walkStroke(c.systoleAccel, c.systoleFloor, c.steps);
+    const Stroke diastole = walkStroke(c.diastoleAccel, c.diastoleFloor, c.steps);
+    Outcome o{};
+    o.candidate = c;
+    o.strokeMl = static_cast<float>(2 * c.steps * mlPerStep);
+    o.systoleMs = static_cast<float>(systole.micros * 1e-3);
+    o.diastoleMs = static_cast<float>(diastole.micros * 1e-3);
+    o.shortestPeriodMs = static_cast<float>((systole.micros + diastole.micros) * 1e-3 / SCHEDULER_SHARE);
+    o.peakFlow = static_cast<float>(std::max(systole.peakRate, diastole.peakRate) * mlPerStep);
+    o.peakAccel = static_cast<float>(std::max(systole.peakAccel, diastole.peakAccel) * mlPerStep);
+    o.volumeError = static_cast<float>(std::fabs(o.strokeMl - targetMl));
+    o.feasible = o.volumeError <= toleranceMl && o.shortestPeriodMs <= periodMs;
+    return o;
+  }
+};
+
+static bool dominates(const Outcome& a, const Outcome& b) {
+  const bool noWorse =
+      a.volumeError <= b.volumeError && a.shortestPeriodMs <= b.shortestPeriodMs && a.peakAccel <= b.peakAccel;
+  const bool better =
+      a.volumeError < b.volumeError || a.shortestPeriodMs < b.shortestPeriodMs || a.peakAccel < b.peakAccel;
+  return noWorse && better;
+}
+
+// Feasible outcomes no other feasible outcome dominates. Sorted by the
+// objectives in turn, a point can only be dominated by one before it, so each
+// is checked against the front found so far.
+static std::vector<Outcome> paretoFront(const std::vector<Outcome>& outcomes) {
+  std::vector<Outcome> feasible;
+  for (const Outcome& o : outcomes) {
+    if (o.feasible) {
+      feasible.push_back(o);
+    }
+  }
+  std::sort(feasible.begin(), feasible.end(), [](const Outcome& a, const Outcome& b) {
+    if (a.volumeError != b.volumeError) {
+      return a.volumeError < b.volumeError;
+    }
+    if (a.shortestPeriodMs != b.shortestPeriodMs) {
+      return a.shortestPeriodMs < b.shortestPeriodMs;
+    }
+    return a.peakAccel < b.peakAccel;
+  });
+  std::vector<Outcome> front;
+  for (const Outcome& o : feasible) {
+    bool dominated = false;
+    for (const Outcome& f : front) {
+      if (dominates(f, o) || (f.volumeError == o.volumeError && f.shortestPeriodMs == o.shortestPeriodMs &&
+                              f.peakAccel == o.peakAccel)) {
+        dominated = true;  // Ties keep the first
+        break;
+      }
+    }
+    if (!dominated) {
+      front.push_back(o);
+    }
+  }
+  std::sort(front.begin(), front.end(), [](const Outcome& a, const Outcome& b) { return a.peakAccel < b.peakAccel; });
+  return front;
+}
+
+static void printOutcome(const char* label, const Outcome& o) {
+  const Candidate& c = o.candidate;
+  std::printf("%-10s %4u %4u %4u %4u %5u  %6.1f  %7.1f %7.1f %8.1f %6.1f  %7.1f %9.0f\n", label, c.systoleAccel,
+              c.systoleFloor, c.diastoleAccel, c.diastoleFloor, c.steps, o.strokeMl, o.systoleMs, o.diastoleMs,
+              o.shortestPeriodMs, 60000.0f / o.shortestPeriodMs, o.peakFlow, o.peakAccel);
+}
+
+static void printHeader() {
+  std::printf("%-10s %4s %4s %4s %4s %5s  %6s  %7s %7s %8s %6s  %7s %9s\n", "", "sysA", "sysF", "diaA", "diaF", "steps",
+              "SV mL", "sys ms", "dia ms", "T min ms", "bpm", "mL/s", "mL/s^2");
+}
+
+// The firmware's own tables for a shipped configuration, against the model's walk
+template <class Pump>
+static int tableMismatches() {
+  constexpr DelayTable<Pump::TABLE_STEPS> systole = Pump::systoleTable();
+  constexpr DelayTable<Pump::TABLE_STEPS> diastole = Pump::diastoleTable();
+  uint16_t walked[Pump::TABLE_STEPS];
+  int mismatches = 0;
+  walkStroke(Pump::SYSTOLE_LIVE.accelMilli, Pump::SYSTOLE_LIVE.floorMicros, Pump::TABLE_STEPS, walked);
+  for (int i = 0; i < Pump::TABLE_STEPS; i++) {
+    mismatches += walked[i] != systole.delays[i];
+  }
+  walkStroke(Pump::DIASTOLE_LIVE.accelMilli, Pump::DIASTOLE_LIVE.floorMicros, Pump::TABLE_STEPS, walked);
+  for (int i = 0; i < Pump::TABLE_STEPS; i++) {
+    mismatches += walked[i] != diastole.delays[i];
+  }
+  return mismatches;
+}
+
+template <class Pump>
+static Candidate shipped() {
+  return {Pump::SYSTOLE_LIVE.accelMilli, Pump::SYSTOLE_LIVE.floorMicros, Pump::DIASTOLE_LIVE.accelMilli,
+          Pump::DIASTOLE_LIVE.floorMicros, static_cast<uint16_t>(Pump::TABLE_STEPS)};
+}
+
+static bool parseRange(const char* text, Range& range) {
+  char* end = nullptr;
+  range.low = static_cast<int>(std::strtol(text, &end, 10));
+  range.high = range.low;
+  range.step = 1;
+  if (*end == ':') {
+    range.high = static_cast<int>(std::strtol(end + 1, &end, 10));
+    if (*end == ':') {
+      range.step = static_cast<int>(std::strtol(end + 1, &end, 10));
+    }
+  }
+  return *end == '\0' && range.low > 0 && range.high >= range.low && range.step > 0 && range.high <= 65535;
+}
+
+static int usage(const char* program) {
+  std::fprintf(stderr,
+               "usage: %s [--volume ML] [--tolerance ML] [--bpm N] [--ml-per-step X] [--systole-accel LO:HI:STEP]\n"
+               "          [--systole-floor R] [--diastole-accel R] [--diastole-floor R] [--steps R] [--threads N]\n"
+               "          [--show N] [--csv FILE]\n",
+               program);
+  return 2;
+}
+
+int main(int argc, char** argv) {
+  Model model{100.0 / 1200.0, 100.0, 5.0, 1000.0};
+  double bpm = 60;
+  Range systoleAccel{10, 100, 5}, systoleFloor{1, 101, 20};
+  Range diastoleAccel{5, 50, 5}, diastoleFloor{1, 61, 15};
+  Range steps{500, 720, 20};
+  unsigned threads = 0;
+  size_t show = 20;
+  const char* csvPath = nullptr;
+  for (int i = 1; i < argc; i++) {
+    const bool hasValue = i + 1 < argc;
+    if (std::strcmp(argv[i], "--volume") == 0 && hasValue) {
+      model.targetMl = std::atof(argv[++i]);
+    } else if (std::strcmp(argv[i], "--tolerance") == 0 && hasValue) {
+      model.toleranceMl = std::atof(argv[++i]);
+    } else if (std::strcmp(argv[i], "--bpm") == 0 && hasValue) {
+      bpm = std::atof(argv[++i]);
+    } else if (std::strcmp(argv[i], "--ml-per-step") == 0 && hasValue) {
+      model.mlPerStep = std::atof(argv[++i]);
+    } else if (std::strcmp(argv[i], "--systole-accel") == 0 && hasValue) {
+      if (!parseRange(argv[++i], systoleAccel)) return usage(argv[0]);
+    } else if (std::strcmp(argv[i], "--systole-floor") == 0 && hasValue) {
+      if (!parseRange(argv[++i], systoleFloor)) return usage(argv[0]);
+    } else if (std::strcmp(argv[i], "--diastole-accel") == 0 && hasValue) {
+      if (!parseRange(argv[++i], diastoleAccel)) return usage(argv[0]);
+    } else if (std::strcmp(argv[i], "--diastole-floor") == 0 && hasValue) {
+      if (!parseRange(argv[++i], diastoleFloor)) return usage(argv[0]);
+    } else if (std::strcmp(argv[i], "--steps") == 0 && hasValue) {
+      if (!parseRange(argv[++i], steps)) return usage(argv[0]);
+    } else if (std::strcmp(argv[i], "--threads") == 0 && hasValue) {
+      threads = static_cast<unsigned>(std::atoi(argv[++i]));
+    } else if (std::strcmp(argv[i], "--show") == 0 && hasValue) {
+      show = static_cast<size_t>(std::atol(argv[++i]));
+    } else if (std::strcmp(argv[i], "--csv") == 0 && hasValue) {
+      csvPath = argv[++i];
+    } else {
+      return usage(argv[0]);
+    }
+  }
+  if (bpm <= 0 || model.mlPerStep <= 0) {
+    return usage(argv[0]);
+  }
+  model.periodMs = 60000.0 / bpm;
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  const int mismatches = tableMismatches<MainPump>() + tableMismatches<Pump100mlSV>();
+  std::printf("model check: %d of %d shipped table entries differ from the walk\n", mismatches,
+              4 * MainPump::TABLE_STEPS);
+
+  // Mixed-radix index over the grid, steps slowest
+  const size_t count = systoleAccel.count() * systoleFloor.count() * diastoleAccel.count() * diastoleFloor.count() *
+                       steps.count();
+  auto candidateAt = [&](size_t index) {
+    Candidate c;
+    c.systoleAccel = static_cast<uint16_t>(systoleAccel.at(index % systoleAccel.count()));
+    index /= systoleAccel.count();
+    c.systoleFloor = static_cast<uint16_t>(systoleFloor.at(index % systoleFloor.count()));
+    index /= systoleFloor.count();
+    c.diastoleAccel = static_cast<uint16_t>(diastoleAccel.at(index % diastoleAccel.count()));
+    index /= diastoleAccel.count();
+    c.diastoleFloor = static_cast<uint16_t>(diastoleFloor.at(index % diastoleFloor.count()));
+    index /= diastoleFloor.count();
+    c.steps = static_cast<uint16_t>(steps.at(index));
+    return c;
+  };
+
+  std::vector<Outcome> outcomes(count);
+  WorkStealingPool pool(threads);
+  pool.start((count + TASK_CANDIDATES - 1) / TASK_CANDIDATES, [&](size_t task, unsigned) {
+    const size_t end = std::min(count, (task + 1) * TASK_CANDIDATES);
+    for (size_t i = task * TASK_CANDIDATES; i < end; i++) {
+      outcomes[i] = model.evaluate(candidateAt(i));
+    }
+  });
+  const double wall = pool.wait();
+  double busy = 0;
+  for (const WorkerStats& worker : pool.stats()) {
+    busy += worker.busySeconds;
+  }
+  size_t feasible = 0;
+  for (const Outcome& o : outcomes) {
+    feasible += o.feasible;
+  }
+  std::printf("%zu candidates on %u threads in %.3f s: %.2f us each on one core, %.0f per second\n", count,
+              pool.workers(), wall, busy / count * 1e6, count / wall);
+  std::printf("target %.1f +- %.1f mL at %.0f bpm (%.0f ms), %.4f mL per step: %zu feasible\n", model.targetMl,
+              model.toleranceMl, bpm, model.periodMs, model.mlPerStep, feasible);
+
+  const std::vector<Outcome> front = paretoFront(outcomes);
+  std::printf("\nPareto front, %zu settings, gentlest first\n", front.size());
+  printHeader();
+  for (size_t i = 0; i < front.size() && i < show; i++) {
+    printOutcome("", front[i]);
+  }
+  if (front.size() > show) {
+    std::printf("... %zu more (--show, --csv)\n", front.size() - show);
+  }
+
+  std::printf("\nShipped settings\n");
+  printHeader();
+  const struct {
+    const char* name;
+    Candidate candidate;
+  } builds[] = {{"main", shipped<MainPump>()}, {"100mlSV", shipped<Pump100mlSV>()}};
+  for (const auto& build : builds) {
+    const Outcome o = model.evaluate(build.candidate);
+    printOutcome(build.name, o);
+    size_t better = 0;
+    const Outcome* gentlest = nullptr;
+    for (const Outcome& f : front) {
+      if (dominates(f, o)) {
+        better++;
+        if (gentlest == nullptr) {
+          gentlest = &f;
+        }
+      }
+    }
+    if (!o.feasible) {
+      std::printf("%-10s infeasible for this target\n", "");
+    } else if (gentlest != nullptr) {
+      std::printf("%-10s dominated by %zu front settings; the gentlest of them:\n", "", better);
+      printOutcome("", *gentlest);
+    } else {
+      std::printf("%-10s on the front\n", "");
+    }
+  }
+
+  if (csvPath != nullptr) {
+    FILE* csv = std::fopen(csvPath, "w");
+    if (csv == nullptr) {
+      std::perror(csvPath);
+      return 1;
+    }
+    std::fprintf(csv, "systole_accel_milli,systole_floor_us,diastole_accel_milli,diastole_floor_us,steps,"
+                      "stroke_ml,systole_ms,diastole_ms,shortest_period_ms,peak_flow_ml_s,peak_accel_ml_s2\n");
+    for (const Outcome& o : front) {
+      const Candidate& c = o.candidate;
+      std::fprintf(csv, "%u,%u,%u,%u,%u,%.3f,%.3f,%.3f,%.3f,%.2f,%.1f\n", c.systoleAccel, c.systoleFloor,
+                   c.diastoleAccel, c.diastoleFloor, c.steps, o.strokeMl, o.systoleMs, o.diastoleMs,
+                   o.shortestPeriodMs, o.peakFlow, o.peakAccel);
+    }
+    std::fclose(csv);
+  }
+  return 0;
+}
@@ -0,0 +1,632 @@
+// Drives many pump rigs at once from a single event loop.
+//
+//   pio run -e rig_daemon
+//   .pio/build/rig_daemon/program [options] PORT...
+//
+// Options:
+//   --out DIR          session files, DIR/rig0.txt, rig1.txt ... (default .)
+//   --rate BPM         run configuration pushed before each session; what
+//   --runtime S        is not given stays as the rig has it
+//   --profile tables|ramp|waveform
+//   --ramps A F A F
+//   --telemetry MASK   record classes streamed during sessions (default 7)
+//   --poll MS          status poll interval per rig (default 500)
+//   --start            run a session on every rig as soon as it answers
+//   --exit-when-done   exit once every rig has run a session and holds again
+//
+// Rigs are named rig0, rig1 ... in the order of their ports. Control lines on
+// stdin, RIG being a name or "all":
+//   RIG run | start | stop | abort | status
+//   RIG jog POSITION | rate BPM | runtime S | profile P | ramps A F A F | telemetry MASK
+//   list
+//   quit
+// "run" pushes the run configuration and telemetry classes and starts a
+// session; a rig in the middle of one is aborted first and started again once
+// it holds. Replies print as "RIG VERB RESULT", firmware text as "RIG | TEXT".
+//
+// Each session file holds what pump_link record writes, so click_extract
+// --session reads it unchanged, and after every reversal a line
+//   sync <rig us> host <unix us>
+// with the host clock when the record arrived (a few milliseconds behind the
+// motor, the record's trip over the link), for lining the rig's clock up with
+// an audio recording made on this machine.
+//
+// One epoll loop serves every port, the control input and the signals;
+// nothing waits on any one rig. Per rig, at most RIG_QUEUE_DEPTH commands are
+// queued (a control line for a rig whose queue is full is answered "busy"),
+// each wakeup reads at most READ_BUDGET bytes so a chatty rig cannot starve
+// the rest, and what a rig sends is parsed as it arrives, so its memory is
+// fixed: the queue, the decoder's buffer, a text line and the session file's
+// stdio buffer. A rig that hangs up is retried every RECONNECT_MICROS. On exit
+// (quit, SIGINT, SIGTERM) the daemon prints per-rig counters and its own CPU
+// time and peak memory.
+
+#include "pump_link.h"
+#include "rig_channel.h"
+#include "telemetry.h"
+#include "telemetry_decoder.h"
+
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/signalfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+constexpr size_t READ_BUDGET = 512;
+constexpr uint64_t RECONNECT_MICROS = 5000000;
+constexpr uint64_t LINGER_MICROS = 1000000;  // Trailing records after the last rig holds
+constexpr size_t SESSION_BUFFER = 16384;
+constexpr size_t MAX_CONTROL_LINE = 512;
+constexpr uint32_t CONTROL_TAG = 0xFFFFFFFE;
+constexpr uint32_t SIGNAL_TAG = 0xFFFFFFFF;
+
+static const char* const STATE_NAMES[] = {
+    "SYSTOLE_ACCEL",   "SYSTOLE_DECEL", "DIASTOLE_ACCEL", "DIASTOLE_DECEL",           "RETURN_TO_START",
+    "CYCLE_COMPLETE",  "SHUTDOWN",      "HOLD_POSITION",  "RETURN_TO_MANUAL_POSITION", "WAVEFORM_PLAYBACK",
+};
+constexpr unsigned STATE_COUNT = sizeof(STATE_NAMES) / sizeof(STATE_NAMES[0]);
+constexpr uint8_t STATE_SHUTDOWN = 6;
+constexpr uint8_t STATE_HOLD_POSITION = 7;
+
+static const char* const STATUS_TEXT[] = {"ok", "unknown command", "bad payload", "refused"};
+
+static uint64_t monotonicMicros() {
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return static_cast<uint64_t>(now.tv_sec) * 1000000ULL + static_cast<uint64_t>(now.tv_nsec) / 1000;
+}
+
+static uint64_t unixMicros() {
+  timespec now;
+  clock_gettime(CLOCK_REALTIME, &now);
+  return static_cast<uint64_t>(now.tv_sec) * 1000000ULL + static_cast<uint64_t>(now.tv_nsec) / 1000;
+}
+
+static const char* statusText(uint8_t status) {
+  if (status == RigChannel::STATUS_TIMEOUT) {
+    return "no reply";
+  }
+  return status < sizeof(STATUS_TEXT) / sizeof(STATUS_TEXT[0]) ? STATUS_TEXT[status] : "?";
+}
+
+struct RunConfig {
+  int rate = -1;
+  long runtime = -1;
+  int profile = -1;
+  bool ramps = false;
+  uint16_t rampValues[4] = {};
+  uint8_t telemetry = TELEMETRY_ALL;
+};
+
+struct Rig {
+  std::string name;
+  std::string port;
+  uint32_t tag = 0;
+  RigChannel channel;
+  FILE* session = nullptr;
+  std::unique_ptr<TelemetryDecoder> decoder;
+  bool online = false;
+  bool watchingOutput = false;
+  uint64_t retryAt = 0;
+  uint64_t nextPoll = 0;
+
+  PumpStatus status{};
+  bool haveStatus = false;
+  bool runRequested = false;  // Start a session once holding
+  bool starting = false;      // Configuration and START queued
+  bool aborting = false;      // ABORT sent for a run request
+  unsigned sessions = 0;
+  uint64_t beats = 0;
+  uint64_t syncMarkers = 0;
+};
+
+class RigDaemon {
+ public:
+  RigDaemon(const RunConfig& run, uint64_t pollMicros, bool exitWhenDone)
+      : run(run), pollMicros(pollMicros), exitWhenDone(exitWhenDone) {}
+
+  bool addRig(const char* port, const char* outDir);
+  int serve(bool startAll);
+
+ private:
+  void connect(Rig& rig, uint64_t now);
+  void disconnect(Rig& rig, const char* why);
+  void watch(Rig& rig, uint64_t now);
+  void poll(Rig& rig);
+  void onStatus(Rig& rig, const PumpStatus& status);
+  void pushRun(Rig& rig);
+  void command(Rig& rig, const char* verb, uint8_t code, const uint8_t* payload, uint8_t length);
+  void control(const std::string& line);
+  void controlRig(Rig& rig, const std::vector<std::string>& words);
+  void readControl();
+  bool done() const;
+  void list() const;
+  void summary(double wallSeconds) const;
+
+  RunConfig run;
+  uint64_t pollMicros;
+  bool exitWhenDone;
+  int epoll = -1;
+  bool quit = false;
+  bool controlOpen = true;
+  std::string controlLine;
+  std::vector<std::unique_ptr<Rig>> rigs;
+};
+
+bool RigDaemon::addRig(const char* port, const char* outDir) {
+  std::unique_ptr<Rig> rig(new Rig);
+  rig->tag = static_cast<uint32_t>(rigs.size());
+  rig->name = "rig" + std::to_string(rigs.size());
+  rig->port = port;
+  const std::string path = std::string(outDir) + "/" + rig->name + ".txt";
+  rig->session = std::fopen(path.c_str(), "w");
+  if (rig->session == nullptr) {
+    std::perror(path.c_str());
+    return false;
+  }
+  std::setvbuf(rig->session, nullptr, _IOFBF, SESSION_BUFFER);
+  rig->decoder.reset(new TelemetryDecoder(rig->session));
+  Rig* r = rig.get();
+  rig->decoder->setListener([r](uint8_t code, uint64_t micros) {
+    if (code == TELEMETRY_REVERSAL) {
+      std::fprintf(r->session, "sync %llu host %llu\n", static_cast<unsigned long long>(micros),
+                   static_cast<unsigned long long>(unixMicros()));
+      r->syncMarkers++;
+    } else if (code == TELEMETRY_BEAT_START) {
+      r->beats++;
+    }
+  });
+  rig->channel.setMonitor([r](const uint8_t* data, size_t size) { r->decoder->feed(data, size); });
+  rig->channel.setTextHandler([r](const std::string& line) { std::printf("%s | %s\n", r->name.c_str(), line.c_str()); });
+  rigs.push_back(std::move(rig));
+  return true;
+}
+
+void RigDaemon::connect(Rig& rig, uint64_t now) {
+  rig.retryAt = now + RECONNECT_MICROS;
+  if (!rig.channel.open(rig.port.c_str())) {
+    return;
+  }
+  epoll_event event{};
+  event.events = EPOLLIN;
+  event.data.u32 = rig.tag;
+  if (epoll_ctl(epoll, EPOLL_CTL_ADD, rig.channel.fd(), &event) != 0) {
+    rig.channel.close();
+    return;
+  }
+  rig.online = true;
+  rig.watchingOutput = false;
+  rig.haveStatus = false;
+  rig.nextPoll = now;
+  std::printf("%s online %s\n", rig.name.c_str(), rig.port.c_str());
+}
+
+void RigDaemon::disconnect(Rig& rig, const char* why) {
+  if (!rig.online) {
+    return;
+  }
+  epoll_ctl(epoll, EPOLL_CTL_DEL, rig.channel.fd(), nullptr);
+  rig.online = false;
+  rig.retryAt = monotonicMicros() + RECONNECT_MICROS;
+  rig.starting = false;
+  rig.aborting = false;
+  rig.channel.close();  // Fails whatever was queued
+  std::printf("%s offline (%s)\n", rig.name.c_str(), why);
+}
+
+// Sends what is queued and watches for output room only while some is left
+void RigDaemon::watch(Rig& rig, uint64_t now) {
+  if (!rig.online) {
+    return;
+  }
+  if (rig.channel.wantsWrite() && !rig.channel.onWritable(now)) {
+    disconnect(rig, std::strerror(errno));
+    return;
+  }
+  const bool wantOutput = rig.channel.wantsWrite();
+  if (wantOutput != rig.watchingOutput) {
+    epoll_event event{};
+    event.events = EPOLLIN | (wantOutput ? EPOLLOUT : 0u);
+    event.data.u32 = rig.tag;
+    epoll_ctl(epoll, EPOLL_CTL_MOD, rig.channel.fd(), &event);
+    rig.watchingOutput = wantOutput;
+  }
+}
+
+void RigDaemon::poll(Rig& rig) {
+  Rig* r = &rig;
+  rig.channel.send(COMMAND_STATUS, nullptr, 0, [this, r](uint8_t status, const uint8_t* reply, uint8_t length) {
+    if (status != STATUS_OK || length < 10) {
+      return;
+    }
+    PumpStatus s{};
+    s.state = reply[0];
+    s.profile = reply[1];
+    s.position = static_cast<int32_t>(readU32(&reply[2]));
+    s.stopping = reply[6] != 0;
+    s.droppedFrames = readU16(&reply[7]);
+    s.configPending = reply[9] != 0;
+    onStatus(*r, s);
+  });
+}
+
+void RigDaemon::onStatus(Rig& rig, const PumpStatus& status) {
+  rig.status = status;
+  rig.haveStatus = true;
+  if (!rig.runRequested || rig.starting) {
+    return;
+  }
+  if (status.state == STATE_HOLD_POSITION) {
+    pushRun(rig);
+  } else if (!rig.aborting && status.state != STATE_SHUTDOWN && !status.stopping) {
+    rig.aborting = true;
+    command(rig, "abort", COMMAND_ABORT, nullptr, 0);
+  }
+}
+
+// Configuration, telemetry classes and START, in one go so nothing can slip in between
+void RigDaemon::pushRun(Rig& rig) {
+  const size_t needed = 2 + (run.rate > 0) + (run.runtime > 0) + (run.profile >= 0) + run.ramps;
+  if (RIG_QUEUE_DEPTH - rig.channel.queued() < needed) {
+    return;  // Next poll
+  }
+  uint8_t payload[8];
+  if (run.rate > 0) {
+    writeU16(payload, static_cast<uint16_t>(run.rate));
+    command(rig, "rate", COMMAND_RATE, payload, 2);
+  }
+  if (run.runtime > 0) {
+    writeU32(payload, static_cast<uint32_t>(run.runtime));
+    command(rig, "runtime", COMMAND_RUNTIME, payload, 4);
+  }
+  if (run.profile >= 0) {
+    payload[0] = static_cast<uint8_t>(run.profile);
+    command(rig, "profile", COMMAND_PROFILE, payload, 1);
+  }
+  if (run.ramps) {
+    for (int i = 0; i < 4; i++) {
+      writeU16(&payload[2 * i], run.rampValues[i]);
+    }
+    command(rig, "ramps", COMMAND_RAMPS, payload, 8);
+  }
+  command(rig, "telemetry", COMMAND_TELEMETRY, &run.telemetry, 1);
+  Rig* r = &rig;
+  rig.starting = true;
+  rig.channel.send(COMMAND_START, nullptr, 0, [r](uint8_t status, const uint8_t*, uint8_t) {
+    r->starting = false;
+    r->aborting = false;
+    if (status == STATUS_OK) {
+      r->runRequested = false;
+      r->sessions++;
+      std::fprintf(r->session, "# session %u started host %llu\n", r->sessions,
+                   static_cast<unsigned long long>(unixMicros()));
+    }
+    std::printf("%s start %s\n", r->name.c_str(), statusText(status));
+  });
+}
+
+// Queues a command whose reply is only reported
+void RigDaemon::command(Rig& rig, const char* verb, uint8_t code, const uint8_t* payload, uint8_t length) {
+  Rig* r = &rig;
+  const bool queued = rig.channel.send(code, payload, length, [r, verb](uint8_t status, const uint8_t*, uint8_t) {
+    std::printf("%s %s %s\n", r->name.c_str(), verb, statusText(status));
+  });
+  if (!queued) {
+    std::printf("%s %s busy\n", rig.name.c_str(), verb);
+  }
+}
+
+void RigDaemon::controlRig(Rig& rig, const std::vector<std::string>& words) {
+  const std::string& verb = words[1];
+  auto number = [&](size_t index) { return std::strtol(words[index].c_str(), nullptr, 0); };
+  uint8_t payload[8];
+  if (verb == "run") {
+    rig.runRequested = true;
+    rig.nextPoll = 0;
+  } else if (!rig.online) {
+    std::printf("%s %s offline\n", rig.name.c_str(), verb.c_str());
+  } else if (verb == "status" && words.size() == 2) {
+    Rig* r = &rig;
+    const bool queued = rig.channel.send(COMMAND_STATUS, nullptr, 0, [r](uint8_t status, const uint8_t* reply, uint8_t length) {
+      if (status != STATUS_OK || length < 10) {
+        std::printf("%s status %s\n", r->name.c_str(), statusText(status));
+        return;
+      }
+      std::printf("%s status %s profile %u position %ld stopping %d dropped %u pending %d\n", r->name.c_str(),
+                  reply[0] < STATE_COUNT ? STATE_NAMES[reply[0]] : "?", reply[1],
+                  static_cast<long>(static_cast<int32_t>(readU32(&reply[2]))), reply[6], readU16(&reply[7]), reply[9]);
+    });
+    if (!queued) {
+      std::printf("%s status busy\n", rig.name.c_str());
+    }
+  } else if (verb == "start" && words.size() == 2) {
+    command(rig, "start", COMMAND_START, nullptr, 0);
+  } else if (verb == "stop" && words.size() == 2) {
+    command(rig, "stop", COMMAND_STOP, nullptr, 0);
+  } else if (verb == "abort" && words.size() == 2) {
+    command(rig, "abort", COMMAND_ABORT, nullptr, 0);
+  } else if (verb == "jog" && words.size() == 3) {
+    writeU32(payload, static_cast<uint32_t>(number(2)));
+    command(rig, "jog", COMMAND_JOG, payload, 4);
+  } else if (verb == "rate" && words.size() == 3) {
+    writeU16(payload, static_cast<uint16_t>(number(2)));
+    command(rig, "rate", COMMAND_RATE, payload, 2);
+  } else if (verb == "runtime" && words.size() == 3) {
+    writeU32(payload, static_cast<uint32_t>(number(2)));
+    command(rig, "runtime", COMMAND_RUNTIME, payload, 4);
+  } else if (verb == "profile" && words.size() == 3) {
+    payload[0] = words[2] == "ramp" ? PROFILE_LIVE_RAMP : words[2] == "waveform" ? PROFILE_WAVEFORM : PROFILE_TABLES;
+    command(rig, "profile", COMMAND_PROFILE, payload, 1);
+  } else if (verb == "ramps" && words.size() == 6) {
+    for (int i = 0; i < 4; i++) {
+      writeU16(&payload[2 * i], static_cast<uint16_t>(number(2 + i)));
+    }
+    command(rig, "ramps", COMMAND_RAMPS, payload, 8);
+  } else if (verb == "telemetry" && words.size() == 3) {
+    payload[0] = static_cast<uint8_t>(number(2));
+    command(rig, "telemetry", COMMAND_TELEMETRY, payload, 1);
+  } else {
+    std::printf("%s %s ?\n", rig.name.c_str(), verb.c_str());
+  }
+}
+
+void RigDaemon::control(const std::string& line) {
+  std::vector<std::string> words;
+  size_t at = 0;
+  while (at < line.size()) {
+    const size_t start = line.find_first_not_of(" \t\r", at);
+    if (start == std::string::npos) {
+      break;
+    }
+    const size_t end = line.find_first_of(" \t\r", start);
+    words.push_back(line.substr(start, end == std::string::npos ? std::string::npos : end - start));
+    at = end == std::string::npos ? line.size() : end;
+  }
+  if (words.empty()) {
+    return;
+  }
+  if (words[0] == "quit") {
+    quit = true;
+  } else if (words[0] == "list") {
+    list();
+  } else if (words.size() < 2) {
+    std::printf("? %s\n", line.c_str());
+  } else {
+    bool matched = false;
+    for (const std::unique_ptr<Rig>& rig : rigs) {
+      if (words[0] == "all" || words[0] == rig->name) {
+        matched = true;
+        controlRig(*rig, words);
+      }
+    }
+    if (!matched) {
+      std::printf("%s unknown rig\n", words[0].c_str());
+    }
+  }
+}
+
+void RigDaemon::readControl() {
+  char buffer[256];
+  const ssize_t got = ::read(STDIN_FILENO, buffer, sizeof(buffer));
+  if (got < 0 && (errno == EAGAIN || errno == EINTR)) {
+    return;
+  }
+  if (got <= 0) {
+    epoll_ctl(epoll, EPOLL_CTL_DEL, STDIN_FILENO, nullptr);
+    controlOpen = false;
+    return;
+  }
+  for (ssize_t i = 0; i < got; i++) {
+    if (buffer[i] == '\n') {
+      control(controlLine);
+      controlLine.clear();
+    } else if (controlLine.size() < MAX_CONTROL_LINE) {
+      controlLine += buffer[i];
+    }
+  }
+}
+
+bool RigDaemon::done() const {
+  for (const std::unique_ptr<Rig>& rig : rigs) {
+    const bool holding = rig->haveStatus && rig->status.state == STATE_HOLD_POSITION;
+    if (rig->online && (rig->sessions == 0 || rig->runRequested || rig->starting || !holding)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void RigDaemon::list() const {
+  for (const std::unique_ptr<Rig>& rig : rigs) {
+    const TelemetryDecoder::Counters& records = rig->decoder->counters();
+    const RigChannel::Counters& link = rig->channel.counters();
+    const char* state = !rig->online ? "offline"
+                        : !rig->haveStatus ? "?"
+                        : rig->status.state < STATE_COUNT ? STATE_NAMES[rig->status.state]
+                                                          : "?";
+    std::printf("%-6s %-26s position %7ld sessions %u beats %llu records %llu lost %llu corrupt %llu sync %llu "
+                "queue %zu timeouts %llu in %llu out %llu\n",
+                rig->name.c_str(), state, static_cast<long>(rig->status.position), rig->sessions,
+                static_cast<unsigned long long>(rig->beats), static_cast<unsigned long long>(records.records),
+                static_cast<unsigned long long>(records.lost), static_cast<unsigned long long>(records.corrupt),
+                static_cast<unsigned long long>(rig->syncMarkers), rig->channel.queued(),
+                static_cast<unsigned long long>(link.timeouts), static_cast<unsigned long long>(link.bytesIn),
+                static_cast<unsigned long long>(link.bytesOut));
+  }
+}
+
+void RigDaemon::summary(double wallSeconds) const {
+  list();
+  rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+  const double cpu = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec * 1e-6 + usage.ru_stime.tv_sec +
+                     usage.ru_stime.tv_usec * 1e-6;
+  std::printf("%zu rigs, %.1f s, cpu %.3f s (%.2f%% of one core, %.3f%% per rig), peak rss %ld kB\n", rigs.size(),
+              wallSeconds, cpu, cpu / wallSeconds * 100, cpu / wallSeconds * 100 / rigs.size(), usage.ru_maxrss);
+}
+
+int RigDaemon::serve(bool startAll) {
+  epoll = epoll_create1(EPOLL_CLOEXEC);
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  sigprocmask(SIG_BLOCK, &signals, nullptr);
+  const int signalFd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+  epoll_event event{};
+  event.events = EPOLLIN;
+  event.data.u32 = SIGNAL_TAG;
+  epoll_ctl(epoll, EPOLL_CTL_ADD, signalFd, &event);
+  event.data.u32 = CONTROL_TAG;
+  controlOpen = epoll_ctl(epoll, EPOLL_CTL_ADD, STDIN_FILENO, &event) == 0;
+
+  const uint64_t started = monotonicMicros();
+  for (const std::unique_ptr<Rig>& rig : rigs) {
+    connect(*rig, started);
+    rig->runRequested = startAll;
+  }
+  std::fflush(stdout);
+
+  uint64_t doneAt = 0;
+  epoll_event events[64];
+  while (!quit) {
+    uint64_t now = monotonicMicros();
+    uint64_t wake = now + 1000000;
+    for (const std::unique_ptr<Rig>& rig : rigs) {
+      wake = std::min(wake, rig->online ? std::min(rig->channel.deadline(), rig->nextPoll) : rig->retryAt);
+    }
+    const int timeout = wake > now ? static_cast<int>((wake - now + 999) / 1000) : 0;
+    const int ready = epoll_wait(epoll, events, 64, timeout);
+    now = monotonicMicros();
+    for (int i = 0; i < ready; i++) {
+      const uint32_t tag = events[i].data.u32;
+      if (tag == SIGNAL_TAG) {
+        quit = true;
+      } else if (tag == CONTROL_TAG) {
+        readControl();
+      } else {
+        Rig& rig = *rigs[tag];
+        if (!rig.online) {
+          continue;
+        }
+        if ((events[i].events & EPOLLOUT) != 0 && !rig.channel.onWritable(now)) {
+          disconnect(rig, std::strerror(errno));
+        } else if ((events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) != 0 &&
+                   !rig.channel.onReadable(READ_BUDGET, now)) {
+          disconnect(rig, (events[i].events & EPOLLHUP) != 0 ? "hung up" : "read failed");
+        }
+      }
+    }
+    for (const std::unique_ptr<Rig>& rig : rigs) {
+      if (!rig->online) {
+        if (now >= rig->retryAt) {
+          connect(*rig, now);
+        }
+        continue;
+      }
+      rig->channel.expire(now);
+      if (now >= rig->nextPoll) {
+        rig->nextPoll = now + pollMicros;
+        if (rig->channel.queued() == 0) {
+          poll(*rig);
+        }
+        std::fflush(rig->session);
+      }
+      watch(*rig, now);
+    }
+    std::fflush(stdout);
+    if (exitWhenDone) {
+      if (!done()) {
+        doneAt = 0;
+      } else if (doneAt == 0) {
+        doneAt = now + LINGER_MICROS;
+      } else if (now >= doneAt) {
+        quit = true;
+      }
+    }
+  }
+
+  // Closing answers what is still queued, so the summary comes after
+  for (const std::unique_ptr<Rig>& rig : rigs) {
+    if (rig->online) {
+      epoll_ctl(epoll, EPOLL_CTL_DEL, rig->channel.fd(), nullptr);
+    }
+    rig->channel.close();
+  }
+  summary((monotonicMicros() - started) * 1e-6);
+  for (const std::unique_ptr<Rig>& rig : rigs) {
+    std::fclose(rig->session);
+  }
+  ::close(signalFd);
+  ::close(epoll);
+  return 0;
+}
+
+static int usage(const char* program) {
+  std::fprintf(stderr,
+               "usage: %s [--out DIR] [--rate BPM] [--runtime S] [--profile tables|ramp|waveform] [--ramps A F A F]\n"
+               "          [--telemetry MASK] [--poll MS] [--start] [--exit-when-done] PORT...\n",
+               program);
+  return 2;
+}
+
+int main(int argc, char** argv) {
+  RunConfig run;
+  const char* outDir = ".";
+  long pollMillis = 500;
+  bool startAll = false;
+  bool exitWhenDone = false;
+  std::vector<const char*> ports;
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+      outDir = argv[++i];
+    } else if (std::strcmp(argv[i], "--rate") == 0 && i + 1 < argc) {
+      run.rate = std::atoi(argv[++i]);
+    } else if (std::strcmp(argv[i], "--runtime") == 0 && i + 1 < argc) {
+      run.runtime = std::atol(argv[++i]);
+    } else if (std::strcmp(argv[i], "--profile") == 0 && i + 1 < argc) {
+      const char* name = argv[++i];
+      run.profile = std::strcmp(name, "ramp") == 0       ? PROFILE_LIVE_RAMP
+                    : std::strcmp(name, "waveform") == 0 ? PROFILE_WAVEFORM
+                                                         : PROFILE_TABLES;
+    } else if (std::strcmp(argv[i], "--ramps") == 0 && i + 4 < argc) {
+      run.ramps = true;
+      for (int k = 0; k < 4; k++) {
+        run.rampValues[k] = static_cast<uint16_t>(std::atoi(argv[++i]));
+      }
+    } else if (std::strcmp(argv[i], "--telemetry") == 0 && i + 1 < argc) {
+      run.telemetry = static_cast<uint8_t>(std::strtol(argv[++i], nullptr, 0));
+    } else if (std::strcmp(argv[i], "--poll") == 0 && i + 1 < argc) {
+      pollMillis = std::atol(argv[++i]);
+    } else if (std::strcmp(argv[i], "--start") == 0) {
+      startAll = true;
+    } else if (std::strcmp(argv[i], "--exit-when-done") == 0) {
+      exitWhenDone = true;
+    } else if (argv[i][0] == '-') {
+      return usage(argv[0]);
+    } else {
+      ports.push_back(argv[i]);
+    }
+  }
+  if (ports.empty() || pollMillis <= 0 || ports.size() >= CONTROL_TAG) {
+    return usage(argv[0]);
+  }
+
+  RigDaemon daemon(run, static_cast<uint64_t>(pollMillis) * 1000, exitWhenDone);
+  for (const char* port : ports) {
+    if (!daemon.addRig(port, outDir)) {
+      return 1;
+    }
+  }
+  return daemon.serve(startAll);
+}
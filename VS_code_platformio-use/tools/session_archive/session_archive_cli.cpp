@@ -0,0 +1,237 @@
+// Reads session archives written by click_extract --archive.
+//
+//   pio run -e session_archive
+//   .pio/build/session_archive/program info ARCHIVE...
+//   .pio/build/session_archive/program click ARCHIVE N [OUT.wav]
+//   .pio/build/session_archive/program beat ARCHIVE BEAT [OUT.wav]
+//   .pio/build/session_archive/program at ARCHIVE SECONDS
+//   .pio/build/session_archive/program bench ARCHIVE... [--fetches N]
+//
+// "click" prints click N (0-based, in onset order) and can save its samples
+// as a WAV file; "beat" does the same for every click of a beat, and "at" for
+// the first click at or after a time. "bench" opens every archive as a
+// catalogue, then fetches random clicks of random sessions and sums their
+// samples, and reports the cost of each step.
+
+#include "session_archive.h"
+#include "wav_io.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t DEFAULT_FETCHES = 1000000;
+
+static const char* const CLICK_KIND[] = {"-", "opening", "closure"};
+
+static int usage(const char* program) {
+  std::fprintf(stderr,
+               "usage: %s info ARCHIVE...\n"
+               "       %s click ARCHIVE N [OUT.wav] | beat ARCHIVE BEAT [OUT.wav] | at ARCHIVE SECONDS\n"
+               "       %s bench ARCHIVE... [--fetches N]\n",
+               program, program, program);
+  return 2;
+}
+
+static bool openArchive(SessionArchive& archive, const char* path) {
+  if (!archive.open(path)) {
+    std::fprintf(stderr, "%s: %s\n", path, archive.error().c_str());
+    return false;
+  }
+  return true;
+}
+
+static void printInfo(const char* path, const SessionArchive& archive) {
+  const ArchiveHeader& h = archive.header();
+  const ArchiveRunConfig& run = archive.run();
+  std::printf("%s\n", path);
+  std::printf("  audio     %.1f s at %u Hz in %llu chunks\n", static_cast<double>(h.totalSamples) / h.sampleRate,
+              h.sampleRate, static_cast<unsigned long long>(h.chunkCount));
+  std::printf("  index     %zu clicks, %zu beats\n", archive.clickCount(), archive.beatCount());
+  std::printf("  run       %.24s, profile %.16s, %u bpm, stroke %u steps, %u s\n", run.variant,
+              run.profile[0] != '\0' ? run.profile : "?", run.heartRate, run.strokeSteps, run.runtimeSeconds);
+  if (run.systoleAccel != 0 || run.diastoleAccel != 0) {
+    std::printf("  ramps     systole %u/%u, diastole %u/%u\n", run.systoleAccel, run.systoleFloor, run.diastoleAccel,
+                run.diastoleFloor);
+  }
+  if (run.note[0] != '\0') {
+    std::printf("  note      %.72s\n", run.note);
+  }
+}
+
+static void printClick(const SessionArchive& archive, size_t index) {
+  const ArchiveClick& c = archive.click(index);
+  const double rate = archive.header().sampleRate;
+  std::printf("click %zu  onset %.4f s  %.2f ms  beat %d %s  peak %.4f  floor %.5f\n", index, c.onset / rate,
+              c.samples * 1e3 / rate, c.beat, c.kind < 3 ? CLICK_KIND[c.kind] : "?", c.peak, c.noiseFloor);
+}
+
+// Appends the clicks [first, first + count) to a WAV file, 10 ms of silence apart
+static bool saveClicks(const SessionArchive& archive, size_t first, size_t count, const char* path) {
+  WavWriter writer;
+  if (!writer.open(path, static_cast<int>(archive.header().sampleRate))) {
+    std::perror(path);
+    return false;
+  }
+  std::vector<float> samples;
+  for (size_t i = first; i < first + count; i++) {
+    const ArchiveClick& c = archive.click(i);
+    const int16_t* pcm = archive.clickSamples(c);
+    if (pcm == nullptr) {
+      continue;
+    }
+    samples.assign(c.samples + archive.header().sampleRate / 100, 0.0f);
+    for (uint32_t s = 0; s < c.samples; s++) {
+      samples[s] = pcm[s] / 32768.0f;
+    }
+    writer.write(samples.data(), samples.size());
+  }
+  return writer.close();
+}
+
+static int bench(const std::vector<const char*>& paths, size_t fetches) {
+  std::vector<SessionArchive> catalogue(paths.size());
+  const Clock::time_point opening = Clock::now();
+  for (size_t k = 0; k < paths.size(); k++) {
+    if (!openArchive(catalogue[k], paths[k])) {
+      return 1;
+    }
+  }
+  const double openSeconds = std::chrono::duration<double>(Clock::now() - opening).count();
+
+  size_t clicks = 0;
+  uint64_t bytes = 0;
+  for (const SessionArchive& archive : catalogue) {
+    clicks += archive.clickCount();
+    bytes += archive.header().beatIndexOffset + archive.beatCount() * sizeof(ArchiveBeat);
+  }
+  std::printf("catalogue  %zu sessions, %zu clicks, %.1f GB\n", catalogue.size(), clicks, bytes / 1e9);
+  std::printf("open       %.3f ms total, %.1f us per session\n", openSeconds * 1e3,
+              openSeconds * 1e6 / catalogue.size());
+  if (clicks == 0) {
+    return 0;
+  }
+
+  // Random session, then a random click of it: the access pattern of building
+  // a labelled set from a list of (session, click) pairs
+  std::mt19937_64 rng(1);
+  int64_t checksum = 0;
+  uint64_t samples = 0;
+  for (int pass = 0; pass < 2; pass++) {
+    const Clock::time_point start = Clock::now();
+    for (size_t f = 0; f < fetches; f++) {
+      const SessionArchive& archive = catalogue[rng() % catalogue.size()];
+      if (archive.clickCount() == 0) {
+        continue;
+      }
+      const ArchiveClick& c = archive.click(rng() % archive.clickCount());
+      const int16_t* pcm = archive.clickSamples(c);
+      for (uint32_t s = 0; s < c.samples; s++) {
+        checksum += pcm[s];
+      }
+      samples += c.samples;
+    }
+    const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    std::printf("fetch %-5s %zu clicks in %.3f s, %.0f ns per click with its samples\n", pass == 0 ? "cold" : "warm",
+                fetches, seconds, seconds * 1e9 / fetches);
+  }
+
+  // Time lookups: beat number and onset, both binary searches
+  const Clock::time_point start = Clock::now();
+  size_t found = 0;
+  for (size_t f = 0; f < fetches; f++) {
+    const SessionArchive& archive = catalogue[rng() % catalogue.size()];
+    if (archive.beatCount() > 0) {
+      found += archive.findBeat(static_cast<uint32_t>(rng() % (archive.beat(archive.beatCount() - 1).beat + 1))) != nullptr;
+    }
+    found += archive.findClick(rng() % (archive.totalSamples() + 1)) < archive.clickCount();
+  }
+  const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+  std::printf("lookup     %.0f ns per beat and time lookup (%zu hits)\n", seconds * 1e9 / fetches, found);
+  std::printf("checksum   %lld over %llu samples\n", static_cast<long long>(checksum),
+              static_cast<unsigned long long>(samples));
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    return usage(argv[0]);
+  }
+  const char* verb = argv[1];
+
+  if (std::strcmp(verb, "info") == 0) {
+    int status = 0;
+    for (int i = 2; i < argc; i++) {
+      SessionArchive archive;
+      if (!openArchive(archive, argv[i])) {
+        status = 1;
+        continue;
+      }
+      printInfo(argv[i], archive);
+    }
+    return status;
+  }
+
+  if (std::strcmp(verb, "bench") == 0) {
+    std::vector<const char*> paths;
+    size_t fetches = DEFAULT_FETCHES;
+    for (int i = 2; i < argc; i++) {
+      if (std::strcmp(argv[i], "--fetches") == 0 && i + 1 < argc) {
+        fetches = std::strtoul(argv[++i], nullptr, 10);
+      } else {
+        paths.push_back(argv[i]);
+      }
+    }
+    return paths.empty() ? usage(argv[0]) : bench(paths, fetches);
+  }
+
+  if (argc < 4) {
+    return usage(argv[0]);
+  }
+  SessionArchive archive;
+  if (!openArchive(archive, argv[2])) {
+    return 1;
+  }
+  const char* wavOut = argc >= 5 ? argv[4] : nullptr;
+
+  if (std::strcmp(verb, "click") == 0) {
+    const size_t index = std::strtoul(argv[3], nullptr, 10);
+    if (index >= archive.clickCount()) {
+      std::fprintf(stderr, "%s has %zu clicks\n", argv[2], archive.clickCount());
+      return 1;
+    }
+    printClick(archive, index);
+    return wavOut == nullptr || saveClicks(archive, index, 1, wavOut) ? 0 : 1;
+  }
+  if (std::strcmp(verb, "beat") == 0) {
+    const ArchiveBeat* beat = archive.findBeat(static_cast<uint32_t>(std::strtoul(argv[3], nullptr, 10)));
+    if (beat == nullptr || beat->firstClick + beat->clickCount > archive.clickCount()) {
+      std::fprintf(stderr, "%s: no such beat\n", argv[2]);
+      return 1;
+    }
+    std::printf("beat %u  start %.4f s  %u clicks\n", beat->beat,
+                static_cast<double>(beat->start) / archive.header().sampleRate, beat->clickCount);
+    for (uint32_t i = 0; i < beat->clickCount; i++) {
+      printClick(archive, static_cast<size_t>(beat->firstClick) + i);
+    }
+    return wavOut == nullptr || saveClicks(archive, static_cast<size_t>(beat->firstClick), beat->clickCount, wavOut)
+               ? 0
+               : 1;
+  }
+  if (std::strcmp(verb, "at") == 0) {
+    const double seconds = std::strtod(argv[3], nullptr);
+    const size_t index = archive.findClick(static_cast<uint64_t>(seconds * archive.header().sampleRate));
+    if (index >= archive.clickCount()) {
+      std::puts("no click after that time");
+      return 1;
+    }
+    printClick(archive, index);
+    return 0;
+  }
+  return usage(argv[0]);
+}
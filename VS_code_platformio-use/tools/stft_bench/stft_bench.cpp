@@ -0,0 +1,233 @@
+// Throughput of the streaming spectrogram front end against a straightforward
+// scalar implementation, on a synthetic 48 kHz session.
+//
+//   pio run -e stft_bench
+//   .pio/build/stft_bench/program [--seconds S] [--fft N] [--hop N] [--mel N] [--block N] [--seed N]
+//
+// Options:
+//   --seconds S   session length (default 300)
+//   --fft N       frame size, a power of two (default 1024)
+//   --hop N       frame advance (default 256)
+//   --mel N       mel bands, 0 for bin powers (default 40)
+//   --block N     samples per process() call, as an audio callback hands
+//                 them over (default 4800)
+//   --seed N      synthetic session (default 1)
+//
+// The session is generated up front so only the front ends are timed. The
+// scalar reference does what a first version would: it appends each block to
+// a history buffer, copies every frame out of it, windows it, runs a complex
+// FFT of the real frame with twiddles from a recurrence, and applies the mel
+// filters as a dense bands x bins matrix. Both produce log mel energies; the
+// check compares their linear energies, and the run fails (exit status 1)
+// when a band differs from the reference by more than 1e-4 of its frame's
+// largest band or the frame counts differ.
+
+#include "click_synth.h"
+#include "spectrogram.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+constexpr double MAX_RELATIVE_ERROR = 1e-4;
+
+using Clock = std::chrono::steady_clock;
+
+class ScalarSpectrogram {
+ public:
+  explicit ScalarSpectrogram(const SpectrogramConfig& config) : config(config) {
+    const size_t size = config.fftSize;
+    for (size_t i = 0; i < size; i++) {
+      window.push_back(static_cast<float>(0.5 - 0.5 * std::cos(2.0 * M_PI * i / size)));
+    }
+    // The same triangles as Spectrogram, held dense
+    const size_t bins = size / 2 + 1;
+    const double top = config.maxHz > 0 ? config.maxHz : config.sampleRate / 2;
+    const double low = 2595.0 * std::log10(1.0 + config.minHz / 700.0);
+    const double high = 2595.0 * std::log10(1.0 + top / 700.0);
+    std::vector<double> edges;
+    for (size_t b = 0; b < config.melBands + 2; b++) {
+      const double mel = low + (high - low) * b / (config.melBands + 1);
+      edges.push_back(static_cast<float>(700.0 * (std::pow(10.0, mel / 2595.0) - 1.0)));
+    }
+    filters.assign(config.melBands * bins, 0.0f);
+    for (size_t b = 0; b < config.melBands; b++) {
+      for (size_t k = 0; k < bins; k++) {
+        const double hz = k * static_cast<double>(config.sampleRate) / size;
+        if (hz > edges[b] && hz < edges[b + 2]) {
+          filters[b * bins + k] = static_cast<float>(hz < edges[b + 1] ? (hz - edges[b]) / (edges[b + 1] - edges[b])
+                                                                       : (edges[b + 2] - hz) / (edges[b + 2] - edges[b + 1]));
+        }
+      }
+    }
+  }
+
+  size_t frameValues() const { return config.melBands > 0 ? config.melBands : config.fftSize / 2 + 1; }
+
+  size_t process(const float* x, size_t n, float* out) {
+    history.insert(history.end(), x, x + n);
+    size_t written = 0;
+    while (next + config.fftSize <= history.size()) {
+      std::vector<float> frame(history.begin() + next, history.begin() + next + config.fftSize);
+      frameValuesOf(frame, out + written * frameValues());
+      next += config.hop;
+      written++;
+    }
+    history.erase(history.begin(), history.begin() + next);
+    next = 0;
+    return written;
+  }
+
+ private:
+  void frameValuesOf(const std::vector<float>& frame, float* out) const {
+    const size_t size = config.fftSize;
+    std::vector<std::complex<float>> z(size);
+    for (size_t i = 0; i < size; i++) {
+      z[i] = frame[i] * window[i];
+    }
+    for (size_t i = 1, j = 0; i < size; i++) {
+      size_t bit = size >> 1;
+      for (; j & bit; bit >>= 1) {
+        j ^= bit;
+      }
+      j ^= bit;
+      if (i < j) {
+        std::swap(z[i], z[j]);
+      }
+    }
+    for (size_t length = 2; length <= size; length *= 2) {
+      // In double: a float recurrence drifts by hundreds of ulps over a stage
+      const std::complex<double> step = std::polar(1.0, -2.0 * M_PI / length);
+      for (size_t block = 0; block < size; block += length) {
+        std::complex<double> w(1.0, 0.0);
+        for (size_t j = 0; j < length / 2; j++) {
+          const std::complex<float> u = z[block + j], t = std::complex<float>(w) * z[block + j + length / 2];
+          z[block + j] = u + t;
+          z[block + j + length / 2] = u - t;
+          w *= step;
+        }
+      }
+    }
+    const size_t bins = size / 2 + 1;
+    std::vector<float> power(bins);
+    for (size_t k = 0; k < bins; k++) {
+      power[k] = std::norm(z[k]);
+    }
+    for (size_t b = 0; b < frameValues(); b++) {
+      float e = power[b];
+      if (config.melBands > 0) {
+        e = 0;
+        for (size_t k = 0; k < bins; k++) {
+          e += filters[b * bins + k] * power[k];
+        }
+      }
+      out[b] = config.logScale ? std::log(e + SPECTROGRAM_LOG_FLOOR) : e;
+    }
+  }
+
+  SpectrogramConfig config;
+  std::vector<float> window;
+  std::vector<float> filters;  // [band][bin]
+  std::vector<float> history;
+  size_t next = 0;
+};
+
+// Runs a front end over the session in blocks; returns seconds spent in process()
+template <typename FrontEnd>
+static double run(FrontEnd& frontEnd, const std::vector<float>& audio, size_t blockSamples, std::vector<float>& out,
+                  size_t& frames) {
+  frames = 0;
+  const Clock::time_point start = Clock::now();
+  for (size_t i = 0; i < audio.size(); i += blockSamples) {
+    const size_t n = std::min(blockSamples, audio.size() - i);
+    frames += frontEnd.process(&audio[i], n, &out[frames * frontEnd.frameValues()]);
+  }
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static int usage(const char* program) {
+  std::fprintf(stderr, "usage: %s [--seconds S] [--fft N] [--hop N] [--mel N] [--block N] [--seed N]\n", program);
+  return 2;
+}
+
+int main(int argc, char** argv) {
+  SynthConfig synth;
+  synth.seconds = 300;
+  synth.knocksPerSecond = 0.5f;
+  SpectrogramConfig config;
+  size_t blockSamples = 4800;
+  for (int i = 1; i < argc; i++) {
+    if (i + 1 < argc && std::strcmp(argv[i], "--seconds") == 0) {
+      synth.seconds = std::atof(argv[++i]);
+    } else if (i + 1 < argc && std::strcmp(argv[i], "--fft") == 0) {
+      config.fftSize = std::strtoul(argv[++i], nullptr, 10);
+    } else if (i + 1 < argc && std::strcmp(argv[i], "--hop") == 0) {
+      config.hop = std::strtoul(argv[++i], nullptr, 10);
+    } else if (i + 1 < argc && std::strcmp(argv[i], "--mel") == 0) {
+      config.melBands = std::strtoul(argv[++i], nullptr, 10);
+    } else if (i + 1 < argc && std::strcmp(argv[i], "--block") == 0) {
+      blockSamples = std::strtoul(argv[++i], nullptr, 10);
+    } else if (i + 1 < argc && std::strcmp(argv[i], "--seed") == 0) {
+      synth.seed = std::strtoull(argv[++i], nullptr, 10);
+    } else {
+      return usage(argv[0]);
+    }
+  }
+  const bool powerOfTwo = config.fftSize >= 4 && (config.fftSize & (config.fftSize - 1)) == 0;
+  if (!powerOfTwo || config.hop == 0 || config.hop > config.fftSize || blockSamples == 0 || synth.seconds <= 0) {
+    return usage(argv[0]);
+  }
+
+  ClickSynth source(synth);
+  std::vector<float> audio(source.totalSamples());
+  for (size_t done = 0; done < audio.size();) {
+    const size_t n = source.generate(&audio[done], audio.size() - done);
+    if (n == 0) {
+      break;
+    }
+    done += n;
+  }
+  const double seconds = audio.size() / static_cast<double>(synth.sampleRate);
+
+  Spectrogram spectrogram(config);
+  ScalarSpectrogram scalar(config);
+  const size_t values = spectrogram.frameValues();
+  const size_t capacity = audio.size() / config.hop + 1;
+  std::vector<float> vectorOut(capacity * values), scalarOut(capacity * values);
+  size_t vectorFrames = 0, scalarFrames = 0;
+  const double vectorSeconds = run(spectrogram, audio, blockSamples, vectorOut, vectorFrames);
+  const double scalarSeconds = run(scalar, audio, blockSamples, scalarOut, scalarFrames);
+
+  std::printf("%.0f s at %.0f Hz, fft %zu, hop %zu, %zu %s, blocks of %zu\n", seconds, synth.sampleRate,
+              config.fftSize, config.hop, values, config.melBands > 0 ? "mel bands" : "bins", blockSamples);
+  std::printf("%-8s %8zu frames  %8.1f ms  %6.2f us/frame  %8.0fx real time\n", "vector", vectorFrames,
+              vectorSeconds * 1e3, vectorSeconds * 1e6 / vectorFrames, seconds / vectorSeconds);
+  std::printf("%-8s %8zu frames  %8.1f ms  %6.2f us/frame  %8.0fx real time\n", "scalar", scalarFrames,
+              scalarSeconds * 1e3, scalarSeconds * 1e6 / scalarFrames, seconds / scalarSeconds);
+  std::printf("speedup %.2fx\n", scalarSeconds / vectorSeconds);
+
+  // Compare linear energies, relative to each frame's largest
+  double worst = 0;
+  for (size_t f = 0; f < vectorFrames && f < scalarFrames; f++) {
+    const float* a = &vectorOut[f * values];
+    const float* b = &scalarOut[f * values];
+    double largest = 0;
+    for (size_t i = 0; i < values; i++) {
+      largest = std::max(largest, config.logScale ? std::exp(static_cast<double>(b[i])) : b[i]);
+    }
+    for (size_t i = 0; i < values && largest > 0; i++) {
+      const double x = config.logScale ? std::exp(static_cast<double>(a[i])) : a[i];
+      const double y = config.logScale ? std::exp(static_cast<double>(b[i])) : b[i];
+      worst = std::max(worst, std::fabs(x - y) / largest);
+    }
+  }
+  std::printf("worst difference %.2e of the frame's largest value (max %.0e)\n", worst, MAX_RELATIVE_ERROR);
+  const bool pass = vectorFrames == scalarFrames && worst <= MAX_RELATIVE_ERROR;
+  std::printf("%s\n", pass ? "PASS" : "FAIL");
+  return pass ? 0 : 1;
+}
@@ -0,0 +1,42 @@
+#!/bin/sh
+# Runs the golden step-trace suite: builds every motion-profile configuration
+# on the native HAL, runs the same scenario on each through pump_sim and checks
+# the pulse metrics against tools/trace_suite/golden/ (see trace_suite.cpp).
+#
+#   tools/trace_suite/run_suite.sh [--update] [--verbose]
+#
+# Every configuration runs two scenarios, each a 12 s session at the
+# variant's own heart rate that is aborted during the eleventh beat, so it
+# also ramps down and homes from mid-stroke: at 10.1 s (baselines NAME.txt),
+# and 5 ms after the beat's motion starts (NAME_early_abort.txt), which is
+# inside the systole's acceleration of every ramp variant. Traces and
+# report.json are left in .pio/trace_suite/.
+# --update rewrites the baselines from this run; commit them with the change
+# that moved them.
+set -e
+cd "$(dirname "$0")/../.."
+
+# suffix:abort time
+SCENARIOS=":10.1 _early_abort:10.005"
+OUT=.pio/trace_suite
+
+# name:environment
+CONFIGS="main:native 100ml_sv:native_100ml_sv sinusoidal:native_sinusoidal live_ramp:native_live_ramp waveform:native_waveform"
+
+ENVS="-e trace_suite"
+for config in $CONFIGS; do
+  ENVS="$ENVS -e ${config#*:}"
+done
+pio run -s $ENVS
+
+mkdir -p "$OUT"
+TRACES=""
+for config in $CONFIGS; do
+  env=${config#*:}
+  for scenario in $SCENARIOS; do
+    name=${config%%:*}${scenario%%:*}
+    ".pio/build/$env/program" --seconds 12 --command-at "${scenario#*:}" 0a --trace "$OUT/$name.trace" > "$OUT/$name.log"
+    TRACES="$TRACES $name=$OUT/$name.trace"
+  done
+done
+.pio/build/trace_suite/program --report "$OUT/report.json" "$@" $TRACES
@@ -0,0 +1,388 @@
+// Golden step-trace check: reduces pump_sim traces to pulse metrics and
+// compares them with checked-in baselines.
+//
+//   pio run -e trace_suite
+//   .pio/build/trace_suite/program [--golden DIR] [--report FILE] [--update] [--verbose] NAME=TRACE...
+//
+// tools/trace_suite/run_suite.sh builds every motion-profile configuration,
+// runs the same scenario on each and hands the traces to this tool; that is
+// the normal way in.
+//
+// A trace is pump_sim --trace output: "S <us> <+1|-1>" per STEP pulse and
+// "T <us> <state>" per state transition. A beat runs from one entry into
+// SYSTOLE_ACCEL or WAVEFORM_PLAYBACK to the next; homing is any time spent in
+// RETURN_TO_START, SHUTDOWN or RETURN_TO_MANUAL_POSITION. Per configuration:
+//   steps, final_position, beats          counts, exact
+//   beat_period_us, beat_jitter_us        first pulse to first pulse, mean and
+//                                         worst deviation from it
+//   systole_us, diastole_us, ratio        first to last clockwise (counter-
+//                                         clockwise) pulse of a complete beat,
+//                                         i.e. one that ends where it started
+//   peak_rate                             fastest pulse pair of any beat, steps/s
+//   stop_rate                             last pulse pair of the last beat,
+//                                         steps/s; an aborted beat must have
+//                                         ramped down to it
+//   reversal_gap_us                       last clockwise to first counter-
+//                                         clockwise pulse, mean
+//   beat_gap_us                           last pulse of a beat to the first of
+//                                         the next, mean
+//   homing_us, homing_steps, homing_peak_rate
+//   session_us                            until HOLD_POSITION
+//
+// Baselines are DIR/NAME.txt, one "metric value tolerance" line per metric; a
+// metric passes when it is within the tolerance of the value. --update writes
+// the measured values, keeping the tolerance of metrics the baseline already
+// has and giving new ones DEFAULT_TOLERANCES. The report is JSON, one object
+// per configuration. Exit status 0 when every configuration passes, 1 when one
+// fails or has no baseline, 2 on bad arguments.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+struct Metric {
+  std::string name;
+  double value;
+};
+
+struct DefaultTolerance {
+  const char* name;
+  double relative;  // Of the measured value
+  double minimum;
+};
+
+// Counts must match; times and rates may move by a fraction, so a deliberate
+// retune shows up while rounding in the ramp arithmetic does not
+static const DefaultTolerance DEFAULT_TOLERANCES[] = {
+    {"steps", 0, 0},
+    {"final_position", 0, 0},
+    {"beats", 0, 0},
+    {"beat_period_us", 0.001, 1},
+    {"beat_jitter_us", 0, 50},
+    {"systole_us", 0.002, 1},
+    {"diastole_us", 0.002, 1},
+    {"systole_diastole_ratio", 0.002, 0},
+    {"peak_rate", 0.005, 1},
+    {"stop_rate", 0.005, 1},
+    {"reversal_gap_us", 0.01, 5},
+    {"beat_gap_us", 0.002, 5},
+    {"homing_us", 0.002, 5},
+    {"homing_steps", 0, 0},
+    {"homing_peak_rate", 0.005, 1},
+    {"session_us", 0.001, 5},
+};
+
+struct Pulse {
+  uint64_t micros;
+  int delta;  // -1 clockwise
+};
+
+struct Beat {
+  std::vector<Pulse> pulses;
+};
+
+static bool isBeatStart(const char* state) {
+  return std::strcmp(state, "SYSTOLE_ACCEL") == 0 || std::strcmp(state, "WAVEFORM_PLAYBACK") == 0;
+}
+
+static bool isBeatState(const char* state) {
+  return isBeatStart(state) || std::strncmp(state, "SYSTOLE_", 8) == 0 || std::strncmp(state, "DIASTOLE_", 9) == 0;
+}
+
+static bool isHomingState(const char* state) {
+  return std::strcmp(state, "RETURN_TO_START") == 0 || std::strcmp(state, "SHUTDOWN") == 0 ||
+         std::strcmp(state, "RETURN_TO_MANUAL_POSITION") == 0;
+}
+
+static double mean(const std::vector<double>& values) {
+  double sum = 0;
+  for (double v : values) {
+    sum += v;
+  }
+  return values.empty() ? 0 : sum / values.size();
+}
+
+// Reduces one trace to its metrics; false when it cannot be read
+static bool measure(const char* path, std::vector<Metric>& metrics) {
+  FILE* trace = std::fopen(path, "r");
+  if (trace == nullptr) {
+    std::perror(path);
+    return false;
+  }
+  std::vector<Beat> beats;
+  char state[64] = "";
+  uint64_t stateSince = 0, sessionEnd = 0, homingMicros = 0, homingSteps = 0;
+  uint64_t lastHomingPulse = 0, homingMinInterval = UINT64_MAX, steps = 0;
+  long position = 0;
+  bool homingPulseBefore = false;
+  char line[128];
+  while (std::fgets(line, sizeof(line), trace) != nullptr) {
+    unsigned long long micros = 0;
+    int delta = 0;
+    char name[64];
+    if (std::sscanf(line, "S %llu %d", &micros, &delta) == 2) {
+      steps++;
+      position += delta;
+      if (isBeatState(state) && !beats.empty()) {
+        beats.back().pulses.push_back({micros, delta});
+      } else if (isHomingState(state)) {
+        homingSteps++;
+        if (homingPulseBefore) {
+          homingMinInterval = std::min<uint64_t>(homingMinInterval, micros - lastHomingPulse);
+        }
+        lastHomingPulse = micros;
+        homingPulseBefore = true;
+      }
+    } else if (std::sscanf(line, "T %llu %63s", &micros, name) == 2) {
+      if (isHomingState(state)) {
+        homingMicros += micros - stateSince;
+      }
+      if (isBeatStart(name)) {
+        beats.emplace_back();
+      }
+      if (!isHomingState(name)) {
+        homingPulseBefore = false;  // Peak rate within one move only
+      }
+      if (std::strcmp(name, "HOLD_POSITION") == 0 && sessionEnd == 0) {
+        sessionEnd = micros;
+      }
+      std::snprintf(state, sizeof(state), "%s", name);
+      stateSince = micros;
+    } else {
+      std::fprintf(stderr, "%s: not a pump_sim trace line: %s", path, line);
+      std::fclose(trace);
+      return false;
+    }
+  }
+  std::fclose(trace);
+
+  std::vector<double> periods, systoles, diastoles, reversalGaps, beatGaps;
+  uint64_t minInterval = UINT64_MAX, stopInterval = 0;
+  for (size_t b = 0; b < beats.size(); b++) {
+    const std::vector<Pulse>& pulses = beats[b].pulses;
+    if (pulses.empty()) {
+      continue;
+    }
+    if (b + 1 < beats.size() && !beats[b + 1].pulses.empty()) {
+      periods.push_back(static_cast<double>(beats[b + 1].pulses.front().micros - pulses.front().micros));
+      beatGaps.push_back(static_cast<double>(beats[b + 1].pulses.front().micros - pulses.back().micros));
+    }
+    if (pulses.size() > 1) {
+      stopInterval = pulses.back().micros - pulses[pulses.size() - 2].micros;
+    }
+    long net = 0;
+    uint64_t cwFirst = UINT64_MAX, cwLast = 0, ccwFirst = UINT64_MAX, ccwLast = 0;
+    bool reversalSeen = false;
+    for (size_t i = 0; i < pulses.size(); i++) {
+      const Pulse& p = pulses[i];
+      net += p.delta;
+      if (p.delta < 0) {
+        cwFirst = std::min(cwFirst, p.micros);
+        cwLast = std::max(cwLast, p.micros);
+      } else {
+        ccwFirst = std::min(ccwFirst, p.micros);
+        ccwLast = std::max(ccwLast, p.micros);
+      }
+      if (i > 0 && pulses[i - 1].delta == p.delta) {
+        minInterval = std::min(minInterval, p.micros - pulses[i - 1].micros);
+      } else if (i > 0 && !reversalSeen && pulses[i - 1].delta < 0) {
+        reversalGaps.push_back(static_cast<double>(p.micros - pulses[i - 1].micros));
+        reversalSeen = true;
+      }
+    }
+    if (net == 0 && cwLast != 0 && ccwLast != 0) {
+      systoles.push_back(static_cast<double>(cwLast - cwFirst));
+      diastoles.push_back(static_cast<double>(ccwLast - ccwFirst));
+    }
+  }
+  const double period = mean(periods);
+  double jitter = 0;
+  for (double p : periods) {
+    jitter = std::max(jitter, std::fabs(p - period));
+  }
+  const double systole = mean(systoles), diastole = mean(diastoles);
+
+  metrics = {
+      {"steps", static_cast<double>(steps)},
+      {"final_position", static_cast<double>(position)},
+      {"beats", static_cast<double>(beats.size())},
+      {"beat_period_us", period},
+      {"beat_jitter_us", jitter},
+      {"systole_us", systole},
+      {"diastole_us", diastole},
+      {"systole_diastole_ratio", diastole > 0 ? systole / diastole : 0},
+      {"peak_rate", minInterval != UINT64_MAX ? 1e6 / minInterval : 0},
+      {"stop_rate", stopInterval != 0 ? 1e6 / stopInterval : 0},
+      {"reversal_gap_us", mean(reversalGaps)},
+      {"beat_gap_us", mean(beatGaps)},
+      {"homing_us", static_cast<double>(homingMicros)},
+      {"homing_steps", static_cast<double>(homingSteps)},
+      {"homing_peak_rate", homingMinInterval != UINT64_MAX ? 1e6 / homingMinInterval : 0},
+      {"session_us", static_cast<double>(sessionEnd)},
+  };
+  return true;
+}
+
+struct Baseline {
+  double value;
+  double tolerance;
+};
+
+// Reads DIR/NAME.txt; false when it does not exist
+static bool readBaseline(const std::string& path, std::map<std::string, Baseline>& baseline) {
+  FILE* file = std::fopen(path.c_str(), "r");
+  if (file == nullptr) {
+    return false;
+  }
+  char line[256];
+  while (std::fgets(line, sizeof(line), file) != nullptr) {
+    char name[64];
+    double value = 0, tolerance = 0;
+    if (line[0] != '#' && std::sscanf(line, "%63s %lf %lf", name, &value, &tolerance) == 3) {
+      baseline[name] = {value, tolerance};
+    }
+  }
+  std::fclose(file);
+  return true;
+}
+
+static bool writeBaseline(const std::string& path, const std::string& name, const std::vector<Metric>& metrics,
+                          const std::map<std::string, Baseline>& previous) {
+  FILE* file = std::fopen(path.c_str(), "w");
+  if (file == nullptr) {
+    std::perror(path.c_str());
+    return false;
+  }
+  std::fprintf(file, "# Golden step-trace metrics for %s (tools/trace_suite/run_suite.sh --update)\n", name.c_str());
+  std::fprintf(file, "# metric value tolerance\n");
+  for (const Metric& m : metrics) {
+    double tolerance = 0;
+    const auto kept = previous.find(m.name);
+    if (kept != previous.end()) {
+      tolerance = kept->second.tolerance;
+    } else {
+      for (const DefaultTolerance& d : DEFAULT_TOLERANCES) {
+        if (m.name == d.name) {
+          tolerance = std::fabs(m.value) * d.relative;
+          tolerance = std::max(d.minimum, tolerance >= 1 ? std::ceil(tolerance) : tolerance);
+        }
+      }
+    }
+    std::fprintf(file, "%-24s %.10g %.10g\n", m.name.c_str(), m.value, tolerance);
+  }
+  std::fclose(file);
+  return true;
+}
+
+static int usage(const char* program) {
+  std::fprintf(stderr, "usage: %s [--golden DIR] [--report FILE] [--update] [--verbose] NAME=TRACE...\n", program);
+  return 2;
+}
+
+int main(int argc, char** argv) {
+  std::string goldenDir = "tools/trace_suite/golden";
+  const char* reportPath = nullptr;
+  bool update = false;
+  bool verbose = false;
+  std::vector<std::pair<std::string, std::string>> configs;
+  for (int i = 1; i < argc; i++) {
+    const char* equals = std::strchr(argv[i], '=');
+    if (std::strcmp(argv[i], "--golden") == 0 && i + 1 < argc) {
+      goldenDir = argv[++i];
+    } else if (std::strcmp(argv[i], "--report") == 0 && i + 1 < argc) {
+      reportPath = argv[++i];
+    } else if (std::strcmp(argv[i], "--update") == 0) {
+      update = true;
+    } else if (std::strcmp(argv[i], "--verbose") == 0) {
+      verbose = true;
+    } else if (argv[i][0] != '-' && equals != nullptr && equals != argv[i] && equals[1] != '\0') {
+      configs.emplace_back(std::string(argv[i], static_cast<size_t>(equals - argv[i])), equals + 1);
+    } else {
+      return usage(argv[0]);
+    }
+  }
+  if (configs.empty()) {
+    return usage(argv[0]);
+  }
+
+  FILE* report = nullptr;
+  if (reportPath != nullptr) {
+    report = std::fopen(reportPath, "w");
+    if (report == nullptr) {
+      std::perror(reportPath);
+      return 1;
+    }
+    std::fprintf(report, "{\"configurations\": [");
+  }
+  bool allPass = true;
+  for (size_t c = 0; c < configs.size(); c++) {
+    const std::string& name = configs[c].first;
+    const std::string goldenPath = goldenDir + "/" + name + ".txt";
+    std::vector<Metric> metrics;
+    if (!measure(configs[c].second.c_str(), metrics)) {
+      return 1;
+    }
+    std::map<std::string, Baseline> baseline;
+    const bool hasBaseline = readBaseline(goldenPath, baseline);
+    if (update && !writeBaseline(goldenPath, name, metrics, baseline)) {
+      return 1;
+    }
+
+    bool pass = hasBaseline || update;
+    size_t failed = 0;
+    if (report != nullptr) {
+      std::fprintf(report, "%s\n  {\"name\": \"%s\", \"trace\": \"%s\", \"baseline\": %s, \"metrics\": [", c ? "," : "",
+                   name.c_str(), configs[c].second.c_str(), hasBaseline ? "true" : "false");
+    }
+    for (size_t m = 0; m < metrics.size(); m++) {
+      const Metric& metric = metrics[m];
+      const auto golden = baseline.find(metric.name);
+      const bool known = golden != baseline.end();
+      const bool ok = update || (known && std::fabs(metric.value - golden->second.value) <= golden->second.tolerance);
+      if (!ok) {
+        pass = false;
+        failed++;
+      }
+      if (verbose || (!ok && known)) {
+        if (known) {
+          std::printf("  %-12s %-24s %14.3f  golden %14.3f +- %g%s\n", name.c_str(), metric.name.c_str(), metric.value,
+                      golden->second.value, golden->second.tolerance, ok ? "" : "  FAIL");
+        } else {
+          std::printf("  %-12s %-24s %14.3f  no baseline%s\n", name.c_str(), metric.name.c_str(), metric.value,
+                      ok ? "" : "  FAIL");
+        }
+      }
+      if (report != nullptr) {
+        std::fprintf(report, "%s\n    {\"metric\": \"%s\", \"value\": %.10g", m ? "," : "", metric.name.c_str(),
+                     metric.value);
+        if (known) {
+          std::fprintf(report, ", \"golden\": %.10g, \"tolerance\": %g", golden->second.value, golden->second.tolerance);
+        }
+        std::fprintf(report, ", \"pass\": %s}", ok ? "true" : "false");
+      }
+    }
+    if (report != nullptr) {
+      std::fprintf(report, "\n  ], \"pass\": %s}", pass ? "true" : "false");
+    }
+    if (update) {
+      std::printf("%-12s %s %s\n", name.c_str(), hasBaseline ? "updated" : "created", goldenPath.c_str());
+    } else if (!hasBaseline) {
+      std::printf("%-12s FAIL  no baseline %s (--update writes one)\n", name.c_str(), goldenPath.c_str());
+    } else {
+      std::printf("%-12s %s  %zu metrics, %zu outside tolerance\n", name.c_str(), pass ? "PASS" : "FAIL",
+                  metrics.size(), failed);
+    }
+    allPass = allPass && pass;
+  }
+  if (report != nullptr) {
+    std::fprintf(report, "\n], \"pass\": %s}\n", allPass ? "true" : "false");
+    std::fclose(report);
+  }
+  return allPass ? 0 : 1;
+}
@@ -0,0 +1,257 @@
+// Host compiler from a displacement-vs-time curve to a step-interval schedule.
+//
+// Input is a CSV of "time_s,displacement" samples covering one beat (a header
+// line and '#' comments are skipped). Displacement is in steps unless --scale
+// is given; positive is the systole (clockwise) direction and the curve is
+// taken relative to its first sample. The curve is linear between samples and
+// a step is emitted each time it crosses the midpoint between two step
+// positions, so the schedule tracks the curve to within half a step. Step
+// times are rounded once on the absolute time axis, so rounding never
+// accumulates over the beat; the beat ends with a dwell up to the last
+// sample's time, which fixes the beat period.
+//
+// Intervals shorter than MIN_STEP_INTERVAL_US cannot be played and are
+// stretched to it; the report says how many and how far the schedule then
+// lags the curve.
+//
+//   pio run -e waveform_compiler
+//   .pio/build/waveform_compiler/program curve.csv --name AORTIC_FLOW [--scale S] [-o out.h]
+//   .pio/build/waveform_compiler/program curve.csv --bench 10000
+
+#include "step_timer.h"
+#include "waveform.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+struct Sample {
+  double seconds;
+  double steps;
+};
+
+struct CompileReport {
+  unsigned long steps = 0;
+  unsigned long dwells = 0;
+  unsigned long clamped = 0;
+  long netSteps = 0;
+  unsigned long shortestIntervalMicros = 0;
+  double maxLagMicros = 0;
+  double periodMicros = 0;
+};
+
+static bool readCsv(const char* path, double scale, std::vector<Sample>& samples) {
+  FILE* file = std::fopen(path, "r");
+  if (file == nullptr) {
+    std::perror(path);
+    return false;
+  }
+  char line[256];
+  while (std::fgets(line, sizeof(line), file) != nullptr) {
+    const char* p = line;
+    while (std::isspace(static_cast<unsigned char>(*p))) {
+      p++;
+    }
+    if (*p == '#' || *p == '\0') {
+      continue;
+    }
+    char* end = nullptr;
+    const double seconds = std::strtod(p, &end);
+    if (end == p) {
+      continue;  // Header line
+    }
+    while (*end == ',' || std::isspace(static_cast<unsigned char>(*end))) {
+      end++;
+    }
+    const char* valueStart = end;
+    const double value = std::strtod(valueStart, &end);
+    if (end == valueStart) {
+      std::fprintf(stderr, "%s: malformed line: %s", path, line);
+      std::fclose(file);
+      return false;
+    }
+    if (!samples.empty() && seconds <= samples.back().seconds) {
+      std::fprintf(stderr, "%s: time must increase (%g after %g)\n", path, seconds, samples.back().seconds);
+      std::fclose(file);
+      return false;
+    }
+    samples.push_back({seconds, value * scale});
+  }
+  std::fclose(file);
+  if (samples.size() < 2) {
+    std::fprintf(stderr, "%s: need at least two samples\n", path);
+    return false;
+  }
+  return true;
+}
+
+// Appends dwells and, if `pulse`, a final step so that `gap` microseconds pass
+static void emitGap(std::vector<uint16_t>& schedule, unsigned long gap, bool pulse, bool clockwise,
+                    CompileReport& report) {
+  const unsigned long pieces = (gap + WAVEFORM_MAX_INTERVAL_US - 1) / WAVEFORM_MAX_INTERVAL_US;
+  for (unsigned long i = 0; i < pieces; i++) {
+    // Split evenly so no piece falls below the step timer's floor
+    const unsigned long piece = gap / pieces + (i < gap % pieces ? 1 : 0);
+    if (pulse && i + 1 == pieces) {
+      schedule.push_back(makeWaveformStep(clockwise, static_cast<uint16_t>(piece)));
+    } else {
+      schedule.push_back(makeWaveformDwell(static_cast<uint16_t>(piece)));
+      report.dwells++;
+    }
+  }
+}
+
+static CompileReport compileWaveform(const std::vector<Sample>& samples, std::vector<uint16_t>& schedule) {
+  CompileReport report;
+  schedule.clear();
+  const double t0 = samples.front().seconds;
+  const double x0 = samples.front().steps;
+  long position = 0;
+  unsigned long lastMicros = 0;  // Time of the previous entry as the firmware will play it
+  report.shortestIntervalMicros = ~0UL;
+
+  auto emitStep = [&](double seconds, int direction) {
+    const double ideal = (seconds - t0) * 1e6;
+    unsigned long at = static_cast<unsigned long>(std::llround(ideal));
+    if (at < lastMicros + MIN_STEP_INTERVAL_US) {
+      at = lastMicros + MIN_STEP_INTERVAL_US;
+      report.clamped++;
+    }
+    report.maxLagMicros = std::max(report.maxLagMicros, at - ideal);
+    const unsigned long gap = at - lastMicros;
+    report.shortestIntervalMicros = std::min(report.shortestIntervalMicros, gap);
+    emitGap(schedule, gap, true, direction > 0, report);
+    lastMicros = at;
+    position += direction;
+    report.steps++;
+  };
+
+  for (size_t i = 0; i + 1 < samples.size(); i++) {
+    const double a = samples[i].steps - x0;
+    const double b = samples[i + 1].steps - x0;
+    const double ta = samples[i].seconds;
+    const double dt = samples[i + 1].seconds - ta;
+    while (b >= position + 0.5) {
+      emitStep(ta + (position + 0.5 - a) / (b - a) * dt, 1);
+    }
+    while (b <= position - 0.5) {
+      emitStep(ta + (position - 0.5 - a) / (b - a) * dt, -1);
+    }
+  }
+
+  // Dwell to the end of the beat so the period is the curve's
+  const unsigned long end = static_cast<unsigned long>(std::llround((samples.back().seconds - t0) * 1e6));
+  if (end >= lastMicros + MIN_STEP_INTERVAL_US) {
+    emitGap(schedule, end - lastMicros, false, false, report);
+    lastMicros = end;
+  }
+  report.netSteps = position;
+  report.periodMicros = lastMicros;
+  if (report.steps == 0) {
+    report.shortestIntervalMicros = 0;
+  }
+  return report;
+}
+
+static bool writeHeader(const char* path, const char* source, const std::string& name,
+                        const std::vector<uint16_t>& schedule) {
+  FILE* out = path != nullptr ? std::fopen(path, "w") : stdout;
+  if (out == nullptr) {
+    std::perror(path);
+    return false;
+  }
+  std::fprintf(out, "// Generated by tools/waveform_compiler from %s - do not edit\n", source);
+  std::fprintf(out, "#ifndef WAVEFORM_%s_H\n#define WAVEFORM_%s_H\n\n", name.c_str(), name.c_str());
+  std::fprintf(out, "#include \"../waveform.h\"\n\n");
+  std::fprintf(out, "constexpr uint16_t %s_SCHEDULE[] PROGMEM = {", name.c_str());
+  for (size_t i = 0; i < schedule.size(); i++) {
+    std::fprintf(out, "%s0x%04X,", i % 10 == 0 ? "\n    " : " ", schedule[i]);
+  }
+  std::fprintf(out, "\n};\n\n");
+  std::fprintf(out, "constexpr Waveform %s = {%s_SCHEDULE, %zu};\n\n", name.c_str(), name.c_str(), schedule.size());
+  std::fprintf(out, "#endif // WAVEFORM_%s_H\n", name.c_str());
+  if (out != stdout) {
+    std::fclose(out);
+  }
+  return true;
+}
+
+int main(int argc, char** argv) {
+  const char* input = nullptr;
+  const char* output = nullptr;
+  std::string name = "WAVEFORM";
+  double scale = 1.0;
+  long benchRuns = 0;
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--name") == 0 && i + 1 < argc) {
+      name = argv[++i];
+    } else if (std::strcmp(argv[i], "--scale") == 0 && i + 1 < argc) {
+      scale = std::strtod(argv[++i], nullptr);
+    } else if (std::strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+      output = argv[++i];
+    } else if (std::strcmp(argv[i], "--bench") == 0 && i + 1 < argc) {
+      benchRuns = std::strtol(argv[++i], nullptr, 10);
+    } else if (input == nullptr && argv[i][0] != '-') {
+      input = argv[i];
+    } else {
+      input = nullptr;
+      break;
+    }
+  }
+  if (input == nullptr) {
+    std::fprintf(stderr, "usage: %s curve.csv [--name NAME] [--scale STEPS_PER_UNIT] [-o out.h] [--bench N]\n",
+                 argv[0]);
+    return 2;
+  }
+  for (char& c : name) {
+    c = std::isalnum(static_cast<unsigned char>(c)) ? std::toupper(static_cast<unsigned char>(c)) : '_';
+  }
+
+  std::vector<Sample> samples;
+  if (!readCsv(input, scale, samples)) {
+    return 1;
+  }
+  std::vector<uint16_t> schedule;
+  const CompileReport report = compileWaveform(samples, schedule);
+  if (schedule.size() > 0xFFFF) {
+    std::fprintf(stderr, "%s: %zu entries do not fit a Waveform\n", input, schedule.size());
+    return 1;
+  }
+
+  if (benchRuns > 0) {
+    // Perturb the amplitude per run, as a parameter sweep would
+    std::vector<Sample> candidate = samples;
+    unsigned long checksum = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (long run = 0; run < benchRuns; run++) {
+      const double gain = 0.9 + 0.2 * static_cast<double>(run % 100) / 100.0;
+      for (size_t i = 0; i < samples.size(); i++) {
+        candidate[i].steps = samples[i].steps * gain;
+      }
+      compileWaveform(candidate, schedule);
+      checksum += schedule.size();
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("%ld waveforms in %.3f s: %.1f us each, %.0f waveforms/s (checksum %lu)\n", benchRuns, seconds,
+                seconds / benchRuns * 1e6, benchRuns / seconds, checksum);
+    return 0;
+  }
+
+  if (!writeHeader(output, input, name, schedule)) {
+    return 1;
+  }
+  std::fprintf(stderr,
+               "%s: %zu entries (%lu steps, %lu dwells), %zu bytes of flash\n"
+               "  period %.1f ms, net %ld steps, shortest interval %lu us\n"
+               "  %lu intervals stretched to %u us, max lag behind curve %.1f us\n",
+               name.c_str(), schedule.size(), report.steps, report.dwells, schedule.size() * 2,
+               report.periodMicros / 1000.0, report.netSteps, report.shortestIntervalMicros, report.clamped,
+               MIN_STEP_INTERVAL_US, report.maxLagMicros);
+  return 0;
+}